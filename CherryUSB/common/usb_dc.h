@@ -49,6 +49,14 @@ int usbd_set_remote_wakeup(uint8_t busid);
  */
 uint8_t usbd_get_port_speed(uint8_t busid);
 
+/**
+ * @brief Mask or unmask the SOF interrupt (CONFIG_USBDEV_SOF_ENABLE only).
+ *
+ * @param[in] busid bus index
+ * @param[in] enable true to deliver USBD_EVENT_SOF every frame
+ */
+void usbd_set_sof_enable(uint8_t busid, bool enable);
+
 /**
  * @brief configure and enable endpoint.
  *
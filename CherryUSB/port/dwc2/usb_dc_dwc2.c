@@ -52,6 +52,8 @@
 #endif
 // clang-format on
 
+#include "usb_dwc2_fifo.h"
+
 #define USBD_BASE (g_usbdev_bus[busid].reg_base)
 
 #define USB_OTG_GLB      ((DWC2_GlobalTypeDef *)(USBD_BASE))
@@ -342,26 +344,12 @@ static void dwc2_ep0_start_read_setup(uint8_t busid, uint8_t *psetup)
 
 void dwc2_ep_write(uint8_t busid, uint8_t ep_idx, uint8_t *src, uint16_t len)
 {
-    uint32_t *pSrc = (uint32_t *)src;
-    uint32_t count32b, i;
-
-    count32b = ((uint32_t)len + 3U) / 4U;
-    for (i = 0U; i < count32b; i++) {
-        USB_OTG_FIFO((uint32_t)ep_idx) = __UNALIGNED_UINT32_READ(pSrc);
-        pSrc++;
-    }
+    dwc2_fifo_write(&USB_OTG_FIFO((uint32_t)ep_idx), src, len);
 }
 
 void dwc2_ep_read(uint8_t busid, uint8_t *dest, uint16_t len)
 {
-    uint32_t *pDest = (uint32_t *)dest;
-    uint32_t i;
-    uint32_t count32b = ((uint32_t)len + 3U) / 4U;
-
-    for (i = 0U; i < count32b; i++) {
-        __UNALIGNED_UINT32_WRITE(pDest, USB_OTG_FIFO(0U));
-        pDest++;
-    }
+    dwc2_fifo_read(&USB_OTG_FIFO(0U), dest, len);
 }
 
 static void dwc2_tx_fifo_empty_procecss(uint8_t busid, uint8_t ep_idx)
@@ -655,6 +643,17 @@ int usbd_set_remote_wakeup(uint8_t busid)
     return 0;
 }
 
+#ifdef CONFIG_USBDEV_SOF_ENABLE
+void usbd_set_sof_enable(uint8_t busid, bool enable)
+{
+    if (enable) {
+        USB_OTG_GLB->GINTMSK |= USB_OTG_GINTMSK_SOFM;
+    } else {
+        USB_OTG_GLB->GINTMSK &= ~USB_OTG_GINTMSK_SOFM;
+    }
+}
+#endif
+
 uint8_t usbd_get_port_speed(uint8_t busid)
 {
     uint8_t speed;
@@ -875,8 +874,8 @@ int usbd_ep_start_write(uint8_t busid, const uint8_t ep, const uint8_t *data, ui
     uint8_t ep_idx = USB_EP_GET_IDX(ep);
     uint32_t pktcnt = 0;
 
-    USB_ASSERT_MSG(!((uint32_t)data % 0x04), "dwc2 data must be 4-byte aligned");
-
+    /* slave mode copies through dwc2_fifo_write/read, which take any alignment;
+     * only the DMA engine needs aligned buffers */
     if (g_dwc2_udc[busid].user_params.device_dma_enable) {
         USB_ASSERT_MSG(!((uint32_t)data % CONFIG_USB_ALIGN_SIZE), "dwc2 data must be %d-byte aligned", CONFIG_USB_ALIGN_SIZE);
     }
@@ -952,8 +951,8 @@ int usbd_ep_start_read(uint8_t busid, const uint8_t ep, uint8_t *data, uint32_t
     uint8_t ep_idx = USB_EP_GET_IDX(ep);
     uint32_t pktcnt = 0;
 
-    USB_ASSERT_MSG(!((uint32_t)data % 0x04), "dwc2 data must be 4-byte aligned");
-
+    /* slave mode copies through dwc2_fifo_write/read, which take any alignment;
+     * only the DMA engine needs aligned buffers */
     if (g_dwc2_udc[busid].user_params.device_dma_enable) {
         USB_ASSERT_MSG(!((uint32_t)data % CONFIG_USB_ALIGN_SIZE), "dwc2 data must be %d-byte aligned", CONFIG_USB_ALIGN_SIZE);
     }
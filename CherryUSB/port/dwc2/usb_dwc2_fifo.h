@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2022, sakumisu
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __USB_DWC2_FIFO_H__
+#define __USB_DWC2_FIFO_H__
+
+#include <stdint.h>
+
+/* Packet copy between a buffer and a dwc2 data FIFO window.
+ *
+ * Shared by usb_dc_dwc2.c and the host benchmark (Tools/host/fifo_bench.c).
+ * The includer provides __IO and __UNALIGNED_UINT32_READ/WRITE.
+ *
+ * DWC2_FIFO_WR/DWC2_FIFO_RD access word i of the window. They default to
+ * plain volatile accesses; the host model overrides them with a software fifo
+ * to check word order. The ARMv7-M LDM/STM bursts bypass them.
+ */
+#ifndef DWC2_FIFO_WR
+#define DWC2_FIFO_WR(fifo, i, v) ((fifo)[i] = (v))
+#endif
+#ifndef DWC2_FIFO_RD
+#define DWC2_FIFO_RD(fifo, i) ((fifo)[i])
+#endif
+
+/* Every word address inside the 4KB FIFO window pushes/pops the same fifo,
+ * so an aligned buffer can be moved with LDM/STM bursts of four words.
+ * The scratch registers are left to the compiler (r7 may be the frame
+ * pointer); LDM and STM both pair the lowest register with the lowest
+ * address, so word order holds whatever registers it picks.
+ */
+#if defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+#define DWC2_FIFO_BURST_ASM
+#endif
+
+static inline void dwc2_fifo_write_aligned(__IO uint32_t *fifo, const uint32_t *src, uint32_t count32b)
+{
+    while (count32b >= 4U) {
+#ifdef DWC2_FIFO_BURST_ASM
+        uint32_t w0, w1, w2, w3;
+
+        __asm volatile("ldmia %0!, {%1, %2, %3, %4}\n\t"
+                       "stmia %5, {%1, %2, %3, %4}"
+                       : "+r"(src), "=&r"(w0), "=&r"(w1), "=&r"(w2), "=&r"(w3)
+                       : "r"(fifo)
+                       : "memory");
+#else
+        DWC2_FIFO_WR(fifo, 0, src[0]);
+        DWC2_FIFO_WR(fifo, 1, src[1]);
+        DWC2_FIFO_WR(fifo, 2, src[2]);
+        DWC2_FIFO_WR(fifo, 3, src[3]);
+        src += 4;
+#endif
+        count32b -= 4U;
+    }
+
+    while (count32b--) {
+        DWC2_FIFO_WR(fifo, 0, *src++);
+    }
+}
+
+static inline void dwc2_fifo_write_unaligned(__IO uint32_t *fifo, const uint8_t *src, uint32_t count32b)
+{
+    while (count32b >= 4U) {
+        DWC2_FIFO_WR(fifo, 0, __UNALIGNED_UINT32_READ(src));
+        DWC2_FIFO_WR(fifo, 1, __UNALIGNED_UINT32_READ(src + 4));
+        DWC2_FIFO_WR(fifo, 2, __UNALIGNED_UINT32_READ(src + 8));
+        DWC2_FIFO_WR(fifo, 3, __UNALIGNED_UINT32_READ(src + 12));
+        src += 16;
+        count32b -= 4U;
+    }
+
+    while (count32b--) {
+        DWC2_FIFO_WR(fifo, 0, __UNALIGNED_UINT32_READ(src));
+        src += 4;
+    }
+}
+
+static inline void dwc2_fifo_read_aligned(__IO uint32_t *fifo, uint32_t *dest, uint32_t count32b)
+{
+    while (count32b >= 4U) {
+#ifdef DWC2_FIFO_BURST_ASM
+        uint32_t w0, w1, w2, w3;
+
+        __asm volatile("ldmia %5, {%1, %2, %3, %4}\n\t"
+                       "stmia %0!, {%1, %2, %3, %4}"
+                       : "+r"(dest), "=&r"(w0), "=&r"(w1), "=&r"(w2), "=&r"(w3)
+                       : "r"(fifo)
+                       : "memory");
+#else
+        dest[0] = DWC2_FIFO_RD(fifo, 0);
+        dest[1] = DWC2_FIFO_RD(fifo, 1);
+        dest[2] = DWC2_FIFO_RD(fifo, 2);
+        dest[3] = DWC2_FIFO_RD(fifo, 3);
+        dest += 4;
+#endif
+        count32b -= 4U;
+    }
+
+    while (count32b--) {
+        *dest++ = DWC2_FIFO_RD(fifo, 0);
+    }
+}
+
+static inline void dwc2_fifo_read_unaligned(__IO uint32_t *fifo, uint8_t *dest, uint32_t count32b)
+{
+    while (count32b >= 4U) {
+        __UNALIGNED_UINT32_WRITE(dest, DWC2_FIFO_RD(fifo, 0));
+        __UNALIGNED_UINT32_WRITE(dest + 4, DWC2_FIFO_RD(fifo, 1));
+        __UNALIGNED_UINT32_WRITE(dest + 8, DWC2_FIFO_RD(fifo, 2));
+        __UNALIGNED_UINT32_WRITE(dest + 12, DWC2_FIFO_RD(fifo, 3));
+        dest += 16;
+        count32b -= 4U;
+    }
+
+    while (count32b--) {
+        __UNALIGNED_UINT32_WRITE(dest, DWC2_FIFO_RD(fifo, 0));
+        dest += 4;
+    }
+}
+
+/* Push len bytes. The tail word may read up to 3 bytes past src, the core
+ * only sends len bytes.
+ */
+static inline void dwc2_fifo_write(__IO uint32_t *fifo, const uint8_t *src, uint16_t len)
+{
+    uint32_t count32b = ((uint32_t)len + 3U) / 4U;
+
+    if (((uintptr_t)src & 0x3U) == 0U) {
+        dwc2_fifo_write_aligned(fifo, (const uint32_t *)src, count32b);
+    } else {
+        dwc2_fifo_write_unaligned(fifo, src, count32b);
+    }
+}
+
+/* Pop len bytes, never writing past dest + len. */
+static inline void dwc2_fifo_read(__IO uint32_t *fifo, uint8_t *dest, uint16_t len)
+{
+    uint32_t count32b = (uint32_t)len / 4U;
+    uint32_t remain = (uint32_t)len & 0x3U;
+    uint32_t tail;
+
+    if (((uintptr_t)dest & 0x3U) == 0U) {
+        dwc2_fifo_read_aligned(fifo, (uint32_t *)dest, count32b);
+    } else {
+        dwc2_fifo_read_unaligned(fifo, dest, count32b);
+    }
+
+    /* pop the last partial word without writing past the end of dest */
+    if (remain) {
+        dest += count32b * 4U;
+        tail = DWC2_FIFO_RD(fifo, 0);
+        while (remain--) {
+            *dest++ = (uint8_t)tail;
+            tail >>= 8;
+        }
+    }
+}
+
+#endif /* __USB_DWC2_FIFO_H__ */
@@ -14,6 +14,168 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
+#include "lz_stream.h"
+
+/*****************************************************************************
+ * 端口配置
+ *****************************************************************************/
+
+/*
+ * 同时工作的 USB 内核数量，每个内核是主机上一个独立的 USB 设备
+ *
+ * - 1: 所有端口在同一个内核上，cdc_acm_init() 调用一次
+ * - 2: OTG_FS 和 OTG_HS (内部FS PHY) 同时工作，每个内核一个 CDC 端口，各有自己的
+ *      缓冲区和统计。cdc_acm_init() 对每个内核调用一次，端口按调用顺序分配，
+ *      U 盘/厂商接口只在第一个内核上。需要 CONFIG_USBDEV_MAX_BUS >= 2
+ *
+ * 注意: 本板 PB15 接 LCD 背光 (LCD_BL, 低电平点亮)，OTG_HS 占用 PB14/PB15 后
+ *       背光不再受 GPIO 控制，需要把背光改接为常亮
+ */
+#ifndef CDC_ACM_BUS_NUM
+#define CDC_ACM_BUS_NUM      1
+#endif
+
+/*
+ * CDC ACM 端口总数
+ *
+ * 每个 CDC ACM 端口占用 2 个 IN 端点（批量 + 中断）和 1 个 OUT 端点：
+ * - OTG_FS  (PA11/PA12): 只有 EP1~EP3，最多 1 个端口
+ * - OTG_HS  (PB14/PB15, 内部FS PHY): 有 EP1~EP5，最多 2 个端口
+ *
+ * 同一内核上的端口0: IN 0x81 / OUT 0x02 / INT 0x83
+ * 同一内核上的端口1: IN 0x82 / OUT 0x01 / INT 0x84
+ *
+ * 所以 FS 内核做不成多端口复合设备 (3 个端口需要 6 个 IN 端点，两个内核都没有)。
+ * 可用的多端口配置:
+ * - CDC_ACM_PORT_NUM=2:                    两个端口都在 OTG_HS 上 (应用用 HS 基址初始化)
+ * - CDC_ACM_BUS_NUM=2 (CONFIG_USBDEV_MAX_BUS=2): 每个内核一个端口
+ * 两种配置都由 Tools/host 的 usb_sim_2port / usb_sim_2bus 在主机上测试
+ * (make check)，Tools/cdc_port_bench.py 测各端口和总吞吐。同一内核上的端口共享
+ * 一条 FS 总线的带宽 (约 1.2MB/s)，分在两个内核上才能叠加
+ */
+#ifndef CDC_ACM_PORT_NUM
+#define CDC_ACM_PORT_NUM     CDC_ACM_BUS_NUM
+#endif
+
+/* 每个内核上的端口数 */
+#define CDC_ACM_BUS_PORTS    (CDC_ACM_PORT_NUM / CDC_ACM_BUS_NUM)
+
+/* 不带端口参数的旧API所使用的端口 */
+#define CDC_ACM_PORT_DEFAULT 0
+
+/*
+ * cdc_acm_printf 的栈上格式化缓冲区大小，也是单次输出的长度上限
+ */
+#ifndef CDC_PRINTF_BUF_SIZE
+#define CDC_PRINTF_BUF_SIZE  128
+#endif
+
+/*
+ * 发送压缩: 打开后发送缓冲区的数据在交给IN端点前压缩成 lz_stream 块，主机用
+ * Tools/lz_stream_cat.py 解码。只有一个压缩器实例 (约 5KB，见 lz_stream.h)，
+ * 同一时刻只能用于一个端口。置 0 可省下这部分内存
+ */
+#ifndef CDC_TX_COMPRESS_ENABLE
+#define CDC_TX_COMPRESS_ENABLE 1
+#endif
+
+/*
+ * 收发环形缓冲区由应用提供: 置 1 时驱动不再静态分配 CDC_RX/TX_RINGBUF_SIZE 的缓冲区，
+ * 应用在 cdc_acm_init() 之前用 cdc_acm_port_set_buffers() 为每个端口指定
+ * (例如从 mem_arena 中划分)，运行时也可以重新划分。高优先级通道仍是静态的
+ */
+#ifndef CDC_RINGBUF_EXTERNAL
+#define CDC_RINGBUF_EXTERNAL 1
+#endif
+
+/* cdc_acm_port_set_buffers() 接受的大小: 2的幂，接收缓冲区至少放得下一次USB读取 */
+#define CDC_RINGBUF_MIN_RX   2048
+#define CDC_RINGBUF_MIN_TX   1024
+#define CDC_RINGBUF_MAX      32768
+
+/* 主机通过 SET_LINE_CODING 设置的串口参数 (取值同 CDC 规范) */
+typedef struct {
+    uint32_t baudrate;
+    uint8_t stopbits;   // 0: 1位, 1: 1.5位, 2: 2位
+    uint8_t parity;     // 0: 无, 1: 奇, 2: 偶, 3: Mark, 4: Space
+    uint8_t databits;   // 5, 6, 7, 8, 16
+} cdc_acm_line_coding_t;
+
+typedef void (*cdc_acm_line_coding_cb_t)(uint8_t port, const cdc_acm_line_coding_t *line_coding);
+
+/* 事件通知 (cdc_acm_set_event_callback)，可以按位组合 */
+#define CDC_ACM_EVENT_RX        0x01    // 收到数据
+#define CDC_ACM_EVENT_TX_DONE   0x02    // IN 传输完成
+#define CDC_ACM_EVENT_STATE     0x04    // 复位/配置/断开，DTR 变化
+
+typedef void (*cdc_acm_event_cb_t)(uint8_t port, uint8_t events);
+
+/* cdc_acm_port_set_forward() 的 dst 取此值表示关闭转发 */
+#define CDC_ACM_FORWARD_OFF  0xFF
+
+/*
+ * 转发钩子: 数据发出前在接收缓冲区中原地修改一段连续数据
+ * 返回要发送的前 n 字节 (n <= len)，0 表示丢弃整段。整段 len 字节在发送完成后一起释放
+ * 在发送消费者上下文调用 (USB中断或主循环)，不能阻塞
+ */
+typedef uint32_t (*cdc_acm_forward_hook_t)(void *ctx, uint8_t *data, uint32_t len);
+
+/*
+ * 接收时间戳: 每次 OUT 传输完成时在USB中断里记录，与数据一起进入接收缓冲区
+ * DWT 周期计数器提供微秒精度，168MHz 下约 25 秒回绕，更长的间隔用毫秒计数计算
+ */
+typedef struct {
+    uint32_t cyc;       // DWT->CYCCNT
+    uint32_t ms;        // HAL_GetTick()
+} cdc_acm_rx_ts_t;
+
+/* 每个端口保留的时间戳数量 (2的幂)，未读数据跨越更多次传输时最旧的时间戳被覆盖 */
+#ifndef CDC_RX_TS_NUM
+#define CDC_RX_TS_NUM        32
+#endif
+
+/* 聚合发送的数据段 */
+typedef struct {
+    const void *base;
+    uint32_t len;
+} cdc_acm_iovec_t;
+
+/*
+ * 端口统计: 一直开启，每次更新只是在已有的代码路径上加几条加法/比较指令
+ *
+ * 主机也可以用厂商控制请求读取 (结构体的内存映像，小端，无填充):
+ *   bmRequestType 0xC1 (设备到主机 | 厂商 | 接口)
+ *   bRequest      CDC_ACM_REQ_GET_STATS
+ *   wValue        CDC_ACM_STATS_RESET 表示读取后清零
+ *   wIndex        端口的通信接口号 (端口0为0，端口1为2)
+ *   wLength       sizeof(cdc_acm_stats_t)
+ * 例如 pyusb: dev.ctrl_transfer(0xC1, 0x20, 0, 0, 80)
+ */
+#define CDC_ACM_REQ_GET_STATS 0x20
+#define CDC_ACM_STATS_RESET   0x0001
+
+typedef struct {
+    uint64_t tx_busy_cycles;    // IN 端点有传输进行中 (含 ZLP) 的累计 DWT 周期
+    uint32_t rx_packets;        // OUT 端点收到的包数 (含 ZLP)
+    uint32_t rx_bytes;
+    uint32_t tx_packets;        // IN 端点发出的包数 (含 ZLP)
+    uint32_t tx_bytes;
+    uint32_t tx_zlps;           // 其中补发的 ZLP
+    uint32_t rx_overflow_bytes; // 接收缓冲区放不下而丢弃的字节
+    uint32_t rx_pauses;         // 接收缓冲区将满、OUT 端点暂停 (NAK) 的次数
+    uint32_t tx_full_events;    // 发送缓冲区空间不足、写入被拒绝的次数
+    uint32_t rx_high_water;     // 接收缓冲区最高占用 (字节)
+    uint32_t tx_high_water;     // 发送缓冲区最高占用 (字节)
+    uint32_t rx_used;           // 读取时的接收缓冲区占用
+    uint32_t tx_used;           // 读取时的发送缓冲区占用
+    uint32_t rx_size;           // 接收缓冲区容量
+    uint32_t tx_size;           // 发送缓冲区容量
+    uint32_t tx_prio_bytes;     // 高优先级通道发出的字节
+    uint32_t tx_prio_wait_max_cycles; // 高优先级数据从写入到开始发送的最长等待 (DWT 周期)
+    uint32_t tx_prio_used;      // 读取时的高优先级通道占用
+    uint32_t reserved;          // 保持 8 字节对齐，无填充
+} cdc_acm_stats_t;
 
 /*****************************************************************************
  * 初始化函数
@@ -22,13 +184,15 @@ extern "C" {
 /**
  * @brief 初始化USB CDC和环形缓冲区
  * 
- * @param busid USB总线ID（通常为0）
+ * @param busid USB总线ID（第一个内核通常为0）
  * @param reg_base USB寄存器基地址
  * 
- * @note 应在系统启动时调用一次
+ * @note 应在系统启动时对每个内核调用一次 (共 CDC_ACM_BUS_NUM 次)，
+ *       每次按顺序分配 CDC_ACM_BUS_PORTS 个端口并只初始化它们的缓冲区
  * 
  * @example
- *   cdc_acm_init(0, USB_BASE);
+ *   cdc_acm_init(0, USB_OTG_FS_PERIPH_BASE);  // 端口0
+ *   cdc_acm_init(1, USB_OTG_HS_PERIPH_BASE);  // 端口1 (CDC_ACM_BUS_NUM 为 2 时)
  */
 void cdc_acm_init(uint8_t busid, uintptr_t reg_base);
 
@@ -43,20 +207,80 @@ void cdc_acm_init(uint8_t busid, uintptr_t reg_base);
  * @param data 要发送的数据指针
  * @param len 数据长度（字节）
  * 
- * @return 实际写入发送缓冲区的字节数
- *         如果返回值 < len，说明发送缓冲区空间不足
+ * @return 写入发送缓冲区的字节数 (len)，发送缓冲区空间不足时返回0
  * 
  * @note 数据先写入发送环形缓冲区，然后自动触发USB发送
+ *       写入是整段的：要么全部写入，要么一个字节都不写，不会把一条消息截断
+ *       可在主循环和中断中同时调用
  * 
  * @example
  *   const char *msg = "Hello USB!\r\n";
  *   int sent = cdc_acm_send_data(0, (uint8_t *)msg, strlen(msg));
- *   if (sent < strlen(msg)) {
+ *   if (sent == 0) {
  *       printf("发送缓冲区满\n");
  *   }
  */
 int cdc_acm_send_data(uint8_t busid, const uint8_t *data, uint32_t len);
 
+/**
+ * @brief 经高优先级通道发送 (交互回复、状态应答)
+ * 
+ * @param busid USB总线ID
+ * @param data 要发送的数据指针
+ * @param len 数据长度（字节），不超过高优先级通道大小 (512)
+ * 
+ * @return 写入的字节数 (len)，通道空间不足时返回0
+ * 
+ * @note 每次IN传输结束时先发这个通道，不排在发送缓冲区的大量数据后面。
+ *       两个通道都有数据时批量数据按 cdc_acm_port_set_tx_bulk_share() 的份额穿插发送，
+ *       所以等待时间最多一次批量传输 (2KB，全速约 2ms)。
+ *       与发送缓冲区之间不保证顺序，同一通道内保持写入顺序
+ * 
+ * @example
+ *   cdc_acm_send_prio(0, (uint8_t *)"OK\r\n", 4);
+ */
+int cdc_acm_send_prio(uint8_t busid, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 聚合发送多段数据
+ * 
+ * @param busid USB总线ID
+ * @param iov 数据段数组
+ * @param iovcnt 数据段个数
+ * 
+ * @return 写入发送缓冲区的总字节数，空间不足时返回0
+ * 
+ * @note 各段直接拷贝进发送缓冲区，一次性提交：要么全部写入，要么都不写，
+ *       帧头、负载、帧尾不会被其他上下文的写入打断或截断
+ * 
+ * @example
+ *   uint8_t hdr[2] = {0xA5, len};
+ *   cdc_acm_iovec_t iov[] = {
+ *       { hdr, sizeof(hdr) },
+ *       { payload, len },
+ *       { &crc, 1 },
+ *   };
+ *   cdc_acm_sendv(0, iov, 3);
+ */
+int cdc_acm_sendv(uint8_t busid, const cdc_acm_iovec_t *iov, uint32_t iovcnt);
+
+/**
+ * @brief 格式化输出到USB CDC
+ * 
+ * @param busid USB总线ID
+ * @param fmt 格式字符串 (同 printf)
+ * 
+ * @return 写入发送缓冲区的字节数，空间不足时返回0，格式错误返回-1
+ * 
+ * @note 先量出长度再按实际长度预留发送缓冲区，格式化期间不阻塞其他生产者
+ *       结果达到 CDC_PRINTF_BUF_SIZE 时返回0，与缓冲区当前位置无关
+ *       与 cdc_acm_send_data 一样是整段写入，不会输出半行
+ * 
+ * @example
+ *   cdc_acm_printf(0, "adc=%d temp=%d\r\n", adc, temp);
+ */
+int cdc_acm_printf(uint8_t busid, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
 /**
  * @brief 从USB CDC接收数据
  * 
@@ -209,6 +433,7 @@ uint32_t cdc_acm_drop_rx(uint32_t size);
  * @param busid USB总线ID
  * 
  * @note ⚠️ 非常重要：必须在主循环中定期调用此函数！
+ *       会尝试发送该总线上所有端口的数据
  *       此函数检查发送条件（DTR使能、非busy），并启动实际的USB传输
  * 
  * @example
@@ -224,6 +449,284 @@ uint32_t cdc_acm_drop_rx(uint32_t size);
  */
 void cdc_acm_try_send(uint8_t busid);
 
+/*****************************************************************************
+ * 多端口API（每个端口有独立的收发环形缓冲区）
+ *****************************************************************************/
+
+/**
+ * @brief 发送数据到指定端口
+ * 
+ * @param port 端口号 (0 ~ CDC_ACM_PORT_NUM-1)
+ * @param data 要发送的数据指针
+ * @param len 数据长度（字节）
+ * 
+ * @return 写入该端口发送缓冲区的字节数，空间不足返回0，参数错误返回-1
+ * 
+ * @example
+ *   // 端口0: 操作员文本, 端口1: 调试日志
+ *   cdc_acm_port_send_data(1, (uint8_t *)log, strlen(log));
+ */
+int cdc_acm_port_send_data(uint8_t port, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 经指定端口的高优先级通道发送，语义同 cdc_acm_send_prio()
+ */
+int cdc_acm_port_send_prio(uint8_t port, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 格式化后经高优先级通道发送
+ * 
+ * @return 写入的字节数，通道空间不足或结果超过 CDC_PRINTF_BUF_SIZE 时返回0
+ */
+int cdc_acm_port_printf_prio(uint8_t port, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief 聚合发送多段数据到指定端口，语义同 cdc_acm_sendv()
+ */
+int cdc_acm_port_sendv(uint8_t port, const cdc_acm_iovec_t *iov, uint32_t iovcnt);
+
+/**
+ * @brief 格式化输出到指定端口，语义同 cdc_acm_printf()
+ */
+int cdc_acm_port_vprintf(uint8_t port, const char *fmt, va_list ap);
+int cdc_acm_port_printf(uint8_t port, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief 从指定端口读取数据
+ * 
+ * @return 实际读取的字节数，0表示无数据
+ */
+int cdc_acm_port_read_data(uint8_t port, uint8_t *buffer, uint32_t max_len);
+
+/**
+ * @brief 查看指定端口的接收数据但不移除
+ * 
+ * @return 实际查看的字节数，0表示无数据
+ */
+int cdc_acm_port_peek_data(uint8_t port, uint8_t *buffer, uint32_t max_len);
+
+/**
+ * @brief 获取指定端口接收缓冲区可用数据量
+ */
+uint32_t cdc_acm_port_get_rx_available(uint8_t port);
+
+/**
+ * @brief 清空指定端口的接收缓冲区，语义同 cdc_acm_flush_rx()
+ */
+void cdc_acm_port_flush_rx(uint8_t port);
+
+/**
+ * @brief 获取指定端口发送缓冲区剩余空间
+ */
+uint32_t cdc_acm_port_get_tx_free(uint8_t port);
+
+/**
+ * @brief 获取指定端口当前的串口参数
+ * 
+ * @note 主机未设置过时为 115200 8N1
+ */
+void cdc_acm_port_get_line_coding(uint8_t port, cdc_acm_line_coding_t *line_coding);
+
+/**
+ * @brief 注册串口参数变化回调
+ * 
+ * @param port 端口号
+ * @param cb 回调函数，NULL 取消注册
+ * 
+ * @note 回调在USB中断中执行，只应记录参数，耗时的重新配置放到主循环
+ */
+void cdc_acm_port_set_line_coding_callback(uint8_t port, cdc_acm_line_coding_cb_t cb);
+
+/**
+ * @brief 注册事件通知回调 (所有端口共用)
+ * 
+ * @param cb 回调函数，NULL 取消注册
+ * 
+ * @note 回调在USB中断中执行，用来唤醒主循环 (置位事件标志)，不要在里面处理数据。
+ *       转发模式下收到的数据由中断直接发出，不通知
+ */
+void cdc_acm_set_event_callback(cdc_acm_event_cb_t cb);
+
+/**
+ * @brief 指定端口是否已被主机打开 (DTR)
+ */
+bool cdc_acm_port_is_open(uint8_t port);
+
+/**
+ * @brief 获取接收数据的时间戳
+ * 
+ * @param port 端口号
+ * @param offset 相对下一个未读字节的偏移，0 即下一个要读取的字节
+ * @param ts 输出参数，该字节所在的 USB 传输完成的时间
+ * 
+ * @return true: 成功, false: 没有这个字节或它的时间戳已被覆盖
+ * 
+ * @note 只能在接收数据的消费者上下文调用。读取、丢弃、清空数据后时间戳自动对齐
+ * 
+ * @example
+ *   cdc_acm_rx_ts_t ts, prev;
+ *   if (cdc_acm_port_get_rx_timestamp(0, 0, &ts)) {
+ *       printf("+%luus\r\n", cdc_acm_rx_ts_diff_us(&ts, &prev));
+ *   }
+ */
+bool cdc_acm_port_get_rx_timestamp(uint8_t port, uint32_t offset, cdc_acm_rx_ts_t *ts);
+
+/**
+ * @brief 获取当前时间，格式同接收时间戳 (取不到数据的时间戳时作为替代)
+ */
+void cdc_acm_rx_ts_now(cdc_acm_rx_ts_t *ts);
+
+/**
+ * @brief 计算两个时间戳的间隔
+ * 
+ * @return later - earlier (us)，later 更早时返回0
+ */
+uint32_t cdc_acm_rx_ts_diff_us(const cdc_acm_rx_ts_t *later, const cdc_acm_rx_ts_t *earlier);
+
+/**
+ * @brief 读取指定端口的统计
+ *
+ * @param port 端口号
+ * @param stats 输出，各计数器在同一时刻的值
+ *
+ * @note 读取期间短暂关中断，保证 64 位计数和各计数器之间一致
+ *
+ * @example
+ *   cdc_acm_stats_t st;
+ *   cdc_acm_port_get_stats(0, &st);
+ *   printf("IN busy %lu%%\r\n", (uint32_t)(st.tx_busy_cycles * 100 / elapsed_cycles));
+ */
+void cdc_acm_port_get_stats(uint8_t port, cdc_acm_stats_t *stats);
+
+/**
+ * @brief 清零指定端口的统计，高水位从当前占用重新开始
+ */
+void cdc_acm_port_reset_stats(uint8_t port);
+
+/**
+ * @brief 设置指定端口的发送合并（SOF驱动）
+ * 
+ * @param port 端口号
+ * @param frames 截止时间（1ms帧数），0 = 关闭合并，每次写入立即发送
+ * 
+ * @return 0: 成功, -1: 端口无效或未开启 CONFIG_USBDEV_SOF_ENABLE
+ * 
+ * @note 开启后，不足一个包(64字节)的小块写入会先留在发送缓冲区，
+ *       凑满一个包或等待满 frames 帧后才作为一次传输发出。
+ *       适合大量短日志，延迟上限为 frames 毫秒。
+ * 
+ * @example
+ *   cdc_acm_port_set_tx_coalesce(0, 2); // 最多延迟 2ms
+ */
+int cdc_acm_port_set_tx_coalesce(uint8_t port, uint8_t frames);
+
+/**
+ * @brief 设置高优先级通道和发送缓冲区都有数据时批量数据的带宽份额
+ * 
+ * @param port 端口号
+ * @param percent 0 ~ 100，0 = 高优先级通道严格优先 (批量数据只在它空闲时发送)，默认 50
+ * 
+ * @return 0: 成功, -1: 端口无效或 percent 超过 100
+ * 
+ * @note 按发出的字节记账，只有两个通道同时有数据时才起作用。
+ *       转发的数据算作批量数据
+ * 
+ * @example
+ *   cdc_acm_port_set_tx_bulk_share(0, 80); // 大量传输期间回复只占 20%
+ */
+int cdc_acm_port_set_tx_bulk_share(uint8_t port, uint8_t percent);
+
+/**
+ * @brief 指定 (或重新指定) 端口的收发环形缓冲区
+ *
+ * @param port 端口号
+ * @param rx_pool 接收缓冲区，rx_size 字节
+ * @param rx_size 2的幂，CDC_RINGBUF_MIN_RX ~ CDC_RINGBUF_MAX
+ * @param tx_pool 发送缓冲区，tx_size 字节
+ * @param tx_size 2的幂，CDC_RINGBUF_MIN_TX ~ CDC_RINGBUF_MAX
+ *
+ * @return 0: 成功, -1: 参数无效, -2: 端口的接收缓冲区正被转发，稍后重试
+ *
+ * @note 只在主循环中调用。可以在 cdc_acm_init() 之前调用，也可以在运行中调用:
+ *       关中断切换，两个缓冲区中未读/未发的数据丢弃 (高优先级通道不受影响)，
+ *       正在进行的USB传输使用的是独立的临时缓冲区，不受影响。
+ *       调用前应用不能持有旧缓冲区的 linear_read_setup 指针
+ *
+ * @example
+ *   cdc_acm_port_set_buffers(0, mem_arena_alloc(8192), 8192, mem_arena_alloc(2048), 2048);
+ */
+int cdc_acm_port_set_buffers(uint8_t port, void *rx_pool, uint32_t rx_size,
+                             void *tx_pool, uint32_t tx_size);
+
+/**
+ * @brief 开关指定端口的发送压缩
+ *
+ * @param port 端口号
+ * @param enable true: 之后取出的发送数据压缩后发出, false: 恢复原样发送
+ *
+ * @return 0: 成功, -1: 端口无效、压缩器正被其他端口使用或未开启 CDC_TX_COMPRESS_ENABLE
+ *
+ * @note 切换在下一次取数据时生效，已在发送缓冲区里的数据也按新状态发出。
+ *       压缩在发送消费者中进行 (可能是发送完成中断)，每块最多 LZ_STREAM_BLOCK_MAX 字节。
+ *       主机重新打开端口 (DTR) 或USB复位后压缩流重新开始，解码端不需要之前的历史。
+ *       关闭时发出流结束标记，解码工具随后原样输出普通数据
+ *
+ * @example
+ *   cdc_acm_port_set_tx_compress(0, true);
+ *   cdc_acm_port_printf(0, "[%lu] log line\r\n", HAL_GetTick()); // 主机: lz_stream_cat.py COM5
+ */
+int cdc_acm_port_set_tx_compress(uint8_t port, bool enable);
+
+/**
+ * @brief 读取发送压缩的状态和压缩器统计
+ *
+ * @param port 端口号
+ * @param stats 输出压缩器的累计统计 (不分端口)，可为 NULL
+ *
+ * @return 该端口是否打开了发送压缩
+ */
+bool cdc_acm_port_get_tx_compress(uint8_t port, lz_stream_stats_t *stats);
+
+/**
+ * @brief 尝试发送指定端口缓冲区中的数据
+ * 
+ * @note cdc_acm_try_send(busid) 会依次调用该总线上所有端口的此函数
+ */
+void cdc_acm_port_try_send(uint8_t port);
+
+/*****************************************************************************
+ * 转发API - 接收缓冲区直接交给IN端点
+ *****************************************************************************/
+
+/**
+ * @brief 把 src 端口收到的数据从 dst 端口原样发回主机 (src == dst 即回环)
+ *
+ * @param src 接收数据的端口
+ * @param dst 发送数据的端口，CDC_ACM_FORWARD_OFF 关闭 src 的转发
+ * @param hook 可选的原地变换钩子，NULL 表示不修改
+ * @param ctx 传给钩子的参数
+ *
+ * @return 0: 成功, -1: 端口无效、dst 已在转发其他端口或 dst 打开了发送压缩
+ *
+ * @note 没有中间缓冲区，也不经过主循环：OUT 传输完成后立即把 src 接收缓冲区中的
+ *       连续区域 (最多 CDC_USB_READ_SIZE 字节) 作为 dst 的IN传输发出，发送完成才释放。
+ *       dst 的主机没打开端口时数据留在接收缓冲区，OUT端点随之暂停 (NAK)，不会丢数据。
+ *       dst 发送缓冲区中的数据在转发空闲时照常发出，两者按整次传输交替。
+ *       转发期间 (直到 cdc_acm_port_is_forwarding() 返回 false) 应用不能读取 src 的接收数据。
+ *       开启 CONFIG_USB_DWC2_DMA_ENABLE 时接收缓冲区中的区域不一定4字节对齐，不能使用
+ *
+ * @example
+ *   cdc_acm_port_set_forward(0, 0, NULL, NULL);  // 端口0回环测试
+ *   cdc_acm_port_set_forward(0, 1, NULL, NULL);  // 端口0收到的数据从端口1发出
+ *   cdc_acm_port_set_forward(0, CDC_ACM_FORWARD_OFF, NULL, NULL);
+ */
+int cdc_acm_port_set_forward(uint8_t src, uint8_t dst, cdc_acm_forward_hook_t hook, void *ctx);
+
+/**
+ * @brief src 端口是否在转发 (包括关闭后仍有一段数据在发送中)
+ */
+bool cdc_acm_port_is_forwarding(uint8_t src);
+
 /*****************************************************************************
  * 高级API - DMA零拷贝支持
  *****************************************************************************/
@@ -271,6 +774,8 @@ void cdc_acm_linear_read_done(uint32_t size);
  * 
  * @note 此函数返回环形缓冲区内部指针，避免数据拷贝
  *       写入完成后必须调用 cdc_acm_linear_write_done() 更新写指针并触发发送
+ *       size > 0 时整个连续区域被独占，期间其他写入会失败，
+ *       即使不写数据也必须调用 cdc_acm_linear_write_done(busid, 0) 释放
  * 
  * @example
  *   uint32_t size;
@@ -283,6 +788,8 @@ void cdc_acm_linear_read_done(uint32_t size);
  *       // 方法2: DMA传输
  *       dma_start(src_buffer, ptr, 100);
  *       // DMA完成中断中调用: cdc_acm_linear_write_done(0, 100);
+ *   } else if (size > 0) {
+ *       cdc_acm_linear_write_done(0, 0);
  *   }
  */
 void *cdc_acm_linear_write_setup(uint32_t *size);
@@ -325,12 +832,14 @@ void usbd_cdc_acm_set_dtr(uint8_t busid, uint8_t intf, bool dtr);
  *****************************************************************************/
 
 /*
- * 缓冲区大小配置（在.c文件中定义）：
- * 
+ * 缓冲区大小配置（在.c文件中定义，CDC_RINGBUF_EXTERNAL 为 0 时使用）：
+ *
  * #define CDC_RX_RINGBUF_SIZE  (4096)  // 接收环形缓冲区大小
  * #define CDC_TX_RINGBUF_SIZE  (4096)  // 发送环形缓冲区大小
  * #define CDC_USB_READ_SIZE    (2048)  // USB单次读取大小
- * 
+ *
+ * CDC_RINGBUF_EXTERNAL 为 1 时大小由 cdc_acm_port_set_buffers() 在运行时决定
+ *
  * ⚠️ 重要：缓冲区大小必须是2的幂次方（512, 1024, 2048, 4096, 8192...）
  * 
  * 推荐配置：
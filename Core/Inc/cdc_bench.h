@@ -0,0 +1,104 @@
+/*
+ * USB CDC ACM Throughput Benchmark - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CDC_BENCH_H
+#define CDC_BENCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 配置
+ *****************************************************************************/
+
+/* 测试图案: 第 n 个字节为 (n % CDC_BENCH_PATTERN_MOD)，取质数便于发现丢包 */
+#define CDC_BENCH_PATTERN_MOD   251
+
+/* 统计报告周期 (ms) */
+#define CDC_BENCH_REPORT_MS     1000
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+typedef enum {
+    CDC_BENCH_OFF = 0,      // 关闭，终端正常工作
+    CDC_BENCH_SOURCE,       // 设备以最大速率发送测试图案
+    CDC_BENCH_SINK,         // 设备接收并校验测试图案
+    CDC_BENCH_LOOPBACK,     // 设备原样回显所有数据 (转发模式，不经过主循环)
+    CDC_BENCH_MODE_NUM
+} cdc_bench_mode_t;
+
+typedef struct {
+    cdc_bench_mode_t mode;
+    uint32_t period_ms;     // 本报告覆盖的时间
+    uint32_t tx_bytes;      // 本周期发送字节数
+    uint32_t rx_bytes;      // 本周期接收字节数
+    uint32_t lost_bytes;    // 累计丢失字节数 (仅 SINK)
+    uint32_t interval_p50_us; // 数据块间隔的中位数上限 (us)
+    uint32_t interval_p99_us; // 数据块间隔的 99% 分位上限 (us)
+    uint32_t interval_max_us; // 数据块间隔的最大值 (us)
+} cdc_bench_report_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 启动基准测试（会清空收发缓冲区）
+ *
+ * @param busid USB总线ID
+ * @param mode 测试模式，CDC_BENCH_OFF 等同于 cdc_bench_stop()
+ *
+ * @note 使用 DWT 周期计数器计时，数据走默认端口的零拷贝线性读写接口，
+ *       回环使用 cdc_acm_port_set_forward()，接收缓冲区直接交给IN端点
+ */
+void cdc_bench_start(uint8_t busid, cdc_bench_mode_t mode);
+
+/**
+ * @brief 停止基准测试，恢复终端正常收发
+ */
+void cdc_bench_stop(void);
+
+/**
+ * @brief 获取当前测试模式
+ */
+cdc_bench_mode_t cdc_bench_get_mode(void);
+
+/**
+ * @brief 获取模式名称 ("OFF", "SOURCE", "SINK", "LOOP")
+ */
+const char *cdc_bench_mode_name(cdc_bench_mode_t mode);
+
+/**
+ * @brief 基准测试轮询，测试期间代替终端的接收处理在主循环中调用
+ *
+ * @param report 输出参数，每个报告周期填充一次
+ *
+ * @return true: report 已更新, false: 本次无新报告
+ *
+ * @note 间隔指标为相邻两次搬运数据之间的时间 (不是往返延迟)，按 2 的幂分桶统计，
+ *       分位数给出的是所在桶的上限。往返延迟由主机在 LOOP 模式下测量
+ *       (Tools/cdc_bench.py)
+ *
+ * @example
+ *   cdc_bench_report_t rpt;
+ *   if (cdc_bench_task(&rpt)) {
+ *       printf("%lu B/s\r\n", rpt.tx_bytes * 1000 / rpt.period_ms);
+ *   }
+ */
+bool cdc_bench_task(cdc_bench_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CDC_BENCH_H */
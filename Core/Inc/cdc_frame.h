@@ -0,0 +1,134 @@
+/*
+ * COBS Framed Packets over USB CDC ACM - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CDC_FRAME_H
+#define CDC_FRAME_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cdc_acm_ringbuffer.h"
+
+/*****************************************************************************
+ * 帧格式
+ *
+ *   0x00 | COBS( type:1 | payload:N | crc32:4 ) | 0x00
+ *
+ * - COBS 编码后帧内不含 0x00，0x00 只作为分隔符，任何错误都在下一个 0x00 处重新同步
+ * - CRC-32/MPEG-2 (见 crc32.h，由 CRC 单元计算)，覆盖 type 和 payload，小端
+ * - 发送时帧前后各加一个分隔符，空帧 (连续两个 0x00) 被忽略
+ *
+ * 兼容普通串口终端：收到第一个 0x00 之前的数据按原始文本交给应用，
+ * 主机工具先发一个 0x00 即切换到帧模式，端口关闭 (DTR 撤销) 后回到文本模式
+ *****************************************************************************/
+
+#define CDC_FRAME_MAX_PAYLOAD   256
+#define CDC_FRAME_POOL_NUM      4       // 帧池大小，全部占满时暂停读取接收缓冲区
+#define CDC_FRAME_CRC_SIZE      4
+
+/* 编码前长度 (type + payload + crc) 和编码后最大长度 (含两个分隔符) */
+#define CDC_FRAME_RAW_MAX       (1 + CDC_FRAME_MAX_PAYLOAD + CDC_FRAME_CRC_SIZE)
+#define CDC_FRAME_MAX_ENCODED   (CDC_FRAME_RAW_MAX + CDC_FRAME_RAW_MAX / 254 + 1 + 2)
+
+typedef enum {
+    CDC_FRAME_TYPE_TEXT        = 0x01, // 文本消息
+    CDC_FRAME_TYPE_CHUNK_START = 0x10, // 分包发送: 开始
+    CDC_FRAME_TYPE_CHUNK_DATA  = 0x11, // 分包发送: 数据
+    CDC_FRAME_TYPE_CHUNK_END   = 0x12, // 分包发送: 结束
+} cdc_frame_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint16_t len;
+    uint8_t *data;      // 指向帧池，data[len] 保证为 '\0'
+    cdc_acm_rx_ts_t rx_ts; // 帧第一个字节的接收时间
+} cdc_frame_t;
+
+typedef struct {
+    uint32_t frames;        // 校验通过的帧
+    uint32_t crc_errors;    // CRC 错误
+    uint32_t format_errors; // 截断、超长或长度不足
+} cdc_frame_stats_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 初始化帧池和解码器
+ */
+void cdc_frame_init(void);
+
+/**
+ * @brief 丢弃未完成的帧，回到文本模式
+ *
+ * @note 已解码但未取走的帧保留
+ */
+void cdc_frame_reset(void);
+
+/**
+ * @brief 是否已切换到帧模式
+ */
+bool cdc_frame_is_synced(void);
+
+/**
+ * @brief 从默认端口的接收缓冲区解码数据
+ *
+ * @param raw 文本模式下接收原始数据的缓冲区
+ * @param raw_max 缓冲区长度
+ *
+ * @return 拷贝到 raw 的原始字节数
+ *
+ * @note 在主循环中调用。帧数据直接解码进帧池，不经过中间缓冲区；
+ *       帧池满时剩余数据留在接收缓冲区，等应用释放帧后继续
+ */
+uint32_t cdc_frame_poll(uint8_t *raw, uint32_t raw_max);
+
+/**
+ * @brief 取出一个已接收的帧
+ *
+ * @return 帧指针，没有时返回 NULL。处理完后必须调用 cdc_frame_release()
+ *
+ * @example
+ *   cdc_frame_t *f;
+ *   while ((f = cdc_frame_get()) != NULL) {
+ *       handle(f->type, f->data, f->len);
+ *       cdc_frame_release(f);
+ *   }
+ */
+cdc_frame_t *cdc_frame_get(void);
+
+/**
+ * @brief 归还帧到帧池
+ */
+void cdc_frame_release(cdc_frame_t *frame);
+
+/**
+ * @brief 编码并发送一帧
+ *
+ * @param busid USB总线ID
+ * @param type 帧类型
+ * @param data 负载
+ * @param len 负载长度 (不超过 CDC_FRAME_MAX_PAYLOAD)
+ *
+ * @return 负载长度；发送缓冲区空间不足返回0 (整帧不发送)；参数错误返回-1
+ */
+int cdc_frame_send(uint8_t busid, uint8_t type, const void *data, uint32_t len);
+
+/**
+ * @brief 获取接收统计
+ */
+void cdc_frame_get_stats(cdc_frame_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CDC_FRAME_H */
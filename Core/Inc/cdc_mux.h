@@ -0,0 +1,181 @@
+/*
+ * Virtual Channel Multiplexing over USB CDC ACM - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CDC_MUX_H
+#define CDC_MUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cdc_acm_ringbuffer.h"
+
+/*****************************************************************************
+ * 配置
+ *
+ * 内存: 每个通道一个接收缓冲区和一个发送缓冲区，
+ *       默认 4 通道 × 2 × 1KB = 8KB
+ *****************************************************************************/
+
+/* 通道数，1 ~ 16 */
+#ifndef CDC_MUX_CH_NUM
+#define CDC_MUX_CH_NUM          4
+#endif
+
+/* 每个通道的收发缓冲区大小，2 的幂。接收缓冲区大小就是给主机的初始额度 */
+#ifndef CDC_MUX_RING_SIZE
+#define CDC_MUX_RING_SIZE       1024
+#endif
+
+/* 一帧最多携带的数据，轮到一个通道时最多发这么多，保证各通道交替发送 */
+#ifndef CDC_MUX_MAX_CHUNK
+#define CDC_MUX_MAX_CHUNK       512
+#endif
+
+/* 应用读走这么多字节后再把额度还给主机 (减少额度帧) */
+#ifndef CDC_MUX_CREDIT_BATCH
+#define CDC_MUX_CREDIT_BATCH    (CDC_MUX_RING_SIZE / 4)
+#endif
+
+#if CDC_MUX_CH_NUM < 1 || CDC_MUX_CH_NUM > 16
+#error "CDC_MUX_CH_NUM must be 1 ~ 16"
+#endif
+#if (CDC_MUX_RING_SIZE & (CDC_MUX_RING_SIZE - 1)) != 0 || CDC_MUX_RING_SIZE > 0xFFFF
+#error "CDC_MUX_RING_SIZE must be a power of 2 below 64KB"
+#endif
+
+/*****************************************************************************
+ * 帧格式 (两个方向相同)
+ *
+ *   type_ch(1) | len(2, LE) | 数据
+ *
+ *   type_ch 高 4 位为类型，低 4 位为通道号
+ *   type 0  DATA    len 字节数据
+ *   type 1  CREDIT  没有数据，len 为发送方新给对方的额度 (字节)
+ *   type 2  CLOSE   没有数据，退出复用模式 (通道号和 len 为 0)
+ *
+ * 额度: 每个通道各自计算，发送方累计发出的数据不能超过接收方给的额度。
+ *       接收方的通道缓冲区因此不会溢出，一个通道阻塞也不影响其他通道。
+ *       进入复用模式时设备先为每个通道发出 CREDIT(CDC_MUX_RING_SIZE)，
+ *       主机同样要先发 CREDIT，设备才会向该通道发送数据。
+ *
+ * 开销: 3 字节帧头，512 字节写入约 0.6%
+ *
+ * 进入: 文本模式下主机发送 "MUX ON" (由应用调用 cdc_mux_start())
+ * 退出: 主机发送 CLOSE 帧、关闭端口 (DTR 撤销) 或收到无效帧
+ *
+ * 复用模式下整个默认端口都是帧流，其他数据必须经过通道发送。
+ * 高优先级发送通道 (cdc_acm_send_prio) 会插在两次IN传输之间，可能落在一帧中间，
+ * 复用模式下不能使用。主机端见 Tools/cdc_mux.py
+ *****************************************************************************/
+
+#define CDC_MUX_HDR_LEN         3
+
+#define CDC_MUX_TYPE_DATA       0
+#define CDC_MUX_TYPE_CREDIT     1
+#define CDC_MUX_TYPE_CLOSE      2
+
+typedef struct {
+    uint32_t rx_bytes;          // 收到的通道数据
+    uint32_t tx_bytes;          // 发出的通道数据
+    uint32_t rx_hdr_bytes;      // 收到的帧头 (含额度帧)
+    uint32_t tx_hdr_bytes;      // 发出的帧头 (含额度帧)
+    uint32_t credit_overruns;   // 主机超出额度发送而丢弃的字节
+    uint32_t format_errors;     // 无效帧 (之后退出复用模式)
+} cdc_mux_stats_t;
+
+/*****************************************************************************
+ * API
+ *
+ * cdc_mux_write() 可在任意上下文调用，其余函数只在主循环中调用
+ *****************************************************************************/
+
+/**
+ * @brief 进入复用模式：清空所有通道，向主机发出初始额度
+ *
+ * @note 之后默认端口的接收数据全部由 cdc_mux_poll() 处理
+ */
+void cdc_mux_start(void);
+
+/**
+ * @brief 退出复用模式，回到普通数据 (未发出的通道数据丢弃)
+ */
+void cdc_mux_stop(void);
+
+/**
+ * @brief 是否处于复用模式
+ */
+bool cdc_mux_is_active(void);
+
+/**
+ * @brief 分发接收数据、归还额度、轮流发送各通道的数据
+ *
+ * @note 在主循环中调用。数据从端口接收缓冲区直接拷进通道缓冲区，不经过中间缓冲区；
+ *       发送时每个通道每轮最多一帧 (CDC_MUX_MAX_CHUNK)，直到端口发送缓冲区放不下
+ */
+void cdc_mux_poll(void);
+
+/**
+ * @brief 写入一个通道
+ *
+ * @param ch 通道号 (0 ~ CDC_MUX_CH_NUM-1)
+ *
+ * @return 写入的字节数 (len)；通道发送缓冲区空间不足返回0 (整段不写入)；
+ *         参数错误或不在复用模式返回-1
+ *
+ * @example
+ *   cdc_mux_write(1, log_line, strlen(log_line));
+ */
+int cdc_mux_write(uint8_t ch, const void *data, uint32_t len);
+
+/**
+ * @brief 从一个通道读取
+ *
+ * @return 读取的字节数，0表示无数据
+ */
+int cdc_mux_read(uint8_t ch, void *buf, uint32_t max_len);
+
+/**
+ * @brief 零拷贝读取：取得通道接收缓冲区中的一段连续数据
+ *
+ * @param size 输出，连续数据长度，0 表示无数据
+ *
+ * @note 处理完后调用 cdc_mux_linear_read_done()，释放的空间作为额度还给主机
+ *
+ * @example
+ *   uint32_t n;
+ *   uint8_t *p = cdc_mux_linear_read_setup(0, &n);
+ *   if (n) {
+ *       handle(p, n);
+ *       cdc_mux_linear_read_done(0, n);
+ *   }
+ */
+void *cdc_mux_linear_read_setup(uint8_t ch, uint32_t *size);
+void cdc_mux_linear_read_done(uint8_t ch, uint32_t size);
+
+/**
+ * @brief 通道接收缓冲区中的数据量
+ */
+uint32_t cdc_mux_get_rx_available(uint8_t ch);
+
+/**
+ * @brief 通道发送缓冲区剩余空间
+ */
+uint32_t cdc_mux_get_tx_free(uint8_t ch);
+
+/**
+ * @brief 获取统计
+ */
+void cdc_mux_get_stats(cdc_mux_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CDC_MUX_H */
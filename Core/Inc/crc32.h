@@ -0,0 +1,94 @@
+/*
+ * CRC-32 Service (STM32 CRC unit + software table) - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 算法
+ *
+ * CRC-32/MPEG-2: 多项式 0x04C11DB7，初值 0xFFFFFFFF，不反转，不异或输出
+ * 这是 STM32F4 CRC 单元的原生算法，"123456789" 的结果为 0x0376E6E7
+ *
+ * - 4 字节对齐的部分按字写入硬件 (每字 4 个周期)
+ * - 不对齐的头尾、硬件正被其他上下文使用时、以及主机编译时使用查表法
+ * - 三种实现结果完全一致，可以混合使用
+ *****************************************************************************/
+
+#define CRC32_INIT          0xFFFFFFFFUL
+#define CRC32_CHECK_VALUE   0x0376E6E7UL    // crc32_calc("123456789", 9)
+
+/* 基准测试使用的数据长度 */
+#define CRC32_BENCH_LEN     4096
+
+typedef struct {
+    uint32_t len;           // 测试数据长度
+    uint32_t hw_cycles;     // 硬件 (主机编译时为 0)
+    uint32_t table_cycles;  // 查表法
+    uint32_t bitwise_cycles;// 逐位计算
+    bool match;             // 三种实现结果一致
+} crc32_bench_result_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 使能 CRC 单元时钟
+ *
+ * @note 未调用时 crc32_update() 全部使用查表法
+ */
+void crc32_init(void);
+
+/**
+ * @brief 增量计算 CRC
+ *
+ * @param crc 之前的结果，第一次传 CRC32_INIT
+ * @param data 数据，任意对齐
+ * @param len 数据长度
+ *
+ * @return 新的 CRC 值，可以继续传给下一次调用
+ *
+ * @note 可在主循环和中断中同时调用，硬件被占用时自动退回查表法
+ *
+ * @example
+ *   uint32_t crc = CRC32_INIT;
+ *   crc = crc32_update(crc, header, sizeof(header));
+ *   crc = crc32_update(crc, payload, len);
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, uint32_t len);
+
+/**
+ * @brief 一次性计算 CRC，等价于 crc32_update(CRC32_INIT, data, len)
+ */
+uint32_t crc32_calc(const void *data, uint32_t len);
+
+/**
+ * @brief 查表法 / 逐位计算 (供对比和测试)
+ */
+uint32_t crc32_update_table(uint32_t crc, const void *data, uint32_t len);
+uint32_t crc32_update_bitwise(uint32_t crc, const void *data, uint32_t len);
+
+/**
+ * @brief 在目标板上对比三种实现的速度 (DWT 周期计数)
+ *
+ * @note 耗时约数毫秒，在主循环中调用
+ */
+void crc32_bench(crc32_bench_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32_H */
@@ -0,0 +1,96 @@
+/*
+ * Lock-free ringbuffer (SPSC / MPSC) for ISR <-> main loop
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LF_RINGBUFFER_H
+#define LF_RINGBUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * 与 chry_ringbuffer 接口一一对应，区别在于:
+ * - 读写指针的发布/读取带 release/acquire 语义，生产者和消费者可分别位于中断和主循环
+ * - 每一方缓存对方的指针，只有缓存的空间不够时才重新读取
+ * - 数据按字拷贝 (newlib-nano 的 memcpy 是逐字节的)
+ *
+ * lf_spsc: 单生产者单消费者，无锁
+ * lf_mpsc: 多生产者 (主循环 + 任意中断) 单消费者，生产者用 CAS 预留空间，
+ *          写入全部成功或全部失败，不会出现被截断的消息。容量不超过 32768 字节
+ */
+
+typedef struct {
+    uint32_t in;        /*!< 写指针，生产者发布 */
+    uint32_t out;       /*!< 读指针，消费者发布 */
+    uint32_t in_cache;  /*!< 消费者缓存的写指针 */
+    uint32_t out_cache; /*!< 生产者缓存的读指针 */
+    uint32_t mask;
+    uint8_t *pool;
+} lf_spsc_ringbuffer_t;
+
+typedef struct {
+    uint32_t state;     /*!< [31:15] 已预留的写位置, [14] 线性写占用, [13:0] 未提交的生产者数 */
+    uint32_t in;        /*!< 已发布的写位置 (17位回绕) */
+    uint32_t out;       /*!< 读指针 (17位回绕) */
+    uint32_t in_cache;  /*!< 消费者缓存的写指针 */
+    uint32_t linear_len;/*!< 线性写占用的长度 */
+    uint32_t mask;
+    uint8_t *pool;
+} lf_mpsc_ringbuffer_t;
+
+#define LF_MPSC_MAX_SIZE 32768
+
+/* ========== SPSC ========== */
+extern int lf_spsc_ringbuffer_init(lf_spsc_ringbuffer_t *rb, void *pool, uint32_t size);
+extern void lf_spsc_ringbuffer_reset(lf_spsc_ringbuffer_t *rb);
+
+extern uint32_t lf_spsc_ringbuffer_get_size(lf_spsc_ringbuffer_t *rb);
+extern uint32_t lf_spsc_ringbuffer_get_used(lf_spsc_ringbuffer_t *rb);
+extern uint32_t lf_spsc_ringbuffer_get_free(lf_spsc_ringbuffer_t *rb);
+extern bool lf_spsc_ringbuffer_check_empty(lf_spsc_ringbuffer_t *rb);
+
+extern uint32_t lf_spsc_ringbuffer_write(lf_spsc_ringbuffer_t *rb, const void *data, uint32_t size);
+extern uint32_t lf_spsc_ringbuffer_peek(lf_spsc_ringbuffer_t *rb, void *data, uint32_t size);
+extern uint32_t lf_spsc_ringbuffer_read(lf_spsc_ringbuffer_t *rb, void *data, uint32_t size);
+extern uint32_t lf_spsc_ringbuffer_drop(lf_spsc_ringbuffer_t *rb, uint32_t size);
+
+extern void *lf_spsc_ringbuffer_linear_write_setup(lf_spsc_ringbuffer_t *rb, uint32_t *size);
+extern uint32_t lf_spsc_ringbuffer_linear_write_done(lf_spsc_ringbuffer_t *rb, uint32_t size);
+extern void *lf_spsc_ringbuffer_linear_read_setup(lf_spsc_ringbuffer_t *rb, uint32_t *size);
+extern uint32_t lf_spsc_ringbuffer_linear_read_done(lf_spsc_ringbuffer_t *rb, uint32_t size);
+
+/* ========== MPSC ========== */
+extern int lf_mpsc_ringbuffer_init(lf_mpsc_ringbuffer_t *rb, void *pool, uint32_t size);
+extern void lf_mpsc_ringbuffer_reset(lf_mpsc_ringbuffer_t *rb);
+
+extern uint32_t lf_mpsc_ringbuffer_get_size(lf_mpsc_ringbuffer_t *rb);
+extern uint32_t lf_mpsc_ringbuffer_get_used(lf_mpsc_ringbuffer_t *rb);
+extern uint32_t lf_mpsc_ringbuffer_get_free(lf_mpsc_ringbuffer_t *rb);
+extern bool lf_mpsc_ringbuffer_check_empty(lf_mpsc_ringbuffer_t *rb);
+
+/* 生产者: 可在任意上下文并发调用 */
+extern uint32_t lf_mpsc_ringbuffer_write(lf_mpsc_ringbuffer_t *rb, const void *data, uint32_t size);
+extern int32_t lf_mpsc_ringbuffer_reserve(lf_mpsc_ringbuffer_t *rb, uint32_t size);
+extern void lf_mpsc_ringbuffer_fill(lf_mpsc_ringbuffer_t *rb, uint32_t pos, const void *data, uint32_t size);
+extern void lf_mpsc_ringbuffer_commit(lf_mpsc_ringbuffer_t *rb);
+extern void *lf_mpsc_ringbuffer_linear_write_setup(lf_mpsc_ringbuffer_t *rb, uint32_t *size);
+extern uint32_t lf_mpsc_ringbuffer_linear_write_done(lf_mpsc_ringbuffer_t *rb, uint32_t size);
+
+/* 消费者: 同一时刻只能有一个 */
+extern uint32_t lf_mpsc_ringbuffer_peek(lf_mpsc_ringbuffer_t *rb, void *data, uint32_t size);
+extern uint32_t lf_mpsc_ringbuffer_read(lf_mpsc_ringbuffer_t *rb, void *data, uint32_t size);
+extern uint32_t lf_mpsc_ringbuffer_drop(lf_mpsc_ringbuffer_t *rb, uint32_t size);
+extern void *lf_mpsc_ringbuffer_linear_read_setup(lf_mpsc_ringbuffer_t *rb, uint32_t *size);
+extern uint32_t lf_mpsc_ringbuffer_linear_read_done(lf_mpsc_ringbuffer_t *rb, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,165 @@
+/*
+ * Streaming LZ Compressor (bounded window, fixed memory) - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LZ_STREAM_H
+#define LZ_STREAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 配置
+ *
+ * 内存全部在 lz_stream_t 里，大小固定:
+ *   LZ_STREAM_WINDOW + LZ_STREAM_BLOCK_MAX + 2 * (1 << LZ_STREAM_HASH_BITS) 字节
+ * 默认 2048 + 1024 + 2048 = 5KB。窗口越大压缩率越高，哈希表越大找到匹配的机会越多
+ *****************************************************************************/
+
+/* 历史窗口 (匹配最远可以引用多少字节之前的数据)，2 的幂 */
+#ifndef LZ_STREAM_WINDOW
+#define LZ_STREAM_WINDOW        2048
+#endif
+
+/* 每块最多压缩的原始字节数 */
+#ifndef LZ_STREAM_BLOCK_MAX
+#define LZ_STREAM_BLOCK_MAX     1024
+#endif
+
+/* 哈希表项数 = 1 << LZ_STREAM_HASH_BITS，每项 2 字节 */
+#ifndef LZ_STREAM_HASH_BITS
+#define LZ_STREAM_HASH_BITS     10
+#endif
+
+#if (LZ_STREAM_WINDOW & (LZ_STREAM_WINDOW - 1)) != 0
+#error "LZ_STREAM_WINDOW must be a power of 2"
+#endif
+#if LZ_STREAM_WINDOW + LZ_STREAM_BLOCK_MAX > 0xFFFF
+#error "LZ_STREAM_WINDOW + LZ_STREAM_BLOCK_MAX must fit in 16 bits"
+#endif
+
+/*****************************************************************************
+ * 流格式
+ *
+ * 流起始: 4 字节标记 FF 'L' 'Z' '1' (0xFF 不会出现在 UTF-8 文本中)，之后全部是块
+ * 块:     type(1) + comp_len(2, LE) + raw_len(2, LE) + comp_len 字节数据
+ *   type 0  LZ 序列
+ *   type 1  原样存储 (压缩后不比原始数据小时)
+ *   type 2  流结束，长度均为 0，之后又是普通数据，直到下一个流起始标记
+ *
+ * LZ 序列 (与 LZ4 相同的 token 编码):
+ *   token(1): 高 4 位字面量长度，低 4 位匹配长度 - 4，值为 15 时后跟 255 累加的扩展字节
+ *   字面量 | offset(2, LE) | 匹配长度扩展字节
+ *   块的最后一个序列只有字面量 (数据在字面量之后结束)
+ *
+ * 匹配可以引用之前的块 (同一个流内)，解码端保留至少 LZ_STREAM_WINDOW 字节的历史
+ *****************************************************************************/
+
+#define LZ_STREAM_MAGIC         "\xFFLZ1"
+#define LZ_STREAM_MAGIC_LEN     4
+#define LZ_STREAM_HDR_LEN       5
+
+#define LZ_STREAM_TYPE_LZ       0
+#define LZ_STREAM_TYPE_STORED   1
+#define LZ_STREAM_TYPE_END      2
+
+/* 压缩 len 字节时输出的最大长度 (起始标记 + 块头 + 原样存储) */
+#define LZ_STREAM_OUT_MAX(len)  (LZ_STREAM_MAGIC_LEN + LZ_STREAM_HDR_LEN + (len))
+
+/* 基准测试使用的日志文本长度 */
+#define LZ_STREAM_BENCH_LEN     4096
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+typedef struct {
+    uint32_t raw_bytes;     // 输入的原始字节
+    uint32_t out_bytes;     // 输出字节 (含起始标记和块头)
+    uint32_t blocks;
+    uint32_t stored_blocks; // 压缩无收益、原样存储的块
+    uint64_t cycles;        // 压缩消耗的 CPU 周期 (主机编译时为 0)
+} lz_stream_stats_t;
+
+typedef struct {
+    uint8_t buf[LZ_STREAM_WINDOW + LZ_STREAM_BLOCK_MAX];  // 历史 + 当前块
+    uint16_t table[1 << LZ_STREAM_HASH_BITS];              // 4 字节哈希 -> buf 中的位置
+    uint32_t pos;           // buf 中已压缩数据的长度 (下一块从这里开始)
+    bool started;           // 已输出流起始标记
+    lz_stream_stats_t stats;
+} lz_stream_t;
+
+typedef struct {
+    uint32_t len;           // 原始日志文本长度
+    uint32_t out_len;       // 压缩后长度 (含块头)
+    uint32_t cycles;        // 压缩总周期 (主机编译时为 0)
+    bool match;             // 解码结果与原文一致
+} lz_stream_bench_result_t;
+
+/*****************************************************************************
+ * API
+ *
+ * 同一个 lz_stream_t 只能在一个上下文中使用
+ *****************************************************************************/
+
+/**
+ * @brief 开始新流：清空历史，下一块前输出流起始标记
+ *
+ * @note 不清零统计
+ */
+void lz_stream_reset(lz_stream_t *lz);
+
+/**
+ * @brief 获取写入下一块原始数据的位置
+ *
+ * @return 可写入 LZ_STREAM_BLOCK_MAX 字节的缓冲区 (必要时先滑动历史窗口)
+ *
+ * @note 原始数据直接放进压缩器的历史缓冲区，压缩时不再拷贝
+ *
+ * @example
+ *   uint8_t *in = lz_stream_input(&lz);
+ *   uint32_t n = lf_mpsc_ringbuffer_read(&rb, in, LZ_STREAM_BLOCK_MAX);
+ *   uint32_t out_len = lz_stream_compress(&lz, n, out);
+ */
+uint8_t *lz_stream_input(lz_stream_t *lz);
+
+/**
+ * @brief 压缩 lz_stream_input() 位置上的 len 字节，输出一个块
+ *
+ * @param len 原始数据长度，1 ~ LZ_STREAM_BLOCK_MAX
+ * @param out 输出缓冲区，至少 LZ_STREAM_OUT_MAX(len) 字节
+ *
+ * @return 输出长度，len 无效时返回 0
+ */
+uint32_t lz_stream_compress(lz_stream_t *lz, uint32_t len, uint8_t *out);
+
+/**
+ * @brief 结束当前流
+ *
+ * @param out 输出缓冲区，至少 LZ_STREAM_HDR_LEN 字节
+ *
+ * @return 输出长度，还没有输出过数据时为 0
+ *
+ * @note 之后等同于 lz_stream_reset()，解码端回到普通数据
+ */
+uint32_t lz_stream_finish(lz_stream_t *lz, uint8_t *out);
+
+/**
+ * @brief 用生成的典型日志文本测试压缩率和速度，并解码校验
+ *
+ * @note 使用独立的压缩器实例，与正在使用的流互不影响
+ */
+void lz_stream_bench(lz_stream_bench_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LZ_STREAM_H */
@@ -0,0 +1,164 @@
+/*
+ * Static Memory Arena and Runtime Buffer Layout - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef MEM_ARENA_H
+#define MEM_ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 配置
+ *
+ * 大块缓冲区 (CDC 收发环形缓冲区、收发日志捕获、文件区) 不再各自静态分配，
+ * 而是从一块静态内存中按"布局"依次划分。布局可以在运行时切换，也可以存入
+ * Flash，上电时按存储的布局划分
+ *
+ * 内存: 默认放在 CCM RAM (64KB, 不占主 SRAM)，链接脚本的 .ccm_noinit 段，
+ *       不占 Flash 也不在启动时清零。CCM 只接在 CPU 的 D 总线上，DMA 控制器和
+ *       USB 内核自带的 DMA 都访问不到，所以从这里划分出去的缓冲区只能由 CPU 读写:
+ *       - USB (dwc2) 工作在非 DMA 模式，FIFO 由 CPU 搬运 (本工程的默认配置)
+ *       - UART 桥接经 SRAM 中转缓冲区发送 (usb_uart_bridge.c)
+ *       要把这些缓冲区直接交给 DMA，定义 MEM_ARENA_IN_CCM 为 0，内存池放到 SRAM
+ *****************************************************************************/
+
+/* 内存池大小 (字节) */
+#ifndef MEM_ARENA_SIZE
+#define MEM_ARENA_SIZE          (48 * 1024)
+#endif
+
+/* 1: 内存池在 CCM (.ccm_noinit); 0: 放在普通 .bss (SRAM, DMA 可访问) */
+#ifndef MEM_ARENA_IN_CCM
+#define MEM_ARENA_IN_CCM        1
+#endif
+
+/* 内存池所在的段 */
+#ifndef MEM_ARENA_SECTION
+#if MEM_ARENA_IN_CCM
+#define MEM_ARENA_SECTION       __attribute__((section(".ccm_noinit")))
+#else
+#define MEM_ARENA_SECTION
+#endif
+#endif
+
+/* 分配对齐 */
+#define MEM_ARENA_ALIGN         8
+
+/* 布局各部分的最小值 */
+#define MEM_LAYOUT_MIN_SCROLLBACK   2048
+#define MEM_LAYOUT_MIN_FILE         1024    // 一个 YMODEM 1K 块
+
+/*
+ * 布局保存在 Flash 扇区 11 (0x080E0000, 128KB)，链接脚本已把它从程序区中去掉
+ * 每次保存追加一条带 CRC 的记录，扇区写满才擦除一次，上电时取最后一条有效记录
+ */
+#define MEM_LAYOUT_FLASH_ADDR       0x080E0000UL
+#define MEM_LAYOUT_FLASH_SIZE       (128 * 1024)
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+/*
+ * 一种内存划分
+ * - cdc_rx / cdc_tx: 每个 CDC 端口的收发缓冲区 (2的幂，范围见 CDC_RINGBUF_MIN_RX/TX)
+ * - scrollback: 收发日志捕获 (U盘 RX_LOG.TXT / TX_LOG.TXT)，两个方向平分
+ * - file: 文件区 (YMODEM 收发、U盘导出)
+ */
+typedef struct {
+    uint32_t cdc_rx;
+    uint32_t cdc_tx;
+    uint32_t scrollback;
+    uint32_t file;
+} mem_layout_t;
+
+/*****************************************************************************
+ * 内存池 API
+ *****************************************************************************/
+
+/**
+ * @brief 释放全部分配，之后重新从头划分
+ *
+ * @note 之前分配出去的指针全部失效，调用者负责先停止使用它们
+ */
+void mem_arena_reset(void);
+
+/**
+ * @brief 从内存池中分配一块 (按 MEM_ARENA_ALIGN 对齐)
+ *
+ * @return 内存地址，空间不足返回NULL
+ */
+void *mem_arena_alloc(uint32_t size);
+
+/**
+ * @brief 已分配的字节数 (含对齐)
+ */
+uint32_t mem_arena_get_used(void);
+
+/**
+ * @brief 内存池大小
+ */
+uint32_t mem_arena_get_size(void);
+
+/*****************************************************************************
+ * 布局 API
+ *****************************************************************************/
+
+/**
+ * @brief 按名称取得预设布局
+ *
+ * @param name "BALANCED" (默认), "RX" (大接收缓冲区，适合持续接收), "TX" (大发送缓冲区)
+ *
+ * @return 预设布局，名称无效返回NULL
+ *
+ * @note 预设按 CDC_ACM_PORT_NUM 缩放，保证放得进 MEM_ARENA_SIZE
+ */
+const mem_layout_t *mem_layout_preset(const char *name);
+
+/**
+ * @brief 布局需要的内存 (含对齐)
+ */
+uint32_t mem_layout_get_total(const mem_layout_t *layout);
+
+/**
+ * @brief 检查布局是否有效
+ *
+ * @return 0: 有效, -1: 大小不是2的幂/超出范围, -2: 内存池放不下
+ */
+int mem_layout_check(const mem_layout_t *layout);
+
+/**
+ * @brief 读取 Flash 中保存的布局
+ *
+ * @return 0: 成功, -1: 没有有效记录 (或记录的布局已不适用于当前配置)
+ *
+ * @note 使用 CRC 单元校验，需要先调用 crc32_init()
+ */
+int mem_layout_load(mem_layout_t *layout);
+
+/**
+ * @brief 把布局保存到 Flash
+ *
+ * @return 0: 成功 (与已保存的相同时不写入), -1: 布局无效, -2: Flash 操作失败
+ *
+ * @note 只在主循环中调用。写一条记录约几十微秒；扇区写满时需要先擦除，
+ *       期间 (1~2 秒) CPU 停顿，USB 传输暂停
+ *
+ * @example
+ *   mem_layout_save(mem_layout_preset("RX"));
+ */
+int mem_layout_save(const mem_layout_t *layout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MEM_ARENA_H */
@@ -0,0 +1,57 @@
+/*
+ * Variable-length record ringbuffer on top of chry_ringbuffer
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef REC_RINGBUFFER_H
+#define REC_RINGBUFFER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "chry_ringbuffer.h"
+
+/*
+ * 按记录 (消息) 存取的环形缓冲区:
+ * - 每条记录前有 4 字节长度头，记录本身在内存中连续，读者直接拿指针使用，不需要拷出来
+ * - 写者先 reserve 一块连续空间、原地写入，再 commit 实际长度，数据只写一次
+ * - 末尾放不下时写一个填充头跳到开头，记录按 4 字节对齐
+ * - 空间不足或记录数超过 max_count 时丢弃最旧的记录 (历史语义，适合日志/显示行)
+ *
+ * 没有原子操作，写者和读者必须在同一上下文 (主循环)。
+ * pool 按 4 字节对齐，大小为 2 的幂；单条记录 (含头) 不超过 size / 2
+ */
+
+#define REC_RINGBUFFER_HDR_LEN 4
+
+typedef struct {
+    chry_ringbuffer_t rb;
+    uint32_t count;     /*!< 记录数 */
+    uint32_t max_count; /*!< 最多保留的记录数，0 表示只受空间限制 */
+    uint32_t last;      /*!< 最新一条记录的位置 (count > 0 时有效) */
+    uint32_t reserved;  /*!< 当前预留的数据长度，0 表示没有预留 */
+} rec_ringbuffer_t;
+
+extern int rec_ringbuffer_init(rec_ringbuffer_t *r, void *pool, uint32_t size, uint32_t max_count);
+extern void rec_ringbuffer_reset(rec_ringbuffer_t *r);
+extern uint32_t rec_ringbuffer_get_count(rec_ringbuffer_t *r);
+
+/* 写者: reserve 返回的空间在 commit 之前都有效，commit 的长度不超过预留长度 */
+extern void *rec_ringbuffer_reserve(rec_ringbuffer_t *r, uint32_t max_len);
+extern void rec_ringbuffer_commit(rec_ringbuffer_t *r, uint32_t len);
+
+/* 读者: 记录指针在下一次 reserve 之前有效 */
+extern bool rec_ringbuffer_drop_oldest(rec_ringbuffer_t *r);
+extern void *rec_ringbuffer_last(rec_ringbuffer_t *r, uint32_t *len);
+extern uint32_t rec_ringbuffer_iter(rec_ringbuffer_t *r);
+extern void *rec_ringbuffer_next(rec_ringbuffer_t *r, uint32_t *it, uint32_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
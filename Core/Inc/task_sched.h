@@ -0,0 +1,141 @@
+/*
+ * Cooperative Event-Driven Task Scheduler - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TASK_SCHED_H
+#define TASK_SCHED_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 说明
+ *
+ * 主循环不再空转轮询，而是按任务表运行:
+ * - 任务在以下情况运行: 订阅的事件被置位 (中断中调用 sched_event_set)、
+ *   周期到期 (由 1ms 的 SysTick 驱动)、或上一次运行返回 true (还有工作没做完)
+ * - 任务按表中的顺序运行，排在前面的优先。每次只运行一轮，不抢占
+ * - 没有任务要运行时执行 WFI 睡眠，任意中断 (USB、SysTick、EXTI...) 唤醒。
+ *   SysTick 每毫秒唤醒一次，空闲时唤醒次数不低于 1000/s，醒来没有工作立即再睡
+ *
+ * 时间预算: 每个任务有单次运行的预算 (微秒)。超出只计数不打断 (协作式)，
+ *           循环处理数据的任务用 sched_in_budget() 判断何时让出 CPU
+ *
+ * 统计: 用 DWT 周期计数器累计醒着的时间 (WFI 期间内核时钟停止，不计入)，
+ *       每秒算一次 CPU 负载和唤醒次数
+ *****************************************************************************/
+
+/* 事件 (各模块的中断共用一张表) */
+#define SCHED_EV_USB_RX         (1U << 0)   // CDC 收到数据
+#define SCHED_EV_USB_TX         (1U << 1)   // CDC IN 传输完成，发送缓冲区有空间
+#define SCHED_EV_USB_STATE      (1U << 2)   // USB 复位/配置/断开，DTR 变化
+#define SCHED_EV_TOUCH          (1U << 3)   // 触摸屏 INT
+#define SCHED_EV_VENDOR         (1U << 4)   // 厂商批量接口收发完成/配置
+
+/* 统计窗口 (毫秒) */
+#define SCHED_STATS_WINDOW_MS   1000
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+/*
+ * 任务函数
+ * 返回 true 表示还有工作没做完 (例如接收缓冲区中还有数据)，下一轮继续运行，
+ * 期间不进入睡眠
+ */
+typedef bool (*sched_task_fn_t)(void);
+
+typedef struct {
+    /* 配置 */
+    const char *name;
+    sched_task_fn_t fn;
+    uint32_t events;            // 唤醒本任务的事件，0 表示只按周期运行
+    uint16_t period_ms;         // 运行周期，0 表示只由事件触发
+    uint16_t budget_us;         // 单次运行预算 (微秒)，0 表示不限
+
+    /* 运行状态和统计 (由调度器维护) */
+    uint32_t next_tick;         // 下一次周期运行的时刻
+    bool pending;               // 上一次运行返回 true
+    uint32_t runs;              // 运行次数
+    uint32_t overruns;          // 超出预算的次数
+    uint32_t max_us;            // 单次运行最长时间
+    uint64_t total_cycles;      // 累计运行时间 (DWT 周期)
+} sched_task_t;
+
+typedef struct {
+    uint16_t load_pm;           // 上一个统计窗口的 CPU 负载 (千分比)
+    uint32_t wakeups_per_s;     // 上一个统计窗口每秒从 WFI 唤醒的次数
+    uint32_t runs_per_s;        // 上一个统计窗口每秒运行任务的次数
+    uint32_t sleeps;            // 累计 WFI 次数
+} sched_stats_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 初始化调度器
+ *
+ * @param tasks 任务表 (由应用静态定义，调度器保留指针)
+ * @param num 任务数
+ *
+ * @note 所有周期任务第一轮都会运行一次
+ */
+void sched_init(sched_task_t *tasks, uint32_t num);
+
+/**
+ * @brief 运行一轮: 取走已置位的事件，运行需要运行的任务，都不需要时睡眠到下一个中断
+ *
+ * @note 在主循环中反复调用
+ */
+void sched_run(void);
+
+/**
+ * @brief 置位事件，唤醒订阅的任务
+ *
+ * @note 可在中断中调用 (原子操作)
+ */
+void sched_event_set(uint32_t events);
+
+/**
+ * @brief 当前任务是否还在预算内
+ *
+ * @note 只在任务函数中调用，循环处理数据的任务每处理一块检查一次
+ *
+ * @example
+ *   do {
+ *       handle_one_chunk();
+ *   } while (has_more_data() && sched_in_budget());
+ */
+bool sched_in_budget(void);
+
+/**
+ * @brief 获取调度统计
+ */
+void sched_get_stats(sched_stats_t *stats);
+
+/**
+ * @brief 清零各任务的运行统计
+ */
+void sched_reset_stats(void);
+
+/**
+ * @brief 按下标取任务 (用于输出统计)
+ *
+ * @return 任务，超出范围返回NULL
+ */
+const sched_task_t *sched_get_task(uint32_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TASK_SCHED_H */
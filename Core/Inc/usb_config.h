@@ -81,11 +81,11 @@
 #endif
 
 #ifndef CONFIG_USBDEV_MSC_MANUFACTURER_STRING
-#define CONFIG_USBDEV_MSC_MANUFACTURER_STRING ""
+#define CONFIG_USBDEV_MSC_MANUFACTURER_STRING "PolarisY"
 #endif
 
 #ifndef CONFIG_USBDEV_MSC_PRODUCT_STRING
-#define CONFIG_USBDEV_MSC_PRODUCT_STRING ""
+#define CONFIG_USBDEV_MSC_PRODUCT_STRING "Serial Terminal"
 #endif
 
 #ifndef CONFIG_USBDEV_MSC_VERSION_STRING
@@ -249,11 +249,14 @@
 
 /* ================ USB Device Port Configuration ================*/
 
+/* CDC on both OTG_FS and OTG_HS (CDC_ACM_BUS_NUM 2) needs 2 */
 #ifndef CONFIG_USBDEV_MAX_BUS
 #define CONFIG_USBDEV_MAX_BUS 1
 #endif
 
-// #define CONFIG_USBDEV_SOF_ENABLE
+/* cdc_acm_ringbuffer.c uses SOF as the 1ms tick of its tx coalescing deadline,
+ * the interrupt is unmasked only while a port has coalescing on */
+#define CONFIG_USBDEV_SOF_ENABLE
 
 /* ---------------- FSDEV Configuration ---------------- */
 //#define CONFIG_USBDEV_FSDEV_PMA_ACCESS 2 // maybe 1 or 2, many chips may have a difference
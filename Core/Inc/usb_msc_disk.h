@@ -0,0 +1,135 @@
+/*
+ * USB Mass Storage (read-only synthesized FAT12 volume) - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef USB_MSC_DISK_H
+#define USB_MSC_DISK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cdc_acm_ringbuffer.h"
+
+/*****************************************************************************
+ * 配置
+ *****************************************************************************/
+
+/*
+ * 大容量存储接口 (Bulk-Only Transport + SCSI 透明命令集)，与 CDC ACM 组成复合设备
+ *
+ * - 主机看到一个只读 U 盘，卷上的文件由应用注册，内容来自应用自己的缓冲区
+ * - 没有磁盘镜像：引导扇区、FAT、根目录和文件数据都在主机读取时按扇区生成
+ * - 文件大小在"快照"时确定，msc_disk_refresh() 生成新快照并向主机报告介质变化
+ * - 接口号紧跟在 CDC 接口之后
+ *
+ * 端点: 与厂商批量接口相同 (OTG_FS 只剩这一对端点)，两者只能启用一个
+ *       内核上 1 个 CDC 端口时 IN 0x82 / OUT 0x01，2 个 CDC 端口时 IN 0x85 / OUT 0x03
+ */
+#ifndef MSC_DISK_ENABLE
+#define MSC_DISK_ENABLE 1
+#endif
+
+#define MSC_DISK_INTF           (2 * CDC_ACM_BUS_PORTS)
+
+#if CDC_ACM_BUS_PORTS > 1
+#define MSC_DISK_IN_EP          0x85
+#define MSC_DISK_OUT_EP         0x03
+#else
+#define MSC_DISK_IN_EP          0x82
+#define MSC_DISK_OUT_EP         0x01
+#endif
+
+/* 卷大小 (512 字节扇区)，簇大小 4KB，簇数必须保持在 FAT12 范围内 (< 4085) */
+#ifndef MSC_DISK_SECTORS
+#define MSC_DISK_SECTORS        8192    // 4MB
+#endif
+
+#define MSC_DISK_SECTOR_SIZE    512
+#define MSC_DISK_MAX_FILES      8       // 根目录占 1 个扇区 (16 项)，其中 1 项为卷标
+
+/* 接口描述符 + 2 个端点描述符 */
+#define MSC_DISK_DESCRIPTOR_LEN (9 + 7 + 7)
+
+/* bInterfaceClass 0x08 (MSC), bInterfaceSubClass 0x06 (SCSI), bInterfaceProtocol 0x50 (BOT) */
+#define MSC_DISK_DESCRIPTOR_INIT(bInterfaceNumber, out_ep, in_ep, wMaxPacketSize)    \
+    USB_INTERFACE_DESCRIPTOR_INIT(bInterfaceNumber, 0x00, 0x02, 0x08, 0x06, 0x50, 0x00), \
+    USB_ENDPOINT_DESCRIPTOR_INIT(out_ep, 0x02, wMaxPacketSize, 0x00),                  \
+    USB_ENDPOINT_DESCRIPTOR_INIT(in_ep, 0x02, wMaxPacketSize, 0x00)
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+/*
+ * 卷上的一个文件
+ *
+ * 回调在 USB 中断中执行，只能读取应用数据，不能阻塞
+ * - snapshot: 冻结当前内容 (例如记下环形缓冲区的起止位置)，返回文件大小
+ * - read: 读取快照中 [offset, offset + len) 的内容，offset 和 len 不会超出快照大小
+ */
+typedef struct {
+    const char *name;       // 8.3 文件名，如 "RX_LOG.TXT"，不区分大小写
+    uint32_t (*snapshot)(void *ctx);
+    void (*read)(void *ctx, uint32_t offset, uint8_t *buf, uint32_t len);
+    void *ctx;
+} msc_disk_file_t;
+
+/*****************************************************************************
+ * 初始化
+ *****************************************************************************/
+
+/**
+ * @brief 注册大容量存储接口和端点
+ *
+ * @param busid USB总线ID
+ *
+ * @note 由 cdc_acm_init() 在添加完 CDC 接口之后、usbd_initialize() 之前调用，
+ *       用户无需直接调用
+ */
+void msc_disk_add_interface(uint8_t busid);
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 在卷上添加一个文件
+ *
+ * @param file 文件描述，必须在程序运行期间保持有效
+ *
+ * @return 0: 成功, -1: 文件数已满
+ *
+ * @note 在主循环中调用，按注册顺序出现在根目录中，下一次快照时生效
+ *
+ * @example
+ *   static const msc_disk_file_t log_file = {
+ *       .name = "RX_LOG.TXT", .snapshot = log_snapshot, .read = log_read, .ctx = &rx_log,
+ *   };
+ *   msc_disk_register_file(&log_file);
+ */
+int msc_disk_register_file(const msc_disk_file_t *file);
+
+/**
+ * @brief 请求生成新快照
+ *
+ * @note 快照在处理下一条 SCSI 命令前生成 (USB 中断中)，之后主机收到一次
+ *       "介质已更换"，会重新读取 FAT 和目录。已挂载的卷在部分系统上需要重新挂载
+ */
+void msc_disk_refresh(void);
+
+/**
+ * @brief 主机是否已配置设备
+ */
+bool msc_disk_is_configured(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_MSC_DISK_H */
@@ -0,0 +1,115 @@
+/*
+ * USB CDC ACM <-> USART1 Bridge - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef USB_UART_BRIDGE_H
+#define USB_UART_BRIDGE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cdc_acm_ringbuffer.h"
+
+/*****************************************************************************
+ * 配置
+ *****************************************************************************/
+
+/*
+ * 桥接模式把默认 CDC 端口和 USART1 (PA9/PA10) 直连，板子变成一个 USB 串口适配器
+ *
+ * - 主机的 SET_LINE_CODING 在主循环中应用到 USART1 (波特率/校验/停止位)
+ * - UART -> USB: DMA 循环接收 + 空闲中断，数据在中断里直接写入 CDC 发送缓冲区
+ * - USB -> UART: CDC 接收缓冲区的数据复制到 SRAM 中转缓冲区后由 DMA 发送，完成中断里
+ *   链式启动下一段 (CDC 缓冲区由 mem_arena 划分，默认在 CCM，DMA2 访问不到)
+ *   CDC 接收缓冲区满时 OUT 端点暂停，主机被 NAK，不会丢数据
+ *
+ * 2 Mbaud 时每秒约 200KB，UART_BRIDGE_RX_DMA_SIZE 决定了 USB 侧最多可以停顿多久
+ */
+#ifndef UART_BRIDGE_RX_DMA_SIZE
+#define UART_BRIDGE_RX_DMA_SIZE 2048    // 2 Mbaud 下约 10ms
+#endif
+
+/* USB -> UART 的 DMA 中转缓冲区，一次发送的最大字节数 (2 Mbaud 下 1KB 约 5ms) */
+#ifndef UART_BRIDGE_TX_DMA_SIZE
+#define UART_BRIDGE_TX_DMA_SIZE 1024
+#endif
+
+/* 监视记录: 每段数据最多保留的字节数，供屏幕日志显示 */
+#define UART_BRIDGE_MON_CHUNK   32
+#define UART_BRIDGE_MON_SIZE    1024
+
+typedef struct {
+    cdc_acm_line_coding_t line_coding; // 当前生效的串口参数
+    uint32_t uart_to_usb;              // 累计字节数
+    uint32_t usb_to_uart;
+    uint32_t dropped;                  // 主机未打开端口或 USB 侧停顿过久被 DMA 覆盖的 UART 数据，以及出错中止的发送
+    uint32_t uart_errors;              // 帧错误/噪声/溢出次数
+} uart_bridge_stats_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 进入桥接模式
+ *
+ * @return 0: 成功
+ *
+ * @note 进入后默认 CDC 端口的接收数据全部转发到 USART1，
+ *       应用不能再调用 cdc_acm_read_data() 等读取接口
+ */
+int uart_bridge_start(void);
+
+/**
+ * @brief 退出桥接模式，停止 USART1 的 DMA 收发
+ */
+void uart_bridge_stop(void);
+
+/**
+ * @brief 是否处于桥接模式
+ */
+bool uart_bridge_is_active(void);
+
+/**
+ * @brief 桥接主循环任务
+ *
+ * @return 本次调用应用了新的串口参数时返回 true
+ *
+ * @note 负责应用串口参数、错误恢复，以及中断里没能搬完的数据
+ */
+bool uart_bridge_task(void);
+
+/**
+ * @brief 读取一条监视记录
+ *
+ * @param to_host 输出参数，true: UART -> USB, false: USB -> UART
+ * @param text 输出缓冲区，不可打印字符替换为 '.'，以 '\0' 结尾
+ * @param max_len 输出缓冲区长度
+ *
+ * @return 记录的字节数，0 表示没有记录
+ *
+ * @example
+ *   bool to_host;
+ *   char text[UART_BRIDGE_MON_CHUNK + 1];
+ *   while (uart_bridge_monitor_read(&to_host, text, sizeof(text)) > 0) {
+ *       add_to_log(!to_host, text);
+ *   }
+ */
+uint32_t uart_bridge_monitor_read(bool *to_host, char *text, uint32_t max_len);
+
+/**
+ * @brief 获取桥接统计
+ */
+void uart_bridge_get_stats(uart_bridge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_UART_BRIDGE_H */
@@ -0,0 +1,212 @@
+/*
+ * USB Vendor Bulk Channel (WinUSB) with CherryRingBuffer - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef USB_VENDOR_BULK_H
+#define USB_VENDOR_BULK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "cdc_acm_ringbuffer.h"
+#include "usb_msc_disk.h"
+
+/*****************************************************************************
+ * 配置
+ *****************************************************************************/
+
+/*
+ * 厂商自定义批量接口，与 CDC ACM 组成复合设备
+ *
+ * - 没有 line coding / DTR，枚举完成即可收发，适合原始二进制流
+ * - 通过 MS OS 2.0 + BOS 描述符在 Windows 上免驱绑定 WinUSB，Linux 下用 libusb 访问
+ * - 接口号紧跟在 CDC 接口之后
+ *
+ * 端点: 1 个 CDC 端口时 IN 0x82 / OUT 0x01 (OTG_FS 剩余的端点)
+ *       同一内核上 2 个 CDC 端口时 IN 0x85 / OUT 0x03 (OTG_HS)
+ *       与 U 盘接口 (usb_msc_disk.h) 使用同一对端点，默认在 U 盘关闭时启用
+ */
+#ifndef VENDOR_BULK_ENABLE
+#define VENDOR_BULK_ENABLE (!MSC_DISK_ENABLE)
+#endif
+
+#if VENDOR_BULK_ENABLE && MSC_DISK_ENABLE
+#error "VENDOR_BULK_ENABLE and MSC_DISK_ENABLE share the same endpoints, enable only one"
+#endif
+
+#define VENDOR_BULK_INTF        (2 * CDC_ACM_BUS_PORTS)
+
+#if CDC_ACM_BUS_PORTS > 1
+#define VENDOR_BULK_IN_EP       0x85
+#define VENDOR_BULK_OUT_EP      0x03
+#else
+#define VENDOR_BULK_IN_EP       0x82
+#define VENDOR_BULK_OUT_EP      0x01
+#endif
+
+/* 主机读取 MS OS 2.0 描述符集合所用的 bRequest */
+#define VENDOR_BULK_VENDOR_CODE 0x17
+
+/* 接口描述符 + 2 个端点描述符 */
+#define VENDOR_BULK_DESCRIPTOR_LEN (9 + 7 + 7)
+
+#define VENDOR_BULK_DESCRIPTOR_INIT(bInterfaceNumber, out_ep, in_ep, wMaxPacketSize)    \
+    USB_INTERFACE_DESCRIPTOR_INIT(bInterfaceNumber, 0x00, 0x02, 0xFF, 0x00, 0x00, 0x00), \
+    USB_ENDPOINT_DESCRIPTOR_INIT(out_ep, 0x02, wMaxPacketSize, 0x00),                    \
+    USB_ENDPOINT_DESCRIPTOR_INIT(in_ep, 0x02, wMaxPacketSize, 0x00)
+
+/*
+ * 测试模式 (主机基准测试 Tools/vendor_bulk_bench.py)
+ *
+ * SET_MODE: bmRequestType 0x41, wValue = 模式, wIndex = 接口号，切换时清空收发缓冲区和计数
+ * GET_STATS: bmRequestType 0xC1, 返回 3 个小端 uint32: 接收字节, 发送字节, 丢失字节 (仅 SINK)
+ */
+#define VENDOR_BULK_REQ_SET_MODE  0x01
+#define VENDOR_BULK_REQ_GET_STATS 0x02
+
+typedef enum {
+    VENDOR_BULK_MODE_LOOP = 0,  // 默认: 原样回显
+    VENDOR_BULK_MODE_SOURCE,    // 以最大速率发送测试图案 (与 cdc_bench.h 相同)
+    VENDOR_BULK_MODE_SINK,      // 接收并校验测试图案
+    VENDOR_BULK_MODE_NUM
+} vendor_bulk_mode_t;
+
+/* 事件通知 (vendor_bulk_set_event_callback)，位定义同 CDC_ACM_EVENT_xxx */
+typedef void (*vendor_bulk_event_cb_t)(uint8_t events);
+
+/* WinUSB 所需的 MS OS 2.0 描述符集合和 BOS 描述符，由 cdc_acm_ringbuffer.c 注册 */
+struct usb_msosv2_descriptor;
+struct usb_bos_descriptor;
+extern struct usb_msosv2_descriptor vendor_bulk_msosv2_desc;
+extern struct usb_bos_descriptor vendor_bulk_bos_desc;
+
+/*****************************************************************************
+ * 初始化
+ *****************************************************************************/
+
+/**
+ * @brief 注册厂商批量接口和端点
+ *
+ * @param busid USB总线ID
+ *
+ * @note 由 cdc_acm_init() 在添加完 CDC 接口之后、usbd_initialize() 之前调用，
+ *       用户无需直接调用
+ */
+void vendor_bulk_add_interface(uint8_t busid);
+
+/*****************************************************************************
+ * 收发API
+ *****************************************************************************/
+
+/**
+ * @brief 写入数据到发送缓冲区并尝试发送
+ *
+ * @return 实际写入的字节数，未枚举时返回 -1
+ */
+int vendor_bulk_write(const uint8_t *data, uint32_t len);
+
+/**
+ * @brief 从接收缓冲区读取数据
+ *
+ * @return 实际读取的字节数
+ */
+int vendor_bulk_read(uint8_t *buffer, uint32_t max_len);
+
+/**
+ * @brief 获取接收缓冲区中可读的字节数
+ */
+uint32_t vendor_bulk_get_rx_available(void);
+
+/**
+ * @brief 获取发送缓冲区剩余空间
+ */
+uint32_t vendor_bulk_get_tx_free(void);
+
+/**
+ * @brief 主机是否已完成配置（可以收发）
+ */
+bool vendor_bulk_is_configured(void);
+
+/*****************************************************************************
+ * 零拷贝API
+ *
+ * USB 端点直接读写环形缓冲区内存，数据全程不经过中间缓冲区：
+ * - OUT 传输直接落在接收缓冲区的线性写区域
+ * - IN 传输直接从发送缓冲区的线性读区域发出，完成后才释放空间
+ *****************************************************************************/
+
+/**
+ * @brief 获取接收缓冲区中连续可读的数据
+ *
+ * @param size 输出参数，返回可连续读取的字节数
+ *
+ * @return 数据指针，处理完后必须调用 vendor_bulk_rx_done()
+ *
+ * @example
+ *   uint32_t size;
+ *   uint8_t *ptr = vendor_bulk_rx_setup(&size);
+ *   if (size > 0) {
+ *       process_data_inplace(ptr, size);
+ *       vendor_bulk_rx_done(size);
+ *   }
+ */
+void *vendor_bulk_rx_setup(uint32_t *size);
+
+/**
+ * @brief 释放已处理的接收数据，若接收因缓冲区满而暂停则重新启动
+ */
+void vendor_bulk_rx_done(uint32_t size);
+
+/**
+ * @brief 获取发送缓冲区中连续可写的空间
+ *
+ * @param size 输出参数，返回可连续写入的字节数
+ *
+ * @return 写入指针，写完后必须调用 vendor_bulk_tx_done()
+ */
+void *vendor_bulk_tx_setup(uint32_t *size);
+
+/**
+ * @brief 提交已写入的数据并触发发送
+ */
+void vendor_bulk_tx_done(uint32_t size);
+
+/*****************************************************************************
+ * 测试服务
+ *****************************************************************************/
+
+/**
+ * @brief 注册事件通知回调
+ *
+ * @param cb 回调函数，NULL 取消注册
+ *
+ * @note 在USB中断中执行 (收到数据、IN 传输完成、配置完成)，只用来唤醒主循环
+ */
+void vendor_bulk_set_event_callback(vendor_bulk_event_cb_t cb);
+
+/**
+ * @brief 按主机选择的模式搬运数据 (回显 / 发送图案 / 接收校验)
+ *
+ * @return true: 还有数据没处理完
+ *
+ * @note 在主循环中调用，是接收缓冲区唯一的消费者和发送缓冲区唯一的生产者；
+ *       应用自己使用收发API时不要调用
+ */
+bool vendor_bulk_task(void);
+
+/**
+ * @brief 获取当前测试模式
+ */
+vendor_bulk_mode_t vendor_bulk_get_mode(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* USB_VENDOR_BULK_H */
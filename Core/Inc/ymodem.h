@@ -0,0 +1,136 @@
+/*
+ * YMODEM File Transfer over USB CDC ACM - Header File
+ *
+ * Copyright (c) 2024
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef YMODEM_H
+#define YMODEM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*****************************************************************************
+ * 协议
+ *
+ * YMODEM-1K: 1024 字节数据块 (STX)，最后不足 128 字节时用 128 字节块 (SOH)，
+ * CRC-16/XMODEM 校验，块 0 携带文件名和大小。与 lrzsz (sb/rb)、Tera Term 等兼容
+ *
+ * 减少往返等待:
+ * - 接收: 可以用 'G' 请求 YMODEM-g 流式传输，发送方连续发块，不等待 ACK
+ *   USB 链路本身有 CRC 和重传，缓冲区满时 OUT 端点 NAK，数据不会丢失
+ * - 发送: 对方请求 'G' 时流式发送；请求 'C' 时最多 YMODEM_TX_WINDOW 个块不等
+ *   ACK 连续发出 (滑动窗口)，收到 NAK 或超时从第一个未确认的块重发
+ *
+ * 引擎在主循环中运行，直接读写所选端口的收发缓冲区，传输期间应用不能读取该端口的接收数据
+ *****************************************************************************/
+
+/* 未确认块的最大数量，受发送缓冲区 (4KB) 限制，设为 1 即标准停等方式 */
+#ifndef YMODEM_TX_WINDOW
+#define YMODEM_TX_WINDOW        3
+#endif
+
+#define YMODEM_NAME_MAX         64      // 文件名最大长度 (含 '\0')
+#define YMODEM_START_TIMEOUT_MS 60000   // 等待对端启动的时间，留给操作员在主机上启动程序
+#define YMODEM_RETRY_MS         1000    // 接收方重发 'C'/NAK 的间隔
+#define YMODEM_ACK_TIMEOUT_MS   5000    // 发送方等待 ACK 的时间
+#define YMODEM_MAX_RETRY        10      // 连续超时/错误次数上限
+
+/*****************************************************************************
+ * 类型定义
+ *****************************************************************************/
+
+typedef enum {
+    YMODEM_IDLE = 0,
+    YMODEM_RUNNING,
+    YMODEM_DONE,            // 传输完成 (ymodem_task() 只返回一次)
+    YMODEM_FAILED,          // 传输失败或被取消 (ymodem_task() 只返回一次)
+} ymodem_status_t;
+
+typedef struct {
+    bool sending;           // true: 设备 -> 主机
+    bool streaming;         // 使用了 YMODEM-g
+    char name[YMODEM_NAME_MAX];
+    uint32_t size;          // 文件大小 (接收时为头块声明的大小，未声明时为实际长度)
+    uint32_t bytes;         // 已传输的文件字节数
+    uint32_t blocks;        // 已传输的数据块
+    uint32_t retries;       // NAK、重发和超时次数
+    uint32_t elapsed_ms;
+    const char *error;      // 失败原因，成功时为 NULL
+} ymodem_result_t;
+
+/*****************************************************************************
+ * API
+ *****************************************************************************/
+
+/**
+ * @brief 开始接收一个文件
+ *
+ * @param port CDC端口号
+ * @param buf 文件存放缓冲区
+ * @param buf_size 缓冲区长度，文件超过该长度时取消传输
+ * @param streaming true: 请求 YMODEM-g 流式传输 (发送方需支持，如 sb -g)
+ *
+ * @return 0: 成功, -1: 已有传输在进行
+ *
+ * @note 只接收批次中的第一个文件，之后的文件会被取消
+ */
+int ymodem_receive_start(uint8_t port, uint8_t *buf, uint32_t buf_size, bool streaming);
+
+/**
+ * @brief 开始发送一个文件
+ *
+ * @param port CDC端口号
+ * @param name 文件名
+ * @param data 文件内容，传输结束前必须保持有效
+ * @param len 文件长度
+ *
+ * @return 0: 成功, -1: 已有传输在进行
+ */
+int ymodem_send_start(uint8_t port, const char *name, const void *data, uint32_t len);
+
+/**
+ * @brief 传输主循环任务
+ *
+ * @return 当前状态，传输结束时返回一次 YMODEM_DONE 或 YMODEM_FAILED，之后为 YMODEM_IDLE
+ *
+ * @example
+ *   switch (ymodem_task()) {
+ *       case YMODEM_DONE:
+ *       case YMODEM_FAILED:
+ *           ymodem_get_result(&res);
+ *           report(&res);
+ *           break;
+ *       default:
+ *           break;
+ *   }
+ */
+ymodem_status_t ymodem_task(void);
+
+/**
+ * @brief 取消传输 (向对端发送 CAN)
+ *
+ * @note 下一次 ymodem_task() 返回 YMODEM_FAILED
+ */
+void ymodem_abort(void);
+
+/**
+ * @brief 是否有传输在进行
+ */
+bool ymodem_is_active(void);
+
+/**
+ * @brief 获取传输进度或结果
+ */
+void ymodem_get_result(ymodem_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* YMODEM_H */
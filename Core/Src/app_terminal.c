@@ -1,7 +1,21 @@
 #include "app_terminal.h"
+#include "cdc_bench.h"
+#include "cdc_frame.h"
+#include "cdc_mux.h"
+#include "crc32.h"
+#include "lz_stream.h"
+#include "mem_arena.h"
+#include "rec_ringbuffer.h"
+#include "task_sched.h"
+#include "usb_uart_bridge.h"
+#include "usb_msc_disk.h"
+#include "usb_vendor_bulk.h"
+#include "ymodem.h"
 #include "stm32f4xx_hal.h" // 需要包含以获取 USB_OTG_FS_PERIPH_BASE
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 
 // --- 屏幕尺寸 (从 lcddev 获取, 但可用于静态数组) ---
@@ -35,10 +49,12 @@
 // --- 存储和日志定义 ---
 #define MAX_LOG_LINES           6       // 日志区显示行数 (RX 和 TX 各自)
 #define MAX_LOG_WIDTH           98      // 日志每行最大字符数
+#define LOG_RING_SIZE           1024    // 每个日志区的记录环形缓冲区 (2的幂, 放得下 MAX_LOG_LINES 行最长的行)
 #define MAX_STORAGE_SLOTS       4       // 数据存储槽数量
 #define MAX_STORAGE_WIDTH       100     // 存储槽最大字符数
 #define MAX_KEY_BUFFER_LEN      90      // 键盘输入框最大长度
 #define MAX_CHUNK_BUFFER_LEN    256    // 长数据重组缓冲区长度
+// YMODEM 文件区和 RX/TX 日志捕获的大小由内存布局决定 (mem_arena.h), 显示相关的缓冲区保持固定
 
 // --- 触控按键结构体 ---
 typedef struct {
@@ -84,8 +100,14 @@ static TouchContext_t g_touch_ctx = {
     .pressed_key = NULL
 };
 
-#define RELEASE_DEBOUNCE_FRAMES 40 // 连续 40 帧检测不到触摸才确认抬起
-static uint8_t g_release_debounce_count = 0; // 抬起去抖计数器
+#ifndef TOUCH_USE_INT
+#define TOUCH_USE_INT     1  // 1: INT (PB1) 中断触发读取, 空闲时不访问 I2C; 0: 定时轮询
+#endif
+#define TOUCH_SCAN_MS     5  // 触摸任务周期 (轮询模式的扫描周期, 中断模式只检查超时)
+#define TOUCH_INT_LOST_MS 30 // 中断模式: 按下期间这么久没有 INT 就主动读一次
+#define TOUCH_RELEASE_MS  60 // 按下期间这么久没有新的触摸帧, 认为漏掉了抬起帧
+static uint32_t g_touch_last_frame_tick = 0;   // 最近一次有触摸点的帧的时间
+static uint32_t g_touch_latency_max_us = 0;    // INT 到状态机处理的最长延迟
 
 
 // --- USB Bus ID ---
@@ -164,11 +186,43 @@ static TouchKey_t control_buttons[] = {
 };
 #define CONTROL_KEY_COUNT (sizeof(control_buttons) / sizeof(TouchKey_t))
 
+// 基准测试按钮 (在标题栏右侧，点击循环切换模式)
+#define BENCH_KEY_W 100
+static const char* bench_key_labels[CDC_BENCH_MODE_NUM] = {
+    "Bench:Off", "Bench:Src", "Bench:Sink", "Bench:Loop"
+};
+static TouchKey_t bench_key = {
+    SCREEN_WIDTH - BENCH_KEY_W - 5, 2, BENCH_KEY_W, ZONE_TITLE_H - 4, "Bench:Off", COLOR_KEY_BG, false
+};
+#define BENCH_STATUS_X 236 // 标题栏中测试结果的显示位置
+static bool g_bench_host_seen = false; // 本次测试中主机是否打开过端口, 打开后再关闭即结束测试
+
+// USB-UART 桥接按钮 (在基准测试按钮左侧)
+static TouchKey_t bridge_key = {
+    SCREEN_WIDTH - BENCH_KEY_W * 2 - 10, 2, BENCH_KEY_W, ZONE_TITLE_H - 4, "Bridge:Off", COLOR_KEY_BG, false
+};
+
+// 诊断页按钮 (在桥接按钮左侧), 诊断页覆盖两个日志区
+#define DIAG_KEY_W 60
+static TouchKey_t diag_key = {
+    SCREEN_WIDTH - BENCH_KEY_W * 2 - DIAG_KEY_W - 15, 2, DIAG_KEY_W, ZONE_TITLE_H - 4, "Diag", COLOR_KEY_BG, false
+};
+static bool diag_page_active = false;
+#define DIAG_REFRESH_MS  500 // 诊断页刷新周期
+#define BRIDGE_STATUS_MS 500 // 桥接状态刷新周期
+#define FILE_STATUS_MS   500 // 文件传输进度刷新周期
+#define MSC_REFRESH_MS   5000 // 日志有变化时最多每隔多久让主机重新读取 U 盘
+
 
 // --- 全局缓冲区和状态 ---
-// 日志
-static char rx_log_lines[MAX_LOG_LINES][MAX_LOG_WIDTH] = {0};
-static char tx_log_lines[MAX_LOG_LINES][MAX_LOG_WIDTH] = {0};
+// 日志: 每行是记录环形缓冲区中的一条记录 (含结尾的 0), 只保留最后 MAX_LOG_LINES 行,
+// 写入时原地生成, 屏幕直接从记录绘制, 滚动不搬移数据
+static rec_ringbuffer_t rx_log;
+static rec_ringbuffer_t tx_log;
+static uint32_t rx_log_pool[LOG_RING_SIZE / 4];
+static uint32_t tx_log_pool[LOG_RING_SIZE / 4];
+static cdc_acm_rx_ts_t rx_log_last_ts; // 上一条接收消息的时间, 用于时间间隔前缀
+static bool rx_log_last_valid = false;
 // static int rx_log_idx = 0;
 // static int tx_log_idx = 0;
 // 存储 (满足Req 4: 3条以上)
@@ -185,6 +239,22 @@ static int keyboard_buffer_idx = 0;
 static char chunk_buffer[MAX_CHUNK_BUFFER_LEN] = {0};
 static int chunk_buffer_idx = 0;
 static bool chunk_receiving = false;
+// 文件传输 (YMODEM), 同一时间只保存一个文件
+static uint8_t* file_area = NULL;
+static uint32_t file_area_size = 0;
+static uint32_t file_area_len = 0; // 文件区中完整文件的长度
+// 日志捕获: 屏幕只显示最后几行, 完整历史保存在环形缓冲区中, 通过 U 盘导出
+typedef struct {
+    char* buf;
+    uint32_t size;              // 缓冲区大小
+    volatile uint32_t total;    // 写入的总字节数 (自由增长)
+    uint32_t snap_start;        // U 盘快照的起点 (总字节数坐标)
+} CaptureRing_t;
+static CaptureRing_t rx_capture;
+static CaptureRing_t tx_capture;
+static bool capture_dirty = false;
+// 当前内存布局 (CDC 收发缓冲区、日志捕获、文件区都从 mem_arena 划分)
+static mem_layout_t mem_layout;
 
 /*
 ================================================================================
@@ -195,7 +265,11 @@ static void draw_key(TouchKey_t *key);
 static void draw_main_ui(void);
 static void refresh_log_text(bool is_rx_zone);
 static void draw_log_area(bool is_rx_zone);
+static uint32_t log_text_len(const char* msg, uint32_t max);
 static void add_to_log(bool is_rx_zone, const char* msg);
+static void commit_log_line(bool is_rx_zone, char* line, uint32_t len);
+static uint32_t rx_log_prefix(char* line, const cdc_acm_rx_ts_t* rx_ts);
+static void commit_rx_log(char* line, uint32_t len, const cdc_acm_rx_ts_t* rx_ts);
 static void add_to_storage(bool is_rx, const char* msg);
 static void query_storage(bool is_rx);
 static void clear_storage(bool is_rx);
@@ -207,11 +281,77 @@ static void reset_long_press_trigger(void);
 static void handle_key_press(TouchKey_t* key); // busid 从 g_busid 获取
 // static void handle_long_press(TouchKey_t* key);
 static void update_keyboard_buffer_display(void);
-static void process_received_data(uint8_t* data, uint32_t len);
+static void process_received_data(uint8_t* data, uint32_t len, const cdc_acm_rx_ts_t* rx_ts);
+static bool process_command(char* str_data);
+static void add_rx_log(const cdc_acm_rx_ts_t* rx_ts, const char* msg);
+static void process_received_frame(const cdc_frame_t* frame);
 static void send_chunked_data(void); // busid 从 g_busid 获取
+static void set_bench_mode(cdc_bench_mode_t mode);
+static void show_bench_report(const cdc_bench_report_t* rpt);
+static void run_crc_bench(void);
+static void run_lz_bench(void);
+static void set_tx_compress(bool on);
+static void show_title_status(const char* line);
+static void set_bridge_mode(bool on);
+static void bridge_task_handler(void);
+static void start_file_receive(bool streaming);
+static void start_file_send(void);
+static void file_task_handler(void);
+static void set_diag_page(bool on);
+static void draw_diag_page(bool force);
+static void print_usb_stats(void);
+static void capture_append(CaptureRing_t* cap, const char* msg);
+static int apply_mem_layout(const mem_layout_t* layout);
+static void mem_command(const char* arg);
+#if MSC_DISK_ENABLE
+static void msc_register_files(void);
+static void msc_task_handler(void);
+#endif
 
 static void cdc_task_handler(void);
+static void mux_task_handler(void);
+#if CDC_ACM_PORT_NUM > 1
+static void ctrl_task_handler(void);
+#endif
 static void touch_task_handler(void);
+static void touch_state_machine(const GT_TouchEvent_t* ev);
+#if TOUCH_USE_INT
+static void touch_irq_notify(void);
+#endif
+static void print_sched_stats(void);
+static void print_touch_stats(void);
+
+/* ========== 任务表 ========== */
+// 排在前面的优先运行; 周期是没有事件时的最长间隔
+static bool usb_task(void);
+#if CDC_ACM_PORT_NUM > 1
+static bool ctrl_task(void);
+#endif
+static bool touch_task(void);
+static bool tx_task(void);
+static bool ui_task(void);
+static void usb_event_callback(uint8_t port, uint8_t events);
+#if VENDOR_BULK_ENABLE
+static void vendor_event_callback(uint8_t events);
+#endif
+
+static sched_task_t app_tasks[] = {
+    { .name = "usb", .fn = usb_task, .period_ms = 10, .budget_us = 2000,
+      .events = SCHED_EV_USB_RX | SCHED_EV_USB_TX | SCHED_EV_USB_STATE },
+#if CDC_ACM_PORT_NUM > 1
+    { .name = "ctrl", .fn = ctrl_task, .period_ms = 50, .budget_us = 500,
+      .events = SCHED_EV_USB_RX | SCHED_EV_USB_STATE },
+#endif
+#if VENDOR_BULK_ENABLE
+    { .name = "vendor", .fn = vendor_bulk_task, .period_ms = 50, .budget_us = 1000,
+      .events = SCHED_EV_VENDOR },
+#endif
+    { .name = "touch", .fn = touch_task, .period_ms = TOUCH_SCAN_MS, .budget_us = 1000,
+      .events = SCHED_EV_TOUCH },
+    { .name = "tx", .fn = tx_task, .period_ms = 10, .budget_us = 200,
+      .events = SCHED_EV_USB_STATE },
+    { .name = "ui", .fn = ui_task, .period_ms = 100, .budget_us = 20000 },
+};
 
 
 /*
@@ -226,9 +366,34 @@ static void touch_task_handler(void);
 int App_Terminal_Init(uint8_t busid)
 {
     g_busid = busid; // 存储 busid 供全局使用
+    rec_ringbuffer_init(&rx_log, rx_log_pool, LOG_RING_SIZE, MAX_LOG_LINES);
+    rec_ringbuffer_init(&tx_log, tx_log_pool, LOG_RING_SIZE, MAX_LOG_LINES);
+
+    /* 内存布局: 优先使用 Flash 中保存的布局 (CDC 缓冲区必须在 cdc_acm_init 之前指定) */
+    crc32_init();
+    if (mem_layout_load(&mem_layout) != 0 || apply_mem_layout(&mem_layout) != 0) {
+        apply_mem_layout(mem_layout_preset("BALANCED"));
+    }
 
-    /* USB CDC 驱动初始化 */
+    /* USB CDC 驱动初始化 (USB中断通过事件唤醒主循环) */
+    cdc_acm_set_event_callback(usb_event_callback);
+#if VENDOR_BULK_ENABLE
+    vendor_bulk_set_event_callback(vendor_event_callback);
+#endif
+#if CDC_ACM_BUS_PORTS > 1
+    // 一个内核上两个端口: 只有 OTG_HS (PB14/PB15, 内部FS PHY) 的端点够用, 端口1作为控制通道
+    cdc_acm_init(g_busid, USB_OTG_HS_PERIPH_BASE);
+#else
     cdc_acm_init(g_busid, USB_OTG_FS_PERIPH_BASE);
+#endif
+#if CDC_ACM_BUS_NUM > 1
+    // 第二个内核 (PB14/PB15) 上的端口1作为控制通道, 端口0专门传数据
+    cdc_acm_init(g_busid + 1, USB_OTG_HS_PERIPH_BASE);
+#endif
+    cdc_frame_init();
+#if MSC_DISK_ENABLE
+    msc_register_files();
+#endif
 
     /* LCD 驱动初始化 */
     LCD_Init(); 
@@ -243,34 +408,24 @@ int App_Terminal_Init(uint8_t busid)
         LCD_ShowString(10, 10, 400, 20, 16, (uint8_t*)"Touch Init FAILED! Check I2C.");
         return -1;
     }
+#if TOUCH_USE_INT
+    GT9147_IRQ_Enable(touch_irq_notify);
+#endif
     
     /* 4. 绘制主 UI */
     draw_main_ui();
+
+    sched_init(app_tasks, sizeof(app_tasks) / sizeof(app_tasks[0]));
     
     return 0;
 }
 
 /**
- * @brief 终端应用的任务轮询
- */
-/**
- * @brief 终端应用的任务轮询
+ * @brief 终端应用的任务轮询: 运行到期的任务, 没有工作时睡眠到下一个中断
  */
 void App_Terminal_Tasks(void)
 {
-    // 任务1: 处理USB接收
-    cdc_task_handler();
-    
-    // 任务2: 处理触摸输入
-    touch_task_handler();
-    
-    // 任务3 (可选): 显示触摸调试信息
-    #ifdef ENABLE_TOUCH_DEBUG
-    display_touch_debug_info();
-    #endif
-    
-    // 任务4: 定期调用USB发送（确保数据及时发出）
-    cdc_acm_try_send(g_busid);
+    sched_run();
 }
 
 
@@ -326,6 +481,9 @@ static void draw_main_ui(void)
     for (int i = 0; i < CONTROL_KEY_COUNT; i++) {
         draw_key(&control_buttons[i]);
     }
+    draw_key(&bench_key);
+    draw_key(&bridge_key);
+    draw_key(&diag_key);
 }
 
 /**
@@ -335,8 +493,17 @@ static void draw_main_ui(void)
 static void refresh_log_text(bool is_rx_zone)
 {
     uint16_t y_start = is_rx_zone ? ZONE_RX_LOG_Y : ZONE_TX_LOG_Y;
-    char (*log_lines)[MAX_LOG_WIDTH] = is_rx_zone ? rx_log_lines : tx_log_lines;
+    rec_ringbuffer_t* log = is_rx_zone ? &rx_log : &tx_log;
+    uint32_t it = rec_ringbuffer_iter(log);
+    uint32_t len;
+    // 行数不足时最新一行仍在最下面
+    int first = MAX_LOG_LINES - (int)rec_ringbuffer_get_count(log);
     
+    // 诊断页盖住了日志区, 关闭时整体重绘
+    if (diag_page_active) {
+        return;
+    }
+
     // 关键：设置 LCD_ShowString 的背景色，使其能“擦除”旧文本
     BACK_COLOR = COLOR_LOG_BG; 
     POINT_COLOR = COLOR_LOG_TEXT; // (您在文件中定义了 YELLOW)
@@ -346,9 +513,10 @@ static void refresh_log_text(bool is_rx_zone)
         // 我们需要先用背景色填充该行，以防新字符串比旧字符串短
         LCD_Fill(10, y_start + 20 + (i * 16), SCREEN_WIDTH - 10, y_start + 20 + (i * 16) + 16, COLOR_LOG_BG);
         
-        // 仅在字符串非空时绘制
-        if (log_lines[i][0] != '\0') {
-            LCD_ShowString(10, y_start + 20 + (i * 16), SCREEN_WIDTH - 20, 16, 16, (uint8_t*)log_lines[i]);
+        // 直接绘制记录中的字符串
+        char* line = (i >= first) ? rec_ringbuffer_next(log, &it, &len) : NULL;
+        if (line != NULL && line[0] != '\0') {
+            LCD_ShowString(10, y_start + 20 + (i * 16), SCREEN_WIDTH - 20, 16, 16, (uint8_t*)line);
         }
     }
     
@@ -364,7 +532,6 @@ static void draw_log_area(bool is_rx_zone)
     uint16_t y_start = is_rx_zone ? ZONE_RX_LOG_Y : ZONE_TX_LOG_Y;
     uint16_t height = is_rx_zone ? ZONE_RX_LOG_H : ZONE_TX_LOG_H;
     char* title = is_rx_zone ? "PC -> MCU (Received)" : "MCU -> PC (Sent)";
-    // char (*log_lines)[MAX_LOG_WIDTH] = is_rx_zone ? rx_log_lines : tx_log_lines;
     
     // 擦除区域
     LCD_Fill(0, y_start, SCREEN_WIDTH - 1, y_start + height - 1, COLOR_LOG_BG);
@@ -382,25 +549,77 @@ static void draw_log_area(bool is_rx_zone)
     // }
 }
 
+/**
+  * @brief 消息长度, 最多 max 个字符 (不依赖 strnlen, -std=c11 下没有它的声明)
+  */
+static uint32_t log_text_len(const char* msg, uint32_t max)
+{
+    const char* end = memchr(msg, '\0', max);
+
+    return end ? (uint32_t)(end - msg) : max;
+}
+
 /**
   * @brief 向日志区添加新消息 (循环滚动)
   */
 static void add_to_log(bool is_rx_zone, const char* msg)
 {
-    char (*log_lines)[MAX_LOG_WIDTH] = is_rx_zone ? rx_log_lines : tx_log_lines;
+    char* line = rec_ringbuffer_reserve(is_rx_zone ? &rx_log : &tx_log, MAX_LOG_WIDTH);
+    uint32_t len = log_text_len(msg, MAX_LOG_WIDTH - 1);
 
-    // 1. [滚动逻辑] 向上滚动字符串缓冲区
-    //    (将 line[1]~[5] 的内容移动到 line[0]~[4])
-    memmove(log_lines[0], log_lines[1], (MAX_LOG_LINES - 1) * MAX_LOG_WIDTH);
-    
-    // 2. 将新消息复制到最后一行
-    strncpy(log_lines[MAX_LOG_LINES - 1], msg, MAX_LOG_WIDTH - 1);
-    log_lines[MAX_LOG_LINES - 1][MAX_LOG_WIDTH - 1] = '\0'; // 确保null终止
+    // 新行直接写进记录, 最旧的一行由缓冲区丢弃, 不再整体搬移
+    memcpy(line, msg, len);
+    line[len] = '\0';
+    commit_log_line(is_rx_zone, line, len);
+}
+
+/**
+  * @brief 提交 rec_ringbuffer_reserve() 取得并已写好的一行 (len 不含结尾的 0)
+  */
+static void commit_log_line(bool is_rx_zone, char* line, uint32_t len)
+{
+    rec_ringbuffer_commit(is_rx_zone ? &rx_log : &tx_log, len + 1);
+    capture_append(is_rx_zone ? &rx_capture : &tx_capture, line);
 
-    // 3. [高效重绘] 调用快速的文本刷新函数
+    // [高效重绘] 调用快速的文本刷新函数
     refresh_log_text(is_rx_zone);
 }
 
+/**
+  * @brief 在 RX 日志的新行开头写入与上一条消息的接收时间间隔, 返回前缀长度
+  */
+static uint32_t rx_log_prefix(char* line, const cdc_acm_rx_ts_t* rx_ts)
+{
+    uint32_t us = rx_log_last_valid ? cdc_acm_rx_ts_diff_us(rx_ts, &rx_log_last_ts) : 0;
+    int n = snprintf(line, MAX_LOG_WIDTH, "+%lu.%03lums ", us / 1000, us % 1000);
+
+    return (n < MAX_LOG_WIDTH) ? (uint32_t)n : MAX_LOG_WIDTH - 1;
+}
+
+/**
+  * @brief 向RX日志区添加一条接收到的消息, 前缀为与上一条消息的接收时间间隔
+  */
+static void add_rx_log(const cdc_acm_rx_ts_t* rx_ts, const char* msg)
+{
+    char* line = rec_ringbuffer_reserve(&rx_log, MAX_LOG_WIDTH);
+    uint32_t pre = rx_log_prefix(line, rx_ts);
+    uint32_t len = log_text_len(msg, MAX_LOG_WIDTH - 1 - pre);
+
+    memcpy(&line[pre], msg, len);
+    line[pre + len] = '\0';
+    commit_rx_log(line, pre + len, rx_ts);
+}
+
+/**
+  * @brief 提交一条带时间间隔前缀的 RX 日志, 它的时间成为下一条的参照
+  */
+static void commit_rx_log(char* line, uint32_t len, const cdc_acm_rx_ts_t* rx_ts)
+{
+    rx_log_last_ts = *rx_ts;
+    rx_log_last_valid = true;
+    commit_log_line(true, line, len);
+}
+
 /**
   * @brief 将消息存入存储槽 (Req 4)
   */
@@ -456,7 +675,7 @@ static void clear_storage(bool is_rx)
         rx_storage_idx = 0;
         
         // 清除日志的内存缓冲区
-        memset(rx_log_lines, 0, sizeof(rx_log_lines));
+        rec_ringbuffer_reset(&rx_log);
         // 重绘该区域（背景+空文本）
         draw_log_area(true);
         // 添加一条新消息
@@ -466,7 +685,7 @@ static void clear_storage(bool is_rx)
         tx_storage_idx = 0;
         
         // 清除日志的内存缓冲区
-        memset(tx_log_lines, 0, sizeof(tx_log_lines));
+        rec_ringbuffer_reset(&tx_log);
         // 重绘该区域（背景+空文本）
         draw_log_area(false);
         // 添加一条新消息
@@ -493,6 +712,16 @@ static TouchKey_t* find_key_at(int x, int y)
             return key;
         }
     }
+    // 检查基准测试按钮
+    if (x > bench_key.x && x < (bench_key.x + bench_key.w) && y > bench_key.y && y < (bench_key.y + bench_key.h)) {
+        return &bench_key;
+    }
+    if (x > bridge_key.x && x < (bridge_key.x + bridge_key.w) && y > bridge_key.y && y < (bridge_key.y + bridge_key.h)) {
+        return &bridge_key;
+    }
+    if (x > diag_key.x && x < (diag_key.x + diag_key.w) && y > diag_key.y && y < (diag_key.y + diag_key.h)) {
+        return &diag_key;
+    }
     return NULL;
 }
 
@@ -676,7 +905,12 @@ static void handle_key_press(TouchKey_t* key)
     // --- 3. 发送键 (SEND) ---
     else if (strcmp(key->label, "SEND") == 0) {
         if (keyboard_buffer_idx > 0) {
-            cdc_acm_send_data(g_busid, (uint8_t*)keyboard_buffer, keyboard_buffer_idx);
+            // 交互输入走高优先级通道, 不排在大量数据后面 (复用模式下走通道0)
+            if (cdc_mux_is_active()) {
+                cdc_mux_write(0, keyboard_buffer, keyboard_buffer_idx);
+            } else {
+                cdc_acm_send_prio(g_busid, (uint8_t*)keyboard_buffer, keyboard_buffer_idx);
+            }
             add_to_log(false, keyboard_buffer);
             keyboard_buffer_idx = 0;
             keyboard_buffer[0] = '\0';
@@ -685,19 +919,21 @@ static void handle_key_press(TouchKey_t* key)
     }
     // --- 4. 存储键 ---
     else if (strcmp(key->label, "Store TX") == 0) {
-        // [正确逻辑] 存储滚动日志的最后一行 (即数组的最后一条)
-        int last_line_index = MAX_LOG_LINES - 1;
+        // [正确逻辑] 存储滚动日志的最后一行 (即最新的一条记录)
+        uint32_t len;
+        char* last = rec_ringbuffer_last(&tx_log, &len);
         
-        if(tx_log_lines[last_line_index][0] != '\0') {
-            add_to_storage(false, tx_log_lines[last_line_index]);
+        if(last != NULL && last[0] != '\0') {
+            add_to_storage(false, last);
         }
     }
     else if (strcmp(key->label, "Store RX") == 0) {
-        // [正确逻辑] 存储滚动日志的最后一行 (即数组的最后一条)
-        int last_line_index = MAX_LOG_LINES - 1;
+        // [正确逻辑] 存储滚动日志的最后一行 (即最新的一条记录)
+        uint32_t len;
+        char* last = rec_ringbuffer_last(&rx_log, &len);
         
-        if(rx_log_lines[last_line_index][0] != '\0') {
-            add_to_storage(true, rx_log_lines[last_line_index]);
+        if(last != NULL && last[0] != '\0') {
+            add_to_storage(true, last);
         }
     }
     // --- 5. 查询键 ---
@@ -718,6 +954,28 @@ static void handle_key_press(TouchKey_t* key)
     else if (strcmp(key->label, "Send 8-Byte Chunks") == 0) {
         send_chunked_data();
     }
+    // --- 8. 基准测试: OFF -> SOURCE -> SINK -> LOOP -> OFF ---
+    else if (key == &bench_key) {
+        if (uart_bridge_is_active()) {
+            add_to_log(false, "[Bench] Stop the UART bridge first.");
+        } else if (ymodem_is_active()) {
+            add_to_log(false, "[Bench] File transfer in progress.");
+        } else {
+            set_bench_mode((cdc_bench_mode_t)((cdc_bench_get_mode() + 1) % CDC_BENCH_MODE_NUM));
+        }
+    }
+    // --- 9. USB-UART 桥接开关 ---
+    else if (key == &bridge_key) {
+        if (ymodem_is_active()) {
+            ymodem_abort(); // 桥接键兼作传输的取消键
+        } else {
+            set_bridge_mode(!uart_bridge_is_active());
+        }
+    }
+    // --- 10. 诊断页开关 ---
+    else if (key == &diag_key) {
+        set_diag_page(!diag_page_active);
+    }
 }
 
 /**
@@ -743,96 +1001,413 @@ static void handle_key_press(TouchKey_t* key)
 //     }
 // }
 
+/**
+  * @brief USB中断中的事件通知: 只置位事件, 由对应的任务处理
+  */
+static void usb_event_callback(uint8_t port, uint8_t events)
+{
+    uint32_t ev = 0;
+
+    (void)port;
+    if (events & CDC_ACM_EVENT_RX) {
+        ev |= SCHED_EV_USB_RX;
+    }
+    if (events & CDC_ACM_EVENT_TX_DONE) {
+        ev |= SCHED_EV_USB_TX;
+    }
+    if (events & CDC_ACM_EVENT_STATE) {
+        ev |= SCHED_EV_USB_STATE;
+    }
+    sched_event_set(ev);
+}
+
+#if VENDOR_BULK_ENABLE
+/* 厂商批量接口的数据由测试服务搬运 (vendor_bulk_task)，任何事件都唤醒它 */
+static void vendor_event_callback(uint8_t events)
+{
+    (void)events;
+    sched_event_set(SCHED_EV_VENDOR);
+}
+#endif
+
+/* 默认端口处于文本/帧模式 (没有被桥接、文件传输、基准测试、复用或转发接管) */
+static bool text_mode_active(void)
+{
+    return !uart_bridge_is_active() && !ymodem_is_active() &&
+           cdc_bench_get_mode() == CDC_BENCH_OFF && !cdc_mux_is_active() &&
+           !cdc_acm_port_is_forwarding(CDC_ACM_PORT_DEFAULT);
+}
+
+/**
+  * @brief 调度任务: USB接收 (桥接/文件传输/基准测试期间由对应模块接管收发)
+  * @return true: 还有数据没处理完
+  */
+static bool usb_task(void)
+{
+    // 这几种会话要搬运 UART/发送数据, 没有对应的事件, 会话期间持续运行
+    if (uart_bridge_is_active()) {
+        bridge_task_handler();
+        return true;
+    }
+    if (ymodem_is_active()) {
+        file_task_handler();
+        return true;
+    }
+    if (cdc_bench_get_mode() != CDC_BENCH_OFF) {
+        cdc_bench_report_t rpt;
+        // 测试期间不解析命令, 主机打开过端口后再关闭 (DTR 撤销) 即结束测试
+        if (cdc_acm_port_is_open(CDC_ACM_PORT_DEFAULT)) {
+            g_bench_host_seen = true;
+        } else if (g_bench_host_seen) {
+            set_bench_mode(CDC_BENCH_OFF);
+            return false;
+        }
+        if (cdc_bench_task(&rpt)) {
+            show_bench_report(&rpt);
+        }
+        return true;
+    }
+    if (cdc_mux_is_active()) {
+        mux_task_handler();
+        return cdc_acm_port_get_rx_available(CDC_ACM_PORT_DEFAULT) > 0;
+    }
+    if (cdc_acm_port_is_forwarding(CDC_ACM_PORT_DEFAULT)) {
+        // 回环停止后, 等最后一段转发数据发完 (IN 完成事件) 再读取接收缓冲区
+        return false;
+    }
+
+    // 一次处理一行, 预算内连续处理; 命令可能切换模式, 切换后剩下的数据留给新模式
+    do {
+        cdc_task_handler();
+    } while (text_mode_active() && cdc_acm_port_get_rx_available(CDC_ACM_PORT_DEFAULT) > 0 &&
+             sched_in_budget());
+
+    return cdc_acm_port_get_rx_available(CDC_ACM_PORT_DEFAULT) > 0;
+}
+
+#if CDC_ACM_PORT_NUM > 1
+static bool ctrl_task(void)
+{
+    ctrl_task_handler();
+    return cdc_acm_port_get_rx_available(1) > 0;
+}
+#endif
+
+#if TOUCH_USE_INT
+/**
+  * @brief 触摸 INT 中断中的通知: 只唤醒触摸任务
+  */
+static void touch_irq_notify(void)
+{
+    sched_event_set(SCHED_EV_TOUCH);
+}
+#endif
+
+static bool touch_task(void)
+{
+#if TOUCH_USE_INT
+    // 有 INT 才读; 按下期间 INT 迟迟不来时主动读一次, 防止漏掉抬起帧
+    bool down = g_touch_ctx.state == TOUCH_STATE_PRESSED || g_touch_ctx.state == TOUCH_STATE_HOLDING;
+    GT9147_Service(down && HAL_GetTick() - g_touch_last_frame_tick >= TOUCH_INT_LOST_MS);
+#else
+    GT9147_Service(1);
+#endif
+    touch_task_handler();
+    #ifdef ENABLE_TOUCH_DEBUG
+    display_touch_debug_info();
+    #endif
+    return false;
+}
+
+/**
+  * @brief 调度任务: 启动USB发送
+  * @note 写入数据和 IN 传输完成时驱动已经会启动发送, 这里只是兜底
+  */
+static bool tx_task(void)
+{
+    cdc_acm_try_send(g_busid);
+#if CDC_ACM_BUS_NUM > 1
+    cdc_acm_try_send(g_busid + 1);
+#endif
+    return false;
+}
+
+/**
+  * @brief 调度任务: U 盘内容更新和诊断页刷新 (各自还有更长的节流周期)
+  */
+static bool ui_task(void)
+{
+    #if MSC_DISK_ENABLE
+    msc_task_handler();
+    #endif
+    if (diag_page_active) {
+        draw_diag_page(false);
+    }
+    return false;
+}
+
 /**
   * @brief 任务1: 处理USB接收环形缓冲区的数据
   */
 static void cdc_task_handler(void)
 {
-    static uint8_t rx_buf[256]; // 临时缓冲区
+    cdc_frame_t* frame;
+    cdc_acm_rx_ts_t rx_ts;
+
+    // 文本模式下读到的第一个字节就是接收缓冲区中下一个未读字节
+    if (!cdc_acm_port_get_rx_timestamp(CDC_ACM_PORT_DEFAULT, 0, &rx_ts)) {
+        cdc_acm_rx_ts_now(&rx_ts);
+    }
     
-    if (cdc_acm_get_rx_available() > 0)
+    // 帧数据直接解码进帧池, 文本模式 (未收到 0x00 分隔符) 的数据直接拷进 RX 日志的新行 (时间前缀之后),
+    // 屏幕从这里绘制, 一行放不下的部分下次成为新的一行
+    char* line = rec_ringbuffer_reserve(&rx_log, MAX_LOG_WIDTH);
+    uint32_t pre = rx_log_prefix(line, &rx_ts);
+    uint32_t len = cdc_frame_poll((uint8_t*)&line[pre], MAX_LOG_WIDTH - 1 - pre);
+    if (len > 0)
     {
-        uint32_t len = cdc_acm_read_data(rx_buf, sizeof(rx_buf) - 1);
-        if (len > 0)
-        {
-            rx_buf[len] = '\0'; // 确保null终止
-            
-            // 处理接收到的数据 (包括高级Req 7)
-            process_received_data(rx_buf, len);
+        line[pre + len] = '\0'; // 确保null终止
+        // 命令不显示, 预留的记录不提交即作废
+        if (!process_command(&line[pre])) {
+            commit_rx_log(line, pre + len, &rx_ts);
         }
     }
+
+    // 处理接收到的帧 (包括高级Req 7)
+    while ((frame = cdc_frame_get()) != NULL)
+    {
+        process_received_frame(frame);
+        cdc_frame_release(frame);
+    }
+}
+
+#if CDC_ACM_PORT_NUM > 1
+/**
+  * @brief 控制通道: 端口1只收文本命令, 与数据端口的命令相同
+  */
+static void ctrl_task_handler(void)
+{
+    static uint8_t cmd_buf[64];
+    cdc_acm_rx_ts_t rx_ts;
+
+    if (!cdc_acm_port_get_rx_timestamp(1, 0, &rx_ts)) {
+        cdc_acm_rx_ts_now(&rx_ts);
+    }
+
+    int len = cdc_acm_port_read_data(1, cmd_buf, sizeof(cmd_buf) - 1);
+    if (len > 0) {
+        cmd_buf[len] = '\0';
+        process_received_data(cmd_buf, len, &rx_ts);
+    }
+}
+#endif
+
+/**
+  * @brief 复用模式: 通道0收命令 (与文本模式相同), 通道1原样回环供主机测吞吐
+  */
+static void mux_task_handler(void)
+{
+    static uint8_t cmd_buf[64];
+    cdc_acm_rx_ts_t rx_ts;
+    uint32_t size;
+
+    cdc_mux_poll();
+
+    int len = cdc_mux_read(0, cmd_buf, sizeof(cmd_buf) - 1);
+    if (len > 0) {
+        cmd_buf[len] = '\0';
+        cdc_acm_rx_ts_now(&rx_ts);
+        process_received_data(cmd_buf, len, &rx_ts);
+    }
+
+    // 回环不经过中间缓冲区, 发送缓冲区放不下时下次再试
+    uint8_t* ptr = cdc_mux_linear_read_setup(1, &size);
+    if (size > 0 && cdc_mux_write(1, ptr, size) > 0) {
+        cdc_mux_linear_read_done(1, size);
+    }
+
+    if (!cdc_mux_is_active()) {
+        add_to_log(false, "[MUX] Stopped.");
+    }
 }
 
 /**
   * @brief 处理接收到的数据 (包含分包重组逻辑)
   */
-static void process_received_data(uint8_t* data, uint32_t len)
+static void process_received_data(uint8_t* data, uint32_t len, const cdc_acm_rx_ts_t* rx_ts)
 {
-    char* str_data = (char*)data;
-    
-    // --- 高级功能 2: 分包重组 (Req 7) ---
-    if (chunk_receiving) {
-        if (strcmp(str_data, "END") == 0) {
-            // 收到结束包
-            chunk_receiving = false;
-            add_to_log(true, "[Chunked] RECV END.");
-            // 显示重组后的长数据
-            add_to_log(true, chunk_buffer);
-            add_to_storage(true, chunk_buffer); // 存起来
-            // 清空重组缓冲区
+    // --- 基本功能: 显示和存储 (Req 2, 4) ---
+    if (!process_command((char*)data)) {
+        add_rx_log(rx_ts, (const char*)data);
+        // add_to_storage(true, str_data);
+    }
+}
+
+/**
+  * @brief 执行文本命令, 不是命令时返回 false
+  * @note cdc_task_handler 中 str_data 就在 RX 日志预留的记录里, 命令只能向 TX 日志区输出
+  */
+static bool process_command(char* str_data)
+{
+    if (strcmp(str_data, "BENCH CRC") == 0) {
+        run_crc_bench();
+    }
+    else if (strcmp(str_data, "BENCH LZ") == 0) {
+        run_lz_bench();
+    }
+    // 发送压缩: 主机用 Tools/lz_stream_cat.py 查看
+    else if (strcmp(str_data, "LZ ON") == 0 || strcmp(str_data, "LZ OFF") == 0) {
+        set_tx_compress(str_data[4] == 'N');
+    }
+    // 统计输出到 RTT, "STATS RESET" 输出后清零
+    else if (strcmp(str_data, "STATS") == 0 || strcmp(str_data, "STATS RESET") == 0) {
+        print_usb_stats();
+        print_sched_stats();
+        print_touch_stats();
+        if (str_data[5] == ' ') {
+            for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+                cdc_acm_port_reset_stats(port);
+            }
+            sched_reset_stats();
+            g_touch_latency_max_us = 0;
+        }
+        add_to_log(false, "[Stats] Written to RTT.");
+    }
+    // 内存布局: "MEM" 显示, "MEM RX|TX|BALANCED" 或 "MEM SET rx tx log file" 重新划分, "MEM SAVE" 保存为上电布局
+    else if (strncmp(str_data, "MEM", 3) == 0 && (str_data[3] == '\0' || str_data[3] == ' ')) {
+        mem_command(str_data[3] ? &str_data[4] : "");
+    }
+    // 通道复用: 主机用 Tools/cdc_mux.py 连接, 通道0为命令, 通道1为回环
+    else if (strcmp(str_data, "MUX ON") == 0) {
+        if (!cdc_mux_is_active()) {
+            cdc_mux_start();
+            add_to_log(false, "[MUX] Started.");
+        }
+    }
+    // 文件传输: 主机发送命令后启动 sb/rb (或终端软件的 YMODEM 功能)
+    else if (strcmp(str_data, "YMODEM RECV") == 0 || strcmp(str_data, "YMODEM RECV G") == 0) {
+        start_file_receive(str_data[11] == ' ');
+    }
+    else if (strcmp(str_data, "YMODEM SEND") == 0) {
+        start_file_send();
+    }
+    else if (strncmp(str_data, "BENCH ", 6) == 0) {
+        // 主机脚本选择测试模式, 如 "BENCH SINK"
+        for (int m = CDC_BENCH_SOURCE; m < CDC_BENCH_MODE_NUM; m++) {
+            if (strcmp(&str_data[6], cdc_bench_mode_name((cdc_bench_mode_t)m)) == 0) {
+                set_bench_mode((cdc_bench_mode_t)m);
+                break;
+            }
+        }
+    }
+    else {
+        return false;
+    }
+    return true;
+}
+
+/**
+  * @brief 处理接收到的一帧 (分包重组基于帧类型, 不受USB合并/拆分包影响)
+  */
+static void process_received_frame(const cdc_frame_t* frame)
+{
+    char msg[40];
+
+    switch (frame->type) {
+        case CDC_FRAME_TYPE_TEXT:
+            add_rx_log(&frame->rx_ts, (const char*)frame->data);
+            break;
+
+        // --- 高级功能 2: 分包重组 (Req 7) ---
+        case CDC_FRAME_TYPE_CHUNK_START:
+            chunk_receiving = true;
             chunk_buffer_idx = 0;
             chunk_buffer[0] = '\0';
-        } else {
-            // 收到数据包
-            add_to_log(true, str_data); // 显示 8 字节包
+            add_to_log(true, "[Chunked] RECV START.");
+            break;
+
+        case CDC_FRAME_TYPE_CHUNK_DATA:
+            if (!chunk_receiving) {
+                break;
+            }
+            add_rx_log(&frame->rx_ts, (const char*)frame->data); // 显示 8 字节包
             // 拼接到重组缓冲区
-            if (chunk_buffer_idx + len < MAX_CHUNK_BUFFER_LEN) {
-                strncpy(&chunk_buffer[chunk_buffer_idx], str_data, len);
-                chunk_buffer_idx += len;
+            if (chunk_buffer_idx + frame->len < MAX_CHUNK_BUFFER_LEN) {
+                memcpy(&chunk_buffer[chunk_buffer_idx], frame->data, frame->len);
+                chunk_buffer_idx += frame->len;
                 chunk_buffer[chunk_buffer_idx] = '\0';
             } else {
                 add_to_log(true, "[Chunked] Buffer Overflow!");
                 chunk_receiving = false;
             }
+            break;
+
+        case CDC_FRAME_TYPE_CHUNK_END:
+            if (!chunk_receiving) {
+                break;
+            }
+            chunk_receiving = false;
+            add_to_log(true, "[Chunked] RECV END.");
+            // 显示重组后的长数据
+            add_to_log(true, chunk_buffer);
+            add_to_storage(true, chunk_buffer); // 存起来
+            // 清空重组缓冲区
+            chunk_buffer_idx = 0;
+            chunk_buffer[0] = '\0';
+            break;
+
+        default:
+            snprintf(msg, sizeof(msg), "[Frame] type 0x%02X, %u bytes", frame->type, frame->len);
+            add_to_log(true, msg);
+            break;
+    }
+}
+
+/**
+  * @brief 任务2: 处理触摸事件队列
+  */
+static void touch_task_handler(void)
+{
+    GT_TouchEvent_t ev;
+    bool got_frame = false;
+
+    // 每一帧都过一遍状态机 (很快的点击, 按下帧和抬起帧可能一起到)
+    while (GT9147_Get_Event(&ev))
+    {
+        uint32_t latency_us = (DWT->CYCCNT - ev.cyc) / (SystemCoreClock / 1000000U);
+        if (latency_us > g_touch_latency_max_us) {
+            g_touch_latency_max_us = latency_us;
         }
-    } else if (strcmp(str_data, "START") == 0) {
-        // 收到起始包
-        chunk_receiving = true;
-        chunk_buffer_idx = 0;
-        chunk_buffer[0] = '\0';
-        add_to_log(true, "[Chunked] RECV START.");
+        touch_state_machine(&ev);
+        got_frame = true;
     }
-    // --- 基本功能: 显示和存储 (Req 2, 4) ---
-    else {
-        add_to_log(true, str_data);
-        // add_to_storage(true, str_data);
+
+    if (!got_frame) {
+        touch_state_machine(NULL);
     }
 }
 
 /**
-  * @brief 任务2: 处理触摸屏输入 (已修复竞态条件)
+  * @brief 触摸状态机
+  * @param ev 芯片报告的一帧, NULL 表示这一轮没有新帧
   */
-static void touch_task_handler(void)
+static void touch_state_machine(const GT_TouchEvent_t* ev)
 {
-    GT_TouchPoint_t tp_data[GT_MAX_POINTS];
-    uint8_t touch_count = GT9147_Scan(tp_data, GT_MAX_POINTS);
-    
     // =========================================================================
     // 状态机：检测按下、保持、抬起
     // =========================================================================
     
-    if (touch_count > 0)
+    if (ev && ev->count > 0)
     {
         // =====================================================================
         // 情况1: 有触摸点 (按下或保持)
         // =====================================================================
         
-        // 只要检测到触摸，就重置“释放防抖”计数器
-        g_release_debounce_count = 0;
+        g_touch_last_frame_tick = ev->tick;
         
         // 更新坐标
-        g_touch_ctx.current_x = tp_data[0].x;
-        g_touch_ctx.current_y = tp_data[0].y;
+        g_touch_ctx.current_x = ev->points[0].x;
+        g_touch_ctx.current_y = ev->points[0].y;
         
         if (g_touch_ctx.state == TOUCH_STATE_IDLE || g_touch_ctx.state == TOUCH_STATE_RELEASED)
         {
@@ -840,9 +1415,9 @@ static void touch_task_handler(void)
             // 从 无触摸 -> 有触摸：这是一个新的按下事件
             // ------------------------------------------------------------------
             g_touch_ctx.state = TOUCH_STATE_PRESSED;
-            g_touch_ctx.press_x = tp_data[0].x;
-            g_touch_ctx.press_y = tp_data[0].y;
-            g_touch_ctx.press_time = HAL_GetTick();
+            g_touch_ctx.press_x = ev->points[0].x;
+            g_touch_ctx.press_y = ev->points[0].y;
+            g_touch_ctx.press_time = ev->tick;
             
             // 查找被按下的按键
             TouchKey_t* key = find_key_at(g_touch_ctx.press_x, g_touch_ctx.press_y);
@@ -870,21 +1445,17 @@ static void touch_task_handler(void)
     else
     {
         // =====================================================================
-        // 情况2: 无触摸点 (可能是抬起，也可能是竞态条件)
+        // 情况2: 抬起帧, 或者这一轮没有新帧
         // =====================================================================
         
         if (g_touch_ctx.state == TOUCH_STATE_PRESSED || g_touch_ctx.state == TOUCH_STATE_HOLDING)
         {
             // ------------------------------------------------------------------
-            // 从 有触摸 -> 无触摸：这是一个 *可能* 的抬起事件
+            // 芯片报告了抬起 (有新数据但没有触摸点), 或者太久没有新帧 (漏掉了抬起帧)。
+            // 只按"有新数据"的帧判断, 两帧之间读到的"无数据"不再被误认为抬起
             // ------------------------------------------------------------------
-            
-            // 增加防抖计数器
-            g_release_debounce_count++;
-            
-            if (g_release_debounce_count >= RELEASE_DEBOUNCE_FRAMES)
+            if (ev || HAL_GetTick() - g_touch_last_frame_tick >= TOUCH_RELEASE_MS)
             {
-                // 连续 N 帧都读到 0，我们 *确认* 手指已抬起
                 g_touch_ctx.state = TOUCH_STATE_RELEASED;
                 
                 // 恢复按键外观
@@ -896,9 +1467,6 @@ static void touch_task_handler(void)
                 
                 // [调用] 抬起瞬间的处理
                 handle_touch_released();
-                
-                // 重置计数器
-                g_release_debounce_count = 0;
             }
         }
         else
@@ -907,12 +1475,8 @@ static void touch_task_handler(void)
             // 从 无触摸 -> 无触摸：保持空闲状态
             // ------------------------------------------------------------------
             g_touch_ctx.state = TOUCH_STATE_IDLE;
-            g_release_debounce_count = 0;
         }
     }
-    
-    // ⭐ 移除：g_touch_ctx.last_point_count 不再需要
-    // g_touch_ctx.last_point_count = touch_count;
 }
 
 /**
@@ -928,9 +1492,9 @@ static void send_chunked_data(void)
     // 自动将完整的长数据存入TX存储
     add_to_storage(false, long_data);
     
+    // 每包是一个独立的帧, 主机按分隔符切分, 不再依赖发送间隔
     add_to_log(false, "[Chunked] SEND START.");
-    cdc_acm_send_data(g_busid, (uint8_t*)"START", 5);
-    HAL_Delay(5); // 确保PC能处理
+    cdc_frame_send(g_busid, CDC_FRAME_TYPE_CHUNK_START, NULL, 0);
     
     for(int i = 0; i < data_len; i += 8)
     {
@@ -939,10 +1503,663 @@ static void send_chunked_data(void)
         chunk[chunk_len] = '\0';
         
         add_to_log(false, chunk); // 在本地显示 8 字节包
-        cdc_acm_send_data(g_busid, (uint8_t*)chunk, chunk_len);
-        HAL_Delay(5); // 模拟连续发送
+        cdc_frame_send(g_busid, CDC_FRAME_TYPE_CHUNK_DATA, chunk, chunk_len);
     }
     
     add_to_log(false, "[Chunked] SEND END.");
-    cdc_acm_send_data(g_busid, (uint8_t*)"END", 3);
-}
\ No newline at end of file
+    cdc_frame_send(g_busid, CDC_FRAME_TYPE_CHUNK_END, NULL, 0);
+}
+
+/**
+  * @brief 切换基准测试模式并刷新按钮/标题栏
+  */
+static void set_bench_mode(cdc_bench_mode_t mode)
+{
+    char msg[40];
+
+    cdc_bench_start(g_busid, mode);
+    g_bench_host_seen = false;
+
+    bench_key.label = bench_key_labels[mode];
+    draw_key(&bench_key);
+    show_title_status("");
+
+    snprintf(msg, sizeof(msg), "[Bench] Mode: %s", cdc_bench_mode_name(mode));
+    add_to_log(false, msg);
+    printf("%s\r\n", msg);
+}
+
+/**
+  * @brief 在标题栏和 RTT 上输出一次基准测试结果
+  */
+static void show_bench_report(const cdc_bench_report_t* rpt)
+{
+    char line[MAX_LOG_WIDTH];
+    uint32_t bytes = (rpt->tx_bytes > rpt->rx_bytes) ? rpt->tx_bytes : rpt->rx_bytes;
+    // 以 10KB/s 为单位计算，避免浮点格式化 (1 MB/s = 100 单位)
+    uint32_t rate = (uint32_t)((uint64_t)bytes * 100U * 1000U / 1000000U / rpt->period_ms);
+
+    // 间隔是相邻两次搬运数据之间的时间, 往返延迟由主机测 (Tools/cdc_bench.py)
+    snprintf(line, sizeof(line), "%lu.%02lu MB/s lost %lu gap p50<%luus p99<%luus",
+             rate / 100, rate % 100, rpt->lost_bytes, rpt->interval_p50_us, rpt->interval_p99_us);
+
+    show_title_status(line);
+
+    printf("[Bench] %s tx=%lu rx=%lu in %lums, %s, gap max %luus\r\n",
+           cdc_bench_mode_name(rpt->mode), rpt->tx_bytes, rpt->rx_bytes,
+           rpt->period_ms, line, rpt->interval_max_us);
+}
+
+/**
+  * @brief 对比硬件/查表/逐位三种 CRC 实现的速度, 结果写入日志和 RTT
+  */
+static void run_crc_bench(void)
+{
+    crc32_bench_result_t res;
+    char line[MAX_LOG_WIDTH];
+
+    crc32_bench(&res);
+
+    snprintf(line, sizeof(line), "[CRC] %luB hw %lu tbl %lu bit %lu cyc %s",
+             res.len, res.hw_cycles, res.table_cycles, res.bitwise_cycles,
+             res.match ? "OK" : "MISMATCH");
+    add_to_log(false, line);
+    printf("%s\r\n", line);
+}
+
+/**
+  * @brief 压缩典型日志文本, 报告压缩率和每字节周期数
+  */
+static void run_lz_bench(void)
+{
+    lz_stream_bench_result_t res;
+    char line[MAX_LOG_WIDTH];
+
+    lz_stream_bench(&res);
+
+    snprintf(line, sizeof(line), "[LZ] %luB -> %luB (%lu%%) %lu cyc/B %s",
+             res.len, res.out_len, res.out_len * 100U / res.len, res.cycles / res.len,
+             res.match ? "OK" : "MISMATCH");
+    add_to_log(false, line);
+    printf("%s\r\n", line);
+}
+
+/**
+  * @brief 开关默认端口的发送压缩
+  */
+static void set_tx_compress(bool on)
+{
+    if (cdc_acm_port_set_tx_compress(CDC_ACM_PORT_DEFAULT, on) != 0) {
+        add_to_log(false, "[LZ] Not available");
+        return;
+    }
+    add_to_log(false, on ? "[LZ] TX compression on" : "[LZ] TX compression off");
+    // 回复主机, 打开时这是压缩流里的第一行
+    if (cdc_mux_is_active()) {
+        const char* reply = on ? "[LZ] TX compression on\r\n" : "[LZ] TX compression off\r\n";
+        cdc_mux_write(0, reply, strlen(reply));
+    } else {
+        cdc_acm_port_printf_prio(CDC_ACM_PORT_DEFAULT, "[LZ] TX compression %s\r\n", on ? "on" : "off");
+    }
+}
+
+/**
+  * @brief 在标题栏状态区显示一行文字 (空串则清空)
+  */
+static void show_title_status(const char* line)
+{
+    BACK_COLOR = LGRAYBLUE;
+    POINT_COLOR = COLOR_TITLE;
+    LCD_Fill(BENCH_STATUS_X, 2, diag_key.x - 5, ZONE_TITLE_H - 3, LGRAYBLUE);
+    LCD_ShowString(BENCH_STATUS_X, 7, diag_key.x - 5 - BENCH_STATUS_X, 16, 16, (uint8_t*)line);
+    BACK_COLOR = COLOR_BG;
+}
+
+/**
+  * @brief 开关 USB-UART 桥接模式
+  */
+static void set_bridge_mode(bool on)
+{
+    if (on) {
+        if (cdc_bench_get_mode() != CDC_BENCH_OFF) {
+            set_bench_mode(CDC_BENCH_OFF);
+        }
+        uart_bridge_start();
+        add_to_log(false, "[Bridge] USB <-> USART1 (PA9/PA10) ON.");
+    } else {
+        uart_bridge_stop();
+        show_title_status("");
+        add_to_log(false, "[Bridge] OFF.");
+    }
+
+    bridge_key.label = on ? "Bridge:On" : "Bridge:Off";
+    draw_key(&bridge_key);
+}
+
+/**
+  * @brief 桥接模式下的任务: 应用串口参数, 显示监视数据和统计
+  */
+static void bridge_task_handler(void)
+{
+    static const char* const parity_names = "NOEMS";
+    static const char* const stop_names[] = { "1", "1.5", "2" };
+    static uint32_t last_status_tick = 0;
+    uart_bridge_stats_t st;
+    char line[MAX_LOG_WIDTH];
+    char text[UART_BRIDGE_MON_CHUNK + 1];
+    bool to_host;
+
+    bool applied = uart_bridge_task();
+    uart_bridge_get_stats(&st);
+
+    if (applied) {
+        cdc_acm_line_coding_t *lc = &st.line_coding;
+        snprintf(line, sizeof(line), "[Bridge] %lu %u%c%s", lc->baudrate, lc->databits,
+                 parity_names[lc->parity < 5 ? lc->parity : 0], stop_names[lc->stopbits < 3 ? lc->stopbits : 0]);
+        add_to_log(false, line);
+        printf("%s\r\n", line);
+    }
+
+    // 每次最多显示几条，避免刷屏拖慢主循环 (显示跟不上时记录会被丢弃)
+    for (int i = 0; i < 4 && uart_bridge_monitor_read(&to_host, text, sizeof(text)) > 0; i++) {
+        add_to_log(!to_host, text); // 主机发来的 (发往UART) 显示在RX区
+    }
+
+    if (HAL_GetTick() - last_status_tick >= BRIDGE_STATUS_MS) {
+        last_status_tick = HAL_GetTick();
+        snprintf(line, sizeof(line), "U>H %lu H>U %lu drop %lu err %lu",
+                 st.uart_to_usb, st.usb_to_uart, st.dropped, st.uart_errors);
+        show_title_status(line);
+    }
+}
+
+/**
+  * @brief 打开/关闭诊断页 (打开时同时把统计输出到 RTT)
+  */
+static void set_diag_page(bool on)
+{
+    diag_page_active = on;
+    diag_key.label = on ? "Logs" : "Diag";
+    draw_key(&diag_key);
+
+    if (on) {
+        LCD_Fill(0, ZONE_RX_LOG_Y, SCREEN_WIDTH - 1, ZONE_KEYBOARD_Y - 1, COLOR_LOG_BG);
+        POINT_COLOR = COLOR_BORDER;
+        LCD_DrawRectangle(0, ZONE_RX_LOG_Y, SCREEN_WIDTH - 1, ZONE_KEYBOARD_Y - 1);
+        POINT_COLOR = COLOR_LOG;
+        LCD_ShowString(5, ZONE_RX_LOG_Y + 3, 400, 16, 16, (uint8_t*)"USB Diagnostics (port 0)");
+        print_usb_stats();
+        draw_diag_page(true);
+    } else {
+        LCD_Fill(0, ZONE_RX_LOG_Y, SCREEN_WIDTH - 1, ZONE_KEYBOARD_Y - 1, COLOR_BG);
+        draw_log_area(true);
+        draw_log_area(false);
+    }
+}
+
+/**
+  * @brief 刷新诊断页: USB 端点/缓冲区统计和帧解码统计
+  * @param force true: 忽略刷新周期立即绘制
+  */
+static void draw_diag_page(bool force)
+{
+    static uint32_t last_tick = 0;
+    static uint32_t last_cyc = 0;
+    static uint64_t last_busy = 0;
+    cdc_acm_stats_t st;
+    cdc_frame_stats_t fs;
+    lz_stream_stats_t lz;
+    char lines[6][MAX_LOG_WIDTH];
+    uint32_t now_cyc, busy_pm;
+
+    if (!force && HAL_GetTick() - last_tick < DIAG_REFRESH_MS) {
+        return;
+    }
+    last_tick = HAL_GetTick();
+
+    cdc_acm_port_get_stats(CDC_ACM_PORT_DEFAULT, &st);
+    cdc_frame_get_stats(&fs);
+
+    // IN 端点忙碌比例 (千分比), 按两次刷新之间的 DWT 周期计算
+    now_cyc = DWT->CYCCNT;
+    busy_pm = (now_cyc != last_cyc && st.tx_busy_cycles >= last_busy) ?
+              (uint32_t)((st.tx_busy_cycles - last_busy) * 1000U / (now_cyc - last_cyc)) : 0;
+    last_cyc = now_cyc;
+    last_busy = st.tx_busy_cycles;
+
+    snprintf(lines[0], MAX_LOG_WIDTH, "OUT  %lu pkts  %lu B  overflow %lu B  NAK pauses %lu",
+             st.rx_packets, st.rx_bytes, st.rx_overflow_bytes, st.rx_pauses);
+    snprintf(lines[1], MAX_LOG_WIDTH, "IN   %lu pkts  %lu B  ZLP %lu  busy %lu.%lu%%",
+             st.tx_packets, st.tx_bytes, st.tx_zlps, busy_pm / 10, busy_pm % 10);
+    snprintf(lines[2], MAX_LOG_WIDTH, "RX ring  %lu / %lu B  high %lu B",
+             st.rx_used, st.rx_size, st.rx_high_water);
+    snprintf(lines[3], MAX_LOG_WIDTH, "TX ring  %lu / %lu B  high %lu B  full %lu",
+             st.tx_used, st.tx_size, st.tx_high_water, st.tx_full_events);
+    snprintf(lines[4], MAX_LOG_WIDTH, "Frames   %lu ok  %lu CRC err  %lu format err",
+             fs.frames, fs.crc_errors, fs.format_errors);
+    if (cdc_acm_port_get_tx_compress(CDC_ACM_PORT_DEFAULT, &lz) && lz.raw_bytes) {
+        snprintf(lines[5], MAX_LOG_WIDTH, "TX LZ    %lu -> %lu B (%lu%%)  %lu cyc/B",
+                 lz.raw_bytes, lz.out_bytes, (uint32_t)((uint64_t)lz.out_bytes * 100U / lz.raw_bytes),
+                 (uint32_t)(lz.cycles / lz.raw_bytes));
+    } else {
+        sched_stats_t ss;
+        sched_get_stats(&ss);
+        snprintf(lines[5], MAX_LOG_WIDTH, "CPU %u.%u%%  wakeups %lu/s  runs %lu/s  (STATS -> RTT)",
+                 ss.load_pm / 10, ss.load_pm % 10, ss.wakeups_per_s, ss.runs_per_s);
+    }
+
+    BACK_COLOR = COLOR_LOG_BG;
+    POINT_COLOR = COLOR_LOG_TEXT;
+    for (int i = 0; i < 6; i++) {
+        uint16_t y = ZONE_RX_LOG_Y + 25 + i * 20;
+        LCD_Fill(10, y, SCREEN_WIDTH - 10, y + 16, COLOR_LOG_BG);
+        LCD_ShowString(10, y, SCREEN_WIDTH - 20, 16, 16, (uint8_t*)lines[i]);
+    }
+    BACK_COLOR = COLOR_BG;
+}
+
+/**
+  * @brief 把 USB 统计输出到 RTT (每个端口一组)
+  */
+static void print_usb_stats(void)
+{
+    cdc_acm_stats_t st;
+    lz_stream_stats_t lz;
+    bool lz_on = false;
+
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        cdc_acm_port_get_stats(port, &st);
+        printf("[Stats%u] OUT pkts=%lu bytes=%lu overflow=%lu pauses=%lu\r\n",
+               port, st.rx_packets, st.rx_bytes, st.rx_overflow_bytes, st.rx_pauses);
+        printf("[Stats%u] IN pkts=%lu bytes=%lu zlp=%lu busy_ms=%lu\r\n",
+               port, st.tx_packets, st.tx_bytes, st.tx_zlps,
+               (uint32_t)(st.tx_busy_cycles / (SystemCoreClock / 1000U)));
+        printf("[Stats%u] RX ring %lu/%lu high=%lu, TX ring %lu/%lu high=%lu full=%lu\r\n",
+               port, st.rx_used, st.rx_size, st.rx_high_water,
+               st.tx_used, st.tx_size, st.tx_high_water, st.tx_full_events);
+        printf("[Stats%u] PRIO bytes=%lu used=%lu wait_max_us=%lu\r\n",
+               port, st.tx_prio_bytes, st.tx_prio_used,
+               st.tx_prio_wait_max_cycles / (SystemCoreClock / 1000000U));
+        lz_on |= cdc_acm_port_get_tx_compress(port, &lz);
+    }
+    if (cdc_mux_is_active()) {
+        cdc_mux_stats_t mux;
+        cdc_mux_get_stats(&mux);
+        printf("[Stats] MUX rx=%lu+%lu tx=%lu+%lu overrun=%lu\r\n",
+               mux.rx_bytes, mux.rx_hdr_bytes, mux.tx_bytes, mux.tx_hdr_bytes, mux.credit_overruns);
+    }
+    // 压缩器只有一个, 统计不分端口
+    if (lz_on || lz.raw_bytes) {
+        printf("[Stats] TX LZ raw=%lu out=%lu blocks=%lu stored=%lu cycles=%lu\r\n",
+               lz.raw_bytes, lz.out_bytes, lz.blocks, lz.stored_blocks, (uint32_t)lz.cycles);
+    }
+}
+
+/**
+  * @brief 把调度统计输出到 RTT (CPU 负载、唤醒次数、各任务耗时)
+  */
+static void print_sched_stats(void)
+{
+    sched_stats_t ss;
+    const sched_task_t* t;
+
+    sched_get_stats(&ss);
+    printf("[Sched] load=%u.%u%% wakeups=%lu/s runs=%lu/s sleeps=%lu\r\n",
+           ss.load_pm / 10, ss.load_pm % 10, ss.wakeups_per_s, ss.runs_per_s, ss.sleeps);
+    for (uint32_t i = 0; (t = sched_get_task(i)) != NULL; i++) {
+        printf("[Sched] %-5s runs=%lu max_us=%lu budget_us=%u over=%lu cpu_ms=%lu\r\n",
+               t->name, t->runs, t->max_us, t->budget_us, t->overruns,
+               (uint32_t)(t->total_cycles / (SystemCoreClock / 1000U)));
+    }
+}
+
+/**
+  * @brief 把触摸统计输出到 RTT
+  */
+static void print_touch_stats(void)
+{
+    GT_TouchStats_t ts;
+
+    GT9147_Get_Stats(&ts);
+    printf("[Touch] irqs=%lu reads=%lu frames=%lu overflows=%lu latency_max_us=%lu\r\n",
+           ts.irqs, ts.reads, ts.frames, ts.overflows, g_touch_latency_max_us);
+}
+
+/**
+  * @brief 开始接收一个文件到文件区
+  * @param streaming true: 请求 YMODEM-g 流式传输
+  */
+static void start_file_receive(bool streaming)
+{
+    if (ymodem_receive_start(CDC_ACM_PORT_DEFAULT, file_area, file_area_size, streaming) == 0) {
+        file_area_len = 0; // 文件区将被覆盖
+        capture_dirty = true;
+    }
+    add_to_log(false, streaming ? "[YMODEM] Waiting for file (1K-G)..." : "[YMODEM] Waiting for file (1K)...");
+}
+
+/**
+  * @brief 向文件区追加格式化文本
+  * @return false: 空间不足, 文本已截断 (MEM SET 允许的文件区小于最大导出量)
+  */
+static bool file_area_printf(uint32_t* len, const char* fmt, ...)
+{
+    uint32_t room = file_area_size - *len;
+    va_list ap;
+    int n;
+
+    if (room <= 1) {
+        return false;
+    }
+    va_start(ap, fmt);
+    n = vsnprintf((char*)&file_area[*len], room, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        return false;
+    }
+    if ((uint32_t)n >= room) {
+        *len = file_area_size - 1; // 截断的文本保留, 不含结尾 '\0'
+        return false;
+    }
+    *len += (uint32_t)n;
+    return true;
+}
+
+/**
+  * @brief 把日志和存储槽导出为文本文件并发送给主机
+  */
+static void start_file_send(void)
+{
+    uint32_t len = 0;
+    uint32_t it, line_len;
+    char* line;
+    bool ok;
+
+    ok = file_area_printf(&len, "# PC -> MCU log\r\n");
+    for (it = rec_ringbuffer_iter(&rx_log); ok && (line = rec_ringbuffer_next(&rx_log, &it, &line_len)) != NULL;) {
+        ok = file_area_printf(&len, "%s\r\n", line);
+    }
+    ok = ok && file_area_printf(&len, "# MCU -> PC log\r\n");
+    for (it = rec_ringbuffer_iter(&tx_log); ok && (line = rec_ringbuffer_next(&tx_log, &it, &line_len)) != NULL;) {
+        ok = file_area_printf(&len, "%s\r\n", line);
+    }
+    for (int i = 0; ok && i < MAX_STORAGE_SLOTS; i++) {
+        ok = file_area_printf(&len, "RX slot %d: %s\r\n", i, rx_storage[i]);
+    }
+    for (int i = 0; ok && i < MAX_STORAGE_SLOTS; i++) {
+        ok = file_area_printf(&len, "TX slot %d: %s\r\n", i, tx_storage[i]);
+    }
+
+    file_area_len = len;
+    capture_dirty = true;
+    ymodem_send_start(CDC_ACM_PORT_DEFAULT, "capture.txt", file_area, len);
+    add_to_log(false, ok ? "[YMODEM] Sending capture.txt, start the receiver."
+                         : "[YMODEM] Sending capture.txt (truncated, file area too small).");
+}
+
+/**
+  * @brief 文件传输期间的任务: 推进协议, 刷新进度, 报告结果
+  */
+static void file_task_handler(void)
+{
+    static uint32_t last_status_tick = 0;
+    ymodem_status_t status = ymodem_task();
+    ymodem_result_t res;
+    char line[MAX_LOG_WIDTH];
+
+    ymodem_get_result(&res);
+
+    if (status == YMODEM_RUNNING) {
+        if (HAL_GetTick() - last_status_tick >= FILE_STATUS_MS) {
+            last_status_tick = HAL_GetTick();
+            snprintf(line, sizeof(line), "%s %lu/%lu retry %lu",
+                     res.sending ? "TX" : "RX", res.bytes, res.size, res.retries);
+            show_title_status(line);
+        }
+        return;
+    }
+
+    show_title_status("");
+    if (status == YMODEM_FAILED) {
+        snprintf(line, sizeof(line), "[YMODEM] Failed: %s (%lu bytes)", res.error, res.bytes);
+        add_to_log(false, line);
+        printf("%s\r\n", line);
+        return;
+    }
+
+    // 速率以 KB/s 显示, 避免浮点格式化
+    snprintf(line, sizeof(line), "[YMODEM] %s %s %luB %lums %luKB/s%s",
+             res.sending ? "Sent" : "Got", res.name, res.bytes, res.elapsed_ms,
+             res.elapsed_ms ? res.bytes / res.elapsed_ms : 0, res.streaming ? " (G)" : "");
+    add_to_log(false, line);
+    printf("%s\r\n", line);
+
+    if (!res.sending) {
+        file_area_len = res.bytes;
+        capture_dirty = true;
+
+        // 显示文件校验值和第一行内容, 方便确认配置/脚本是否正确
+        uint32_t first = 0;
+        while (first < res.bytes && first < MAX_LOG_WIDTH - 1 && file_area[first] != '\r' && file_area[first] != '\n') {
+            first++;
+        }
+        snprintf(line, sizeof(line), "CRC32 %08lX: %.*s", crc32_calc(file_area, res.bytes), (int)first, (char*)file_area);
+        add_to_log(true, line);
+    }
+}
+
+/**
+  * @brief 向日志捕获缓冲区追加一行 (以 CRLF 结尾), 写满后覆盖最旧的内容
+  */
+static void capture_append(CaptureRing_t* cap, const char* msg)
+{
+    uint32_t pos = cap->total;
+
+    for (; *msg; msg++) {
+        cap->buf[pos++ % cap->size] = *msg;
+    }
+    cap->buf[pos++ % cap->size] = '\r';
+    cap->buf[pos++ % cap->size] = '\n';
+
+    cap->total = pos; // 内容写完后才发布
+    capture_dirty = true;
+}
+
+/**
+  * @brief 按布局重新划分 mem_arena: CDC 收发缓冲区、日志捕获和文件区 (原有内容全部丢弃)
+  * @return 0: 成功, -1: 布局无效, -2: 文件传输/桥接/复用/测试/转发进行中
+  */
+static int apply_mem_layout(const mem_layout_t* layout)
+{
+    uint32_t primask;
+    uint32_t half = layout->scrollback / 2;
+
+    if (mem_layout_check(layout) != 0) {
+        return -1;
+    }
+    // 这些模块正在使用缓冲区中的数据
+    if (ymodem_is_active() || uart_bridge_is_active() || cdc_mux_is_active() ||
+        cdc_bench_get_mode() != CDC_BENCH_OFF) {
+        return -2;
+    }
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        if (cdc_acm_port_is_forwarding(port)) {
+            return -2;
+        }
+    }
+
+    // 布局已检查过, 下面的分配和设置不会失败
+    mem_arena_reset();
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        void* rx = mem_arena_alloc(layout->cdc_rx);
+        void* tx = mem_arena_alloc(layout->cdc_tx);
+        cdc_acm_port_set_buffers(port, rx, layout->cdc_rx, tx, layout->cdc_tx);
+    }
+
+    // U 盘回调在 USB 中断中读取这些缓冲区, 关中断一起切换
+    primask = __get_PRIMASK();
+    __disable_irq();
+    rx_capture = (CaptureRing_t){ .buf = mem_arena_alloc(half), .size = half };
+    tx_capture = (CaptureRing_t){ .buf = mem_arena_alloc(half), .size = half };
+    file_area_size = layout->file;
+    file_area = mem_arena_alloc(file_area_size);
+    file_area_len = 0;
+    __set_PRIMASK(primask);
+
+    mem_layout = *layout;
+    capture_dirty = true;
+    return 0;
+}
+
+/**
+  * @brief 内存布局命令: "" 显示, "RX"/"TX"/"BALANCED" 预设, "SET rx tx log file" 自定义, "SAVE" 保存
+  */
+static void mem_command(const char* arg)
+{
+    const mem_layout_t* preset = mem_layout_preset(arg);
+    mem_layout_t layout;
+    char msg[MAX_LOG_WIDTH];
+    int ret;
+
+    if (strcmp(arg, "SAVE") == 0) {
+        // 扇区写满时要擦除, CPU 会停顿 1~2 秒
+        ret = mem_layout_save(&mem_layout);
+        add_to_log(false, ret == 0 ? "[MEM] Layout saved." : "[MEM] Save failed!");
+        return;
+    }
+
+    if (arg[0] != '\0') {
+        if (preset != NULL) {
+            layout = *preset;
+        } else if (strncmp(arg, "SET ", 4) == 0) {
+            uint32_t* v[4] = { &layout.cdc_rx, &layout.cdc_tx, &layout.scrollback, &layout.file };
+            const char* s = &arg[4];
+            char* end;
+
+            for (int i = 0; i < 4; i++, s = end) {
+                *v[i] = (uint32_t)strtoul(s, &end, 0);
+                if (end == s) {
+                    add_to_log(false, "[MEM] Usage: MEM SET <rx> <tx> <log> <file>");
+                    return;
+                }
+            }
+        } else {
+            add_to_log(false, "[MEM] Unknown layout, use BALANCED / RX / TX / SET / SAVE");
+            return;
+        }
+
+        ret = apply_mem_layout(&layout);
+        if (ret != 0) {
+            add_to_log(false, ret == -1 ? "[MEM] Invalid layout (2^n CDC sizes, must fit arena)."
+                                        : "[MEM] Busy, stop transfer/bridge/mux first.");
+            return;
+        }
+    }
+
+    snprintf(msg, sizeof(msg), "[MEM] CDC RX %lu TX %lu x%d, Log %lu, File %lu, %lu/%lu used",
+             mem_layout.cdc_rx, mem_layout.cdc_tx, CDC_ACM_PORT_NUM, mem_layout.scrollback,
+             mem_layout.file, mem_arena_get_used(), mem_arena_get_size());
+    add_to_log(false, msg);
+}
+
+#if MSC_DISK_ENABLE
+/*
+ * U 盘文件 (回调在 USB 中断中执行, 直接读取应用缓冲区, 不复制)
+ *   RX_LOG.TXT / TX_LOG.TXT: 日志捕获缓冲区中保留的内容
+ *   SLOTS.TXT: 8 个存储槽, 每行定长, 空槽为空格
+ *   FILE.BIN:  YMODEM 文件区中的文件
+ */
+#define SLOT_LINE_LEN (4 + MAX_STORAGE_WIDTH - 1 + 2) // "RX0 " + 内容 + CRLF
+
+static uint32_t capture_snapshot(void* ctx)
+{
+    CaptureRing_t* cap = ctx;
+    uint32_t total = cap->total;
+
+    cap->snap_start = total > cap->size ? total - cap->size : 0;
+    return total - cap->snap_start;
+}
+
+static void capture_read(void* ctx, uint32_t offset, uint8_t* buf, uint32_t len)
+{
+    CaptureRing_t* cap = ctx;
+    uint32_t pos = cap->snap_start + offset;
+
+    for (uint32_t i = 0; i < len; i++, pos++) {
+        // 快照之后又被新日志覆盖的部分用 '~' 填充
+        buf[i] = (cap->total - pos > cap->size) ? '~' : (uint8_t)cap->buf[pos % cap->size];
+    }
+}
+
+static uint32_t slots_snapshot(void* ctx)
+{
+    return 2 * MAX_STORAGE_SLOTS * SLOT_LINE_LEN;
+}
+
+static void slots_read(void* ctx, uint32_t offset, uint8_t* buf, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; i++, offset++) {
+        uint32_t line = offset / SLOT_LINE_LEN;
+        uint32_t col = offset % SLOT_LINE_LEN;
+        bool is_rx = line < MAX_STORAGE_SLOTS;
+        const char* slot = is_rx ? rx_storage[line] : tx_storage[line - MAX_STORAGE_SLOTS];
+
+        if (col < 4) {
+            buf[i] = (uint8_t)"RX0 "[col];
+            if (col == 0 && !is_rx) buf[i] = 'T';
+            if (col == 2) buf[i] = (uint8_t)('0' + line % MAX_STORAGE_SLOTS);
+        } else if (col < SLOT_LINE_LEN - 2) {
+            // strncpy 把槽的剩余部分填成 0, 显示为空格
+            buf[i] = slot[col - 4] ? (uint8_t)slot[col - 4] : ' ';
+        } else {
+            buf[i] = (col == SLOT_LINE_LEN - 2) ? '\r' : '\n';
+        }
+    }
+}
+
+static uint32_t file_snapshot(void* ctx)
+{
+    return file_area_len;
+}
+
+static void file_read(void* ctx, uint32_t offset, uint8_t* buf, uint32_t len)
+{
+    // 快照之后文件区被重新划分 (MEM 命令), 旧快照的内容已不存在
+    if (offset + len > file_area_len) {
+        memset(buf, 0, len);
+        return;
+    }
+    memcpy(buf, &file_area[offset], len);
+}
+
+static const msc_disk_file_t msc_files[] = {
+    { .name = "RX_LOG.TXT", .snapshot = capture_snapshot, .read = capture_read, .ctx = &rx_capture },
+    { .name = "TX_LOG.TXT", .snapshot = capture_snapshot, .read = capture_read, .ctx = &tx_capture },
+    { .name = "SLOTS.TXT",  .snapshot = slots_snapshot,   .read = slots_read },
+    { .name = "FILE.BIN",   .snapshot = file_snapshot,    .read = file_read },
+};
+
+/**
+  * @brief 把日志、存储槽和文件区注册为 U 盘上的文件
+  */
+static void msc_register_files(void)
+{
+    for (uint32_t i = 0; i < sizeof(msc_files) / sizeof(msc_files[0]); i++) {
+        msc_disk_register_file(&msc_files[i]);
+    }
+}
+
+/**
+  * @brief 内容有变化时定期生成新快照, 避免主机频繁重新读取
+  */
+static void msc_task_handler(void)
+{
+    static uint32_t last_refresh_tick = 0;
+
+    if (capture_dirty && HAL_GetTick() - last_refresh_tick >= MSC_REFRESH_MS) {
+        last_refresh_tick = HAL_GetTick();
+        capture_dirty = false;
+        msc_disk_refresh();
+    }
+}
+#endif
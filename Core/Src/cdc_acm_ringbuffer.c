@@ -3,22 +3,51 @@
  */
 
 #include "cdc_acm_ringbuffer.h"
+#include "usb_vendor_bulk.h"
+#include "usb_msc_disk.h"
 #include "usbd_core.h"
 #include "usbd_cdc_acm.h"
-#include "chry_ringbuffer.h"  // 引入CherryRingBuffer头文件
+#include "lf_ringbuffer.h"    // 中断与主循环之间的无锁环形缓冲区
+#include "stm32f4xx_hal.h"    // DWT 周期计数器和 HAL 毫秒计数 (接收时间戳)
+#include <stdio.h>
+#include <string.h>
 
 /*!< endpoint address */
 #define CDC_IN_EP  0x81
 #define CDC_OUT_EP 0x02
 #define CDC_INT_EP 0x83
 
+/*!< 同一内核上第二个端口的端点 (仅 OTG_HS 内核有足够的 IN 端点) */
+#define CDC1_IN_EP  0x82
+#define CDC1_OUT_EP 0x01
+#define CDC1_INT_EP 0x84
+
 #define USBD_VID           0xFFFF
 #define USBD_PID           0xFFFF
 #define USBD_MAX_POWER     100
 #define USBD_LANGID_STRING 1033
 
 /*!< config descriptor size */
-#define USB_CONFIG_SIZE (9 + CDC_ACM_DESCRIPTOR_LEN)
+#if VENDOR_BULK_ENABLE
+#define USB_CONFIG_SIZE (9 + CDC_ACM_DESCRIPTOR_LEN * CDC_ACM_BUS_PORTS + VENDOR_BULK_DESCRIPTOR_LEN)
+#define USB_INTF_NUM    (2 * CDC_ACM_BUS_PORTS + 1)
+#define USBD_BCD_USB    USB_2_1 // 2.1 才会让主机读取 BOS 描述符
+#elif MSC_DISK_ENABLE
+#define USB_CONFIG_SIZE (9 + CDC_ACM_DESCRIPTOR_LEN * CDC_ACM_BUS_PORTS + MSC_DISK_DESCRIPTOR_LEN)
+#define USB_INTF_NUM    (2 * CDC_ACM_BUS_PORTS + 1)
+#define USBD_BCD_USB    USB_2_0
+#else
+#define USB_CONFIG_SIZE (9 + CDC_ACM_DESCRIPTOR_LEN * CDC_ACM_BUS_PORTS)
+#define USB_INTF_NUM    (2 * CDC_ACM_BUS_PORTS)
+#define USBD_BCD_USB    USB_2_0
+#endif
+
+/*!< 第二个内核只有 CDC 端口 (U 盘/厂商接口只在第一个内核上) */
+#define USB_CONFIG_SIZE_CDC (9 + CDC_ACM_DESCRIPTOR_LEN * CDC_ACM_BUS_PORTS)
+#define USB_INTF_NUM_CDC    (2 * CDC_ACM_BUS_PORTS)
+
+/* 尚未分配到内核的端口 */
+#define CDC_ACM_BUS_NONE 0xFF
 
 #ifdef CONFIG_USB_HS
 #define CDC_MAX_MPS 512
@@ -26,43 +55,185 @@
 #define CDC_MAX_MPS 64
 #endif
 
+#if CDC_ACM_PORT_NUM < 1 || CDC_ACM_PORT_NUM > 2
+#error "CDC_ACM_PORT_NUM must be 1 or 2 (each CDC ACM port needs 2 IN endpoints)"
+#endif
+
+#if CDC_ACM_BUS_NUM < 1 || CDC_ACM_BUS_NUM > 2 || CDC_ACM_PORT_NUM % CDC_ACM_BUS_NUM != 0
+#error "CDC_ACM_BUS_NUM must be 1 or 2 and divide CDC_ACM_PORT_NUM"
+#endif
+
+#if CDC_ACM_BUS_NUM > CONFIG_USBDEV_MAX_BUS
+#error "CDC_ACM_BUS_NUM > 1 needs CONFIG_USBDEV_MAX_BUS >= 2 in usb_config.h"
+#endif
+
+#if CDC_ACM_BUS_NUM > 1 && !defined(CONFIG_USBDEV_ADVANCE_DESC)
+#error "CDC_ACM_BUS_NUM > 1 needs CONFIG_USBDEV_ADVANCE_DESC (one descriptor set per core)"
+#endif
+
 /* ========== RingBuffer配置 ========== */
 /* 注意：size必须是2的幂次方！如：512, 1024, 2048, 4096, 8192 */
 #define CDC_RX_RINGBUF_SIZE  (4096)  // 接收环形缓冲区大小
 #define CDC_TX_RINGBUF_SIZE  (4096)  // 发送环形缓冲区大小
+#define CDC_TX_PRIO_RINGBUF_SIZE (512) // 高优先级发送通道大小 (交互回复，不需要很大)
 #define CDC_USB_READ_SIZE    (2048)  // USB单次读取大小
 
-/* RingBuffer实例 */
-static chry_ringbuffer_t rx_ringbuf;
-static chry_ringbuffer_t tx_ringbuf;
+/* ========== 发送合并配置 ========== */
+/* 小于一个包的数据最多等待多少帧(1ms)再发出，0 表示立即发送。需要 CONFIG_USBDEV_SOF_ENABLE */
+#ifndef CDC_TX_COALESCE_FRAMES
+#define CDC_TX_COALESCE_FRAMES (0)
+#endif
+
+/* ========== 优先级发送配置 ========== */
+/* 两个发送通道都有数据时批量数据的带宽份额 (%)，0 表示高优先级通道严格优先 */
+#ifndef CDC_TX_BULK_SHARE
+#define CDC_TX_BULK_SHARE (50)
+#endif
+
+#if CDC_TX_COMPRESS_ENABLE && LZ_STREAM_OUT_MAX(LZ_STREAM_BLOCK_MAX) > CDC_USB_READ_SIZE
+#error "A compressed block must fit in the USB write buffer"
+#endif
+
+#if CDC_USB_READ_SIZE > CDC_RINGBUF_MIN_RX
+#error "The smallest RX ringbuffer must hold one USB read"
+#endif
+
+#if (CDC_RX_TS_NUM & (CDC_RX_TS_NUM - 1)) != 0
+#error "CDC_RX_TS_NUM must be a power of 2"
+#endif
+
+/* 一次 OUT 传输在接收缓冲区中的位置 [start, end) (与读写指针一样不回绕) 和完成时间 */
+typedef struct {
+    uint32_t start;
+    uint32_t end;
+    cdc_acm_rx_ts_t ts;
+} cdc_acm_rx_chunk_t;
+
+/* ========== 端口实例 ========== */
+struct cdc_acm_port {
+    uint8_t busid;                   // 端口所在的USB总线
+    uint8_t in_ep;                   // 批量IN端点
+    uint8_t out_ep;                  // 批量OUT端点
+    lf_spsc_ringbuffer_t rx_ringbuf; // 接收环形缓冲区 (USB中断写, 主循环读)
+    lf_mpsc_ringbuffer_t tx_ringbuf; // 发送环形缓冲区 (任意上下文写, 占有IN端点者读)
+    lf_mpsc_ringbuffer_t tx_prio_ringbuf; // 高优先级发送通道，每次传输边界先于发送缓冲区
+    uint8_t *usb_read_buffer;        // USB接收临时缓冲区
+    uint8_t *usb_write_buffer;       // USB发送临时缓冲区
+    volatile bool ep_tx_busy_flag;   // IN端点占用，同时保证发送缓冲区只有一个消费者
+    volatile bool rx_flush_req;      // 由消费者执行的清空请求 (复位/断开时设置)
+    volatile bool tx_flush_req;
+    volatile bool rx_paused;         // 接收缓冲区放不下下一次传输，OUT端点暂停 (NAK)
+    cdc_acm_rx_chunk_t rx_ts[CDC_RX_TS_NUM]; // 接收时间戳 (USB中断写，满了覆盖最旧的)
+    volatile uint32_t rx_ts_head;    // 已记录的时间戳数
+    uint32_t rx_ts_tail;             // 消费者: 第一个可能还有未读数据的时间戳
+    volatile uint8_t dtr_enable;
+    uint8_t tx_coalesce_frames;      // 合并发送截止时间 (帧, 0=立即发送)
+    volatile uint8_t tx_wait_frames; // 待发送数据已等待的帧数
+    cdc_acm_line_coding_t line_coding;       // 主机设置的串口参数
+    cdc_acm_line_coding_cb_t line_coding_cb; // 串口参数变化回调 (USB中断上下文)
+    cdc_acm_stats_t stats;           // 统计 (rx_used 等读取时才填写的字段不在这里维护)
+    uint32_t tx_start_cyc;           // 当前 IN 传输开始时的 DWT 周期
+    uint8_t tx_bulk_share;           // 两个通道都有数据时批量数据的带宽份额 (%)
+    int32_t tx_bulk_credit;          // 发送消费者: 批量数据应得而未得的份额 (字节 × 100)，>0 时轮到批量数据
+    volatile uint32_t tx_prio_enq_cyc; // 高优先级通道从空变为非空时的 DWT 周期
+    volatile bool tx_lz_req;         // 请求的发送压缩状态 (由发送消费者应用)
+    volatile bool tx_lz_restart;     // 主机重新打开端口，压缩流从头开始
+    bool tx_lz_on;                   // 发送消费者: 当前是否在压缩
+    struct cdc_acm_port *volatile fwd_src; // 转发: IN端点直接发送这个端口的接收缓冲区
+    struct cdc_acm_port *volatile fwd_dst; // 转发: 本端口收到的数据由这个端口发出
+    struct cdc_acm_port *fwd_inflight; // 当前IN传输发送的是哪个端口的接收缓冲区
+    volatile uint32_t fwd_len;       // 本端口接收缓冲区中正被转发的字节数，发送完成才释放
+    cdc_acm_forward_hook_t fwd_hook; // 转发钩子 (属于发送端口)
+    void *fwd_ctx;
+    struct usbd_endpoint out_ep_cfg;
+    struct usbd_endpoint in_ep_cfg;
+    struct usbd_interface intf0;     // 通信接口
+    struct usbd_interface intf1;     // 数据接口
+};
 
-/* RingBuffer存储空间 */
-USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t rx_ringbuf_pool[CDC_RX_RINGBUF_SIZE];
-USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t tx_ringbuf_pool[CDC_TX_RINGBUF_SIZE];
+/* RingBuffer存储空间 (CDC_RINGBUF_EXTERNAL 时收发缓冲区由应用提供) */
+#if !CDC_RINGBUF_EXTERNAL
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t rx_ringbuf_pool[CDC_ACM_PORT_NUM][CDC_RX_RINGBUF_SIZE];
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t tx_ringbuf_pool[CDC_ACM_PORT_NUM][CDC_TX_RINGBUF_SIZE];
+#endif
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t tx_prio_ringbuf_pool[CDC_ACM_PORT_NUM][CDC_TX_PRIO_RINGBUF_SIZE];
 
 /* USB临时缓冲区 */
-USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t usb_read_buffer[CDC_USB_READ_SIZE];
-USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t usb_write_buffer[CDC_USB_READ_SIZE];
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t usb_read_buffer[CDC_ACM_PORT_NUM][CDC_USB_READ_SIZE];
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t usb_write_buffer[CDC_ACM_PORT_NUM][CDC_USB_READ_SIZE];
 
-volatile bool ep_tx_busy_flag = false;
-volatile uint8_t dtr_enable = 0;
+/* 事件通知回调 (USB中断上下文) */
+static cdc_acm_event_cb_t g_event_cb;
+
+#if CDC_TX_COMPRESS_ENABLE
+/* 发送压缩器: 属于 owner 端口，只在该端口的发送消费者 (占有IN端点者) 中使用 */
+static lz_stream_t g_tx_lz;
+static struct cdc_acm_port *g_tx_lz_owner;
+#endif
 
 /* ========== 函数前向声明 ========== */
 static void usbd_event_handler(uint8_t busid, uint8_t event);
+static int cdc_acm_vendor_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len);
 void usbd_cdc_acm_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes);
 void usbd_cdc_acm_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes);
 void usbd_cdc_acm_set_dtr(uint8_t busid, uint8_t intf, bool dtr);
 void cdc_acm_try_send(uint8_t busid);
 
+static struct cdc_acm_port g_cdc_ports[CDC_ACM_PORT_NUM] = {
+    {
+        .busid = CDC_ACM_BUS_NONE,
+        .in_ep = CDC_IN_EP,
+        .out_ep = CDC_OUT_EP,
+        .out_ep_cfg = { .ep_addr = CDC_OUT_EP, .ep_cb = usbd_cdc_acm_bulk_out },
+        .in_ep_cfg = { .ep_addr = CDC_IN_EP, .ep_cb = usbd_cdc_acm_bulk_in },
+        .tx_coalesce_frames = CDC_TX_COALESCE_FRAMES,
+        .tx_bulk_share = CDC_TX_BULK_SHARE,
+        .line_coding = { 115200, 0, 0, 8 },
+    },
+#if CDC_ACM_BUS_PORTS > 1
+    {
+        .busid = CDC_ACM_BUS_NONE,
+        .in_ep = CDC1_IN_EP,
+        .out_ep = CDC1_OUT_EP,
+        .out_ep_cfg = { .ep_addr = CDC1_OUT_EP, .ep_cb = usbd_cdc_acm_bulk_out },
+        .in_ep_cfg = { .ep_addr = CDC1_IN_EP, .ep_cb = usbd_cdc_acm_bulk_in },
+        .tx_coalesce_frames = CDC_TX_COALESCE_FRAMES,
+        .tx_bulk_share = CDC_TX_BULK_SHARE,
+        .line_coding = { 115200, 0, 0, 8 },
+    },
+#elif CDC_ACM_PORT_NUM > 1
+    {
+        // 另一个内核上的端口，端点号与端口0相同
+        .busid = CDC_ACM_BUS_NONE,
+        .in_ep = CDC_IN_EP,
+        .out_ep = CDC_OUT_EP,
+        .out_ep_cfg = { .ep_addr = CDC_OUT_EP, .ep_cb = usbd_cdc_acm_bulk_out },
+        .in_ep_cfg = { .ep_addr = CDC_IN_EP, .ep_cb = usbd_cdc_acm_bulk_in },
+        .tx_coalesce_frames = CDC_TX_COALESCE_FRAMES,
+        .tx_bulk_share = CDC_TX_BULK_SHARE,
+        .line_coding = { 115200, 0, 0, 8 },
+    },
+#endif
+};
+
 /* ========== 描述符定义 (保持原样) ========== */
 #ifdef CONFIG_USBDEV_ADVANCE_DESC
 static const uint8_t device_descriptor[] = {
-    USB_DEVICE_DESCRIPTOR_INIT(USB_2_0, 0xEF, 0x02, 0x01, USBD_VID, USBD_PID, 0x0100, 0x01)
+    USB_DEVICE_DESCRIPTOR_INIT(USBD_BCD_USB, 0xEF, 0x02, 0x01, USBD_VID, USBD_PID, 0x0100, 0x01)
 };
 
 static const uint8_t config_descriptor[] = {
-    USB_CONFIG_DESCRIPTOR_INIT(USB_CONFIG_SIZE, 0x02, 0x01, USB_CONFIG_BUS_POWERED, USBD_MAX_POWER),
-    CDC_ACM_DESCRIPTOR_INIT(0x00, CDC_INT_EP, CDC_OUT_EP, CDC_IN_EP, CDC_MAX_MPS, 0x02)
+    USB_CONFIG_DESCRIPTOR_INIT(USB_CONFIG_SIZE, USB_INTF_NUM, 0x01, USB_CONFIG_BUS_POWERED, USBD_MAX_POWER),
+    CDC_ACM_DESCRIPTOR_INIT(0x00, CDC_INT_EP, CDC_OUT_EP, CDC_IN_EP, CDC_MAX_MPS, 0x02),
+#if CDC_ACM_BUS_PORTS > 1
+    CDC_ACM_DESCRIPTOR_INIT(0x02, CDC1_INT_EP, CDC1_OUT_EP, CDC1_IN_EP, CDC_MAX_MPS, 0x02),
+#endif
+#if VENDOR_BULK_ENABLE
+    VENDOR_BULK_DESCRIPTOR_INIT(VENDOR_BULK_INTF, VENDOR_BULK_OUT_EP, VENDOR_BULK_IN_EP, CDC_MAX_MPS),
+#endif
+#if MSC_DISK_ENABLE
+    MSC_DISK_DESCRIPTOR_INIT(MSC_DISK_INTF, MSC_DISK_OUT_EP, MSC_DISK_IN_EP, CDC_MAX_MPS),
+#endif
 };
 
 static const uint8_t device_quality_descriptor[] = {
@@ -105,14 +276,71 @@ const struct usb_descriptor cdc_descriptor = {
     .device_descriptor_callback = device_descriptor_callback,
     .config_descriptor_callback = config_descriptor_callback,
     .device_quality_descriptor_callback = device_quality_descriptor_callback,
-    .string_descriptor_callback = string_descriptor_callback
+    .string_descriptor_callback = string_descriptor_callback,
+#if VENDOR_BULK_ENABLE
+    .msosv2_descriptor = &vendor_bulk_msosv2_desc,
+    .bos_descriptor = &vendor_bulk_bos_desc,
+#endif
+};
+
+#if CDC_ACM_BUS_NUM > 1
+/* 第二个内核: 只有 CDC 端口，序列号不同，主机才能把两个设备区分开 */
+static const uint8_t device_descriptor_cdc[] = {
+    USB_DEVICE_DESCRIPTOR_INIT(USB_2_0, 0xEF, 0x02, 0x01, USBD_VID, USBD_PID, 0x0100, 0x01)
+};
+
+static const uint8_t config_descriptor_cdc[] = {
+    USB_CONFIG_DESCRIPTOR_INIT(USB_CONFIG_SIZE_CDC, USB_INTF_NUM_CDC, 0x01, USB_CONFIG_BUS_POWERED, USBD_MAX_POWER),
+    CDC_ACM_DESCRIPTOR_INIT(0x00, CDC_INT_EP, CDC_OUT_EP, CDC_IN_EP, CDC_MAX_MPS, 0x02),
+};
+
+static const char *string_descriptors_cdc[] = {
+    (const char[]){ 0x09, 0x04 },
+    "PolarisYu",
+    "Polaris CDC DEMO (HS)",
+    "2052125841",
+};
+
+static const uint8_t *device_descriptor_cdc_callback(uint8_t speed)
+{
+    return device_descriptor_cdc;
+}
+
+static const uint8_t *config_descriptor_cdc_callback(uint8_t speed)
+{
+    return config_descriptor_cdc;
+}
+
+static const char *string_descriptor_cdc_callback(uint8_t speed, uint8_t index)
+{
+    if (index > 3) {
+        return NULL;
+    }
+    return string_descriptors_cdc[index];
+}
+
+const struct usb_descriptor cdc_descriptor_bus1 = {
+    .device_descriptor_callback = device_descriptor_cdc_callback,
+    .config_descriptor_callback = config_descriptor_cdc_callback,
+    .device_quality_descriptor_callback = device_quality_descriptor_callback,
+    .string_descriptor_callback = string_descriptor_cdc_callback,
 };
+#endif
 #else
 /*!< global descriptor */
 static const uint8_t cdc_descriptor[] = {
-    USB_DEVICE_DESCRIPTOR_INIT(USB_2_0, 0xEF, 0x02, 0x01, USBD_VID, USBD_PID, 0x0100, 0x01),
-    USB_CONFIG_DESCRIPTOR_INIT(USB_CONFIG_SIZE, 0x02, 0x01, USB_CONFIG_BUS_POWERED, USBD_MAX_POWER),
+    USB_DEVICE_DESCRIPTOR_INIT(USBD_BCD_USB, 0xEF, 0x02, 0x01, USBD_VID, USBD_PID, 0x0100, 0x01),
+    USB_CONFIG_DESCRIPTOR_INIT(USB_CONFIG_SIZE, USB_INTF_NUM, 0x01, USB_CONFIG_BUS_POWERED, USBD_MAX_POWER),
     CDC_ACM_DESCRIPTOR_INIT(0x00, CDC_INT_EP, CDC_OUT_EP, CDC_IN_EP, CDC_MAX_MPS, 0x02),
+#if CDC_ACM_BUS_PORTS > 1
+    CDC_ACM_DESCRIPTOR_INIT(0x02, CDC1_INT_EP, CDC1_OUT_EP, CDC1_IN_EP, CDC_MAX_MPS, 0x02),
+#endif
+#if VENDOR_BULK_ENABLE
+    VENDOR_BULK_DESCRIPTOR_INIT(VENDOR_BULK_INTF, VENDOR_BULK_OUT_EP, VENDOR_BULK_IN_EP, CDC_MAX_MPS),
+#endif
+#if MSC_DISK_ENABLE
+    MSC_DISK_DESCRIPTOR_INIT(MSC_DISK_INTF, MSC_DISK_OUT_EP, MSC_DISK_IN_EP, CDC_MAX_MPS),
+#endif
     USB_LANGID_INIT(USBD_LANGID_STRING),
     0x14, USB_DESCRIPTOR_TYPE_STRING,
     'C', 0x00, 'h', 0x00, 'e', 0x00, 'r', 0x00, 'r', 0x00, 'y', 0x00,
@@ -132,284 +360,1296 @@ static const uint8_t cdc_descriptor[] = {
 };
 #endif
 
+/* 一次传输包含的包数，0 字节为一个 ZLP */
+#define CDC_PACKETS(nbytes) ((nbytes) ? ((nbytes) + CDC_MAX_MPS - 1) / CDC_MAX_MPS : 1U)
+
+/* ========== 端口查找 ========== */
+static inline struct cdc_acm_port *cdc_acm_get_port(uint8_t port)
+{
+    return (port < CDC_ACM_PORT_NUM) ? &g_cdc_ports[port] : NULL;
+}
+
+static inline void cdc_acm_port_notify(struct cdc_acm_port *p, uint8_t events)
+{
+    cdc_acm_event_cb_t cb = g_event_cb;
+
+    if (cb) {
+        cb((uint8_t)(p - g_cdc_ports), events);
+    }
+}
+
+static struct cdc_acm_port *cdc_acm_port_by_ep(uint8_t busid, uint8_t ep)
+{
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        struct cdc_acm_port *p = &g_cdc_ports[i];
+        if (p->busid == busid && (p->in_ep == ep || p->out_ep == ep)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+static struct cdc_acm_port *cdc_acm_port_by_intf(uint8_t busid, uint8_t intf)
+{
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        struct cdc_acm_port *p = &g_cdc_ports[i];
+        if (p->busid == busid && (p->intf0.intf_num == intf || p->intf1.intf_num == intf)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/* 旧的单端口API: 取该总线上的第一个端口 */
+static uint8_t cdc_acm_port_of_bus(uint8_t busid)
+{
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        if (g_cdc_ports[i].busid == busid) {
+            return i;
+        }
+    }
+    return CDC_ACM_PORT_DEFAULT;
+}
+
+/* 消费者访问接收缓冲区前先执行挂起的清空请求 */
+static lf_spsc_ringbuffer_t *cdc_acm_port_rx(struct cdc_acm_port *p)
+{
+    // 正在转发的区域还被IN端点引用，等它释放后再清空
+    if (p->rx_flush_req && p->fwd_len == 0) {
+        p->rx_flush_req = false;
+        lf_spsc_ringbuffer_drop(&p->rx_ringbuf, lf_spsc_ringbuffer_get_used(&p->rx_ringbuf));
+    }
+    return &p->rx_ringbuf;
+}
+
+/*
+ * 消费者释放接收缓冲区空间后调用：OUT端点因缓冲区满而暂停时，
+ * 空间足够一次传输就重新启动接收
+ */
+static void cdc_acm_port_rx_resume(struct cdc_acm_port *p)
+{
+    if (!p->rx_paused || lf_spsc_ringbuffer_get_free(&p->rx_ringbuf) < CDC_USB_READ_SIZE) {
+        return;
+    }
+    if (__atomic_exchange_n(&p->rx_paused, false, __ATOMIC_ACQ_REL)) {
+        usbd_ep_start_read(p->busid, p->out_ep, p->usb_read_buffer, CDC_USB_READ_SIZE);
+    }
+}
+
+/* ========== 接收时间戳 ========== */
+/* USB中断中记录一次传输，不等待消费者，所以不会拖慢接收 */
+static void cdc_acm_port_rx_stamp(struct cdc_acm_port *p, const cdc_acm_rx_ts_t *ts, uint32_t len)
+{
+    uint32_t head = p->rx_ts_head;
+    cdc_acm_rx_chunk_t *c = &p->rx_ts[head & (CDC_RX_TS_NUM - 1)];
+
+    c->end = p->rx_ringbuf.in; // 生产者自己的写指针，已包含本次数据
+    c->start = c->end - len;
+    c->ts = *ts;
+    __atomic_store_n(&p->rx_ts_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/* ========== 优先级发送 (在发送消费者中执行) ========== */
+
+/* 记账: 高优先级通道发出的字节为批量数据积累份额，批量数据发出的字节消耗份额 */
+static void cdc_acm_port_tx_charge(struct cdc_acm_port *p, bool prio, uint32_t len)
+{
+    const int32_t limit = CDC_USB_READ_SIZE * 100;
+    int32_t credit = p->tx_bulk_credit;
+
+    if (prio) {
+        credit += (int32_t)(len * p->tx_bulk_share);
+    } else {
+        credit -= (int32_t)(len * (100U - p->tx_bulk_share));
+    }
+    // 限制在一次传输的范围内，长时间单边占用后不会反过来饿死另一个通道
+    p->tx_bulk_credit = (credit > limit) ? limit : (credit < -limit) ? -limit : credit;
+}
+
+/* ========== 转发 (在发送端口的发送消费者中执行) ========== */
+
+/* 转发的IN传输结束 (或被断开打断)：释放来源接收缓冲区中的区域 */
+static void cdc_acm_port_forward_done(struct cdc_acm_port *p)
+{
+    struct cdc_acm_port *src = p->fwd_inflight;
+
+    if (src == NULL) {
+        return;
+    }
+    p->fwd_inflight = NULL;
+    lf_spsc_ringbuffer_linear_read_done(&src->rx_ringbuf, src->fwd_len);
+    __atomic_store_n(&src->fwd_len, 0, __ATOMIC_RELEASE);
+    cdc_acm_port_rx_resume(src);
+}
+
+/* 把来源端口接收缓冲区中的一段连续数据直接作为IN传输发出，返回是否已启动 */
+static bool cdc_acm_port_forward(struct cdc_acm_port *p, struct cdc_acm_port *src)
+{
+    uint32_t size, len;
+    uint8_t *ptr;
+
+    for (;;) {
+        ptr = lf_spsc_ringbuffer_linear_read_setup(cdc_acm_port_rx(src), &size);
+        if (size == 0) {
+            return false;
+        }
+        if (size > CDC_USB_READ_SIZE) {
+            size = CDC_USB_READ_SIZE;
+        }
+
+        len = p->fwd_hook ? p->fwd_hook(p->fwd_ctx, ptr, size) : size;
+        if (len > 0) {
+            break;
+        }
+        // 钩子丢弃了整段
+        lf_spsc_ringbuffer_linear_read_done(&src->rx_ringbuf, size);
+        cdc_acm_port_rx_resume(src);
+    }
+
+    src->fwd_len = size;
+    p->fwd_inflight = src;
+    cdc_acm_port_tx_charge(p, false, (len < size) ? len : size);
+    p->tx_wait_frames = 0;
+    p->tx_start_cyc = DWT->CYCCNT;
+    usbd_ep_start_write(p->busid, p->in_ep, ptr, (len < size) ? len : size);
+    return true;
+}
+
+/* ========== 发送合并 ========== */
+/* 每个SOF(1ms)调用一次：待发送数据等待超过截止时间后强制发出 */
+static void cdc_acm_port_sof(struct cdc_acm_port *p)
+{
+    if (p->tx_coalesce_frames == 0 || p->ep_tx_busy_flag ||
+        lf_mpsc_ringbuffer_check_empty(&p->tx_ringbuf)) {
+        return;
+    }
+
+    if (++p->tx_wait_frames >= p->tx_coalesce_frames) {
+        cdc_acm_port_try_send((uint8_t)(p - g_cdc_ports));
+    }
+}
+
+/* 只有该总线上有端口开启合并时才打开SOF中断，否则每帧一次的中断白白占用CPU */
+static void cdc_acm_sof_update(uint8_t busid)
+{
+#ifdef CONFIG_USBDEV_SOF_ENABLE
+    bool enable = false;
+
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        if (g_cdc_ports[i].busid == busid && g_cdc_ports[i].tx_coalesce_frames) {
+            enable = true;
+        }
+    }
+    usbd_set_sof_enable(busid, enable);
+#else
+    (void)busid;
+#endif
+}
+
 /* ========== RingBuffer初始化函数 ========== */
-static int cdc_ringbuffer_init(void)
+static int cdc_ringbuffer_init(uint8_t first, uint8_t num)
 {
     int ret;
-    
-    // 初始化接收环形缓冲区
-    ret = chry_ringbuffer_init(&rx_ringbuf, rx_ringbuf_pool, CDC_RX_RINGBUF_SIZE);
-    if (ret != 0) {
-        USB_LOG_ERR("RX ringbuffer init failed\r\n");
-        return ret;
-    }
-    
-    // 初始化发送环形缓冲区
-    ret = chry_ringbuffer_init(&tx_ringbuf, tx_ringbuf_pool, CDC_TX_RINGBUF_SIZE);
-    if (ret != 0) {
-        USB_LOG_ERR("TX ringbuffer init failed\r\n");
-        return ret;
+
+    for (uint8_t i = first; i < first + num; i++) {
+#if CDC_RINGBUF_EXTERNAL
+        // 收发缓冲区已由 cdc_acm_port_set_buffers() 指定
+        if (g_cdc_ports[i].rx_ringbuf.pool == NULL || g_cdc_ports[i].tx_ringbuf.pool == NULL) {
+            USB_LOG_ERR("Port%d has no ringbuffer, call cdc_acm_port_set_buffers() first\r\n", i);
+            return -1;
+        }
+#else
+        // 初始化接收环形缓冲区
+        ret = lf_spsc_ringbuffer_init(&g_cdc_ports[i].rx_ringbuf, rx_ringbuf_pool[i], CDC_RX_RINGBUF_SIZE);
+        if (ret != 0) {
+            USB_LOG_ERR("Port%d RX ringbuffer init failed\r\n", i);
+            return ret;
+        }
+
+        // 初始化发送环形缓冲区
+        ret = lf_mpsc_ringbuffer_init(&g_cdc_ports[i].tx_ringbuf, tx_ringbuf_pool[i], CDC_TX_RINGBUF_SIZE);
+        if (ret != 0) {
+            USB_LOG_ERR("Port%d TX ringbuffer init failed\r\n", i);
+            return ret;
+        }
+#endif
+
+        ret = lf_mpsc_ringbuffer_init(&g_cdc_ports[i].tx_prio_ringbuf, tx_prio_ringbuf_pool[i], CDC_TX_PRIO_RINGBUF_SIZE);
+        if (ret != 0) {
+            USB_LOG_ERR("Port%d TX prio ringbuffer init failed\r\n", i);
+            return ret;
+        }
+
+        g_cdc_ports[i].usb_read_buffer = usb_read_buffer[i];
+        g_cdc_ports[i].usb_write_buffer = usb_write_buffer[i];
     }
-    
-    USB_LOG_INFO("CDC RingBuffer initialized (RX:%d, TX:%d)\r\n", 
-                 CDC_RX_RINGBUF_SIZE, CDC_TX_RINGBUF_SIZE);
+
+    USB_LOG_INFO("CDC RingBuffer initialized (%d port, RX:%d, TX:%d)\r\n",
+                 num, (int)lf_spsc_ringbuffer_get_size(&g_cdc_ports[first].rx_ringbuf),
+                 (int)lf_mpsc_ringbuffer_get_size(&g_cdc_ports[first].tx_ringbuf));
     return 0;
 }
 
 /* ========== USB事件处理 ========== */
 static void usbd_event_handler(uint8_t busid, uint8_t event)
 {
-    switch (event) {
-        case USBD_EVENT_RESET:
-            // 复位时清空环形缓冲区
-            chry_ringbuffer_reset(&rx_ringbuf);
-            chry_ringbuffer_reset(&tx_ringbuf);
-            break;
-            
-        case USBD_EVENT_CONNECTED:
-            break;
-            
-        case USBD_EVENT_DISCONNECTED:
-            // 断开连接时清空缓冲区
-            chry_ringbuffer_reset(&rx_ringbuf);
-            chry_ringbuffer_reset(&tx_ringbuf);
-            ep_tx_busy_flag = false;
-            break;
-            
-        case USBD_EVENT_RESUME:
-            break;
-            
-        case USBD_EVENT_SUSPEND:
-            break;
-            
-        case USBD_EVENT_CONFIGURED:
-            ep_tx_busy_flag = false;
-            // 启动第一次USB接收
-            usbd_ep_start_read(busid, CDC_OUT_EP, usb_read_buffer, CDC_USB_READ_SIZE);
-            break;
-            
-        case USBD_EVENT_SET_REMOTE_WAKEUP:
-            break;
-            
-        case USBD_EVENT_CLR_REMOTE_WAKEUP:
-            break;
+    // usb_dc_init 默认打开了SOF中断，按各端口的合并设置重新决定
+    if (event == USBD_EVENT_INIT) {
+        cdc_acm_sof_update(busid);
+    }
 
-        default:
-            break;
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        struct cdc_acm_port *p = &g_cdc_ports[i];
+
+        if (p->busid != busid) {
+            continue;
+        }
+
+        switch (event) {
+            case USBD_EVENT_RESET:
+                // 复位时清空环形缓冲区 (由各自的消费者执行，中断里不能直接改读写指针)
+                p->rx_flush_req = true;
+                p->tx_flush_req = true;
+                p->rx_paused = false;
+                p->tx_lz_restart = true;
+                cdc_acm_port_notify(p, CDC_ACM_EVENT_STATE);
+                break;
+
+            case USBD_EVENT_CONNECTED:
+                break;
+
+            case USBD_EVENT_DISCONNECTED:
+                // 断开连接时清空缓冲区
+                p->rx_flush_req = true;
+                p->tx_flush_req = true;
+                __atomic_store_n(&p->ep_tx_busy_flag, false, __ATOMIC_RELEASE);
+                cdc_acm_port_notify(p, CDC_ACM_EVENT_STATE);
+                break;
+
+            case USBD_EVENT_RESUME:
+                break;
+
+            case USBD_EVENT_SUSPEND:
+                break;
+
+            case USBD_EVENT_SOF:
+                cdc_acm_port_sof(p);
+                break;
+
+            case USBD_EVENT_CONFIGURED:
+                __atomic_store_n(&p->ep_tx_busy_flag, false, __ATOMIC_RELEASE);
+                // 启动第一次USB接收
+                usbd_ep_start_read(busid, p->out_ep, p->usb_read_buffer, CDC_USB_READ_SIZE);
+                cdc_acm_port_notify(p, CDC_ACM_EVENT_STATE);
+                break;
+
+            case USBD_EVENT_SET_REMOTE_WAKEUP:
+                break;
+
+            case USBD_EVENT_CLR_REMOTE_WAKEUP:
+                break;
+
+            default:
+                break;
+        }
     }
 }
 
 /* ========== USB批量输出回调 (主机->设备) ========== */
 void usbd_cdc_acm_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes)
 {
+    struct cdc_acm_port *p = cdc_acm_port_by_ep(busid, ep);
+    cdc_acm_rx_ts_t ts;
+
+    if (p == NULL) {
+        return;
+    }
+
+    p->stats.rx_packets += CDC_PACKETS(nbytes);
+
     if (nbytes > 0) {
+        cdc_acm_rx_ts_now(&ts);
+
         // 将接收到的数据写入接收环形缓冲区
-        uint32_t written = chry_ringbuffer_write(&rx_ringbuf, usb_read_buffer, nbytes);
-        
+        uint32_t written = lf_spsc_ringbuffer_write(&p->rx_ringbuf, p->usb_read_buffer, nbytes);
+        if (written > 0) {
+            cdc_acm_port_rx_stamp(p, &ts, written);
+        }
+
+        uint32_t used = lf_spsc_ringbuffer_get_used(&p->rx_ringbuf);
+        p->stats.rx_bytes += nbytes;
+        if (used > p->stats.rx_high_water) {
+            p->stats.rx_high_water = used;
+        }
+
         if (written < nbytes) {
             // 缓冲区满，数据丢失
+            p->stats.rx_overflow_bytes += nbytes - written;
             USB_LOG_WRN("RX buffer overflow, lost %ld bytes\r\n", nbytes - written);
         }
-        
+
+        // 转发模式：不等主循环，直接启动发送端口的IN传输
+        struct cdc_acm_port *dst = p->fwd_dst;
+        if (dst != NULL) {
+            cdc_acm_port_try_send((uint8_t)(dst - g_cdc_ports));
+        } else if (written > 0) {
+            cdc_acm_port_notify(p, CDC_ACM_EVENT_RX);
+        }
+
         USB_LOG_DBG("Received %d bytes, buffered %ld bytes\r\n", nbytes, written);
     }
-    
+
+    // 放不下下一次传输时暂停接收，主机会被NAK直到消费者取走数据
+    if (lf_spsc_ringbuffer_get_free(&p->rx_ringbuf) < CDC_USB_READ_SIZE) {
+        p->stats.rx_pauses++;
+        __atomic_store_n(&p->rx_paused, true, __ATOMIC_RELEASE);
+        // 消费者可能在置位之前就已经取走了数据，再检查一次
+        cdc_acm_port_rx_resume(p);
+        return;
+    }
+
     // 继续启动下一次USB接收
-    usbd_ep_start_read(busid, CDC_OUT_EP, usb_read_buffer, CDC_USB_READ_SIZE);
+    usbd_ep_start_read(busid, p->out_ep, p->usb_read_buffer, CDC_USB_READ_SIZE);
 }
 
 /* ========== USB批量输入回调 (设备->主机) ========== */
 void usbd_cdc_acm_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes)
 {
+    struct cdc_acm_port *p = cdc_acm_port_by_ep(busid, ep);
+
     USB_LOG_DBG("Sent %d bytes\r\n", nbytes);
 
+    if (p == NULL) {
+        return;
+    }
+
+    p->stats.tx_packets += CDC_PACKETS(nbytes);
+    p->stats.tx_bytes += nbytes;
+
     // 处理ZLP (Zero Length Packet)
     if ((nbytes % usbd_get_ep_mps(busid, ep)) == 0 && nbytes) {
-        usbd_ep_start_write(busid, CDC_IN_EP, NULL, 0);
+        p->stats.tx_zlps++;
+        usbd_ep_start_write(busid, p->in_ep, NULL, 0);
     } else {
-        ep_tx_busy_flag = false;
-        
+        p->stats.tx_busy_cycles += DWT->CYCCNT - p->tx_start_cyc;
+        cdc_acm_port_forward_done(p);
+        __atomic_store_n(&p->ep_tx_busy_flag, false, __ATOMIC_RELEASE);
+
         // 发送完成后，检查是否还有待发送数据
-        cdc_acm_try_send(busid);
+        cdc_acm_port_try_send((uint8_t)(p - g_cdc_ports));
+        cdc_acm_port_notify(p, CDC_ACM_EVENT_TX_DONE);
     }
 }
 
-/* ========== 端点定义 ========== */
-struct usbd_endpoint cdc_out_ep = {
-    .ep_addr = CDC_OUT_EP,
-    .ep_cb = usbd_cdc_acm_bulk_out
-};
+/* ========== 厂商控制请求：读取统计 ========== */
+static int cdc_acm_vendor_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len)
+{
+    struct cdc_acm_port *p;
+    cdc_acm_stats_t st;
+    uint8_t port;
 
-struct usbd_endpoint cdc_in_ep = {
-    .ep_addr = CDC_IN_EP,
-    .ep_cb = usbd_cdc_acm_bulk_in
-};
+    // 所有接口的厂商处理函数都会被依次调用，只认发给本端口通信接口的请求
+    if ((setup->bmRequestType & USB_REQUEST_RECIPIENT_MASK) != USB_REQUEST_RECIPIENT_INTERFACE ||
+        setup->bRequest != CDC_ACM_REQ_GET_STATS) {
+        return -1;
+    }
+    p = cdc_acm_port_by_intf(busid, setup->wIndex & 0xFF);
+    if (p == NULL) {
+        return -1;
+    }
+
+    port = (uint8_t)(p - g_cdc_ports);
+    cdc_acm_port_get_stats(port, &st);
+    if (setup->wValue & CDC_ACM_STATS_RESET) {
+        cdc_acm_port_reset_stats(port);
+    }
 
-static struct usbd_interface intf0;
-static struct usbd_interface intf1;
+    memcpy(*data, &st, sizeof(st));
+    *len = sizeof(st);
+    return 0;
+}
 
 /* ========== DTR控制 ========== */
 void usbd_cdc_acm_set_dtr(uint8_t busid, uint8_t intf, bool dtr)
 {
+    struct cdc_acm_port *p = cdc_acm_port_by_intf(busid, intf);
+
+    if (p == NULL) {
+        return;
+    }
+
     if (dtr) {
-        dtr_enable = 1;
+        if (!p->dtr_enable) {
+            p->tx_lz_restart = true; // 新打开端口的解码端没有之前的压缩历史
+        }
+        p->dtr_enable = 1;
         // DTR使能时尝试发送缓冲区中的数据
-        cdc_acm_try_send(busid);
+        cdc_acm_port_try_send((uint8_t)(p - g_cdc_ports));
     } else {
-        dtr_enable = 0;
+        p->dtr_enable = 0;
     }
+    cdc_acm_port_notify(p, CDC_ACM_EVENT_STATE);
 }
 
-/* ========== 初始化函数 ========== */
-void cdc_acm_init(uint8_t busid, uintptr_t reg_base)
+/* ========== 串口参数 (Line Coding) ========== */
+void usbd_cdc_acm_set_line_coding(uint8_t busid, uint8_t intf, struct cdc_line_coding *line_coding)
 {
-    // 初始化环形缓冲区
-    if (cdc_ringbuffer_init() != 0) {
-        USB_LOG_ERR("CDC RingBuffer init failed!\r\n");
+    struct cdc_acm_port *p = cdc_acm_port_by_intf(busid, intf);
+
+    if (p == NULL) {
         return;
     }
-    
-#ifdef CONFIG_USBDEV_ADVANCE_DESC
-    usbd_desc_register(busid, &cdc_descriptor);
-#else
-    usbd_desc_register(busid, cdc_descriptor);
-#endif
 
-    usbd_add_interface(busid, usbd_cdc_acm_init_intf(busid, &intf0));
-    usbd_add_interface(busid, usbd_cdc_acm_init_intf(busid, &intf1));
-    usbd_add_endpoint(busid, &cdc_out_ep);
-    usbd_add_endpoint(busid, &cdc_in_ep);
-    usbd_initialize(busid, reg_base, usbd_event_handler);
+    p->line_coding.baudrate = line_coding->dwDTERate;
+    p->line_coding.stopbits = line_coding->bCharFormat;
+    p->line_coding.parity = line_coding->bParityType;
+    p->line_coding.databits = line_coding->bDataBits;
+
+    if (p->line_coding_cb) {
+        p->line_coding_cb((uint8_t)(p - g_cdc_ports), &p->line_coding);
+    }
 }
 
-/* ========== 应用层API：尝试发送数据 ========== */
-void cdc_acm_try_send(uint8_t busid)
+void usbd_cdc_acm_get_line_coding(uint8_t busid, uint8_t intf, struct cdc_line_coding *line_coding)
 {
-    // 检查是否可以发送
-    if (!dtr_enable || ep_tx_busy_flag) {
+    struct cdc_acm_port *p = cdc_acm_port_by_intf(busid, intf);
+
+    if (p == NULL) {
         return;
     }
-    
-    // 从发送环形缓冲区读取数据
-    uint32_t available = chry_ringbuffer_get_used(&tx_ringbuf);
-    if (available == 0) {
-        return;  // 没有待发送数据
-    }
-    
-    // 限制单次发送大小
-    uint32_t send_size = (available > CDC_USB_READ_SIZE) ? CDC_USB_READ_SIZE : available;
-    
-    // 从环形缓冲区读取数据到USB发送缓冲区
-    uint32_t read_size = chry_ringbuffer_read(&tx_ringbuf, usb_write_buffer, send_size);
-    
-    if (read_size > 0) {
-        ep_tx_busy_flag = true;
-        usbd_ep_start_write(busid, CDC_IN_EP, usb_write_buffer, read_size);
-    }
+
+    line_coding->dwDTERate = p->line_coding.baudrate;
+    line_coding->bCharFormat = p->line_coding.stopbits;
+    line_coding->bParityType = p->line_coding.parity;
+    line_coding->bDataBits = p->line_coding.databits;
 }
 
-/* ========== 应用层API：写入数据到发送缓冲区 ========== */
-int cdc_acm_send_data(uint8_t busid, const uint8_t *data, uint32_t len)
+/* ========== 初始化函数 ========== */
+void cdc_acm_init(uint8_t busid, uintptr_t reg_base)
 {
-    if (data == NULL || len == 0) {
+    static uint8_t next_port = 0; // 下一个未分配到内核的端口
+    uint8_t first = next_port;
+
+    if (first + CDC_ACM_BUS_PORTS > CDC_ACM_PORT_NUM) {
+        USB_LOG_ERR("All %d CDC ports are already assigned\r\n", CDC_ACM_PORT_NUM);
+        return;
+    }
+
+#if CDC_ACM_BUS_PORTS > 1
+    // OTG_FS 内核只有 EP1~EP3 三个 IN 端点，只够一个完整的 CDC ACM 端口
+    if (reg_base != 0x40040000UL) { // USB_OTG_HS_PERIPH_BASE
+        USB_LOG_ERR("%d CDC ports need the OTG_HS core (PB14/PB15)\r\n", CDC_ACM_BUS_PORTS);
+        return;
+    }
+#endif
+
+    // 接收时间戳使用 DWT 周期计数器
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    // 只初始化本内核的环形缓冲区，另一个内核可能已经在收发
+    if (cdc_ringbuffer_init(first, CDC_ACM_BUS_PORTS) != 0) {
+        USB_LOG_ERR("CDC RingBuffer init failed!\r\n");
+        return;
+    }
+    next_port += CDC_ACM_BUS_PORTS;
+
+#ifdef CONFIG_USBDEV_ADVANCE_DESC
+#if CDC_ACM_BUS_NUM > 1
+    usbd_desc_register(busid, (first == 0) ? &cdc_descriptor : &cdc_descriptor_bus1);
+#else
+    usbd_desc_register(busid, &cdc_descriptor);
+#endif
+#else
+    usbd_desc_register(busid, cdc_descriptor);
+#if VENDOR_BULK_ENABLE
+    usbd_msosv2_desc_register(busid, &vendor_bulk_msosv2_desc);
+    usbd_bos_desc_register(busid, &vendor_bulk_bos_desc);
+#endif
+#endif
+
+    for (uint8_t i = first; i < first + CDC_ACM_BUS_PORTS; i++) {
+        struct cdc_acm_port *p = &g_cdc_ports[i];
+
+        p->busid = busid;
+        __atomic_store_n(&p->ep_tx_busy_flag, false, __ATOMIC_RELEASE);
+        p->dtr_enable = 0;
+        usbd_add_interface(busid, usbd_cdc_acm_init_intf(busid, &p->intf0));
+        p->intf0.vendor_handler = cdc_acm_vendor_request; // 统计读取，init_intf 会清掉它
+        usbd_add_interface(busid, usbd_cdc_acm_init_intf(busid, &p->intf1));
+        usbd_add_endpoint(busid, &p->out_ep_cfg);
+        usbd_add_endpoint(busid, &p->in_ep_cfg);
+    }
+    // 厂商接口和 U 盘接口只在第一个内核上，接口号紧跟 CDC 接口，必须在其后添加
+    if (first == 0) {
+#if VENDOR_BULK_ENABLE
+        vendor_bulk_add_interface(busid);
+#endif
+#if MSC_DISK_ENABLE
+        msc_disk_add_interface(busid);
+#endif
+    }
+    usbd_initialize(busid, reg_base, usbd_event_handler);
+}
+
+#if CDC_TX_COMPRESS_ENABLE
+/* ========== 发送压缩 (在发送消费者中执行) ========== */
+
+/* 应用压缩开关。关闭时把流结束标记放在 usb_write_buffer 开头，返回其长度 */
+static uint32_t cdc_acm_port_lz_update(struct cdc_acm_port *p)
+{
+    bool req = p->tx_lz_req;
+    uint32_t len = 0;
+
+    if (__atomic_exchange_n(&p->tx_lz_restart, false, __ATOMIC_ACQUIRE) && p->tx_lz_on) {
+        lz_stream_reset(&g_tx_lz);
+    }
+
+    if (req == p->tx_lz_on) {
+        return 0;
+    }
+
+    if (req) {
+        lz_stream_reset(&g_tx_lz);
+        p->tx_lz_on = true;
+    } else {
+        // 主机没打开端口时不用通知，重新打开后解码端本来就从普通数据开始
+        if (p->dtr_enable) {
+            len = lz_stream_finish(&g_tx_lz, p->usb_write_buffer);
+        }
+        p->tx_lz_on = false;
+        __atomic_store_n(&g_tx_lz_owner, NULL, __ATOMIC_RELEASE);
+    }
+    return len;
+}
+
+/* 原始数据直接读进压缩器的历史缓冲区，压缩结果写入 usb_write_buffer */
+static uint32_t cdc_acm_port_lz_fill(struct cdc_acm_port *p, lf_mpsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t n = (size > LZ_STREAM_BLOCK_MAX) ? LZ_STREAM_BLOCK_MAX : size;
+
+    n = lf_mpsc_ringbuffer_read(rb, lz_stream_input(&g_tx_lz), n);
+    return n ? lz_stream_compress(&g_tx_lz, n, p->usb_write_buffer) : 0;
+}
+#endif
+
+/* ========== 多端口API ========== */
+void cdc_acm_port_try_send(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL) {
+        return;
+    }
+
+    // 主循环、SOF中断和发送完成中断都会进入这里，先原子地占有IN端点
+    if (__atomic_exchange_n(&p->ep_tx_busy_flag, true, __ATOMIC_ACQUIRE)) {
+        return;
+    }
+
+    if (p->tx_flush_req) {
+        p->tx_flush_req = false;
+        lf_mpsc_ringbuffer_drop(&p->tx_ringbuf, lf_mpsc_ringbuffer_get_used(&p->tx_ringbuf));
+        lf_mpsc_ringbuffer_drop(&p->tx_prio_ringbuf, lf_mpsc_ringbuffer_get_used(&p->tx_prio_ringbuf));
+    }
+
+    // 断开连接时进行中的转发传输不会有完成回调，在这里释放
+    cdc_acm_port_forward_done(p);
+
+    // 从发送环形缓冲区读取数据
+    uint32_t available = lf_mpsc_ringbuffer_get_used(&p->tx_ringbuf);
+    uint32_t prio = lf_mpsc_ringbuffer_get_used(&p->tx_prio_ringbuf);
+    uint32_t read_size = 0;
+    uint32_t prefix = 0;
+
+#if CDC_TX_COMPRESS_ENABLE
+    prefix = cdc_acm_port_lz_update(p);
+#endif
+
+    // 高优先级通道先发；两个通道都有数据时批量数据 (含转发) 积累到份额才发一次，
+    // 所以高优先级数据最多等一次批量传输 (CDC_USB_READ_SIZE 字节)
+    struct cdc_acm_port *src = p->fwd_src;
+
+    // 合并模式：不足一个包且未到截止时间时，等待更多数据 (高优先级数据不等)
+    bool bulk_wait = p->tx_coalesce_frames && available < CDC_MAX_MPS &&
+                     p->tx_wait_frames < p->tx_coalesce_frames;
+    bool bulk_pending = (available != 0 && !bulk_wait) ||
+                        (src != NULL && lf_spsc_ringbuffer_get_used(&src->rx_ringbuf) != 0);
+    if (prio == 0 || !bulk_pending) {
+        p->tx_bulk_credit = 0; // 没有竞争时不积累份额
+    }
+    bool use_prio = prio != 0 && !(bulk_pending && p->tx_bulk_credit > 0);
+
+    // 转发的数据先于发送缓冲区中的数据，接收缓冲区空了才发送发送缓冲区
+    if (!use_prio && src != NULL && prefix == 0 && p->dtr_enable && cdc_acm_port_forward(p, src)) {
+        return;
+    }
+
+    // 占用只在这里减少，每次取数据前的值就是高水位的候选
+    if (available > p->stats.tx_high_water) {
+        p->stats.tx_high_water = available;
+    }
+
+    lf_mpsc_ringbuffer_t *rb = use_prio ? &p->tx_prio_ringbuf : &p->tx_ringbuf;
+    uint32_t pending = use_prio ? prio : available;
+    bool wait_more = !use_prio && bulk_wait;
+
+    if (p->dtr_enable && pending && !wait_more) {
+        // 限制单次发送大小
+        uint32_t send_size = (pending > CDC_USB_READ_SIZE - prefix) ? CDC_USB_READ_SIZE - prefix : pending;
+
+#if CDC_TX_COMPRESS_ENABLE
+        if (p->tx_lz_on) {
+            // 两个通道的数据进入同一个压缩流，解码端按传输顺序还原
+            read_size = cdc_acm_port_lz_fill(p, rb, send_size);
+        } else
+#endif
+        {
+            // 从环形缓冲区读取数据到USB发送缓冲区 (流结束标记之后)
+            read_size = lf_mpsc_ringbuffer_read(rb, p->usb_write_buffer + prefix, send_size);
+        }
+
+        if (read_size) {
+            cdc_acm_port_tx_charge(p, use_prio, read_size);
+        }
+        if (read_size && use_prio) {
+            uint32_t now = DWT->CYCCNT;
+            uint32_t wait = now - p->tx_prio_enq_cyc;
+
+            p->stats.tx_prio_bytes += read_size;
+            if (wait > p->stats.tx_prio_wait_max_cycles) {
+                p->stats.tx_prio_wait_max_cycles = wait;
+            }
+            // 剩下的数据从现在开始等下一次传输
+            p->tx_prio_enq_cyc = now;
+        }
+    }
+    read_size += prefix;
+
+    if (read_size == 0) {
+        // 没有可发送的数据，释放端点
+        __atomic_store_n(&p->ep_tx_busy_flag, false, __ATOMIC_RELEASE);
+        return;
+    }
+
+    p->tx_wait_frames = 0;
+    p->tx_start_cyc = DWT->CYCCNT;
+    usbd_ep_start_write(p->busid, p->in_ep, p->usb_write_buffer, read_size);
+}
+
+int cdc_acm_port_send_data(uint8_t port, const uint8_t *data, uint32_t len)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL || data == NULL || len == 0) {
         return -1;
     }
-    
-    // 写入发送环形缓冲区
-    uint32_t written = chry_ringbuffer_write(&tx_ringbuf, (void *)data, len);
-    
+
+    // 写入发送环形缓冲区 (空间不足时整段放弃，不会截断)
+    uint32_t written = lf_mpsc_ringbuffer_write(&p->tx_ringbuf, data, len);
+    if (written == 0) {
+        __atomic_fetch_add(&p->stats.tx_full_events, 1, __ATOMIC_RELAXED);
+    }
+
     // 立即尝试发送
-    cdc_acm_try_send(busid);
-    
+    cdc_acm_port_try_send(port);
+
     USB_LOG_INFO("Written %ld bytes\r\n", written);
     return (int)written;
 }
 
-/* ========== 应用层API：从接收缓冲区读取数据 ========== */
-int cdc_acm_read_data(uint8_t *buffer, uint32_t max_len)
+int cdc_acm_port_send_prio(uint8_t port, const uint8_t *data, uint32_t len)
 {
-    if (buffer == NULL || max_len == 0) {
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL || data == NULL || len == 0) {
+        return -1;
+    }
+
+    // 通道从空变为非空时记下时间，发出时得到等待时间
+    if (lf_mpsc_ringbuffer_check_empty(&p->tx_prio_ringbuf)) {
+        p->tx_prio_enq_cyc = DWT->CYCCNT;
+    }
+
+    uint32_t written = lf_mpsc_ringbuffer_write(&p->tx_prio_ringbuf, data, len);
+    if (written == 0) {
+        __atomic_fetch_add(&p->stats.tx_full_events, 1, __ATOMIC_RELAXED);
+    }
+
+    cdc_acm_port_try_send(port);
+    return (int)written;
+}
+
+int cdc_acm_port_printf_prio(uint8_t port, const char *fmt, ...)
+{
+    char buf[CDC_PRINTF_BUF_SIZE];
+    va_list ap;
+    int len;
+
+    if (fmt == NULL) {
+        return -1;
+    }
+
+    // 交互回复都很短，经栈缓冲区整段写入
+    va_start(ap, fmt);
+    len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (len < 0 || len >= CDC_PRINTF_BUF_SIZE) {
+        return (len < 0) ? -1 : 0;
+    }
+    return (len > 0) ? cdc_acm_port_send_prio(port, (const uint8_t *)buf, (uint32_t)len) : 0;
+}
+
+int cdc_acm_port_sendv(uint8_t port, const cdc_acm_iovec_t *iov, uint32_t iovcnt)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    uint32_t total = 0;
+    int32_t pos;
+
+    if (p == NULL || iov == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        total += iov[i].len;
+    }
+
+    // 一次预留全部空间，逐段填充后统一提交
+    pos = lf_mpsc_ringbuffer_reserve(&p->tx_ringbuf, total);
+    if (pos < 0) {
+        __atomic_fetch_add(&p->stats.tx_full_events, 1, __ATOMIC_RELAXED);
         return 0;
     }
 
-    uint32_t used = chry_ringbuffer_get_used(&rx_ringbuf);
+    for (uint32_t i = 0, off = 0; i < iovcnt; off += iov[i].len, i++) {
+        lf_mpsc_ringbuffer_fill(&p->tx_ringbuf, (uint32_t)pos + off, iov[i].base, iov[i].len);
+    }
+    lf_mpsc_ringbuffer_commit(&p->tx_ringbuf);
+
+    cdc_acm_port_try_send(port);
+    return (int)total;
+}
+
+int cdc_acm_port_vprintf(uint8_t port, const char *fmt, va_list ap)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    char buf[CDC_PRINTF_BUF_SIZE];
+    va_list ap2;
+    int32_t pos;
+    int len;
+
+    if (p == NULL || fmt == NULL) {
+        return -1;
+    }
+
+    // 先量出长度，超长或空间不足时不做格式化，也不占用发送缓冲区
+    va_copy(ap2, ap);
+    len = vsnprintf(NULL, 0, fmt, ap2);
+    va_end(ap2);
+
+    if (len <= 0 || len >= CDC_PRINTF_BUF_SIZE) {
+        return (len < 0) ? -1 : 0;
+    }
+
+    // 按实际长度预留，与其他生产者 (含中断里的日志) 并发写入互不阻塞
+    pos = lf_mpsc_ringbuffer_reserve(&p->tx_ringbuf, (uint32_t)len);
+    if (pos < 0) {
+        __atomic_fetch_add(&p->stats.tx_full_events, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+
+    // vsnprintf 结尾的'\0'会超出预留区，先格式化到栈上再填入
+    vsnprintf(buf, sizeof(buf), fmt, ap);
+    lf_mpsc_ringbuffer_fill(&p->tx_ringbuf, (uint32_t)pos, buf, (uint32_t)len);
+    lf_mpsc_ringbuffer_commit(&p->tx_ringbuf);
+
+    cdc_acm_port_try_send(port);
+    return len;
+}
+
+int cdc_acm_port_printf(uint8_t port, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+
+    va_start(ap, fmt);
+    ret = cdc_acm_port_vprintf(port, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int cdc_acm_port_read_data(uint8_t port, uint8_t *buffer, uint32_t max_len)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL || buffer == NULL || max_len == 0) {
+        return 0;
+    }
+
+    uint32_t used = lf_spsc_ringbuffer_get_used(cdc_acm_port_rx(p));
     USB_LOG_INFO("Read %ld bytes\r\n", used);
 
-    return (int)chry_ringbuffer_read(&rx_ringbuf, buffer, max_len);
+    uint32_t read = lf_spsc_ringbuffer_read(&p->rx_ringbuf, buffer, max_len);
+    cdc_acm_port_rx_resume(p);
+    return (int)read;
 }
 
-/* ========== 应用层API：查看接收数据但不移除 ========== */
-int cdc_acm_peek_data(uint8_t *buffer, uint32_t max_len)
+int cdc_acm_port_peek_data(uint8_t port, uint8_t *buffer, uint32_t max_len)
 {
-    if (buffer == NULL || max_len == 0) {
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL || buffer == NULL || max_len == 0) {
         return 0;
     }
-    
-    return (int)chry_ringbuffer_peek(&rx_ringbuf, buffer, max_len);
+
+    return (int)lf_spsc_ringbuffer_peek(cdc_acm_port_rx(p), buffer, max_len);
+}
+
+uint32_t cdc_acm_port_get_rx_available(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    return p ? lf_spsc_ringbuffer_get_used(cdc_acm_port_rx(p)) : 0;
+}
+
+void cdc_acm_port_flush_rx(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL) {
+        return;
+    }
+    p->rx_flush_req = true;
+    cdc_acm_port_rx(p);
+    cdc_acm_port_rx_resume(p);
+}
+
+uint32_t cdc_acm_port_get_tx_free(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    return p ? lf_mpsc_ringbuffer_get_free(&p->tx_ringbuf) : 0;
+}
+
+int cdc_acm_port_set_tx_coalesce(uint8_t port, uint8_t frames)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL) {
+        return -1;
+    }
+#ifndef CONFIG_USBDEV_SOF_ENABLE
+    // 没有SOF中断就无法保证截止时间
+    if (frames) {
+        return -1;
+    }
+#endif
+
+    p->tx_wait_frames = 0;
+    p->tx_coalesce_frames = frames;
+    cdc_acm_sof_update(p->busid);
+    if (frames == 0) {
+        cdc_acm_port_try_send(port);
+    }
+    return 0;
+}
+
+int cdc_acm_port_set_tx_bulk_share(uint8_t port, uint8_t percent)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p == NULL || percent > 100) {
+        return -1;
+    }
+
+    // 份额只在发送消费者中读取，下一次传输边界生效
+    p->tx_bulk_share = percent;
+    return 0;
+}
+
+int cdc_acm_port_set_buffers(uint8_t port, void *rx_pool, uint32_t rx_size,
+                             void *tx_pool, uint32_t tx_size)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    uint32_t primask;
+
+    if (p == NULL || rx_pool == NULL || tx_pool == NULL ||
+        rx_size < CDC_RINGBUF_MIN_RX || rx_size > CDC_RINGBUF_MAX || (rx_size & (rx_size - 1)) ||
+        tx_size < CDC_RINGBUF_MIN_TX || tx_size > CDC_RINGBUF_MAX || (tx_size & (tx_size - 1))) {
+        return -1;
+    }
+
+    // 生产者和消费者都可能在中断里，关中断后两边都不会访问到一半的缓冲区
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    // 正在转发的区域还被IN端点引用
+    if (p->fwd_len != 0) {
+        __set_PRIMASK(primask);
+        return -2;
+    }
+
+    lf_spsc_ringbuffer_init(&p->rx_ringbuf, rx_pool, rx_size);
+    lf_mpsc_ringbuffer_init(&p->tx_ringbuf, tx_pool, tx_size);
+    p->rx_flush_req = false;
+    p->tx_flush_req = false;
+    p->rx_ts_tail = p->rx_ts_head; // 时间戳记录的是旧缓冲区中的位置
+    p->tx_wait_frames = 0;
+    p->stats.rx_high_water = 0;
+    p->stats.tx_high_water = 0;
+
+    __set_PRIMASK(primask);
+
+    // 新缓冲区是空的，暂停的OUT端点可以继续接收
+    cdc_acm_port_rx_resume(p);
+    return 0;
+}
+
+int cdc_acm_port_set_tx_compress(uint8_t port, bool enable)
+{
+#if CDC_TX_COMPRESS_ENABLE
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    struct cdc_acm_port *owner = NULL;
+
+    if (p == NULL) {
+        return -1;
+    }
+
+    if (enable && p->fwd_src != NULL) {
+        return -1; // 转发的原样数据会插进压缩流
+    }
+
+    // 压缩器空闲或已经属于本端口 (关闭请求还没被消费者应用) 时才能打开
+    if (enable && !__atomic_compare_exchange_n(&g_tx_lz_owner, &owner, p, false,
+                                               __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) && owner != p) {
+        return -1;
+    }
+
+    p->tx_lz_req = enable;
+    cdc_acm_port_try_send(port);
+    return 0;
+#else
+    (void)port;
+    return enable ? -1 : 0;
+#endif
+}
+
+int cdc_acm_port_set_forward(uint8_t src, uint8_t dst, cdc_acm_forward_hook_t hook, void *ctx)
+{
+    struct cdc_acm_port *s = cdc_acm_get_port(src);
+    struct cdc_acm_port *d = (dst == CDC_ACM_FORWARD_OFF) ? NULL : cdc_acm_get_port(dst);
+    struct cdc_acm_port *old;
+
+    if (s == NULL || (d == NULL && dst != CDC_ACM_FORWARD_OFF)) {
+        return -1;
+    }
+    if (d != NULL && ((d->fwd_src != NULL && d->fwd_src != s) || d->tx_lz_req)) {
+        return -1; // 压缩流中不能插入原样数据
+    }
+
+    // 先停掉原来的转发，已在发送的区域由发送完成回调释放
+    old = s->fwd_dst;
+    if (old != NULL) {
+        s->fwd_dst = NULL;
+        old->fwd_src = NULL;
+    }
+    if (d == NULL) {
+        return 0;
+    }
+
+    d->fwd_hook = hook;
+    d->fwd_ctx = ctx;
+    __atomic_store_n(&d->fwd_src, s, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->fwd_dst, d, __ATOMIC_RELEASE);
+    cdc_acm_port_try_send(dst);
+    return 0;
+}
+
+bool cdc_acm_port_is_forwarding(uint8_t src)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(src);
+
+    return p ? (p->fwd_dst != NULL || p->fwd_len != 0) : false;
+}
+
+bool cdc_acm_port_get_tx_compress(uint8_t port, lz_stream_stats_t *stats)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (stats != NULL) {
+#if CDC_TX_COMPRESS_ENABLE
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        *stats = g_tx_lz.stats;
+        __set_PRIMASK(primask);
+#else
+        *stats = (lz_stream_stats_t){ 0 };
+#endif
+    }
+    return p ? p->tx_lz_req : false;
+}
+
+void cdc_acm_port_get_line_coding(uint8_t port, cdc_acm_line_coding_t *line_coding)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p != NULL && line_coding != NULL) {
+        *line_coding = p->line_coding;
+    }
+}
+
+void cdc_acm_port_set_line_coding_callback(uint8_t port, cdc_acm_line_coding_cb_t cb)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    if (p != NULL) {
+        p->line_coding_cb = cb;
+    }
+}
+
+void cdc_acm_set_event_callback(cdc_acm_event_cb_t cb)
+{
+    g_event_cb = cb;
+}
+
+bool cdc_acm_port_is_open(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+
+    return p ? (p->dtr_enable != 0) : false;
+}
+
+bool cdc_acm_port_get_rx_timestamp(uint8_t port, uint32_t offset, cdc_acm_rx_ts_t *ts)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    lf_spsc_ringbuffer_t *rb;
+    uint32_t head, pos;
+
+    if (p == NULL) {
+        return false;
+    }
+
+    rb = cdc_acm_port_rx(p);
+    if (offset >= lf_spsc_ringbuffer_get_used(rb)) {
+        return false;
+    }
+    pos = rb->out + offset; // 消费者自己的读指针
+
+    // 被覆盖的时间戳直接跳过 (留一个位置给中断正在写入的那个)
+    head = __atomic_load_n(&p->rx_ts_head, __ATOMIC_ACQUIRE);
+    if (head - p->rx_ts_tail >= CDC_RX_TS_NUM) {
+        p->rx_ts_tail = head - (CDC_RX_TS_NUM - 1);
+    }
+
+    for (uint32_t i = p->rx_ts_tail; i != head; i++) {
+        cdc_acm_rx_chunk_t c = p->rx_ts[i & (CDC_RX_TS_NUM - 1)];
+
+        if ((int32_t)(c.end - rb->out) <= 0) {
+            if (i == p->rx_ts_tail) {
+                p->rx_ts_tail++; // 已经读完的传输
+            }
+            continue;
+        }
+        if ((int32_t)(c.end - pos) <= 0) {
+            continue;
+        }
+
+        // 拷贝期间中断可能覆盖了这个位置
+        if (__atomic_load_n(&p->rx_ts_head, __ATOMIC_ACQUIRE) - i >= CDC_RX_TS_NUM) {
+            return false;
+        }
+        // pos 所在传输的时间戳已被覆盖，这里是它后面的一次
+        if ((int32_t)(pos - c.start) < 0) {
+            return false;
+        }
+        *ts = c.ts;
+        return true;
+    }
+    return false;
+}
+
+void cdc_acm_port_get_stats(uint8_t port, cdc_acm_stats_t *stats)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    uint32_t primask;
+
+    if (p == NULL || stats == NULL) {
+        return;
+    }
+
+    // 计数器在USB中断里更新，关中断拷贝得到同一时刻的值
+    primask = __get_PRIMASK();
+    __disable_irq();
+    *stats = p->stats;
+    __set_PRIMASK(primask);
+
+    stats->rx_used = lf_spsc_ringbuffer_get_used(&p->rx_ringbuf);
+    stats->tx_used = lf_mpsc_ringbuffer_get_used(&p->tx_ringbuf);
+    stats->rx_size = lf_spsc_ringbuffer_get_size(&p->rx_ringbuf);
+    stats->tx_size = lf_mpsc_ringbuffer_get_size(&p->tx_ringbuf);
+    stats->tx_prio_used = lf_mpsc_ringbuffer_get_used(&p->tx_prio_ringbuf);
+}
+
+void cdc_acm_port_reset_stats(uint8_t port)
+{
+    struct cdc_acm_port *p = cdc_acm_get_port(port);
+    uint32_t primask;
+
+    if (p == NULL) {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+    p->stats = (cdc_acm_stats_t){ 0 };
+    p->stats.rx_high_water = lf_spsc_ringbuffer_get_used(&p->rx_ringbuf);
+    p->stats.tx_high_water = lf_mpsc_ringbuffer_get_used(&p->tx_ringbuf);
+    __set_PRIMASK(primask);
+}
+
+void cdc_acm_rx_ts_now(cdc_acm_rx_ts_t *ts)
+{
+    ts->cyc = DWT->CYCCNT;
+    ts->ms = HAL_GetTick();
+}
+
+uint32_t cdc_acm_rx_ts_diff_us(const cdc_acm_rx_ts_t *later, const cdc_acm_rx_ts_t *earlier)
+{
+    int32_t ms = (int32_t)(later->ms - earlier->ms);
+    int32_t cyc;
+
+    if (ms < 0) {
+        return 0;
+    }
+    // 周期计数器的差值在 168MHz 下 12 秒后就超出 int32，较长的间隔按毫秒计算
+    if (ms >= 10000) {
+        return (ms >= (int32_t)(UINT32_MAX / 1000U)) ? UINT32_MAX : (uint32_t)ms * 1000U;
+    }
+
+    cyc = (int32_t)(later->cyc - earlier->cyc);
+    return (cyc > 0) ? (uint32_t)cyc / (SystemCoreClock / 1000000U) : 0;
+}
+
+/* ========== 应用层API：尝试发送数据 ========== */
+void cdc_acm_try_send(uint8_t busid)
+{
+    // 依次尝试该总线上的所有端口
+    for (uint8_t i = 0; i < CDC_ACM_PORT_NUM; i++) {
+        if (g_cdc_ports[i].busid == busid) {
+            cdc_acm_port_try_send(i);
+        }
+    }
+}
+
+/* ========== 应用层API：写入数据到发送缓冲区 ========== */
+int cdc_acm_send_data(uint8_t busid, const uint8_t *data, uint32_t len)
+{
+    return cdc_acm_port_send_data(cdc_acm_port_of_bus(busid), data, len);
+}
+
+int cdc_acm_send_prio(uint8_t busid, const uint8_t *data, uint32_t len)
+{
+    return cdc_acm_port_send_prio(cdc_acm_port_of_bus(busid), data, len);
+}
+
+int cdc_acm_sendv(uint8_t busid, const cdc_acm_iovec_t *iov, uint32_t iovcnt)
+{
+    return cdc_acm_port_sendv(cdc_acm_port_of_bus(busid), iov, iovcnt);
+}
+
+int cdc_acm_printf(uint8_t busid, const char *fmt, ...)
+{
+    va_list ap;
+    int ret;
+
+    va_start(ap, fmt);
+    ret = cdc_acm_port_vprintf(cdc_acm_port_of_bus(busid), fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+/* ========== 应用层API：从接收缓冲区读取数据 ========== */
+int cdc_acm_read_data(uint8_t *buffer, uint32_t max_len)
+{
+    return cdc_acm_port_read_data(CDC_ACM_PORT_DEFAULT, buffer, max_len);
+}
+
+/* ========== 应用层API：查看接收数据但不移除 ========== */
+int cdc_acm_peek_data(uint8_t *buffer, uint32_t max_len)
+{
+    return cdc_acm_port_peek_data(CDC_ACM_PORT_DEFAULT, buffer, max_len);
 }
 
 /* ========== 应用层API：获取接收缓冲区可用数据量 ========== */
 uint32_t cdc_acm_get_rx_available(void)
 {
-    return chry_ringbuffer_get_used(&rx_ringbuf);
+    return cdc_acm_port_get_rx_available(CDC_ACM_PORT_DEFAULT);
 }
 
 /* ========== 应用层API：获取发送缓冲区剩余空间 ========== */
 uint32_t cdc_acm_get_tx_free(void)
 {
-    return chry_ringbuffer_get_free(&tx_ringbuf);
+    return cdc_acm_port_get_tx_free(CDC_ACM_PORT_DEFAULT);
 }
 
 /* ========== 应用层API：检查接收缓冲区是否为空 ========== */
 bool cdc_acm_is_rx_empty(void)
 {
-    return chry_ringbuffer_check_empty(&rx_ringbuf);
+    return lf_spsc_ringbuffer_check_empty(cdc_acm_port_rx(&g_cdc_ports[CDC_ACM_PORT_DEFAULT]));
 }
 
 /* ========== 应用层API：检查发送缓冲区是否满 ========== */
 bool cdc_acm_is_tx_full(void)
 {
-    return chry_ringbuffer_check_full(&tx_ringbuf);
+    return lf_mpsc_ringbuffer_get_free(&g_cdc_ports[CDC_ACM_PORT_DEFAULT].tx_ringbuf) == 0;
 }
 
 /* ========== 应用层API：清空接收缓冲区 ========== */
 void cdc_acm_flush_rx(void)
 {
-    chry_ringbuffer_reset(&rx_ringbuf);
+    cdc_acm_port_flush_rx(CDC_ACM_PORT_DEFAULT);
 }
 
 /* ========== 应用层API：清空发送缓冲区 ========== */
 void cdc_acm_flush_tx(void)
 {
-    chry_ringbuffer_reset(&tx_ringbuf);
+    // 发送缓冲区的消费者是占有IN端点的一方，由它在下次发送时清空
+    g_cdc_ports[CDC_ACM_PORT_DEFAULT].tx_flush_req = true;
+    cdc_acm_port_try_send(CDC_ACM_PORT_DEFAULT);
 }
 
 /* ========== 应用层API：丢弃指定字节的接收数据 ========== */
 uint32_t cdc_acm_drop_rx(uint32_t size)
 {
-    return chry_ringbuffer_drop(&rx_ringbuf, size);
+    struct cdc_acm_port *p = &g_cdc_ports[CDC_ACM_PORT_DEFAULT];
+    uint32_t dropped = lf_spsc_ringbuffer_drop(cdc_acm_port_rx(p), size);
+
+    cdc_acm_port_rx_resume(p);
+    return dropped;
 }
 
 /* ========== 高级API：使用线性缓冲区进行零拷贝读取（适合DMA） ========== */
 void *cdc_acm_linear_read_setup(uint32_t *size)
 {
-    return chry_ringbuffer_linear_read_setup(&rx_ringbuf, size);
+    return lf_spsc_ringbuffer_linear_read_setup(cdc_acm_port_rx(&g_cdc_ports[CDC_ACM_PORT_DEFAULT]), size);
 }
 
 void cdc_acm_linear_read_done(uint32_t size)
 {
-    chry_ringbuffer_linear_read_done(&rx_ringbuf, size);
+    lf_spsc_ringbuffer_linear_read_done(&g_cdc_ports[CDC_ACM_PORT_DEFAULT].rx_ringbuf, size);
+    cdc_acm_port_rx_resume(&g_cdc_ports[CDC_ACM_PORT_DEFAULT]);
 }
 
 /* ========== 高级API：使用线性缓冲区进行零拷贝写入（适合DMA） ========== */
 void *cdc_acm_linear_write_setup(uint32_t *size)
 {
-    return chry_ringbuffer_linear_write_setup(&tx_ringbuf, size);
+    return lf_mpsc_ringbuffer_linear_write_setup(&g_cdc_ports[CDC_ACM_PORT_DEFAULT].tx_ringbuf, size);
 }
 
 void cdc_acm_linear_write_done(uint8_t busid, uint32_t size)
 {
-    chry_ringbuffer_linear_write_done(&tx_ringbuf, size);
+    lf_mpsc_ringbuffer_linear_write_done(&g_cdc_ports[CDC_ACM_PORT_DEFAULT].tx_ringbuf, size);
     cdc_acm_try_send(busid);
 }
 
@@ -441,7 +1681,7 @@ void example_line_processing(uint8_t busid)
     static uint32_t line_pos = 0;
     uint8_t byte;
     
-    while (chry_ringbuffer_read_byte(&rx_ringbuf, &byte)) {
+    while (cdc_acm_read_data(&byte, 1) == 1) {
         if (byte == '\n' || byte == '\r') {
             if (line_pos > 0) {
                 // 处理完整的一行
@@ -0,0 +1,245 @@
+/*
+ * USB CDC ACM Throughput Benchmark
+ */
+
+#include "cdc_bench.h"
+#include "cdc_acm_ringbuffer.h"
+#include "stm32f4xx_hal.h"
+#include <string.h>
+
+/* 间隔直方图: 桶 b 统计 [2^(b-1), 2^b) us，最后一个桶兼收更大的值 */
+#define BENCH_HIST_BUCKETS 16
+
+static struct {
+    cdc_bench_mode_t mode;
+    uint8_t busid;
+    uint8_t tx_seq;             // 下一个要发送的图案字节
+    uint8_t rx_seq;             // 期望收到的下一个图案字节
+    bool rx_synced;             // 是否已与对端图案同步
+    uint32_t window_tick;       // 本报告周期起始时间 (HAL tick)
+    uint32_t last_cyc;          // 上一次搬运数据时的 DWT 计数
+    bool last_valid;
+    uint32_t tx_bytes;
+    uint32_t rx_bytes;
+    uint32_t lost_bytes;
+    volatile uint32_t loop_bytes; // 回环: 转发钩子累计的字节数
+    uint32_t loop_seen;           // 回环: 主循环已统计到的位置
+    uint32_t hist[BENCH_HIST_BUCKETS];
+    uint32_t hist_count;
+    uint32_t interval_max_us;
+} g_bench;
+
+static const char *const bench_mode_names[CDC_BENCH_MODE_NUM] = {
+    "OFF", "SOURCE", "SINK", "LOOP"
+};
+
+/* ========== 计时 ========== */
+static void bench_timer_init(void)
+{
+    // 不清零 CYCCNT，接收时间戳也在使用它
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/* 记录一次数据搬运，统计与上一次的间隔 */
+static void bench_mark_chunk(void)
+{
+    uint32_t now = DWT->CYCCNT;
+
+    if (g_bench.last_valid) {
+        uint32_t us = (now - g_bench.last_cyc) / (SystemCoreClock / 1000000U);
+        uint32_t bucket = us ? 32U - (uint32_t)__CLZ(us) : 0;
+
+        if (bucket >= BENCH_HIST_BUCKETS) {
+            bucket = BENCH_HIST_BUCKETS - 1;
+        }
+        g_bench.hist[bucket]++;
+        g_bench.hist_count++;
+        if (us > g_bench.interval_max_us) {
+            g_bench.interval_max_us = us;
+        }
+    }
+    g_bench.last_cyc = now;
+    g_bench.last_valid = true;
+}
+
+static uint32_t bench_percentile_us(uint32_t percent)
+{
+    uint32_t target = (g_bench.hist_count * percent + 99U) / 100U;
+    uint32_t sum = 0;
+
+    if (g_bench.hist_count == 0) {
+        return 0;
+    }
+    for (uint32_t b = 0; b < BENCH_HIST_BUCKETS; b++) {
+        sum += g_bench.hist[b];
+        if (sum >= target) {
+            return 1U << b;
+        }
+    }
+    return 1U << (BENCH_HIST_BUCKETS - 1);
+}
+
+/* ========== 三种模式的数据搬运 ========== */
+static void bench_source(void)
+{
+    uint32_t size;
+    uint8_t *ptr;
+
+    if (!cdc_acm_port_is_open(CDC_ACM_PORT_DEFAULT)) {
+        return;
+    }
+
+    ptr = cdc_acm_linear_write_setup(&size);
+    if (size == 0) {
+        return;
+    }
+
+    uint8_t seq = g_bench.tx_seq;
+    for (uint32_t i = 0; i < size; i++) {
+        ptr[i] = seq;
+        if (++seq == CDC_BENCH_PATTERN_MOD) {
+            seq = 0;
+        }
+    }
+    g_bench.tx_seq = seq;
+
+    cdc_acm_linear_write_done(g_bench.busid, size);
+    g_bench.tx_bytes += size;
+    bench_mark_chunk();
+}
+
+static void bench_sink(void)
+{
+    uint32_t size;
+    uint8_t *ptr = cdc_acm_linear_read_setup(&size);
+
+    if (size == 0) {
+        return;
+    }
+
+    uint8_t seq = g_bench.rx_seq;
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t c = ptr[i];
+
+        if (c != seq && g_bench.rx_synced) {
+            // 图案跳变：按差值计入丢失字节并重新同步
+            g_bench.lost_bytes += (c < CDC_BENCH_PATTERN_MOD) ?
+                                  (uint32_t)(c + CDC_BENCH_PATTERN_MOD - seq) % CDC_BENCH_PATTERN_MOD : 1U;
+        }
+        g_bench.rx_synced = true;
+        seq = (c + 1U < CDC_BENCH_PATTERN_MOD) ? (uint8_t)(c + 1U) : 0;
+    }
+    g_bench.rx_seq = seq;
+
+    cdc_acm_linear_read_done(size);
+    g_bench.rx_bytes += size;
+    bench_mark_chunk();
+}
+
+/* 回环走驱动的转发模式 (接收缓冲区直接交给IN端点)，钩子只计数，在USB中断中调用 */
+static uint32_t bench_loop_hook(void *ctx, uint8_t *data, uint32_t len)
+{
+    (void)ctx;
+    (void)data;
+    g_bench.loop_bytes += len;
+    return len;
+}
+
+static void bench_loopback(void)
+{
+    uint32_t total = g_bench.loop_bytes;
+    uint32_t n = total - g_bench.loop_seen;
+
+    if (n == 0) {
+        return;
+    }
+    g_bench.loop_seen = total;
+
+    g_bench.rx_bytes += n;
+    g_bench.tx_bytes += n;
+    bench_mark_chunk();
+}
+
+/* ========== 公共API ========== */
+void cdc_bench_start(uint8_t busid, cdc_bench_mode_t mode)
+{
+    if (mode == CDC_BENCH_OFF || mode >= CDC_BENCH_MODE_NUM) {
+        cdc_bench_stop();
+        return;
+    }
+
+    cdc_acm_flush_rx();
+    cdc_acm_flush_tx();
+
+    memset(&g_bench, 0, sizeof(g_bench));
+    g_bench.mode = mode;
+    g_bench.busid = busid;
+    g_bench.window_tick = HAL_GetTick();
+
+    bench_timer_init();
+
+    if (mode == CDC_BENCH_LOOPBACK) {
+        cdc_acm_port_set_forward(CDC_ACM_PORT_DEFAULT, CDC_ACM_PORT_DEFAULT, bench_loop_hook, NULL);
+    } else {
+        cdc_acm_port_set_forward(CDC_ACM_PORT_DEFAULT, CDC_ACM_FORWARD_OFF, NULL, NULL);
+    }
+}
+
+void cdc_bench_stop(void)
+{
+    g_bench.mode = CDC_BENCH_OFF;
+    // 正在发送的那段转发数据由发送完成回调释放，清空会等到那之后
+    cdc_acm_port_set_forward(CDC_ACM_PORT_DEFAULT, CDC_ACM_FORWARD_OFF, NULL, NULL);
+    cdc_acm_flush_rx();
+}
+
+cdc_bench_mode_t cdc_bench_get_mode(void)
+{
+    return g_bench.mode;
+}
+
+const char *cdc_bench_mode_name(cdc_bench_mode_t mode)
+{
+    return (mode < CDC_BENCH_MODE_NUM) ? bench_mode_names[mode] : "?";
+}
+
+bool cdc_bench_task(cdc_bench_report_t *report)
+{
+    switch (g_bench.mode) {
+        case CDC_BENCH_SOURCE:
+            bench_source();
+            break;
+        case CDC_BENCH_SINK:
+            bench_sink();
+            break;
+        case CDC_BENCH_LOOPBACK:
+            bench_loopback();
+            break;
+        default:
+            return false;
+    }
+
+    uint32_t elapsed = HAL_GetTick() - g_bench.window_tick;
+    if (elapsed < CDC_BENCH_REPORT_MS || report == NULL) {
+        return false;
+    }
+
+    report->mode = g_bench.mode;
+    report->period_ms = elapsed;
+    report->tx_bytes = g_bench.tx_bytes;
+    report->rx_bytes = g_bench.rx_bytes;
+    report->lost_bytes = g_bench.lost_bytes;
+    report->interval_p50_us = bench_percentile_us(50);
+    report->interval_p99_us = bench_percentile_us(99);
+    report->interval_max_us = g_bench.interval_max_us;
+
+    // 开始新的报告周期 (丢失字节为累计值，不清零)
+    g_bench.window_tick += elapsed;
+    g_bench.tx_bytes = 0;
+    g_bench.rx_bytes = 0;
+    memset(g_bench.hist, 0, sizeof(g_bench.hist));
+    g_bench.hist_count = 0;
+    g_bench.interval_max_us = 0;
+    return true;
+}
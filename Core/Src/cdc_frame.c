@@ -0,0 +1,311 @@
+/*
+ * COBS Framed Packets over USB CDC ACM
+ */
+
+#include "cdc_frame.h"
+#include "cdc_acm_ringbuffer.h"
+#include "crc32.h"
+#include <stddef.h>
+
+typedef enum {
+    FRAME_SLOT_FREE = 0,
+    FRAME_SLOT_FILLING,     // 解码器正在写入
+    FRAME_SLOT_READY,       // 等待应用取走
+    FRAME_SLOT_IN_USE,      // 应用处理中
+} frame_slot_state_t;
+
+static struct {
+    uint8_t pool[CDC_FRAME_POOL_NUM][CDC_FRAME_RAW_MAX + 1];
+    cdc_frame_t frames[CDC_FRAME_POOL_NUM];
+    uint8_t state[CDC_FRAME_POOL_NUM];
+    uint8_t ready[CDC_FRAME_POOL_NUM];  // 按接收顺序排列的就绪帧
+    uint8_t ready_head;
+    uint8_t ready_count;
+
+    /* 解码器 */
+    bool synced;
+    bool discard;           // 出错后丢弃到下一个分隔符
+    int8_t cur;             // 正在写入的帧，-1 表示没有
+    uint16_t len;
+    uint8_t code;           // 当前 COBS 块的长度码
+    uint8_t remain;         // 当前块剩余的数据字节
+
+    cdc_frame_stats_t stats;
+} g_frame;
+
+/* COBS 编码器：dst[code_pos] 为当前块的长度码，块内满 254 字节或遇到 0 时结束 */
+typedef struct {
+    uint8_t *dst;
+    uint32_t out;
+    uint32_t code_pos;
+    uint8_t code;
+} cobs_encoder_t;
+
+/* ========== 编码 ========== */
+static void cobs_encode_begin(cobs_encoder_t *enc, uint8_t *dst)
+{
+    enc->dst = dst;
+    enc->dst[0] = 0x00;     // 前导分隔符，让对端丢弃之前的残留数据
+    enc->code_pos = 1;
+    enc->out = 2;
+    enc->code = 1;
+}
+
+static void cobs_encode_byte(cobs_encoder_t *enc, uint8_t b)
+{
+    if (b == 0) {
+        enc->dst[enc->code_pos] = enc->code;
+        enc->code_pos = enc->out++;
+        enc->code = 1;
+        return;
+    }
+
+    enc->dst[enc->out++] = b;
+    if (++enc->code == 0xFF) {
+        enc->dst[enc->code_pos] = enc->code;
+        enc->code_pos = enc->out++;
+        enc->code = 1;
+    }
+}
+
+static uint32_t cobs_encode_end(cobs_encoder_t *enc)
+{
+    enc->dst[enc->code_pos] = enc->code;
+    enc->dst[enc->out++] = 0x00;
+    return enc->out;
+}
+
+/* ========== 帧池 ========== */
+static bool frame_alloc(void)
+{
+    for (uint8_t i = 0; i < CDC_FRAME_POOL_NUM; i++) {
+        if (g_frame.state[i] == FRAME_SLOT_FREE) {
+            g_frame.state[i] = FRAME_SLOT_FILLING;
+            g_frame.cur = (int8_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* 当前帧结束 (遇到分隔符)：校验并放入就绪队列，失败则复用该帧 */
+static void frame_finish(void)
+{
+    uint8_t *buf;
+    uint32_t crc, rx_crc;
+
+    if (g_frame.cur < 0 || (g_frame.len == 0 && !g_frame.discard)) {
+        goto out; // 空帧
+    }
+
+    buf = g_frame.pool[g_frame.cur];
+    if (g_frame.discard || g_frame.remain != 0 || g_frame.len < 1 + CDC_FRAME_CRC_SIZE) {
+        g_frame.stats.format_errors++;
+        goto out;
+    }
+
+    crc = crc32_calc(buf, g_frame.len - CDC_FRAME_CRC_SIZE);
+    rx_crc = (uint32_t)buf[g_frame.len - 4] | ((uint32_t)buf[g_frame.len - 3] << 8) |
+             ((uint32_t)buf[g_frame.len - 2] << 16) | ((uint32_t)buf[g_frame.len - 1] << 24);
+    if (crc != rx_crc) {
+        g_frame.stats.crc_errors++;
+        goto out;
+    }
+
+    cdc_frame_t *f = &g_frame.frames[g_frame.cur];
+    f->type = buf[0];
+    f->len = g_frame.len - 1U - CDC_FRAME_CRC_SIZE;
+    f->data = &buf[1];
+    f->data[f->len] = '\0';
+
+    g_frame.state[g_frame.cur] = FRAME_SLOT_READY;
+    g_frame.ready[(g_frame.ready_head + g_frame.ready_count) % CDC_FRAME_POOL_NUM] = (uint8_t)g_frame.cur;
+    g_frame.ready_count++;
+    g_frame.stats.frames++;
+    g_frame.cur = -1;
+
+out:
+    g_frame.len = 0;
+    g_frame.code = 0;
+    g_frame.remain = 0;
+    g_frame.discard = false;
+}
+
+static void frame_put(uint8_t b)
+{
+    if (g_frame.len >= CDC_FRAME_RAW_MAX) {
+        g_frame.discard = true; // 超长，丢弃到下一个分隔符
+        return;
+    }
+    g_frame.pool[g_frame.cur][g_frame.len++] = b;
+}
+
+/* 记录当前帧第一个字节的接收时间，offset 为该字节相对接收缓冲区读指针的位置 */
+static void frame_stamp(uint32_t offset)
+{
+    cdc_acm_rx_ts_t *ts = &g_frame.frames[g_frame.cur].rx_ts;
+
+    if (!cdc_acm_port_get_rx_timestamp(CDC_ACM_PORT_DEFAULT, offset, ts)) {
+        cdc_acm_rx_ts_now(ts);
+    }
+}
+
+/* 解码一个非分隔符字节，调用者保证 g_frame.cur 有效 */
+static void frame_decode_byte(uint8_t b)
+{
+    if (g_frame.discard) {
+        return;
+    }
+
+    if (g_frame.remain == 0) {
+        // 新块开始：上一个块不满 254 字节说明它后面原本是 0
+        if (g_frame.code != 0 && g_frame.code != 0xFF) {
+            frame_put(0);
+        }
+        g_frame.code = b;
+        g_frame.remain = b - 1;
+    } else {
+        frame_put(b);
+        g_frame.remain--;
+    }
+}
+
+/* ========== 公共API ========== */
+void cdc_frame_init(void)
+{
+    for (uint8_t i = 0; i < CDC_FRAME_POOL_NUM; i++) {
+        g_frame.state[i] = FRAME_SLOT_FREE;
+    }
+    g_frame.ready_head = 0;
+    g_frame.ready_count = 0;
+    g_frame.stats = (cdc_frame_stats_t){ 0 };
+    g_frame.cur = -1;
+    cdc_frame_reset();
+}
+
+void cdc_frame_reset(void)
+{
+    if (g_frame.cur >= 0) {
+        g_frame.state[g_frame.cur] = FRAME_SLOT_FREE;
+        g_frame.cur = -1;
+    }
+    g_frame.synced = false;
+    g_frame.discard = false;
+    g_frame.len = 0;
+    g_frame.code = 0;
+    g_frame.remain = 0;
+}
+
+bool cdc_frame_is_synced(void)
+{
+    return g_frame.synced;
+}
+
+uint32_t cdc_frame_poll(uint8_t *raw, uint32_t raw_max)
+{
+    uint32_t raw_len = 0;
+    uint32_t size, i;
+    uint8_t *ptr;
+
+    // 主机关闭端口后回到文本模式
+    if (g_frame.synced && !cdc_acm_port_is_open(CDC_ACM_PORT_DEFAULT)) {
+        cdc_frame_reset();
+    }
+
+    for (;;) {
+        ptr = cdc_acm_linear_read_setup(&size);
+        if (size == 0) {
+            break;
+        }
+
+        for (i = 0; i < size; i++) {
+            uint8_t b = ptr[i];
+
+            if (!g_frame.synced) {
+                if (b == 0x00) {
+                    g_frame.synced = true;
+                    continue;
+                }
+                if (raw_len >= raw_max) {
+                    break;
+                }
+                raw[raw_len++] = b;
+            } else if (b == 0x00) {
+                frame_finish();
+            } else if (g_frame.cur >= 0 || frame_alloc()) {
+                if (g_frame.len == 0 && g_frame.code == 0) {
+                    frame_stamp(i);
+                }
+                frame_decode_byte(b);
+            } else {
+                break; // 帧池满，剩余数据留在接收缓冲区
+            }
+        }
+
+        cdc_acm_linear_read_done(i);
+        if (i < size) {
+            break;
+        }
+    }
+
+    return raw_len;
+}
+
+cdc_frame_t *cdc_frame_get(void)
+{
+    uint8_t idx;
+
+    if (g_frame.ready_count == 0) {
+        return NULL;
+    }
+
+    idx = g_frame.ready[g_frame.ready_head];
+    g_frame.ready_head = (g_frame.ready_head + 1) % CDC_FRAME_POOL_NUM;
+    g_frame.ready_count--;
+    g_frame.state[idx] = FRAME_SLOT_IN_USE;
+    return &g_frame.frames[idx];
+}
+
+void cdc_frame_release(cdc_frame_t *frame)
+{
+    uint32_t idx = (uint32_t)(frame - g_frame.frames);
+
+    if (idx < CDC_FRAME_POOL_NUM && g_frame.state[idx] == FRAME_SLOT_IN_USE) {
+        g_frame.state[idx] = FRAME_SLOT_FREE;
+    }
+}
+
+int cdc_frame_send(uint8_t busid, uint8_t type, const void *data, uint32_t len)
+{
+    uint8_t buf[CDC_FRAME_MAX_ENCODED];
+    const uint8_t *p = data;
+    cobs_encoder_t enc;
+    uint32_t crc;
+
+    if (len > CDC_FRAME_MAX_PAYLOAD || (len && data == NULL)) {
+        return -1;
+    }
+
+    crc = crc32_update(CRC32_INIT, &type, 1);
+    crc = crc32_update(crc, p, len);
+
+    cobs_encode_begin(&enc, buf);
+    cobs_encode_byte(&enc, type);
+    for (uint32_t i = 0; i < len; i++) {
+        cobs_encode_byte(&enc, p[i]);
+    }
+    for (uint8_t i = 0; i < CDC_FRAME_CRC_SIZE; i++) {
+        cobs_encode_byte(&enc, (uint8_t)(crc >> (i * 8)));
+    }
+
+    // 整帧一次写入发送缓冲区，不会和其他上下文的数据交错
+    if (cdc_acm_send_data(busid, buf, cobs_encode_end(&enc)) <= 0) {
+        return 0;
+    }
+    return (int)len;
+}
+
+void cdc_frame_get_stats(cdc_frame_stats_t *stats)
+{
+    *stats = g_frame.stats;
+}
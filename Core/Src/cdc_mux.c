@@ -0,0 +1,327 @@
+/*
+ * Virtual Channel Multiplexing over USB CDC ACM
+ */
+
+#include "cdc_mux.h"
+#include "cdc_acm_ringbuffer.h"
+#include "lf_ringbuffer.h"
+#include <stddef.h>
+
+typedef struct {
+    lf_spsc_ringbuffer_t rx;    // 主机 -> 应用 (cdc_mux_poll 写, 应用读)
+    lf_mpsc_ringbuffer_t tx;    // 应用 -> 主机 (任意上下文写, cdc_mux_poll 读)
+    uint32_t tx_credit;         // 主机还允许本通道发送的字节
+    uint32_t rx_unacked;        // 应用已读走、还没还给主机的额度
+} mux_channel_t;
+
+static struct {
+    bool active;
+    mux_channel_t ch[CDC_MUX_CH_NUM];
+    uint8_t rx_pool[CDC_MUX_CH_NUM][CDC_MUX_RING_SIZE];
+    uint8_t tx_pool[CDC_MUX_CH_NUM][CDC_MUX_RING_SIZE];
+
+    /* 解码器 */
+    uint8_t hdr[CDC_MUX_HDR_LEN];
+    uint8_t hdr_len;            // 已收到的帧头字节
+    uint8_t rx_ch;              // 当前 DATA 帧的通道
+    uint32_t rx_remain;         // 当前 DATA 帧剩余的数据
+
+    uint8_t tx_next;            // 下一轮第一个发送的通道
+    cdc_mux_stats_t stats;
+} g_mux;
+
+static inline mux_channel_t *mux_get_channel(uint8_t ch)
+{
+    return (g_mux.active && ch < CDC_MUX_CH_NUM) ? &g_mux.ch[ch] : NULL;
+}
+
+static inline void mux_fill_header(uint8_t *hdr, uint8_t type, uint8_t ch, uint16_t len)
+{
+    hdr[0] = (uint8_t)((type << 4) | ch);
+    hdr[1] = (uint8_t)len;
+    hdr[2] = (uint8_t)(len >> 8);
+}
+
+/* ========== 接收 ========== */
+
+/* 处理一个完整的帧头，返回 false 表示已退出复用模式 */
+static bool mux_rx_header(void)
+{
+    uint8_t type = g_mux.hdr[0] >> 4;
+    uint8_t ch = g_mux.hdr[0] & 0x0F;
+    uint16_t len = (uint16_t)(g_mux.hdr[1] | (g_mux.hdr[2] << 8));
+
+    g_mux.stats.rx_hdr_bytes += CDC_MUX_HDR_LEN;
+
+    switch (type) {
+        case CDC_MUX_TYPE_DATA:
+            if (ch >= CDC_MUX_CH_NUM) {
+                break;
+            }
+            g_mux.rx_ch = ch;
+            g_mux.rx_remain = len;
+            return true;
+
+        case CDC_MUX_TYPE_CREDIT:
+            if (ch >= CDC_MUX_CH_NUM) {
+                break;
+            }
+            g_mux.ch[ch].tx_credit += len;
+            return true;
+
+        case CDC_MUX_TYPE_CLOSE:
+            cdc_mux_stop();
+            return false;
+
+        default:
+            break;
+    }
+
+    // USB 批量传输本身不会出错，帧头无效说明主机没有在说复用协议
+    g_mux.stats.format_errors++;
+    cdc_mux_stop();
+    return false;
+}
+
+/* 端口接收缓冲区中的数据原地解析，DATA 直接拷进通道接收缓冲区 */
+static void mux_rx(void)
+{
+    uint32_t size, i;
+    uint8_t *ptr;
+
+    for (;;) {
+        ptr = cdc_acm_linear_read_setup(&size);
+        if (size == 0) {
+            return;
+        }
+
+        for (i = 0; i < size;) {
+            if (g_mux.rx_remain == 0) {
+                g_mux.hdr[g_mux.hdr_len++] = ptr[i++];
+                if (g_mux.hdr_len < CDC_MUX_HDR_LEN) {
+                    continue;
+                }
+                g_mux.hdr_len = 0;
+                if (!mux_rx_header()) {
+                    // 之后的数据留给文本模式
+                    cdc_acm_linear_read_done(i);
+                    return;
+                }
+                continue;
+            }
+
+            uint32_t n = size - i;
+            if (n > g_mux.rx_remain) {
+                n = g_mux.rx_remain;
+            }
+
+            // 额度保证放得下，主机超出额度时丢弃多余部分
+            uint32_t written = lf_spsc_ringbuffer_write(&g_mux.ch[g_mux.rx_ch].rx, &ptr[i], n);
+            g_mux.stats.rx_bytes += written;
+            g_mux.stats.credit_overruns += n - written;
+
+            g_mux.rx_remain -= n;
+            i += n;
+        }
+
+        cdc_acm_linear_read_done(size);
+    }
+}
+
+/* 应用读走的空间攒够一批 (或通道已读空) 后还给主机 */
+static void mux_return_credit(void)
+{
+    uint8_t hdr[CDC_MUX_HDR_LEN];
+
+    for (uint8_t c = 0; c < CDC_MUX_CH_NUM; c++) {
+        mux_channel_t *ch = &g_mux.ch[c];
+
+        if (ch->rx_unacked == 0 ||
+            (ch->rx_unacked < CDC_MUX_CREDIT_BATCH && !lf_spsc_ringbuffer_check_empty(&ch->rx))) {
+            continue;
+        }
+
+        uint16_t n = (ch->rx_unacked > 0xFFFF) ? 0xFFFF : (uint16_t)ch->rx_unacked;
+        mux_fill_header(hdr, CDC_MUX_TYPE_CREDIT, c, n);
+        if (cdc_acm_port_send_data(CDC_ACM_PORT_DEFAULT, hdr, sizeof(hdr)) <= 0) {
+            return; // 发送缓冲区满，下次再还
+        }
+        ch->rx_unacked -= n;
+        g_mux.stats.tx_hdr_bytes += CDC_MUX_HDR_LEN;
+    }
+}
+
+/* ========== 发送 ========== */
+
+/* 发送通道 c 的一帧: 1 已发送, 0 没有可发送的数据或额度, -1 端口发送缓冲区满 */
+static int mux_tx_chunk(uint8_t c)
+{
+    mux_channel_t *ch = &g_mux.ch[c];
+    uint8_t hdr[CDC_MUX_HDR_LEN];
+    uint32_t size;
+
+    uint8_t *ptr = lf_mpsc_ringbuffer_linear_read_setup(&ch->tx, &size);
+    if (size > ch->tx_credit) {
+        size = ch->tx_credit;
+    }
+    if (size > CDC_MUX_MAX_CHUNK) {
+        size = CDC_MUX_MAX_CHUNK;
+    }
+    if (size == 0) {
+        return 0;
+    }
+
+    // 帧头和数据一次预留，整帧写入端口发送缓冲区，不会和其他帧交错
+    mux_fill_header(hdr, CDC_MUX_TYPE_DATA, c, (uint16_t)size);
+    const cdc_acm_iovec_t iov[2] = {
+        { hdr, sizeof(hdr) },
+        { ptr, size },
+    };
+    if (cdc_acm_port_sendv(CDC_ACM_PORT_DEFAULT, iov, 2) <= 0) {
+        return -1;
+    }
+
+    lf_mpsc_ringbuffer_linear_read_done(&ch->tx, size);
+    ch->tx_credit -= size;
+    g_mux.stats.tx_bytes += size;
+    g_mux.stats.tx_hdr_bytes += CDC_MUX_HDR_LEN;
+    return 1;
+}
+
+/* 轮流从各通道取一帧，直到没有数据或端口发送缓冲区放不下 */
+static void mux_tx(void)
+{
+    bool progress;
+
+    do {
+        progress = false;
+        for (uint8_t k = 0; k < CDC_MUX_CH_NUM; k++) {
+            uint8_t c = (uint8_t)((g_mux.tx_next + k) % CDC_MUX_CH_NUM);
+            int ret = mux_tx_chunk(c);
+
+            if (ret < 0) {
+                // 下次从这个通道开始，不让它因为缓冲区满而少一轮
+                g_mux.tx_next = c;
+                return;
+            }
+            progress |= (ret > 0);
+        }
+    } while (progress);
+}
+
+/* ========== 公共API ========== */
+void cdc_mux_start(void)
+{
+    for (uint8_t c = 0; c < CDC_MUX_CH_NUM; c++) {
+        mux_channel_t *ch = &g_mux.ch[c];
+
+        lf_spsc_ringbuffer_init(&ch->rx, g_mux.rx_pool[c], CDC_MUX_RING_SIZE);
+        lf_mpsc_ringbuffer_init(&ch->tx, g_mux.tx_pool[c], CDC_MUX_RING_SIZE);
+        ch->tx_credit = 0;
+        ch->rx_unacked = CDC_MUX_RING_SIZE; // 初始额度由 mux_return_credit() 发出
+    }
+    g_mux.hdr_len = 0;
+    g_mux.rx_remain = 0;
+    g_mux.tx_next = 0;
+    g_mux.stats = (cdc_mux_stats_t){ 0 };
+    g_mux.active = true;
+
+    mux_return_credit();
+}
+
+void cdc_mux_stop(void)
+{
+    g_mux.active = false;
+}
+
+bool cdc_mux_is_active(void)
+{
+    return g_mux.active;
+}
+
+void cdc_mux_poll(void)
+{
+    if (!g_mux.active) {
+        return;
+    }
+
+    // 主机关闭端口后回到普通数据
+    if (!cdc_acm_port_is_open(CDC_ACM_PORT_DEFAULT)) {
+        cdc_mux_stop();
+        return;
+    }
+
+    mux_rx();
+    if (!g_mux.active) {
+        return;
+    }
+    mux_return_credit();
+    mux_tx();
+}
+
+int cdc_mux_write(uint8_t ch, const void *data, uint32_t len)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    if (c == NULL || (len && data == NULL)) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    // 整段写入，由 cdc_mux_poll() 按额度分帧发出
+    return (int)lf_mpsc_ringbuffer_write(&c->tx, data, len);
+}
+
+int cdc_mux_read(uint8_t ch, void *buf, uint32_t max_len)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    if (c == NULL || buf == NULL) {
+        return 0;
+    }
+
+    uint32_t n = lf_spsc_ringbuffer_read(&c->rx, buf, max_len);
+    c->rx_unacked += n;
+    return (int)n;
+}
+
+void *cdc_mux_linear_read_setup(uint8_t ch, uint32_t *size)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    if (c == NULL) {
+        *size = 0;
+        return NULL;
+    }
+    return lf_spsc_ringbuffer_linear_read_setup(&c->rx, size);
+}
+
+void cdc_mux_linear_read_done(uint8_t ch, uint32_t size)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    if (c != NULL) {
+        c->rx_unacked += lf_spsc_ringbuffer_linear_read_done(&c->rx, size);
+    }
+}
+
+uint32_t cdc_mux_get_rx_available(uint8_t ch)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    return c ? lf_spsc_ringbuffer_get_used(&c->rx) : 0;
+}
+
+uint32_t cdc_mux_get_tx_free(uint8_t ch)
+{
+    mux_channel_t *c = mux_get_channel(ch);
+
+    return c ? lf_mpsc_ringbuffer_get_free(&c->tx) : 0;
+}
+
+void cdc_mux_get_stats(cdc_mux_stats_t *stats)
+{
+    *stats = g_mux.stats;
+}
@@ -0,0 +1,595 @@
+/*
+ * Lock-free ringbuffer (SPSC / MPSC) for ISR <-> main loop
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "lf_ringbuffer.h"
+
+/* 读写指针的发布和读取。Cortex-M4 上 acquire/release 编译为 DMB，CAS 为 LDREX/STREX */
+#define LF_LOAD_RELAXED(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define LF_LOAD_ACQ(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define LF_STORE_REL(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define LF_CAS(p, e, d)    __atomic_compare_exchange_n((p), (e), (d), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/*
+ * MPSC 的指针只有 17 位有效，和预留位置一起打包进 state 才能用一次 CAS 更新。
+ * 指针范围必须大于容量的两倍: 晚到的发布者拿着落后最多一整圈的旧位置，
+ * 只有这样它和"前进一整圈"的新位置才区分得开 (见 mpsc_publish)
+ */
+#define MPSC_IDX_BITS    17
+#define MPSC_IDX_MASK    ((1u << MPSC_IDX_BITS) - 1)
+#define MPSC_FLAGS       ((1u << (32 - MPSC_IDX_BITS)) - 1)
+#define MPSC_LINEAR_BIT  (1u << (31 - MPSC_IDX_BITS))
+#define MPSC_WRITERS     (MPSC_LINEAR_BIT - 1)
+#define MPSC_HEAD(s)     ((s) >> (32 - MPSC_IDX_BITS))
+#define MPSC_STATE(h, f) ((((h) & MPSC_IDX_MASK) << (32 - MPSC_IDX_BITS)) | (f))
+
+typedef uint32_t __attribute__((__may_alias__)) lf_word_t;
+
+/*****************************************************************************
+* @brief        copy memory, word by word when src and dst share alignment
+*****************************************************************************/
+static void lf_copy(void *dst, const void *src, uint32_t n)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+        while (n && ((uintptr_t)d & 3)) {
+            *d++ = *s++;
+            n--;
+        }
+
+        lf_word_t *dw = (lf_word_t *)d;
+        const lf_word_t *sw = (const lf_word_t *)s;
+
+        while (n >= 16) {
+            dw[0] = sw[0];
+            dw[1] = sw[1];
+            dw[2] = sw[2];
+            dw[3] = sw[3];
+            dw += 4;
+            sw += 4;
+            n -= 16;
+        }
+        while (n >= 4) {
+            *dw++ = *sw++;
+            n -= 4;
+        }
+
+        d = (uint8_t *)dw;
+        s = (const uint8_t *)sw;
+    }
+
+    while (n--) {
+        *d++ = *s++;
+    }
+}
+
+static void lf_copy_to_ring(uint8_t *pool, uint32_t mask, uint32_t pos, const void *data, uint32_t size)
+{
+    uint32_t offset = pos & mask;
+    uint32_t remain = mask + 1 - offset;
+
+    remain = remain > size ? size : remain;
+    lf_copy(pool + offset, data, remain);
+    lf_copy(pool, (const uint8_t *)data + remain, size - remain);
+}
+
+static void lf_copy_from_ring(const uint8_t *pool, uint32_t mask, uint32_t pos, void *data, uint32_t size)
+{
+    uint32_t offset = pos & mask;
+    uint32_t remain = mask + 1 - offset;
+
+    remain = remain > size ? size : remain;
+    lf_copy(data, pool + offset, remain);
+    lf_copy((uint8_t *)data + remain, pool, size - remain);
+}
+
+/*****************************************************************************
+* SPSC
+*****************************************************************************/
+
+/*****************************************************************************
+* @brief        init ringbuffer
+*
+* @param[in]    rb          ringbuffer instance
+* @param[in]    pool        memory pool address
+* @param[in]    size        memory size in byte,
+*                           must be power of 2 !!!
+*
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int lf_spsc_ringbuffer_init(lf_spsc_ringbuffer_t *rb, void *pool, uint32_t size)
+{
+    if ((NULL == rb) || (NULL == pool)) {
+        return -1;
+    }
+
+    if ((size < 2) || (size & (size - 1))) {
+        return -1;
+    }
+
+    memset(rb, 0, sizeof(*rb));
+    rb->mask = size - 1;
+    rb->pool = pool;
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        reset ringbuffer, producer and consumer must both be idle
+*****************************************************************************/
+void lf_spsc_ringbuffer_reset(lf_spsc_ringbuffer_t *rb)
+{
+    rb->in = 0;
+    rb->out = 0;
+    rb->in_cache = 0;
+    rb->out_cache = 0;
+}
+
+uint32_t lf_spsc_ringbuffer_get_size(lf_spsc_ringbuffer_t *rb)
+{
+    return rb->mask + 1;
+}
+
+uint32_t lf_spsc_ringbuffer_get_used(lf_spsc_ringbuffer_t *rb)
+{
+    uint32_t out = LF_LOAD_ACQ(&rb->out);
+    return LF_LOAD_ACQ(&rb->in) - out;
+}
+
+uint32_t lf_spsc_ringbuffer_get_free(lf_spsc_ringbuffer_t *rb)
+{
+    return (rb->mask + 1) - lf_spsc_ringbuffer_get_used(rb);
+}
+
+bool lf_spsc_ringbuffer_check_empty(lf_spsc_ringbuffer_t *rb)
+{
+    return lf_spsc_ringbuffer_get_used(rb) == 0;
+}
+
+/* 生产者侧的可用空间，缓存的读指针不够用时才重新读取 */
+static uint32_t spsc_producer_free(lf_spsc_ringbuffer_t *rb, uint32_t in, uint32_t need)
+{
+    uint32_t unused = (rb->mask + 1) - (in - rb->out_cache);
+
+    if (unused < need) {
+        rb->out_cache = LF_LOAD_ACQ(&rb->out);
+        unused = (rb->mask + 1) - (in - rb->out_cache);
+    }
+    return unused;
+}
+
+/* 消费者侧的可读数据，缓存的写指针不够用时才重新读取 */
+static uint32_t spsc_consumer_used(lf_spsc_ringbuffer_t *rb, uint32_t out, uint32_t need)
+{
+    uint32_t used = rb->in_cache - out;
+
+    if (used < need) {
+        rb->in_cache = LF_LOAD_ACQ(&rb->in);
+        used = rb->in_cache - out;
+    }
+    return used;
+}
+
+/*****************************************************************************
+* @brief        write data to ringbuffer, producer side only
+*
+* @param[in]    rb          ringbuffer instance
+* @param[in]    data        data pointer
+* @param[in]    size        size in byte
+*
+* @retval uint32_t          actual write size in byte
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_write(lf_spsc_ringbuffer_t *rb, const void *data, uint32_t size)
+{
+    uint32_t in = LF_LOAD_RELAXED(&rb->in);
+    uint32_t unused = spsc_producer_free(rb, in, size);
+
+    if (size > unused) {
+        size = unused;
+    }
+
+    lf_copy_to_ring(rb->pool, rb->mask, in, data, size);
+    LF_STORE_REL(&rb->in, in + size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        peek data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_peek(lf_spsc_ringbuffer_t *rb, void *data, uint32_t size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t used = spsc_consumer_used(rb, out, size);
+
+    if (size > used) {
+        size = used;
+    }
+
+    lf_copy_from_ring(rb->pool, rb->mask, out, data, size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        read data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_read(lf_spsc_ringbuffer_t *rb, void *data, uint32_t size)
+{
+    size = lf_spsc_ringbuffer_peek(rb, data, size);
+    LF_STORE_REL(&rb->out, LF_LOAD_RELAXED(&rb->out) + size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        drop data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_drop(lf_spsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t used = spsc_consumer_used(rb, out, size);
+
+    if (size > used) {
+        size = used;
+    }
+
+    LF_STORE_REL(&rb->out, out + size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        linear write setup, get write pointer and max linear size,
+*               producer side only
+*****************************************************************************/
+void *lf_spsc_ringbuffer_linear_write_setup(lf_spsc_ringbuffer_t *rb, uint32_t *size)
+{
+    uint32_t in = LF_LOAD_RELAXED(&rb->in);
+    uint32_t offset = in & rb->mask;
+    uint32_t remain = rb->mask + 1 - offset;
+    uint32_t unused = spsc_producer_free(rb, in, remain);
+
+    *size = remain > unused ? unused : remain;
+    return rb->pool + offset;
+}
+
+/*****************************************************************************
+* @brief        linear write done, publish written data
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_linear_write_done(lf_spsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t in = LF_LOAD_RELAXED(&rb->in);
+    uint32_t unused = spsc_producer_free(rb, in, size);
+
+    if (size > unused) {
+        size = unused;
+    }
+
+    LF_STORE_REL(&rb->in, in + size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        linear read setup, get read pointer and max linear size,
+*               consumer side only
+*****************************************************************************/
+void *lf_spsc_ringbuffer_linear_read_setup(lf_spsc_ringbuffer_t *rb, uint32_t *size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t offset = out & rb->mask;
+    uint32_t remain = rb->mask + 1 - offset;
+    uint32_t used = spsc_consumer_used(rb, out, remain);
+
+    *size = remain > used ? used : remain;
+    return rb->pool + offset;
+}
+
+/*****************************************************************************
+* @brief        linear read done, release consumed data
+*****************************************************************************/
+uint32_t lf_spsc_ringbuffer_linear_read_done(lf_spsc_ringbuffer_t *rb, uint32_t size)
+{
+    return lf_spsc_ringbuffer_drop(rb, size);
+}
+
+/*****************************************************************************
+* MPSC
+*
+* 生产者先用 CAS 在 state 中预留空间并把未提交计数加一，拷贝完数据后再减一。
+* 计数减到零的生产者负责发布写指针: 此时 state 中的预留位置之前的数据都已写完。
+* 多个发布者之间只允许写指针前进，晚到的旧位置会被丢弃。
+*****************************************************************************/
+
+/*****************************************************************************
+* @brief        init ringbuffer
+*
+* @param[in]    size        memory size in byte,
+*                           must be power of 2 and not larger than 32768 !!!
+*
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int lf_mpsc_ringbuffer_init(lf_mpsc_ringbuffer_t *rb, void *pool, uint32_t size)
+{
+    if ((NULL == rb) || (NULL == pool)) {
+        return -1;
+    }
+
+    if ((size < 2) || (size > LF_MPSC_MAX_SIZE) || (size & (size - 1))) {
+        return -1;
+    }
+
+    memset(rb, 0, sizeof(*rb));
+    rb->mask = size - 1;
+    rb->pool = pool;
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        reset ringbuffer, producers and consumer must all be idle
+*****************************************************************************/
+void lf_mpsc_ringbuffer_reset(lf_mpsc_ringbuffer_t *rb)
+{
+    rb->state = 0;
+    rb->in = 0;
+    rb->out = 0;
+    rb->in_cache = 0;
+    rb->linear_len = 0;
+}
+
+uint32_t lf_mpsc_ringbuffer_get_size(lf_mpsc_ringbuffer_t *rb)
+{
+    return rb->mask + 1;
+}
+
+uint32_t lf_mpsc_ringbuffer_get_used(lf_mpsc_ringbuffer_t *rb)
+{
+    uint32_t out = LF_LOAD_ACQ(&rb->out);
+    return (LF_LOAD_ACQ(&rb->in) - out) & MPSC_IDX_MASK;
+}
+
+/* 剩余空间按已预留的位置计算，与生产者看到的一致 */
+uint32_t lf_mpsc_ringbuffer_get_free(lf_mpsc_ringbuffer_t *rb)
+{
+    uint32_t out = LF_LOAD_ACQ(&rb->out);
+    uint32_t head = MPSC_HEAD(LF_LOAD_ACQ(&rb->state));
+    return (rb->mask + 1) - ((head - out) & MPSC_IDX_MASK);
+}
+
+bool lf_mpsc_ringbuffer_check_empty(lf_mpsc_ringbuffer_t *rb)
+{
+    return lf_mpsc_ringbuffer_get_used(rb) == 0;
+}
+
+static void mpsc_publish(lf_mpsc_ringbuffer_t *rb, uint32_t pos)
+{
+    uint32_t cur = LF_LOAD_RELAXED(&rb->in);
+
+    do {
+        uint32_t dist = (pos - cur) & MPSC_IDX_MASK;
+        if ((dist == 0) || (dist > rb->mask + 1)) {
+            return; // 已被更新的位置发布过
+        }
+    } while (!LF_CAS(&rb->in, &cur, pos));
+}
+
+/*****************************************************************************
+* @brief        reserve space for size bytes, all or nothing
+*
+* @retval int32_t           start position for lf_mpsc_ringbuffer_fill(),
+*                           -1: not enough space
+*
+* @note         every successful reserve must be followed by one commit
+*****************************************************************************/
+int32_t lf_mpsc_ringbuffer_reserve(lf_mpsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t s = LF_LOAD_ACQ(&rb->state);
+    uint32_t n, head, used;
+
+    if ((size == 0) || (size > rb->mask + 1)) {
+        return -1;
+    }
+
+    do {
+        if (s & MPSC_LINEAR_BIT) {
+            return -1; // 线性写占用期间不允许预留
+        }
+
+        head = MPSC_HEAD(s);
+        used = (head - LF_LOAD_ACQ(&rb->out)) & MPSC_IDX_MASK;
+        if (size > (rb->mask + 1) - used) {
+            return -1;
+        }
+
+        n = MPSC_STATE(head + size, (s & MPSC_FLAGS) + 1);
+    } while (!LF_CAS(&rb->state, &s, n));
+
+    return (int32_t)head;
+}
+
+/*****************************************************************************
+* @brief        copy data into reserved space, handles wrap-around
+*
+* @param[in]    pos         reserved start position plus offset
+*****************************************************************************/
+void lf_mpsc_ringbuffer_fill(lf_mpsc_ringbuffer_t *rb, uint32_t pos, const void *data, uint32_t size)
+{
+    lf_copy_to_ring(rb->pool, rb->mask, pos, data, size);
+}
+
+/*****************************************************************************
+* @brief        commit one reservation, last committer publishes
+*****************************************************************************/
+void lf_mpsc_ringbuffer_commit(lf_mpsc_ringbuffer_t *rb)
+{
+    uint32_t s = LF_LOAD_RELAXED(&rb->state);
+    uint32_t n;
+
+    do {
+        n = s - 1;
+    } while (!LF_CAS(&rb->state, &s, n));
+
+    if ((n & MPSC_WRITERS) == 0) {
+        mpsc_publish(rb, MPSC_HEAD(n));
+    }
+}
+
+/*****************************************************************************
+* @brief        write data to ringbuffer, all or nothing, any context
+*
+* @retval uint32_t          size on success, 0 if not enough space
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_write(lf_mpsc_ringbuffer_t *rb, const void *data, uint32_t size)
+{
+    int32_t pos = lf_mpsc_ringbuffer_reserve(rb, size);
+
+    if (pos < 0) {
+        return 0;
+    }
+
+    lf_mpsc_ringbuffer_fill(rb, (uint32_t)pos, data, size);
+    lf_mpsc_ringbuffer_commit(rb);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        linear write setup, reserve the whole linear free region
+*
+* @note         other producers fail until lf_mpsc_ringbuffer_linear_write_done()
+*               so the unused tail can be given back
+*****************************************************************************/
+void *lf_mpsc_ringbuffer_linear_write_setup(lf_mpsc_ringbuffer_t *rb, uint32_t *size)
+{
+    uint32_t s = LF_LOAD_ACQ(&rb->state);
+    uint32_t n, head, unused, offset, remain;
+
+    do {
+        head = MPSC_HEAD(s);
+        offset = head & rb->mask;
+
+        if (s & MPSC_LINEAR_BIT) {
+            *size = 0;
+            return rb->pool + offset;
+        }
+
+        unused = (rb->mask + 1) - ((head - LF_LOAD_ACQ(&rb->out)) & MPSC_IDX_MASK);
+        remain = rb->mask + 1 - offset;
+        remain = remain > unused ? unused : remain;
+        if (remain == 0) {
+            *size = 0;
+            return rb->pool + offset;
+        }
+
+        n = MPSC_STATE(head + remain, ((s & MPSC_WRITERS) + 1) | MPSC_LINEAR_BIT);
+    } while (!LF_CAS(&rb->state, &s, n));
+
+    rb->linear_len = remain;
+    *size = remain;
+    return rb->pool + offset;
+}
+
+/*****************************************************************************
+* @brief        linear write done, give back unused tail and publish
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_linear_write_done(lf_mpsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t s = LF_LOAD_RELAXED(&rb->state);
+    uint32_t n, head, writers;
+    uint32_t len = rb->linear_len;
+
+    if (!(s & MPSC_LINEAR_BIT)) {
+        return 0;
+    }
+    if (size > len) {
+        size = len;
+    }
+
+    do {
+        // 占用期间没有新的预留，state 中的位置就是本次线性区域的末尾
+        head = MPSC_HEAD(s) - (len - size);
+        writers = (s & MPSC_WRITERS) - 1;
+        n = MPSC_STATE(head, writers);
+    } while (!LF_CAS(&rb->state, &s, n));
+
+    rb->linear_len = 0;
+    if (writers == 0) {
+        mpsc_publish(rb, head & MPSC_IDX_MASK);
+    }
+    return size;
+}
+
+/* 消费者侧的可读数据，缓存的写指针不够用时才重新读取 */
+static uint32_t mpsc_consumer_used(lf_mpsc_ringbuffer_t *rb, uint32_t out, uint32_t need)
+{
+    uint32_t used = (rb->in_cache - out) & MPSC_IDX_MASK;
+
+    if (used < need) {
+        rb->in_cache = LF_LOAD_ACQ(&rb->in);
+        used = (rb->in_cache - out) & MPSC_IDX_MASK;
+    }
+    return used;
+}
+
+/*****************************************************************************
+* @brief        peek data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_peek(lf_mpsc_ringbuffer_t *rb, void *data, uint32_t size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t used = mpsc_consumer_used(rb, out, size);
+
+    if (size > used) {
+        size = used;
+    }
+
+    lf_copy_from_ring(rb->pool, rb->mask, out, data, size);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        read data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_read(lf_mpsc_ringbuffer_t *rb, void *data, uint32_t size)
+{
+    size = lf_mpsc_ringbuffer_peek(rb, data, size);
+    LF_STORE_REL(&rb->out, (LF_LOAD_RELAXED(&rb->out) + size) & MPSC_IDX_MASK);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        drop data from ringbuffer, consumer side only
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_drop(lf_mpsc_ringbuffer_t *rb, uint32_t size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t used = mpsc_consumer_used(rb, out, size);
+
+    if (size > used) {
+        size = used;
+    }
+
+    LF_STORE_REL(&rb->out, (out + size) & MPSC_IDX_MASK);
+    return size;
+}
+
+/*****************************************************************************
+* @brief        linear read setup, consumer side only
+*****************************************************************************/
+void *lf_mpsc_ringbuffer_linear_read_setup(lf_mpsc_ringbuffer_t *rb, uint32_t *size)
+{
+    uint32_t out = LF_LOAD_RELAXED(&rb->out);
+    uint32_t offset = out & rb->mask;
+    uint32_t remain = rb->mask + 1 - offset;
+    uint32_t used = mpsc_consumer_used(rb, out, remain);
+
+    *size = remain > used ? used : remain;
+    return rb->pool + offset;
+}
+
+/*****************************************************************************
+* @brief        linear read done, release consumed data
+*****************************************************************************/
+uint32_t lf_mpsc_ringbuffer_linear_read_done(lf_mpsc_ringbuffer_t *rb, uint32_t size)
+{
+    return lf_mpsc_ringbuffer_drop(rb, size);
+}
@@ -0,0 +1,361 @@
+/*
+ * Streaming LZ Compressor (bounded window, fixed memory)
+ */
+
+#include "lz_stream.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(USE_HAL_DRIVER)
+#include "stm32f4xx_hal.h"
+#define LZ_CYCLES()     (DWT->CYCCNT)
+#else
+#define LZ_CYCLES()     0U
+#endif
+
+#define LZ_MIN_MATCH    4
+#define LZ_NO_POS       0xFFFFU
+#define LZ_BUF_SIZE     (LZ_STREAM_WINDOW + LZ_STREAM_BLOCK_MAX)
+
+/* 连续这么多字节没有匹配后，查找步长加 1 (不可压缩的数据很快跳过) */
+#define LZ_SKIP_SHIFT   5
+
+/* ========== 工具 ========== */
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (uint32_t)(v * 2654435761U) >> (32 - LZ_STREAM_HASH_BITS);
+}
+
+static inline void lz_put16(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+/* 长度扩展字节: 先减去 token 中的 15，之后每字节最多 255 */
+static uint8_t *lz_put_len(uint8_t *op, uint32_t len)
+{
+    for (len -= 15; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+/* 历史窗口满时把最近 LZ_STREAM_WINDOW 字节移到开头，哈希表同步平移 */
+static void lz_slide(lz_stream_t *lz)
+{
+    uint32_t shift = lz->pos - LZ_STREAM_WINDOW;
+
+    memmove(lz->buf, &lz->buf[shift], LZ_STREAM_WINDOW);
+    for (uint32_t i = 0; i < (1U << LZ_STREAM_HASH_BITS); i++) {
+        uint16_t v = lz->table[i];
+        lz->table[i] = (v != LZ_NO_POS && v >= shift) ? (uint16_t)(v - shift) : LZ_NO_POS;
+    }
+    lz->pos = LZ_STREAM_WINDOW;
+}
+
+/*
+ * 压缩 buf[pos, pos + len) 为 LZ 序列，写入 op
+ * 输出达到 len 字节 (不比原样存储小) 时放弃，返回 0
+ */
+static uint32_t lz_encode(lz_stream_t *lz, uint32_t len, uint8_t *op)
+{
+    const uint8_t *buf = lz->buf;
+    const uint32_t end = lz->pos + len;
+    const uint8_t *oend = op + len;
+    uint8_t *ostart = op;
+    uint32_t ip = lz->pos;
+    uint32_t anchor = ip;
+    uint32_t lit, need;
+
+    while (ip + LZ_MIN_MATCH <= end) {
+        uint32_t h = lz_hash(lz_read32(&buf[ip]));
+        uint32_t ref = lz->table[h];
+        uint32_t mlen;
+
+        lz->table[h] = (uint16_t)ip;
+        if (ref == LZ_NO_POS || ip - ref > LZ_STREAM_WINDOW ||
+            lz_read32(&buf[ref]) != lz_read32(&buf[ip])) {
+            ip += 1 + ((ip - anchor) >> LZ_SKIP_SHIFT);
+            continue;
+        }
+
+        mlen = LZ_MIN_MATCH;
+        while (ip + mlen < end && buf[ref + mlen] == buf[ip + mlen]) {
+            mlen++;
+        }
+
+        // token + 字面量 + 扩展字节 + offset，超出上限就不划算了
+        lit = ip - anchor;
+        need = 1 + lit + lit / 255 + 1 + 2 + (mlen - LZ_MIN_MATCH) / 255 + 1;
+        if (op + need > oend) {
+            return 0;
+        }
+
+        uint8_t *token = op++;
+        *token = (uint8_t)(((lit >= 15) ? 15 : lit) << 4);
+        if (lit >= 15) {
+            op = lz_put_len(op, lit);
+        }
+        memcpy(op, &buf[anchor], lit);
+        op += lit;
+
+        lz_put16(op, ip - ref);
+        op += 2;
+        if (mlen - LZ_MIN_MATCH >= 15) {
+            *token |= 15;
+            op = lz_put_len(op, mlen - LZ_MIN_MATCH);
+        } else {
+            *token |= (uint8_t)(mlen - LZ_MIN_MATCH);
+        }
+
+        // 匹配末尾附近也记入哈希表，下一个匹配更容易接上
+        if (ip + mlen - 2 + LZ_MIN_MATCH <= end) {
+            lz->table[lz_hash(lz_read32(&buf[ip + mlen - 2]))] = (uint16_t)(ip + mlen - 2);
+        }
+        ip += mlen;
+        anchor = ip;
+    }
+
+    // 最后一个序列只有字面量
+    lit = end - anchor;
+    if (op + 1 + lit + lit / 255 + 1 > oend) {
+        return 0;
+    }
+    *op++ = (uint8_t)(((lit >= 15) ? 15 : lit) << 4);
+    if (lit >= 15) {
+        op = lz_put_len(op, lit);
+    }
+    memcpy(op, &buf[anchor], lit);
+    op += lit;
+
+    return (uint32_t)(op - ostart);
+}
+
+/* ========== 公共API ========== */
+void lz_stream_reset(lz_stream_t *lz)
+{
+    memset(lz->table, 0xFF, sizeof(lz->table));
+    lz->pos = 0;
+    lz->started = false;
+}
+
+uint8_t *lz_stream_input(lz_stream_t *lz)
+{
+    if (lz->pos + LZ_STREAM_BLOCK_MAX > LZ_BUF_SIZE) {
+        lz_slide(lz);
+    }
+    return &lz->buf[lz->pos];
+}
+
+uint32_t lz_stream_compress(lz_stream_t *lz, uint32_t len, uint8_t *out)
+{
+    uint32_t t0 = LZ_CYCLES();
+    uint8_t *op = out;
+    uint8_t *hdr;
+    uint32_t clen;
+    uint8_t type = LZ_STREAM_TYPE_LZ;
+
+    if (len == 0 || len > LZ_STREAM_BLOCK_MAX || lz->pos + len > LZ_BUF_SIZE) {
+        return 0;
+    }
+
+    if (!lz->started) {
+        memcpy(op, LZ_STREAM_MAGIC, LZ_STREAM_MAGIC_LEN);
+        op += LZ_STREAM_MAGIC_LEN;
+        lz->started = true;
+    }
+
+    hdr = op;
+    op += LZ_STREAM_HDR_LEN;
+    clen = lz_encode(lz, len, op);
+    if (clen == 0) {
+        // 解码端同样把原样数据加入历史，后面的块仍可引用它
+        type = LZ_STREAM_TYPE_STORED;
+        memcpy(op, &lz->buf[lz->pos], len);
+        clen = len;
+        lz->stats.stored_blocks++;
+    }
+
+    hdr[0] = type;
+    lz_put16(&hdr[1], clen);
+    lz_put16(&hdr[3], len);
+    op += clen;
+    lz->pos += len;
+
+    lz->stats.raw_bytes += len;
+    lz->stats.out_bytes += (uint32_t)(op - out);
+    lz->stats.blocks++;
+    lz->stats.cycles += LZ_CYCLES() - t0;
+    return (uint32_t)(op - out);
+}
+
+uint32_t lz_stream_finish(lz_stream_t *lz, uint8_t *out)
+{
+    bool started = lz->started;
+
+    lz_stream_reset(lz);
+    if (!started) {
+        return 0;
+    }
+
+    memset(out, 0, LZ_STREAM_HDR_LEN);
+    out[0] = LZ_STREAM_TYPE_END;
+    lz->stats.out_bytes += LZ_STREAM_HDR_LEN;
+    return LZ_STREAM_HDR_LEN;
+}
+
+/* ========== 基准测试 ========== */
+
+/* 解码一个块的数据，追加到 dst[*pos]，dst 前面的内容就是历史 */
+static bool lz_decode_block(const uint8_t *in, uint32_t clen, uint8_t *dst, uint32_t *pos, uint32_t cap)
+{
+    const uint8_t *iend = in + clen;
+    uint32_t op = *pos;
+
+    while (in < iend) {
+        uint8_t token = *in++;
+        uint32_t lit = token >> 4;
+        uint32_t mlen = token & 15;
+        uint32_t off;
+
+        if (lit == 15) {
+            uint8_t b;
+            do {
+                if (in >= iend) {
+                    return false;
+                }
+                b = *in++;
+                lit += b;
+            } while (b == 255);
+        }
+        if (lit > (uint32_t)(iend - in) || op + lit > cap) {
+            return false;
+        }
+        memcpy(&dst[op], in, lit);
+        in += lit;
+        op += lit;
+
+        if (in == iend) {
+            break; // 最后一个序列
+        }
+        if (iend - in < 2) {
+            return false;
+        }
+        off = in[0] | ((uint32_t)in[1] << 8);
+        in += 2;
+        if (mlen == 15) {
+            uint8_t b;
+            do {
+                if (in >= iend) {
+                    return false;
+                }
+                b = *in++;
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LZ_MIN_MATCH;
+        if (off == 0 || off > op || op + mlen > cap) {
+            return false;
+        }
+        for (uint32_t i = 0; i < mlen; i++, op++) {
+            dst[op] = dst[op - off]; // 可能与自身重叠，逐字节复制
+        }
+    }
+
+    *pos = op;
+    return true;
+}
+
+/* 生成类似终端日志的文本: 时间戳、收发方向、AT 命令和数值 */
+static uint32_t lz_bench_text(char *buf, uint32_t size)
+{
+    static const char *const msgs[] = {
+        "RX: AT+CSQ", "TX: +CSQ: %lu,99", "RX: AT+CGATT?", "TX: +CGATT: 1",
+        "[Touch] x=%lu y=%lu", "[Temp] %lu.%lu C", "TX: OK", "[Bench] %lu KB/s",
+    };
+    uint32_t seed = 12345;
+    uint32_t len = 0;
+    uint32_t ms = 1000;
+
+    while (len < size) {
+        char line[64];
+        int n;
+
+        seed = seed * 1103515245UL + 12345;
+        ms += (seed >> 16) % 200;
+        n = snprintf(line, sizeof(line), "[%05lu.%03lu] ", ms / 1000, ms % 1000);
+        n += snprintf(&line[n], sizeof(line) - n, msgs[(seed >> 8) % 8],
+                      (seed >> 4) % 320, (seed >> 12) % 32);
+        n += snprintf(&line[n], sizeof(line) - n, "\r\n");
+
+        if ((uint32_t)n > size - len) {
+            n = (int)(size - len);
+        }
+        memcpy(&buf[len], line, n);
+        len += n;
+    }
+    return len;
+}
+
+void lz_stream_bench(lz_stream_bench_result_t *result)
+{
+    static lz_stream_t lz;
+    static char text[LZ_STREAM_BENCH_LEN];
+    static uint8_t decoded[LZ_STREAM_BENCH_LEN];
+    static uint8_t out[LZ_STREAM_OUT_MAX(LZ_STREAM_BLOCK_MAX)];
+    uint32_t done = 0, dec_len = 0;
+    bool ok = true;
+
+    result->len = lz_bench_text(text, LZ_STREAM_BENCH_LEN);
+    result->out_len = 0;
+
+#if defined(USE_HAL_DRIVER)
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+
+    lz_stream_reset(&lz);
+    memset(&lz.stats, 0, sizeof(lz.stats));
+
+    // 按日志输出的节奏分成大小不一的块
+    while (done < result->len) {
+        uint32_t n = result->len - done;
+        uint32_t olen, skip;
+
+        if (n > 200 + (done % 700)) {
+            n = 200 + (done % 700);
+        }
+        memcpy(lz_stream_input(&lz), &text[done], n);
+        olen = lz_stream_compress(&lz, n, out);
+        done += n;
+
+        // 校验块头并解码
+        skip = (done == n) ? LZ_STREAM_MAGIC_LEN : 0;
+        if (olen < skip + LZ_STREAM_HDR_LEN ||
+            (out[skip + 3] | (out[skip + 4] << 8)) != n) {
+            ok = false;
+            break;
+        }
+        if (out[skip] == LZ_STREAM_TYPE_STORED) {
+            memcpy(&decoded[dec_len], &out[skip + LZ_STREAM_HDR_LEN], n);
+            dec_len += n;
+        } else if (!lz_decode_block(&out[skip + LZ_STREAM_HDR_LEN], olen - skip - LZ_STREAM_HDR_LEN,
+                                    decoded, &dec_len, sizeof(decoded))) {
+            ok = false;
+            break;
+        }
+    }
+
+    result->out_len = lz.stats.out_bytes;
+    result->cycles = (uint32_t)lz.stats.cycles;
+    result->match = ok && dec_len == result->len && memcmp(decoded, text, dec_len) == 0;
+}
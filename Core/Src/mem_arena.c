@@ -0,0 +1,199 @@
+/*
+ * Static Memory Arena and Runtime Buffer Layout
+ */
+
+#include "mem_arena.h"
+#include "cdc_acm_ringbuffer.h"
+#include "crc32.h"
+#include "usb_config.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+#include <string.h>
+
+// USB 内核的 DMA 直接读写 CDC 收发缓冲区，它们在 CCM 时 DMA 访问不到
+#if MEM_ARENA_IN_CCM && defined(CONFIG_USB_DWC2_DMA_ENABLE)
+#error "USB DMA cannot reach CCM RAM: set MEM_ARENA_IN_CCM to 0 to place the arena in SRAM, or disable USB DMA"
+#endif
+
+#define MEM_ALIGN_UP(x)     (((x) + MEM_ARENA_ALIGN - 1) & ~(uint32_t)(MEM_ARENA_ALIGN - 1))
+
+static uint8_t mem_arena_pool[MEM_ARENA_SIZE] MEM_ARENA_SECTION __attribute__((aligned(MEM_ARENA_ALIGN)));
+static uint32_t mem_arena_used;
+
+/* ========== 预设布局 ========== */
+static const struct {
+    const char *name;
+    mem_layout_t layout;
+} mem_presets[] = {
+    { "BALANCED", { 4096, 4096, 16384, 16384 } },
+    { "RX",       { 16384 / CDC_ACM_PORT_NUM, 2048 / CDC_ACM_PORT_NUM, 8192, 16384 } },
+    { "TX",       { CDC_RINGBUF_MIN_RX, 16384 / CDC_ACM_PORT_NUM, 8192, 16384 } },
+};
+
+/* ========== Flash 记录 ========== */
+#define MEM_LAYOUT_MAGIC    0x4C4D454DUL    // "MEML"
+#define MEM_LAYOUT_ERASED   0xFFFFFFFFUL
+
+typedef struct {
+    uint32_t magic;
+    mem_layout_t layout;
+    uint32_t reserved[2];
+    uint32_t crc;           // 前面所有字段的 CRC
+} mem_layout_record_t;
+
+#define MEM_LAYOUT_SLOTS    (MEM_LAYOUT_FLASH_SIZE / sizeof(mem_layout_record_t))
+
+static inline const mem_layout_record_t *mem_layout_slot(uint32_t i)
+{
+    return (const mem_layout_record_t *)(MEM_LAYOUT_FLASH_ADDR + i * sizeof(mem_layout_record_t));
+}
+
+static bool mem_layout_record_valid(const mem_layout_record_t *r)
+{
+    return r->magic == MEM_LAYOUT_MAGIC &&
+           r->crc == crc32_calc(r, offsetof(mem_layout_record_t, crc));
+}
+
+/* 第一个未写过的位置，扇区已满返回 MEM_LAYOUT_SLOTS */
+static uint32_t mem_layout_find_free(void)
+{
+    uint32_t i = MEM_LAYOUT_SLOTS;
+
+    // 记录只会追加，从后往前找到最后一条写过的
+    while (i > 0 && mem_layout_slot(i - 1)->magic == MEM_LAYOUT_ERASED) {
+        i--;
+    }
+    return i;
+}
+
+/* ========== 内存池 API ========== */
+void mem_arena_reset(void)
+{
+    mem_arena_used = 0;
+}
+
+void *mem_arena_alloc(uint32_t size)
+{
+    uint32_t n = MEM_ALIGN_UP(size);
+    void *ptr;
+
+    if (size == 0 || n > MEM_ARENA_SIZE - mem_arena_used) {
+        return NULL;
+    }
+
+    ptr = &mem_arena_pool[mem_arena_used];
+    mem_arena_used += n;
+    return ptr;
+}
+
+uint32_t mem_arena_get_used(void)
+{
+    return mem_arena_used;
+}
+
+uint32_t mem_arena_get_size(void)
+{
+    return MEM_ARENA_SIZE;
+}
+
+/* ========== 布局 API ========== */
+const mem_layout_t *mem_layout_preset(const char *name)
+{
+    for (uint32_t i = 0; i < sizeof(mem_presets) / sizeof(mem_presets[0]); i++) {
+        if (strcmp(name, mem_presets[i].name) == 0) {
+            return &mem_presets[i].layout;
+        }
+    }
+    return NULL;
+}
+
+uint32_t mem_layout_get_total(const mem_layout_t *layout)
+{
+    // 各部分分开分配，每块都要对齐
+    return CDC_ACM_PORT_NUM * (MEM_ALIGN_UP(layout->cdc_rx) + MEM_ALIGN_UP(layout->cdc_tx)) +
+           2 * MEM_ALIGN_UP(layout->scrollback / 2) + MEM_ALIGN_UP(layout->file);
+}
+
+int mem_layout_check(const mem_layout_t *layout)
+{
+    uint32_t rx = layout->cdc_rx;
+    uint32_t tx = layout->cdc_tx;
+
+    if (rx < CDC_RINGBUF_MIN_RX || rx > CDC_RINGBUF_MAX || (rx & (rx - 1)) ||
+        tx < CDC_RINGBUF_MIN_TX || tx > CDC_RINGBUF_MAX || (tx & (tx - 1)) ||
+        layout->scrollback < MEM_LAYOUT_MIN_SCROLLBACK || layout->file < MEM_LAYOUT_MIN_FILE ||
+        layout->scrollback > MEM_ARENA_SIZE || layout->file > MEM_ARENA_SIZE) {
+        return -1;
+    }
+    if (mem_layout_get_total(layout) > MEM_ARENA_SIZE) {
+        return -2;
+    }
+    return 0;
+}
+
+int mem_layout_load(mem_layout_t *layout)
+{
+    // 掉电时写到一半的记录 CRC 不对，跳过它用前一条
+    for (uint32_t i = mem_layout_find_free(); i > 0; i--) {
+        const mem_layout_record_t *r = mem_layout_slot(i - 1);
+
+        if (mem_layout_record_valid(r)) {
+            if (mem_layout_check(&r->layout) != 0) {
+                return -1; // 端口数或内存池大小变了
+            }
+            *layout = r->layout;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int mem_layout_save(const mem_layout_t *layout)
+{
+    mem_layout_record_t rec = { 0 };
+    mem_layout_t current;
+    const uint32_t *src = (const uint32_t *)&rec;
+    uint32_t slot, addr;
+    HAL_StatusTypeDef ret = HAL_OK;
+
+    if (mem_layout_check(layout) != 0) {
+        return -1;
+    }
+    if (mem_layout_load(&current) == 0 && memcmp(&current, layout, sizeof(current)) == 0) {
+        return 0; // 不必要的写入只会消耗擦写次数
+    }
+
+    rec.magic = MEM_LAYOUT_MAGIC;
+    rec.layout = *layout;
+    rec.crc = crc32_calc(&rec, offsetof(mem_layout_record_t, crc));
+
+    HAL_FLASH_Unlock();
+    __HAL_FLASH_CLEAR_FLAG(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR |
+                           FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+    slot = mem_layout_find_free();
+    if (slot >= MEM_LAYOUT_SLOTS) {
+        FLASH_EraseInitTypeDef erase = {
+            .TypeErase = FLASH_TYPEERASE_SECTORS,
+            .Sector = FLASH_SECTOR_11,
+            .NbSectors = 1,
+            .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+        };
+        uint32_t sector_error;
+
+        ret = HAL_FLASHEx_Erase(&erase, &sector_error);
+        slot = 0;
+    }
+
+    addr = (uint32_t)(uintptr_t)mem_layout_slot(slot);
+    for (uint32_t i = 0; ret == HAL_OK && i < sizeof(rec) / 4; i++) {
+        ret = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, addr + i * 4, src[i]);
+    }
+
+    HAL_FLASH_Lock();
+
+    if (ret != HAL_OK || !mem_layout_record_valid(mem_layout_slot(slot))) {
+        return -2;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Variable-length record ringbuffer on top of chry_ringbuffer
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+#include "rec_ringbuffer.h"
+
+/* 长度头取这个值表示后面到缓冲区末尾都是填充 */
+#define REC_PAD          0xFFFFFFFFu
+
+#define REC_ALIGN(n)     (((n) + 3u) & ~3u)
+#define REC_SPAN(len)    REC_ALIGN(REC_RINGBUFFER_HDR_LEN + (len))
+
+static inline uint32_t *rec_hdr(rec_ringbuffer_t *r, uint32_t pos)
+{
+    return (uint32_t *)((uint8_t *)r->rb.pool + (pos & r->rb.mask));
+}
+
+/* pos 处是填充时跳到开头 */
+static inline uint32_t rec_skip_pad(rec_ringbuffer_t *r, uint32_t pos)
+{
+    if (pos != r->rb.in && *rec_hdr(r, pos) == REC_PAD) {
+        pos += r->rb.mask + 1 - (pos & r->rb.mask);
+    }
+    return pos;
+}
+
+/*****************************************************************************
+* @brief        init record ringbuffer
+*
+* @param[in]    r           record ringbuffer instance
+* @param[in]    pool        memory pool address, 4 byte aligned
+* @param[in]    size        memory size in byte, must be power of 2 !!!
+* @param[in]    max_count   records kept at most, 0 for no limit
+*
+* @retval int               0:Success -1:Error
+*****************************************************************************/
+int rec_ringbuffer_init(rec_ringbuffer_t *r, void *pool, uint32_t size, uint32_t max_count)
+{
+    if ((NULL == r) || ((uintptr_t)pool & 3) || (size < 4 * REC_RINGBUFFER_HDR_LEN)) {
+        return -1;
+    }
+
+    if (chry_ringbuffer_init(&r->rb, pool, size) != 0) {
+        return -1;
+    }
+
+    r->max_count = max_count;
+    rec_ringbuffer_reset(r);
+    return 0;
+}
+
+/*****************************************************************************
+* @brief        drop all records
+*****************************************************************************/
+void rec_ringbuffer_reset(rec_ringbuffer_t *r)
+{
+    chry_ringbuffer_reset(&r->rb);
+    r->count = 0;
+    r->last = 0;
+    r->reserved = 0;
+}
+
+uint32_t rec_ringbuffer_get_count(rec_ringbuffer_t *r)
+{
+    return r->count;
+}
+
+/*****************************************************************************
+* @brief        reserve contiguous space for one record, dropping the
+*               oldest records when needed
+*
+* @param[in]    r           record ringbuffer instance
+* @param[in]    max_len     record length upper bound in byte
+*
+* @retval void*             record data pointer, NULL if max_len is too large
+*****************************************************************************/
+void *rec_ringbuffer_reserve(rec_ringbuffer_t *r, uint32_t max_len)
+{
+    uint32_t size = r->rb.mask + 1;
+    uint32_t need = REC_SPAN(max_len);
+    uint32_t tail;
+
+    if (max_len == 0 || need > size / 2) {
+        return NULL;
+    }
+
+    for (;;) {
+        // 没有记录时从头开始，免得写填充
+        if (r->count == 0) {
+            chry_ringbuffer_reset(&r->rb);
+        }
+
+        // 末尾放不下时要连同末尾一起腾出来
+        tail = size - (r->rb.in & r->rb.mask);
+        if (chry_ringbuffer_get_free(&r->rb) >= (tail < need ? tail + need : need)) {
+            break;
+        }
+        rec_ringbuffer_drop_oldest(r);
+    }
+
+    if (tail < need) {
+        *rec_hdr(r, r->rb.in) = REC_PAD;
+        chry_ringbuffer_linear_write_done(&r->rb, tail);
+    }
+
+    r->reserved = max_len;
+    return rec_hdr(r, r->rb.in) + 1;
+}
+
+/*****************************************************************************
+* @brief        publish the reserved record
+*
+* @param[in]    r           record ringbuffer instance
+* @param[in]    len         actual record length, clipped to the reserved length
+*****************************************************************************/
+void rec_ringbuffer_commit(rec_ringbuffer_t *r, uint32_t len)
+{
+    if (r->reserved == 0) {
+        return;
+    }
+    if (len > r->reserved) {
+        len = r->reserved;
+    }
+
+    *rec_hdr(r, r->rb.in) = len;
+    r->last = r->rb.in;
+    chry_ringbuffer_linear_write_done(&r->rb, REC_SPAN(len));
+    r->reserved = 0;
+
+    if (++r->count > r->max_count && r->max_count) {
+        rec_ringbuffer_drop_oldest(r);
+    }
+}
+
+/*****************************************************************************
+* @brief        drop the oldest record
+*
+* @retval bool              false if there is no record
+*****************************************************************************/
+bool rec_ringbuffer_drop_oldest(rec_ringbuffer_t *r)
+{
+    uint32_t pos;
+
+    if (r->count == 0) {
+        return false;
+    }
+
+    pos = rec_skip_pad(r, r->rb.out);
+    r->rb.out = pos + REC_SPAN(*rec_hdr(r, pos));
+    r->count--;
+    return true;
+}
+
+/*****************************************************************************
+* @brief        newest record
+*
+* @param[out]   len         record length
+*
+* @retval void*             record data pointer, NULL if empty
+*****************************************************************************/
+void *rec_ringbuffer_last(rec_ringbuffer_t *r, uint32_t *len)
+{
+    if (r->count == 0) {
+        *len = 0;
+        return NULL;
+    }
+
+    *len = *rec_hdr(r, r->last);
+    return rec_hdr(r, r->last) + 1;
+}
+
+/*****************************************************************************
+* @brief        iterate records from oldest to newest
+*
+* @example
+*   uint32_t it = rec_ringbuffer_iter(r), len;
+*   char *line;
+*   while ((line = rec_ringbuffer_next(r, &it, &len)) != NULL) { ... }
+*****************************************************************************/
+uint32_t rec_ringbuffer_iter(rec_ringbuffer_t *r)
+{
+    return r->rb.out;
+}
+
+void *rec_ringbuffer_next(rec_ringbuffer_t *r, uint32_t *it, uint32_t *len)
+{
+    uint32_t pos = rec_skip_pad(r, *it);
+
+    if (pos == r->rb.in) {
+        *it = pos;
+        *len = 0;
+        return NULL;
+    }
+
+    *len = *rec_hdr(r, pos);
+    *it = pos + REC_SPAN(*len);
+    return rec_hdr(r, pos) + 1;
+}
@@ -0,0 +1,198 @@
+/*
+ * Cooperative Event-Driven Task Scheduler
+ */
+
+#include "task_sched.h"
+#include "stm32f4xx_hal.h"
+#include <stddef.h>
+
+static struct {
+    sched_task_t *tasks;
+    uint32_t num;
+    volatile uint32_t events;   // 已置位、还没被取走的事件
+
+    /* 当前运行的任务 */
+    uint32_t task_start_cyc;
+    uint32_t task_budget_cyc;
+
+    /* 统计窗口 */
+    uint32_t window_tick;
+    uint32_t awake_cyc;         // 上次醒来 (或上次结算) 时的 DWT 周期
+    uint64_t busy_cycles;       // 本窗口醒着的周期
+    uint32_t wakeups;
+    uint32_t runs;
+    sched_stats_t stats;
+} g_sched;
+
+static inline uint32_t sched_cyc_per_us(void)
+{
+    return SystemCoreClock / 1000000U;
+}
+
+static inline bool sched_tick_due(uint32_t now, uint32_t next)
+{
+    return (int32_t)(now - next) >= 0;
+}
+
+/* 有周期任务到期或有任务还没做完 */
+static bool sched_work_due(uint32_t now)
+{
+    for (uint32_t i = 0; i < g_sched.num; i++) {
+        sched_task_t *t = &g_sched.tasks[i];
+
+        if (t->pending || (t->period_ms && sched_tick_due(now, t->next_tick))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void sched_run_task(sched_task_t *t, uint32_t now)
+{
+    uint32_t cyc, us;
+
+    g_sched.task_start_cyc = DWT->CYCCNT;
+    g_sched.task_budget_cyc = t->budget_us ? t->budget_us * sched_cyc_per_us() : UINT32_MAX;
+
+    t->pending = t->fn();
+
+    cyc = DWT->CYCCNT - g_sched.task_start_cyc;
+    us = cyc / sched_cyc_per_us();
+
+    // 事件触发的运行也算一次周期运行，周期只保证最长间隔
+    t->next_tick = now + t->period_ms;
+    t->runs++;
+    t->total_cycles += cyc;
+    if (us > t->max_us) {
+        t->max_us = us;
+    }
+    if (t->budget_us && us > t->budget_us) {
+        t->overruns++;
+    }
+    g_sched.runs++;
+}
+
+static void sched_update_stats(uint32_t now)
+{
+    uint32_t elapsed = now - g_sched.window_tick;
+    uint32_t cyc;
+    uint64_t total;
+
+    if (elapsed < SCHED_STATS_WINDOW_MS) {
+        return;
+    }
+
+    cyc = DWT->CYCCNT;
+    g_sched.busy_cycles += cyc - g_sched.awake_cyc;
+    g_sched.awake_cyc = cyc;
+
+    total = (uint64_t)elapsed * (SystemCoreClock / 1000U);
+    g_sched.stats.load_pm = (uint16_t)(g_sched.busy_cycles >= total ? 1000U :
+                                       g_sched.busy_cycles * 1000U / total);
+    g_sched.stats.wakeups_per_s = g_sched.wakeups * 1000U / elapsed;
+    g_sched.stats.runs_per_s = g_sched.runs * 1000U / elapsed;
+
+    g_sched.window_tick = now;
+    g_sched.busy_cycles = 0;
+    g_sched.wakeups = 0;
+    g_sched.runs = 0;
+}
+
+/* 没有工作时睡眠到下一个中断 */
+static void sched_idle(void)
+{
+    uint32_t cyc;
+
+    // 关中断后再检查一次: 检查之后到达的中断保持挂起，WFI 会立即返回，不会丢事件
+    __disable_irq();
+    if (g_sched.events == 0 && !sched_work_due(HAL_GetTick())) {
+        cyc = DWT->CYCCNT;
+        g_sched.busy_cycles += cyc - g_sched.awake_cyc;
+        __DSB();
+        __WFI();
+        // 唤醒的中断在开中断之后才执行，它的时间计入醒着的时间
+        g_sched.awake_cyc = DWT->CYCCNT;
+        g_sched.wakeups++;
+        g_sched.stats.sleeps++;
+    }
+    __enable_irq();
+}
+
+/* ========== API ========== */
+void sched_init(sched_task_t *tasks, uint32_t num)
+{
+    uint32_t now = HAL_GetTick();
+
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    g_sched.tasks = tasks;
+    g_sched.num = num;
+    g_sched.events = 0;
+    for (uint32_t i = 0; i < num; i++) {
+        tasks[i].next_tick = now;
+        tasks[i].pending = false;
+    }
+    sched_reset_stats();
+
+    g_sched.window_tick = now;
+    g_sched.awake_cyc = DWT->CYCCNT;
+    g_sched.busy_cycles = 0;
+    g_sched.wakeups = 0;
+    g_sched.runs = 0;
+    g_sched.stats = (sched_stats_t){ 0 };
+}
+
+void sched_run(void)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t events = __atomic_exchange_n(&g_sched.events, 0, __ATOMIC_ACQUIRE);
+    bool busy = false;
+
+    for (uint32_t i = 0; i < g_sched.num; i++) {
+        sched_task_t *t = &g_sched.tasks[i];
+
+        if (t->pending || (t->events & events) ||
+            (t->period_ms && sched_tick_due(now, t->next_tick))) {
+            sched_run_task(t, now);
+            busy |= t->pending;
+        }
+    }
+
+    sched_update_stats(now);
+
+    if (!busy) {
+        sched_idle();
+    }
+}
+
+void sched_event_set(uint32_t events)
+{
+    __atomic_fetch_or(&g_sched.events, events, __ATOMIC_RELEASE);
+}
+
+bool sched_in_budget(void)
+{
+    return DWT->CYCCNT - g_sched.task_start_cyc < g_sched.task_budget_cyc;
+}
+
+void sched_get_stats(sched_stats_t *stats)
+{
+    *stats = g_sched.stats;
+}
+
+void sched_reset_stats(void)
+{
+    for (uint32_t i = 0; i < g_sched.num; i++) {
+        sched_task_t *t = &g_sched.tasks[i];
+
+        t->runs = 0;
+        t->overruns = 0;
+        t->max_us = 0;
+        t->total_cycles = 0;
+    }
+}
+
+const sched_task_t *sched_get_task(uint32_t index)
+{
+    return index < g_sched.num ? &g_sched.tasks[index] : NULL;
+}
@@ -0,0 +1,701 @@
+/*
+ * USB Mass Storage: read-only FAT12 volume synthesized on the fly
+ */
+
+#include "usb_msc_disk.h"
+#include "usbd_core.h"
+#include <string.h>
+#include <ctype.h>
+
+#if MSC_DISK_ENABLE
+
+#ifdef CONFIG_USB_HS
+#define MSC_DISK_MPS 512
+#else
+#define MSC_DISK_MPS 64
+#endif
+
+/* ========== 卷布局 ========== */
+/* 引导扇区 | FAT1 | FAT2 | 根目录 | 数据区，两份 FAT 内容相同 */
+#define FAT_SECTORS_PER_CLUSTER 8
+#define FAT_CLUSTER_SIZE        (FAT_SECTORS_PER_CLUSTER * MSC_DISK_SECTOR_SIZE)
+#define FAT_RESERVED_SECTORS    1
+#define FAT_NUM                 2
+#define FAT_SECTORS             4
+#define FAT_ROOT_ENTRIES        16
+#define FAT_ROOT_SECTORS        (FAT_ROOT_ENTRIES * 32 / MSC_DISK_SECTOR_SIZE)
+#define FAT_FIRST_ROOT          (FAT_RESERVED_SECTORS + FAT_NUM * FAT_SECTORS)
+#define FAT_FIRST_DATA          (FAT_FIRST_ROOT + FAT_ROOT_SECTORS)
+#define FAT_CLUSTER_COUNT       ((MSC_DISK_SECTORS - FAT_FIRST_DATA) / FAT_SECTORS_PER_CLUSTER)
+#define FAT_EOC                 0xFFF
+#define FAT_DATE                (((2024 - 1980) << 9) | (1 << 5) | 1) // 目录项日期固定为 2024-01-01
+#define FAT_VOLUME_LABEL        "TERMINAL   "
+
+/* 主机按簇数判断 FAT 类型，超过 4084 个簇会被当作 FAT16 */
+#if FAT_CLUSTER_COUNT >= 4085 || MSC_DISK_SECTORS > 0xFFFF
+#error "MSC_DISK_SECTORS too large for FAT12"
+#endif
+#if (FAT_CLUSTER_COUNT + 2) * 3 / 2 > FAT_SECTORS * MSC_DISK_SECTOR_SIZE
+#error "FAT_SECTORS too small for MSC_DISK_SECTORS"
+#endif
+#if MSC_DISK_MAX_FILES + 1 > FAT_ROOT_ENTRIES
+#error "MSC_DISK_MAX_FILES does not fit in the root directory"
+#endif
+
+/* ========== BOT / SCSI 定义 ========== */
+#define BOT_CBW_SIGNATURE       0x43425355UL // "USBC"
+#define BOT_CSW_SIGNATURE       0x53425355UL // "USBS"
+#define BOT_CBW_LEN             31
+#define BOT_CSW_LEN             13
+#define BOT_REQ_RESET           0xFF
+#define BOT_REQ_GET_MAX_LUN     0xFE
+#define BOT_CSW_PASSED          0x00
+#define BOT_CSW_FAILED          0x01
+
+#define SCSI_TEST_UNIT_READY    0x00
+#define SCSI_REQUEST_SENSE      0x03
+#define SCSI_INQUIRY            0x12
+#define SCSI_MODE_SENSE6        0x1A
+#define SCSI_START_STOP_UNIT    0x1B
+#define SCSI_PREVENT_ALLOW      0x1E
+#define SCSI_READ_FORMAT_CAP    0x23
+#define SCSI_READ_CAPACITY10    0x25
+#define SCSI_READ10             0x28
+#define SCSI_WRITE10            0x2A
+#define SCSI_VERIFY10           0x2F
+#define SCSI_SYNC_CACHE10       0x35
+#define SCSI_MODE_SENSE10       0x5A
+
+#define SENSE_ILLEGAL_REQUEST   0x05
+#define SENSE_UNIT_ATTENTION    0x06
+#define SENSE_DATA_PROTECT      0x07
+#define ASC_INVALID_COMMAND     0x20
+#define ASC_LBA_OUT_OF_RANGE    0x21
+#define ASC_INVALID_FIELD       0x24
+#define ASC_WRITE_PROTECTED     0x27
+#define ASC_MEDIUM_CHANGED      0x28
+
+typedef enum {
+    MSC_STAGE_CBW = 0,      // 等待命令块
+    MSC_STAGE_DATA_IN,      // 向主机发送数据
+    MSC_STAGE_DATA_OUT,     // 接收并丢弃主机数据 (只读卷)
+    MSC_STAGE_CSW,          // 发送状态块
+} msc_stage_t;
+
+typedef struct {
+    uint16_t first_cluster; // 0 表示空文件
+    uint16_t clusters;
+    uint32_t size;
+} msc_file_layout_t;
+
+static const uint8_t fat_boot_sector[62] = {
+    0xEB, 0x3C, 0x90,                       // 跳转指令
+    'M', 'S', 'D', 'O', 'S', '5', '.', '0',
+    WBVAL(MSC_DISK_SECTOR_SIZE),
+    FAT_SECTORS_PER_CLUSTER,
+    WBVAL(FAT_RESERVED_SECTORS),
+    FAT_NUM,
+    WBVAL(FAT_ROOT_ENTRIES),
+    WBVAL(MSC_DISK_SECTORS),
+    0xF8,                                   // 介质描述符: 固定磁盘
+    WBVAL(FAT_SECTORS),
+    WBVAL(63), WBVAL(255),                  // 每磁道扇区数, 磁头数 (仅为兼容)
+    0x00, 0x00, 0x00, 0x00,                 // 隐藏扇区
+    0x00, 0x00, 0x00, 0x00,                 // 32 位总扇区数 (未使用)
+    0x80, 0x00, 0x29,                       // 驱动器号, 保留, 扩展引导标记
+    0x01, 0x01, 0x24, 0x20,                 // 卷序列号
+    'T', 'E', 'R', 'M', 'I', 'N', 'A', 'L', ' ', ' ', ' ',
+    'F', 'A', 'T', '1', '2', ' ', ' ', ' ',
+};
+
+/* ========== 缓冲区和状态 ========== */
+/* 扇区和命令块共用一个缓冲区，同一时刻只有一个阶段在使用 */
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t msc_buf[MSC_DISK_SECTOR_SIZE];
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t msc_csw[16];
+
+static struct {
+    uint8_t busid;
+    volatile bool configured;
+    uint8_t stage;
+
+    /* 当前命令 */
+    uint32_t tag;
+    uint32_t residue;       // 主机期望但未传输的字节数
+    uint32_t out_left;      // 还要丢弃的主机数据
+    bool dir_in;
+    bool zlp;               // 数据短于主机期望且为包长整数倍，补一个 ZLP 结束数据阶段
+    uint8_t status;
+    uint32_t lba;           // READ(10) 下一个扇区
+    uint32_t sectors;       // READ(10) 剩余扇区
+
+    /* 上一条失败命令的 sense 数据 */
+    uint8_t sense_key;
+    uint8_t sense_asc;
+    bool unit_attention;    // 快照已更新，下一条命令报告介质变化
+
+    /* 文件和快照 */
+    const msc_disk_file_t *files[MSC_DISK_MAX_FILES];
+    char names[MSC_DISK_MAX_FILES][11];
+    volatile uint8_t file_num;
+    msc_file_layout_t layout[MSC_DISK_MAX_FILES];
+    uint8_t layout_num;
+    bool layout_valid;
+    volatile bool refresh_req;
+} g_msc;
+
+static void msc_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes);
+static void msc_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes);
+static int msc_class_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len);
+static void msc_notify(uint8_t busid, uint8_t event, void *arg);
+
+static struct usbd_interface msc_intf = {
+    .class_interface_handler = msc_class_request,
+    .notify_handler = msc_notify,
+};
+
+static struct usbd_endpoint msc_out_ep = {
+    .ep_addr = MSC_DISK_OUT_EP,
+    .ep_cb = msc_bulk_out
+};
+
+static struct usbd_endpoint msc_in_ep = {
+    .ep_addr = MSC_DISK_IN_EP,
+    .ep_cb = msc_bulk_in
+};
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+    put_le16(p, (uint16_t)v);
+    put_le16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void put_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static uint32_t get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t get_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+/* ========== 快照 ========== */
+/* "rx_log.txt" -> "RX_LOG  TXT" */
+static void msc_name83(char dst[11], const char *name)
+{
+    uint8_t i = 0;
+
+    memset(dst, ' ', 11);
+    while (*name && *name != '.' && i < 8) {
+        dst[i++] = (char)toupper((unsigned char)*name++);
+    }
+    while (*name && *name != '.') {
+        name++;
+    }
+    if (*name == '.') {
+        name++;
+        for (i = 8; *name && i < 11; name++) {
+            dst[i++] = (char)toupper((unsigned char)*name);
+        }
+    }
+}
+
+/* 冻结所有文件的大小，文件在数据区中按注册顺序连续存放 */
+static void msc_take_snapshot(void)
+{
+    uint32_t next = 2;
+
+    g_msc.refresh_req = false;
+    g_msc.layout_num = __atomic_load_n(&g_msc.file_num, __ATOMIC_ACQUIRE);
+
+    for (uint8_t i = 0; i < g_msc.layout_num; i++) {
+        const msc_disk_file_t *f = g_msc.files[i];
+        msc_file_layout_t *l = &g_msc.layout[i];
+        uint32_t size = f->snapshot(f->ctx);
+        uint32_t clusters = (size + FAT_CLUSTER_SIZE - 1) / FAT_CLUSTER_SIZE;
+        uint32_t free_clusters = FAT_CLUSTER_COUNT + 2 - next;
+
+        if (clusters > free_clusters) {
+            // 卷空间不足，截断文件
+            clusters = free_clusters;
+            size = clusters * FAT_CLUSTER_SIZE;
+        }
+        l->first_cluster = clusters ? (uint16_t)next : 0;
+        l->clusters = (uint16_t)clusters;
+        l->size = size;
+        next += clusters;
+    }
+
+    // 第一次快照是主机初次看到的内容，不需要报告变化
+    if (g_msc.layout_valid) {
+        g_msc.unit_attention = true;
+    }
+    g_msc.layout_valid = true;
+}
+
+/* ========== 扇区生成 ========== */
+static uint16_t fat_entry(uint32_t cluster)
+{
+    if (cluster < 2) {
+        return cluster == 0 ? 0xFF8 : 0xFFF; // 介质描述符, 保留项
+    }
+
+    for (uint8_t i = 0; i < g_msc.layout_num; i++) {
+        const msc_file_layout_t *l = &g_msc.layout[i];
+        uint32_t end = (uint32_t)l->first_cluster + l->clusters;
+
+        if (l->clusters && cluster >= l->first_cluster && cluster < end) {
+            return cluster + 1 < end ? (uint16_t)(cluster + 1) : FAT_EOC;
+        }
+    }
+    return 0; // 空闲
+}
+
+/* FAT12 每 3 字节存放 2 个 12 位表项 */
+static void fat_build_fat(uint8_t *buf, uint32_t sector)
+{
+    uint32_t off = sector * MSC_DISK_SECTOR_SIZE;
+
+    for (uint32_t i = 0; i < MSC_DISK_SECTOR_SIZE; i++, off++) {
+        uint32_t n = off / 3 * 2;
+
+        switch (off % 3) {
+            case 0:
+                buf[i] = (uint8_t)fat_entry(n);
+                break;
+            case 1:
+                buf[i] = (uint8_t)((fat_entry(n) >> 8) | (fat_entry(n + 1) << 4));
+                break;
+            default:
+                buf[i] = (uint8_t)(fat_entry(n + 1) >> 4);
+                break;
+        }
+    }
+}
+
+static void fat_build_root(uint8_t *buf)
+{
+    uint8_t *e = buf;
+
+    memcpy(e, FAT_VOLUME_LABEL, 11);
+    e[11] = 0x08; // 卷标
+    put_le16(&e[24], FAT_DATE);
+    e += 32;
+
+    for (uint8_t i = 0; i < g_msc.layout_num; i++, e += 32) {
+        const msc_file_layout_t *l = &g_msc.layout[i];
+
+        memcpy(e, g_msc.names[i], 11);
+        e[11] = 0x01; // 只读
+        put_le16(&e[16], FAT_DATE); // 创建日期
+        put_le16(&e[18], FAT_DATE); // 访问日期
+        put_le16(&e[24], FAT_DATE); // 修改日期
+        put_le16(&e[26], l->first_cluster);
+        put_le32(&e[28], l->size);
+    }
+}
+
+/* 数据区扇区直接由文件的读回调填充 */
+static void fat_build_data(uint8_t *buf, uint32_t sector)
+{
+    uint32_t cluster = 2 + sector / FAT_SECTORS_PER_CLUSTER;
+
+    for (uint8_t i = 0; i < g_msc.layout_num; i++) {
+        const msc_file_layout_t *l = &g_msc.layout[i];
+
+        if (l->clusters && cluster >= l->first_cluster && cluster < (uint32_t)l->first_cluster + l->clusters) {
+            uint32_t offset = (cluster - l->first_cluster) * FAT_CLUSTER_SIZE +
+                              (sector % FAT_SECTORS_PER_CLUSTER) * MSC_DISK_SECTOR_SIZE;
+            if (offset < l->size) {
+                uint32_t len = l->size - offset;
+                g_msc.files[i]->read(g_msc.files[i]->ctx, offset, buf,
+                                     len < MSC_DISK_SECTOR_SIZE ? len : MSC_DISK_SECTOR_SIZE);
+            }
+            return;
+        }
+    }
+}
+
+static void fat_build_sector(uint8_t *buf, uint32_t lba)
+{
+    memset(buf, 0, MSC_DISK_SECTOR_SIZE);
+
+    if (lba < FAT_RESERVED_SECTORS) {
+        memcpy(buf, fat_boot_sector, sizeof(fat_boot_sector));
+        buf[510] = 0x55;
+        buf[511] = 0xAA;
+    } else if (lba < FAT_FIRST_ROOT) {
+        fat_build_fat(buf, (lba - FAT_RESERVED_SECTORS) % FAT_SECTORS);
+    } else if (lba < FAT_FIRST_DATA) {
+        fat_build_root(buf);
+    } else {
+        fat_build_data(buf, lba - FAT_FIRST_DATA);
+    }
+}
+
+/* ========== BOT 传输 ========== */
+static void msc_start_cbw(void)
+{
+    g_msc.stage = MSC_STAGE_CBW;
+    usbd_ep_start_read(g_msc.busid, MSC_DISK_OUT_EP, msc_buf, MSC_DISK_MPS);
+}
+
+static void msc_send_csw(void)
+{
+    put_le32(&msc_csw[0], BOT_CSW_SIGNATURE);
+    put_le32(&msc_csw[4], g_msc.tag);
+    put_le32(&msc_csw[8], g_msc.residue);
+    msc_csw[12] = g_msc.status;
+
+    g_msc.stage = MSC_STAGE_CSW;
+    usbd_ep_start_write(g_msc.busid, MSC_DISK_IN_EP, msc_csw, BOT_CSW_LEN);
+}
+
+/* 发送 msc_buf 中的应答，超出主机期望长度的部分被截掉 */
+static void msc_send_data(uint32_t len)
+{
+    if (len > g_msc.residue) {
+        len = g_msc.residue;
+    }
+    if (len == 0) {
+        msc_send_csw();
+        return;
+    }
+
+    g_msc.residue -= len;
+    g_msc.zlp = g_msc.residue != 0 && (len % MSC_DISK_MPS) == 0;
+    g_msc.stage = MSC_STAGE_DATA_IN;
+    usbd_ep_start_write(g_msc.busid, MSC_DISK_IN_EP, msc_buf, len);
+}
+
+static void msc_read_next(void)
+{
+    fat_build_sector(msc_buf, g_msc.lba);
+    g_msc.lba++;
+    g_msc.sectors--;
+    msc_send_data(MSC_DISK_SECTOR_SIZE);
+}
+
+static void msc_discard_out(void)
+{
+    uint32_t len = g_msc.out_left < MSC_DISK_SECTOR_SIZE ? g_msc.out_left : MSC_DISK_SECTOR_SIZE;
+
+    g_msc.stage = MSC_STAGE_DATA_OUT;
+    usbd_ep_start_read(g_msc.busid, MSC_DISK_OUT_EP, msc_buf, len);
+}
+
+/*
+ * 命令失败：记录 sense，主机随后用 REQUEST SENSE 读取原因
+ * 主机期望的数据阶段不用 STALL 结束：IN 方向发 ZLP，OUT 方向收下并丢弃
+ */
+static void msc_fail(uint8_t key, uint8_t asc)
+{
+    g_msc.sense_key = key;
+    g_msc.sense_asc = asc;
+    g_msc.status = BOT_CSW_FAILED;
+
+    if (g_msc.residue == 0) {
+        msc_send_csw();
+    } else if (g_msc.dir_in) {
+        g_msc.stage = MSC_STAGE_DATA_IN;
+        usbd_ep_start_write(g_msc.busid, MSC_DISK_IN_EP, NULL, 0);
+    } else {
+        g_msc.out_left = g_msc.residue;
+        msc_discard_out();
+    }
+}
+
+/* ========== SCSI 命令 ========== */
+static void scsi_inquiry(const uint8_t *cb)
+{
+    static const char vendor[] = CONFIG_USBDEV_MSC_MANUFACTURER_STRING;
+    static const char product[] = CONFIG_USBDEV_MSC_PRODUCT_STRING;
+    static const char version[] = CONFIG_USBDEV_MSC_VERSION_STRING;
+
+    if (cb[1] & 0x01) {
+        msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD); // 不支持 VPD 页
+        return;
+    }
+
+    memset(msc_buf, ' ', 36);
+    msc_buf[0] = 0x00; // 直接访问设备
+    msc_buf[1] = 0x80; // 可移动介质
+    msc_buf[2] = 0x02; // SPC-2
+    msc_buf[3] = 0x02;
+    msc_buf[4] = 36 - 5;
+    msc_buf[5] = 0x00;
+    msc_buf[6] = 0x00;
+    msc_buf[7] = 0x00;
+    memcpy(&msc_buf[8], vendor, sizeof(vendor) - 1 < 8 ? sizeof(vendor) - 1 : 8);
+    memcpy(&msc_buf[16], product, sizeof(product) - 1 < 16 ? sizeof(product) - 1 : 16);
+    memcpy(&msc_buf[32], version, sizeof(version) - 1 < 4 ? sizeof(version) - 1 : 4);
+    msc_send_data(36);
+}
+
+static void scsi_read10(const uint8_t *cb)
+{
+    uint32_t lba = get_be32(&cb[2]);
+    uint32_t count = ((uint32_t)cb[7] << 8) | cb[8];
+
+    if (lba >= MSC_DISK_SECTORS || count > MSC_DISK_SECTORS - lba) {
+        msc_fail(SENSE_ILLEGAL_REQUEST, ASC_LBA_OUT_OF_RANGE);
+        return;
+    }
+    if (!g_msc.dir_in && g_msc.residue) {
+        msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_FIELD);
+        return;
+    }
+
+    // 主机给的数据长度不够时只发能容纳的整扇区，剩余部分记入 residue
+    if (count > g_msc.residue / MSC_DISK_SECTOR_SIZE) {
+        count = g_msc.residue / MSC_DISK_SECTOR_SIZE;
+    }
+    if (count == 0) {
+        msc_send_csw();
+        return;
+    }
+
+    g_msc.lba = lba;
+    g_msc.sectors = count;
+    msc_read_next();
+}
+
+static void msc_handle_cbw(uint32_t nbytes)
+{
+    uint8_t cb[16];
+
+    if (nbytes != BOT_CBW_LEN || get_le32(msc_buf) != BOT_CBW_SIGNATURE) {
+        // 无效命令块：规范要求 STALL 后由主机复位恢复，主机实际不会发出，这里直接忽略
+        msc_start_cbw();
+        return;
+    }
+
+    g_msc.tag = get_le32(&msc_buf[4]);
+    g_msc.residue = get_le32(&msc_buf[8]);
+    g_msc.dir_in = (msc_buf[12] & 0x80) != 0;
+    g_msc.status = BOT_CSW_PASSED;
+    g_msc.sectors = 0;
+    g_msc.zlp = false;
+    memcpy(cb, &msc_buf[15], sizeof(cb)); // 应答会覆盖 msc_buf
+
+    if (g_msc.refresh_req) {
+        msc_take_snapshot();
+    }
+
+    // 介质变化只报告一次，INQUIRY 和 REQUEST SENSE 不受影响
+    if (g_msc.unit_attention && cb[0] != SCSI_INQUIRY && cb[0] != SCSI_REQUEST_SENSE) {
+        g_msc.unit_attention = false;
+        msc_fail(SENSE_UNIT_ATTENTION, ASC_MEDIUM_CHANGED);
+        return;
+    }
+
+    switch (cb[0]) {
+        case SCSI_TEST_UNIT_READY:
+        case SCSI_PREVENT_ALLOW:
+        case SCSI_START_STOP_UNIT:
+        case SCSI_VERIFY10:
+        case SCSI_SYNC_CACHE10:
+            msc_send_csw();
+            break;
+
+        case SCSI_REQUEST_SENSE:
+            memset(msc_buf, 0, 18);
+            msc_buf[0] = 0x70; // 当前错误，固定格式
+            msc_buf[2] = g_msc.sense_key;
+            msc_buf[7] = 18 - 8;
+            msc_buf[12] = g_msc.sense_asc;
+            g_msc.sense_key = 0;
+            g_msc.sense_asc = 0;
+            msc_send_data(18);
+            break;
+
+        case SCSI_INQUIRY:
+            scsi_inquiry(cb);
+            break;
+
+        case SCSI_MODE_SENSE6:
+            // 只有模式参数头，设备参数 bit7 = 写保护
+            msc_buf[0] = 3;
+            msc_buf[1] = 0x00;
+            msc_buf[2] = 0x80;
+            msc_buf[3] = 0x00;
+            msc_send_data(4);
+            break;
+
+        case SCSI_MODE_SENSE10:
+            memset(msc_buf, 0, 8);
+            msc_buf[1] = 6;
+            msc_buf[3] = 0x80;
+            msc_send_data(8);
+            break;
+
+        case SCSI_READ_FORMAT_CAP:
+            memset(msc_buf, 0, 12);
+            msc_buf[3] = 8; // 容量列表长度
+            put_be32(&msc_buf[4], MSC_DISK_SECTORS);
+            put_be32(&msc_buf[8], MSC_DISK_SECTOR_SIZE);
+            msc_buf[8] = 0x02; // 已格式化介质
+            msc_send_data(12);
+            break;
+
+        case SCSI_READ_CAPACITY10:
+            put_be32(&msc_buf[0], MSC_DISK_SECTORS - 1);
+            put_be32(&msc_buf[4], MSC_DISK_SECTOR_SIZE);
+            msc_send_data(8);
+            break;
+
+        case SCSI_READ10:
+            scsi_read10(cb);
+            break;
+
+        case SCSI_WRITE10:
+            msc_fail(SENSE_DATA_PROTECT, ASC_WRITE_PROTECTED);
+            break;
+
+        default:
+            msc_fail(SENSE_ILLEGAL_REQUEST, ASC_INVALID_COMMAND);
+            break;
+    }
+}
+
+/* ========== USB回调 ========== */
+static void msc_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes)
+{
+    switch (g_msc.stage) {
+        case MSC_STAGE_CBW:
+            msc_handle_cbw(nbytes);
+            break;
+
+        case MSC_STAGE_DATA_OUT: {
+            uint32_t expect = g_msc.out_left < MSC_DISK_SECTOR_SIZE ? g_msc.out_left : MSC_DISK_SECTOR_SIZE;
+
+            g_msc.out_left -= nbytes < g_msc.out_left ? nbytes : g_msc.out_left;
+            // 短包表示主机提前结束了数据阶段
+            if (g_msc.out_left && nbytes == expect) {
+                msc_discard_out();
+            } else {
+                msc_send_csw();
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void msc_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes)
+{
+    switch (g_msc.stage) {
+        case MSC_STAGE_DATA_IN:
+            if (g_msc.sectors) {
+                msc_read_next();
+            } else if (g_msc.zlp) {
+                g_msc.zlp = false;
+                usbd_ep_start_write(busid, ep, NULL, 0);
+            } else {
+                msc_send_csw();
+            }
+            break;
+
+        case MSC_STAGE_CSW:
+            msc_start_cbw();
+            break;
+
+        default:
+            break;
+    }
+}
+
+static int msc_class_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len)
+{
+    switch (setup->bRequest) {
+        case BOT_REQ_RESET:
+            g_msc.sectors = 0;
+            g_msc.zlp = false;
+            msc_start_cbw();
+            break;
+
+        case BOT_REQ_GET_MAX_LUN:
+            (*data)[0] = 0; // 只有 LUN 0
+            *len = 1;
+            break;
+
+        default:
+            return -1;
+    }
+    return 0;
+}
+
+static void msc_notify(uint8_t busid, uint8_t event, void *arg)
+{
+    switch (event) {
+        case USBD_EVENT_RESET:
+            g_msc.configured = false;
+            break;
+
+        case USBD_EVENT_CONFIGURED:
+            g_msc.configured = true;
+            g_msc.sectors = 0;
+            g_msc.zlp = false;
+            msc_start_cbw();
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* ========== 初始化 ========== */
+void msc_disk_add_interface(uint8_t busid)
+{
+    g_msc.busid = busid;
+    g_msc.configured = false;
+    g_msc.refresh_req = true;
+
+    usbd_add_interface(busid, &msc_intf);
+    usbd_add_endpoint(busid, &msc_out_ep);
+    usbd_add_endpoint(busid, &msc_in_ep);
+}
+
+/* ========== API ========== */
+int msc_disk_register_file(const msc_disk_file_t *file)
+{
+    uint8_t n = g_msc.file_num;
+
+    if (n >= MSC_DISK_MAX_FILES) {
+        return -1;
+    }
+
+    msc_name83(g_msc.names[n], file->name);
+    g_msc.files[n] = file;
+    __atomic_store_n(&g_msc.file_num, n + 1, __ATOMIC_RELEASE);
+    g_msc.refresh_req = true;
+    return 0;
+}
+
+void msc_disk_refresh(void)
+{
+    g_msc.refresh_req = true;
+}
+
+bool msc_disk_is_configured(void)
+{
+    return g_msc.configured;
+}
+
+#endif /* MSC_DISK_ENABLE */
@@ -0,0 +1,407 @@
+/*
+ * USB CDC ACM <-> USART1 Bridge
+ */
+
+#include "usb_uart_bridge.h"
+#include "lf_ringbuffer.h"
+#include "usart.h"
+#include <string.h>
+
+#define BRIDGE_PORT CDC_ACM_PORT_DEFAULT
+#define BRIDGE_RX_HALF (UART_BRIDGE_RX_DMA_SIZE / 2)
+
+static uint8_t bridge_rx_dma_buf[UART_BRIDGE_RX_DMA_SIZE];
+// CDC 缓冲区可能在 CCM (mem_arena), DMA2 访问不到, 发送经这里中转 (普通 .bss 在 SRAM)
+static uint8_t bridge_tx_dma_buf[UART_BRIDGE_TX_DMA_SIZE];
+static uint8_t bridge_mon_pool[UART_BRIDGE_MON_SIZE];
+
+static struct {
+    volatile bool active;
+    volatile bool coding_pending;      // 主机设置了新的串口参数，等待主循环应用
+    volatile bool rx_restart;          // 接收因错误停止，等待主循环重启
+    cdc_acm_line_coding_t coding;      // 主机最近一次设置的参数 (USB中断写)
+    cdc_acm_line_coding_t applied;     // 当前生效的参数
+    volatile bool rx_busy;             // UART -> USB 搬运占用 (中断和主循环互斥)
+    volatile bool tx_busy;             // UART DMA 发送占用，占有者是 CDC 接收缓冲区的消费者
+    uint32_t rx_tail;                  // DMA 接收缓冲区中下一个待搬运的位置
+    volatile uint32_t rx_half_events;  // DMA 半满/全满中断次数 (中断里累加)
+    uint32_t rx_half_seen;             // rx_tail 走过的半缓冲区边界数，与上面对账发现套圈
+    volatile uint32_t tx_len;          // 当前 DMA 发送中的字节数 (已从 CDC 接收缓冲区取出)
+    volatile uint32_t uart_to_usb;
+    volatile uint32_t usb_to_uart;
+    volatile uint32_t dropped;
+    volatile uint32_t uart_errors;
+    lf_mpsc_ringbuffer_t mon;          // 监视记录: [方向|长度] + 数据
+} g_bridge;
+
+/* ========== 互斥 ========== */
+static bool bridge_claim(volatile bool *busy)
+{
+    return !__atomic_exchange_n(busy, true, __ATOMIC_ACQUIRE);
+}
+
+static void bridge_release(volatile bool *busy)
+{
+    __atomic_store_n(busy, false, __ATOMIC_RELEASE);
+}
+
+/* ========== 监视记录 ========== */
+static void bridge_monitor(bool to_host, const uint8_t *data, uint32_t len)
+{
+    uint8_t hdr;
+    int32_t pos;
+
+    if (len > UART_BRIDGE_MON_CHUNK) {
+        len = UART_BRIDGE_MON_CHUNK;
+    }
+
+    // 显示跟不上时直接丢弃记录，不影响数据通路
+    pos = lf_mpsc_ringbuffer_reserve(&g_bridge.mon, len + 1);
+    if (pos < 0) {
+        return;
+    }
+
+    hdr = (uint8_t)((to_host ? 0x80 : 0x00) | len);
+    lf_mpsc_ringbuffer_fill(&g_bridge.mon, (uint32_t)pos, &hdr, 1);
+    lf_mpsc_ringbuffer_fill(&g_bridge.mon, (uint32_t)pos + 1, data, len);
+    lf_mpsc_ringbuffer_commit(&g_bridge.mon);
+}
+
+/* ========== UART -> USB ========== */
+/* 从 from 前进 len 字节跨过的半缓冲区边界数，即 DMA 写过这段时应有的 HT/TC 中断数 */
+static uint32_t bridge_rx_halves(uint32_t from, uint32_t len)
+{
+    return (from % BRIDGE_RX_HALF + len) / BRIDGE_RX_HALF;
+}
+
+/* rx_tail 前进 n 字节 (已搬运或丢弃) */
+static void bridge_rx_advance(uint32_t n)
+{
+    g_bridge.rx_half_seen += bridge_rx_halves(g_bridge.rx_tail, n);
+    g_bridge.rx_tail = (g_bridge.rx_tail + n) % UART_BRIDGE_RX_DMA_SIZE;
+}
+
+/* 把 DMA 已写入的数据搬到 CDC 发送缓冲区，调用者需持有 rx_busy */
+static void bridge_rx_drain(void)
+{
+    // 先取中断计数再读 DMA 位置：中断若还没来得及执行只会少计，不会误判套圈
+    uint32_t events = __atomic_load_n(&g_bridge.rx_half_events, __ATOMIC_ACQUIRE);
+    uint32_t head = UART_BRIDGE_RX_DMA_SIZE - __HAL_DMA_GET_COUNTER(huart1.hdmarx);
+    uint32_t pending;
+    int32_t extra;
+
+    if (head >= UART_BRIDGE_RX_DMA_SIZE) {
+        head = 0;
+    }
+    pending = (head + UART_BRIDGE_RX_DMA_SIZE - g_bridge.rx_tail) % UART_BRIDGE_RX_DMA_SIZE;
+
+    // 发送缓冲区长时间满着时 DMA 会追上并覆盖 rx_tail 处未搬运的数据，
+    // 只看位置差分不出来，靠 HT/TC 中断数对账: 多出来的边界说明至少套了一圈。
+    // 这时缓冲区里的旧数据已经被改写，整段丢弃，从 DMA 当前位置重新开始
+    extra = (int32_t)(events - g_bridge.rx_half_seen - bridge_rx_halves(g_bridge.rx_tail, pending));
+    if (extra > 0) {
+        uint32_t laps = ((uint32_t)extra + 1) / 2;
+        g_bridge.dropped += pending + laps * UART_BRIDGE_RX_DMA_SIZE;
+        bridge_rx_advance(pending);
+        g_bridge.rx_half_seen += laps * 2;
+        return;
+    }
+
+    // 主机没有打开端口：数据无处可去，直接丢弃，避免 DMA 回绕后发出错乱的旧数据
+    if (!cdc_acm_port_is_open(BRIDGE_PORT)) {
+        g_bridge.dropped += pending;
+        bridge_rx_advance(pending);
+        return;
+    }
+
+    while (g_bridge.rx_tail != head) {
+        uint32_t tail = g_bridge.rx_tail;
+        uint32_t n = ((head > tail) ? head : UART_BRIDGE_RX_DMA_SIZE) - tail;
+        uint32_t space = cdc_acm_port_get_tx_free(BRIDGE_PORT);
+
+        if (n > space) {
+            n = space;
+        }
+        // 发送缓冲区满时剩余数据留在 DMA 缓冲区，发送完成后由主循环继续搬运
+        if (n == 0 || cdc_acm_port_send_data(BRIDGE_PORT, &bridge_rx_dma_buf[tail], n) <= 0) {
+            break;
+        }
+
+        bridge_monitor(true, &bridge_rx_dma_buf[tail], n);
+        g_bridge.uart_to_usb += n;
+        bridge_rx_advance(n);
+    }
+}
+
+static void bridge_uart_to_usb(void)
+{
+    if (!bridge_claim(&g_bridge.rx_busy)) {
+        return;
+    }
+    bridge_rx_drain();
+    bridge_release(&g_bridge.rx_busy);
+}
+
+/* 调用者需持有 rx_busy */
+static void bridge_rx_start(void)
+{
+    g_bridge.rx_tail = 0;
+    g_bridge.rx_half_seen = __atomic_load_n(&g_bridge.rx_half_events, __ATOMIC_ACQUIRE);
+    HAL_UARTEx_ReceiveToIdle_DMA(&huart1, bridge_rx_dma_buf, UART_BRIDGE_RX_DMA_SIZE);
+}
+
+/* ========== USB -> UART ========== */
+static void bridge_usb_to_uart(void)
+{
+    uint32_t size;
+    uint8_t *ptr;
+
+    // 等待应用新的串口参数期间不再启动发送
+    if (g_bridge.coding_pending || !bridge_claim(&g_bridge.tx_busy)) {
+        return;
+    }
+
+    ptr = cdc_acm_linear_read_setup(&size);
+    if (size > UART_BRIDGE_TX_DMA_SIZE) {
+        size = UART_BRIDGE_TX_DMA_SIZE;
+    }
+
+    // 复制到 SRAM 中转缓冲区再发送，DMA 启动成功后才释放 CDC 接收缓冲区的空间
+    if (size > 0) {
+        memcpy(bridge_tx_dma_buf, ptr, size);
+    }
+    if (size == 0 || HAL_UART_Transmit_DMA(&huart1, bridge_tx_dma_buf, (uint16_t)size) != HAL_OK) {
+        bridge_release(&g_bridge.tx_busy);
+        return;
+    }
+
+    cdc_acm_linear_read_done(size);
+    g_bridge.tx_len = size;
+    bridge_monitor(false, bridge_tx_dma_buf, size);
+}
+
+/* ========== 串口参数 ========== */
+/* USB中断上下文：只记录参数 */
+static void bridge_line_coding_cb(uint8_t port, const cdc_acm_line_coding_t *line_coding)
+{
+    (void)port;
+
+    g_bridge.coding = *line_coding;
+    __atomic_store_n(&g_bridge.coding_pending, true, __ATOMIC_RELEASE);
+}
+
+/*
+ * CDC 参数映射到 USART:
+ * - STM32 的字长包含校验位，8位数据+校验 = 9B，7位数据+校验 = 8B
+ * - 不支持的组合 (5/6/7 位无校验、Mark/Space 校验) 退化为 8 位无校验
+ * - 1.5 停止位按 2 位处理
+ */
+static void bridge_uart_config(const cdc_acm_line_coding_t *lc)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+    uint32_t baud = lc->baudrate ? lc->baudrate : 115200;
+
+    if (baud > pclk / 8) {
+        baud = pclk / 8;
+    }
+
+    huart1.Init.BaudRate = baud;
+    huart1.Init.OverSampling = (baud > pclk / 16) ? UART_OVERSAMPLING_8 : UART_OVERSAMPLING_16;
+    huart1.Init.StopBits = (lc->stopbits == 0) ? UART_STOPBITS_1 : UART_STOPBITS_2;
+
+    switch (lc->parity) {
+        case 1:
+            huart1.Init.Parity = UART_PARITY_ODD;
+            break;
+        case 2:
+            huart1.Init.Parity = UART_PARITY_EVEN;
+            break;
+        default:
+            huart1.Init.Parity = UART_PARITY_NONE;
+            break;
+    }
+
+    if (huart1.Init.Parity != UART_PARITY_NONE && lc->databits == 8) {
+        huart1.Init.WordLength = UART_WORDLENGTH_9B;
+    } else if (huart1.Init.Parity != UART_PARITY_NONE && lc->databits == 7) {
+        huart1.Init.WordLength = UART_WORDLENGTH_8B;
+    } else {
+        huart1.Init.Parity = UART_PARITY_NONE;
+        huart1.Init.WordLength = UART_WORDLENGTH_8B;
+    }
+
+    HAL_UART_Init(&huart1);
+}
+
+/* 重新配置 USART1，需要同时持有收发两个方向 */
+static bool bridge_apply_line_coding(void)
+{
+    if (!bridge_claim(&g_bridge.tx_busy)) {
+        return false; // 等待当前发送完成
+    }
+    if (!bridge_claim(&g_bridge.rx_busy)) {
+        bridge_release(&g_bridge.tx_busy);
+        return false;
+    }
+
+    // 先清除标志再取参数，期间主机再次设置会重新置位
+    __atomic_store_n(&g_bridge.coding_pending, false, __ATOMIC_RELEASE);
+    g_bridge.applied = g_bridge.coding;
+
+    bridge_rx_drain();
+    HAL_UART_AbortReceive(&huart1);
+    bridge_uart_config(&g_bridge.applied);
+    g_bridge.rx_restart = false;
+    bridge_rx_start();
+
+    bridge_release(&g_bridge.rx_busy);
+    bridge_release(&g_bridge.tx_busy);
+    return true;
+}
+
+/* ========== HAL 回调 (中断上下文) ========== */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+    (void)Size; // 以 DMA 计数器为准，主循环补搬时也用同一来源
+
+    if (huart == &huart1 && g_bridge.active) {
+        // 主循环正在搬运时这里搬不了，但计数照记，供套圈检测
+        if (HAL_UARTEx_GetRxEventType(huart) != HAL_UART_RXEVENT_IDLE) {
+            __atomic_fetch_add(&g_bridge.rx_half_events, 1, __ATOMIC_RELEASE);
+        }
+        bridge_uart_to_usb();
+    }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != &huart1 || !g_bridge.active) {
+        return;
+    }
+
+    g_bridge.usb_to_uart += g_bridge.tx_len;
+    g_bridge.tx_len = 0;
+    bridge_release(&g_bridge.tx_busy);
+
+    bridge_usb_to_uart();
+}
+
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    if (huart != &huart1 || !g_bridge.active) {
+        return;
+    }
+
+    g_bridge.uart_errors++;
+    // DMA 模式下溢出等错误会终止接收，交给主循环重启
+    if (huart->RxState == HAL_UART_STATE_READY) {
+        g_bridge.rx_restart = true;
+    }
+    // 发送 DMA 出错被终止：没有完成回调，在这里释放 (中转缓冲区里的数据丢失)
+    if (huart->gState == HAL_UART_STATE_READY && g_bridge.tx_len) {
+        g_bridge.dropped += g_bridge.tx_len;
+        g_bridge.tx_len = 0;
+        bridge_release(&g_bridge.tx_busy);
+    }
+}
+
+/* ========== 公共API ========== */
+int uart_bridge_start(void)
+{
+    if (g_bridge.active) {
+        return 0;
+    }
+
+    memset(&g_bridge, 0, sizeof(g_bridge));
+    lf_mpsc_ringbuffer_init(&g_bridge.mon, bridge_mon_pool, UART_BRIDGE_MON_SIZE);
+
+    // 立即应用主机当前的参数，之后的变化由回调通知
+    cdc_acm_port_get_line_coding(BRIDGE_PORT, &g_bridge.coding);
+    g_bridge.coding_pending = true;
+    cdc_acm_port_set_line_coding_callback(BRIDGE_PORT, bridge_line_coding_cb);
+
+    g_bridge.active = true;
+    uart_bridge_task();
+    return 0;
+}
+
+void uart_bridge_stop(void)
+{
+    if (!g_bridge.active) {
+        return;
+    }
+
+    g_bridge.active = false;
+    cdc_acm_port_set_line_coding_callback(BRIDGE_PORT, NULL);
+    HAL_UART_Abort(&huart1);
+
+    // 中止的发送不会再有完成回调，数据已从 CDC 接收缓冲区取出，按已发出处理
+    g_bridge.tx_len = 0;
+    g_bridge.tx_busy = false;
+    g_bridge.rx_busy = false;
+}
+
+bool uart_bridge_is_active(void)
+{
+    return g_bridge.active;
+}
+
+bool uart_bridge_task(void)
+{
+    bool applied = false;
+
+    if (!g_bridge.active) {
+        return false;
+    }
+
+    if (g_bridge.coding_pending) {
+        applied = bridge_apply_line_coding();
+    }
+
+    if (g_bridge.rx_restart && bridge_claim(&g_bridge.rx_busy)) {
+        g_bridge.rx_restart = false;
+        bridge_rx_drain();
+        bridge_rx_start();
+        bridge_release(&g_bridge.rx_busy);
+    }
+
+    // 中断里因缓冲区满没搬完的数据，以及链式发送断开后的重新启动
+    bridge_uart_to_usb();
+    bridge_usb_to_uart();
+
+    return applied;
+}
+
+uint32_t uart_bridge_monitor_read(bool *to_host, char *text, uint32_t max_len)
+{
+    uint8_t hdr;
+    uint8_t data[UART_BRIDGE_MON_CHUNK];
+    uint32_t len;
+
+    if (max_len == 0 || lf_mpsc_ringbuffer_peek(&g_bridge.mon, &hdr, 1) == 0) {
+        return 0;
+    }
+
+    len = hdr & 0x7F;
+    lf_mpsc_ringbuffer_drop(&g_bridge.mon, 1);
+    lf_mpsc_ringbuffer_read(&g_bridge.mon, data, len);
+
+    *to_host = (hdr & 0x80) != 0;
+    if (len > max_len - 1) {
+        len = max_len - 1;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        text[i] = (data[i] >= 0x20 && data[i] < 0x7F) ? (char)data[i] : '.';
+    }
+    text[len] = '\0';
+    return len;
+}
+
+void uart_bridge_get_stats(uart_bridge_stats_t *stats)
+{
+    stats->line_coding = g_bridge.applied;
+    stats->uart_to_usb = g_bridge.uart_to_usb;
+    stats->usb_to_uart = g_bridge.usb_to_uart;
+    stats->dropped = g_bridge.dropped;
+    stats->uart_errors = g_bridge.uart_errors;
+}
@@ -0,0 +1,500 @@
+/*
+ * USB Vendor Bulk Channel (WinUSB) with CherryRingBuffer
+ */
+
+#include "usb_vendor_bulk.h"
+#include "usbd_core.h"
+#include "lf_ringbuffer.h"
+#include "cdc_bench.h"
+#include <string.h>
+
+#if VENDOR_BULK_ENABLE
+
+#ifdef CONFIG_USB_HS
+#define VENDOR_BULK_MPS 512
+#else
+#define VENDOR_BULK_MPS 64
+#endif
+
+/* ========== RingBuffer配置 ========== */
+/* 注意：size必须是2的幂次方，且不小于 VENDOR_BULK_MPS */
+#define VENDOR_RX_RINGBUF_SIZE (4096)
+#define VENDOR_TX_RINGBUF_SIZE (4096)
+
+/* ========== MS OS 2.0 描述符 ========== */
+/* 描述符集合头(10) + 配置子集头(8) + 功能子集头(8) + 兼容ID(20) + 注册表属性(132) */
+#define VENDOR_MSOSV2_PROPERTY_LEN  132
+#define VENDOR_MSOSV2_FUNCTION_LEN  (8 + 20 + VENDOR_MSOSV2_PROPERTY_LEN)
+#define VENDOR_MSOSV2_CONFIG_LEN    (8 + VENDOR_MSOSV2_FUNCTION_LEN)
+#define VENDOR_MSOSV2_DESC_SIZE     (10 + VENDOR_MSOSV2_CONFIG_LEN)
+
+static const uint8_t vendor_msosv2_set[VENDOR_MSOSV2_DESC_SIZE] = {
+    // 描述符集合头
+    WBVAL(WINUSB_DESCRIPTOR_SET_HEADER_SIZE), WBVAL(WINUSB_SET_HEADER_DESCRIPTOR_TYPE),
+    0x00, 0x00, 0x03, 0x06, // dwWindowsVersion: Windows 8.1
+    WBVAL(VENDOR_MSOSV2_DESC_SIZE),
+    // 配置子集头
+    WBVAL(8), WBVAL(WINUSB_SUBSET_HEADER_CONFIGURATION_TYPE),
+    0x00, 0x00, WBVAL(VENDOR_MSOSV2_CONFIG_LEN),
+    // 功能子集头：只作用于厂商接口，CDC 接口仍由 usbser 驱动
+    WBVAL(WINUSB_FUNCTION_SUBSET_HEADER_SIZE), WBVAL(WINUSB_SUBSET_HEADER_FUNCTION_TYPE),
+    VENDOR_BULK_INTF, 0x00, WBVAL(VENDOR_MSOSV2_FUNCTION_LEN),
+    // 兼容ID: WINUSB
+    WBVAL(WINUSB_FEATURE_COMPATIBLE_ID_SIZE), WBVAL(WINUSB_FEATURE_COMPATIBLE_ID_TYPE),
+    'W', 'I', 'N', 'U', 'S', 'B', 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    // 注册表属性: DeviceInterfaceGUIDs (REG_MULTI_SZ)
+    WBVAL(VENDOR_MSOSV2_PROPERTY_LEN), WBVAL(WINUSB_FEATURE_REG_PROPERTY_TYPE),
+    WBVAL(WINUSB_PROP_DATA_TYPE_REG_MULTI_SZ),
+    WBVAL(42), // wPropertyNameLength
+    'D', 0x00, 'e', 0x00, 'v', 0x00, 'i', 0x00, 'c', 0x00, 'e', 0x00,
+    'I', 0x00, 'n', 0x00, 't', 0x00, 'e', 0x00, 'r', 0x00, 'f', 0x00,
+    'a', 0x00, 'c', 0x00, 'e', 0x00, 'G', 0x00, 'U', 0x00, 'I', 0x00,
+    'D', 0x00, 's', 0x00, 0x00, 0x00,
+    WBVAL(80), // wPropertyDataLength
+    '{', 0x00, 'C', 0x00, 'D', 0x00, 'B', 0x00, '3', 0x00, 'B', 0x00,
+    '5', 0x00, 'A', 0x00, 'D', 0x00, '-', 0x00, '2', 0x00, '9', 0x00,
+    '3', 0x00, 'B', 0x00, '-', 0x00, '4', 0x00, '6', 0x00, '6', 0x00,
+    '3', 0x00, '-', 0x00, 'A', 0x00, 'A', 0x00, '3', 0x00, '6', 0x00,
+    '-', 0x00, '1', 0x00, 'A', 0x00, 'A', 0x00, 'E', 0x00, '4', 0x00,
+    '6', 0x00, '4', 0x00, '6', 0x00, '3', 0x00, '7', 0x00, '7', 0x00,
+    '6', 0x00, '}', 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+/* ========== BOS 描述符 ========== */
+#define VENDOR_BOS_DESC_SIZE (5 + 28)
+
+static const uint8_t vendor_bos_set[VENDOR_BOS_DESC_SIZE] = {
+    // BOS 头
+    0x05, USB_DESCRIPTOR_TYPE_BINARY_OBJECT_STORE, WBVAL(VENDOR_BOS_DESC_SIZE), 0x01,
+    // 平台能力: MS OS 2.0 (UUID D8DD60DF-4589-4CC7-9CD2-659D9E648A9F)
+    0x1C, USB_DESCRIPTOR_TYPE_DEVICE_CAPABILITY, USB_DEVICE_CAPABILITY_PLATFORM, 0x00,
+    0xDF, 0x60, 0xDD, 0xD8, 0x89, 0x45, 0xC7, 0x4C,
+    0x9C, 0xD2, 0x65, 0x9D, 0x9E, 0x64, 0x8A, 0x9F,
+    0x00, 0x00, 0x03, 0x06, // dwWindowsVersion: Windows 8.1
+    WBVAL(VENDOR_MSOSV2_DESC_SIZE),
+    VENDOR_BULK_VENDOR_CODE,
+    0x00, // bAltEnumCode
+};
+
+struct usb_msosv2_descriptor vendor_bulk_msosv2_desc = {
+    .compat_id = vendor_msosv2_set,
+    .compat_id_len = VENDOR_MSOSV2_DESC_SIZE,
+    .vendor_code = VENDOR_BULK_VENDOR_CODE,
+};
+
+struct usb_bos_descriptor vendor_bulk_bos_desc = {
+    .string = vendor_bos_set,
+    .string_len = VENDOR_BOS_DESC_SIZE,
+};
+
+/* ========== 缓冲区和状态 ========== */
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t vendor_rx_pool[VENDOR_RX_RINGBUF_SIZE];
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t vendor_tx_pool[VENDOR_TX_RINGBUF_SIZE];
+/* 接收缓冲区线性区域不足一个包时使用的中转缓冲区 */
+USB_NOCACHE_RAM_SECTION USB_MEM_ALIGNX uint8_t vendor_rx_bounce[VENDOR_BULK_MPS];
+
+static struct {
+    uint8_t busid;
+    lf_spsc_ringbuffer_t rx_ringbuf;
+    lf_spsc_ringbuffer_t tx_ringbuf;
+    volatile bool configured;
+    volatile bool rx_busy;      // OUT 传输进行中，占有者是接收缓冲区唯一的生产者
+    volatile bool rx_bounce;    // 当前 OUT 传输落在中转缓冲区
+    volatile bool tx_busy;      // IN 传输进行中，占有者是发送缓冲区唯一的消费者
+    volatile uint32_t tx_len;   // 当前 IN 传输占用的发送缓冲区字节数
+    volatile bool rx_flush_req; // 复位后由各自的消费者清空缓冲区
+    volatile bool tx_flush_req;
+    vendor_bulk_event_cb_t event_cb;
+    // 测试服务: 模式由控制请求 (中断) 设置，计数只由 vendor_bulk_task() 更新
+    volatile vendor_bulk_mode_t mode;
+    volatile bool mode_changed;
+    uint8_t tx_seq;
+    uint8_t rx_seq;
+    bool rx_synced;
+    volatile uint32_t rx_bytes;
+    volatile uint32_t tx_bytes;
+    volatile uint32_t lost_bytes;
+} g_vendor;
+
+static void vendor_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes);
+static void vendor_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes);
+static void vendor_bulk_notify(uint8_t busid, uint8_t event, void *arg);
+static int vendor_bulk_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len);
+
+static struct usbd_interface vendor_intf = {
+    .vendor_handler = vendor_bulk_request,
+    .notify_handler = vendor_bulk_notify,
+};
+
+static struct usbd_endpoint vendor_out_ep = {
+    .ep_addr = VENDOR_BULK_OUT_EP,
+    .ep_cb = vendor_bulk_out
+};
+
+static struct usbd_endpoint vendor_in_ep = {
+    .ep_addr = VENDOR_BULK_IN_EP,
+    .ep_cb = vendor_bulk_in
+};
+
+/* ========== 传输调度 ========== */
+/* 原子地占有端点，线程和完成中断同时进入时只有一方能提交传输 */
+static bool vendor_bulk_claim(volatile bool *busy)
+{
+    return !__atomic_exchange_n(busy, true, __ATOMIC_ACQUIRE);
+}
+
+static void vendor_bulk_release(volatile bool *busy)
+{
+    __atomic_store_n(busy, false, __ATOMIC_RELEASE);
+}
+
+/* 接收缓冲区的消费者 (线程) 在访问前执行挂起的清空请求 */
+static lf_spsc_ringbuffer_t *vendor_bulk_rx_ring(void)
+{
+    if (g_vendor.rx_flush_req) {
+        g_vendor.rx_flush_req = false;
+        lf_spsc_ringbuffer_drop(&g_vendor.rx_ringbuf, lf_spsc_ringbuffer_get_used(&g_vendor.rx_ringbuf));
+    }
+    return &g_vendor.rx_ringbuf;
+}
+
+/* 提交下一次 OUT 传输 */
+static void vendor_bulk_start_read(void)
+{
+    uint32_t size;
+    uint8_t *ptr;
+
+    if (!g_vendor.configured || !vendor_bulk_claim(&g_vendor.rx_busy)) {
+        return;
+    }
+
+    ptr = lf_spsc_ringbuffer_linear_write_setup(&g_vendor.rx_ringbuf, &size);
+    if (size >= VENDOR_BULK_MPS) {
+        // 长度必须是包长的整数倍，否则一个满包会写出界
+        size -= size % VENDOR_BULK_MPS;
+        g_vendor.rx_bounce = false;
+    } else if (lf_spsc_ringbuffer_get_free(&g_vendor.rx_ringbuf) >= VENDOR_BULK_MPS) {
+        // 线性区域在缓冲区末尾且不足一个包，借道中转缓冲区
+        ptr = vendor_rx_bounce;
+        size = VENDOR_BULK_MPS;
+        g_vendor.rx_bounce = true;
+    } else {
+        // 缓冲区满：不提交传输，端点NAK，由 vendor_bulk_rx_done() 恢复
+        vendor_bulk_release(&g_vendor.rx_busy);
+        return;
+    }
+
+    usbd_ep_start_read(g_vendor.busid, VENDOR_BULK_OUT_EP, ptr, size);
+}
+
+static void vendor_bulk_start_write(void)
+{
+    uint32_t size;
+    uint8_t *ptr;
+
+    if (!g_vendor.configured || !vendor_bulk_claim(&g_vendor.tx_busy)) {
+        return;
+    }
+
+    if (g_vendor.tx_flush_req) {
+        g_vendor.tx_flush_req = false;
+        lf_spsc_ringbuffer_drop(&g_vendor.tx_ringbuf, lf_spsc_ringbuffer_get_used(&g_vendor.tx_ringbuf));
+    }
+
+    ptr = lf_spsc_ringbuffer_linear_read_setup(&g_vendor.tx_ringbuf, &size);
+    if (size == 0) {
+        vendor_bulk_release(&g_vendor.tx_busy);
+        return;
+    }
+
+    // 数据直接从环形缓冲区发出，传输完成后才释放空间
+    g_vendor.tx_len = size;
+    usbd_ep_start_write(g_vendor.busid, VENDOR_BULK_IN_EP, ptr, size);
+}
+
+/* ========== USB回调 ========== */
+static void vendor_bulk_event(uint8_t events)
+{
+    if (g_vendor.event_cb) {
+        g_vendor.event_cb(events);
+    }
+}
+
+static void vendor_bulk_out(uint8_t busid, uint8_t ep, uint32_t nbytes)
+{
+    if (g_vendor.rx_bounce) {
+        lf_spsc_ringbuffer_write(&g_vendor.rx_ringbuf, vendor_rx_bounce, nbytes);
+    } else {
+        lf_spsc_ringbuffer_linear_write_done(&g_vendor.rx_ringbuf, nbytes);
+    }
+
+    vendor_bulk_release(&g_vendor.rx_busy);
+    vendor_bulk_start_read();
+    vendor_bulk_event(CDC_ACM_EVENT_RX);
+}
+
+static void vendor_bulk_in(uint8_t busid, uint8_t ep, uint32_t nbytes)
+{
+    lf_spsc_ringbuffer_linear_read_done(&g_vendor.tx_ringbuf, g_vendor.tx_len);
+    g_vendor.tx_len = 0;
+
+    // 长度为包长整数倍且没有后续数据时补发ZLP，让主机结束本次读取
+    if (nbytes && (nbytes % VENDOR_BULK_MPS) == 0 &&
+        lf_spsc_ringbuffer_check_empty(&g_vendor.tx_ringbuf)) {
+        usbd_ep_start_write(busid, ep, NULL, 0);
+        return;
+    }
+
+    vendor_bulk_release(&g_vendor.tx_busy);
+    vendor_bulk_start_write();
+    vendor_bulk_event(CDC_ACM_EVENT_TX_DONE);
+}
+
+static void vendor_bulk_notify(uint8_t busid, uint8_t event, void *arg)
+{
+    switch (event) {
+        case USBD_EVENT_RESET:
+            g_vendor.configured = false;
+            g_vendor.rx_busy = false;
+            g_vendor.tx_busy = false;
+            g_vendor.tx_len = 0;
+            // 中断里不能直接改对方的指针，交给消费者清空
+            g_vendor.rx_flush_req = true;
+            g_vendor.tx_flush_req = true;
+            break;
+
+        case USBD_EVENT_CONFIGURED:
+            g_vendor.configured = true;
+            vendor_bulk_start_read();
+            vendor_bulk_start_write();
+            vendor_bulk_event(CDC_ACM_EVENT_STATE);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* 测试服务的厂商请求，只处理发给本接口的 */
+static int vendor_bulk_request(uint8_t busid, struct usb_setup_packet *setup, uint8_t **data, uint32_t *len)
+{
+    if ((setup->bmRequestType & USB_REQUEST_RECIPIENT_MASK) != USB_REQUEST_RECIPIENT_INTERFACE ||
+        (setup->wIndex & 0xFF) != VENDOR_BULK_INTF) {
+        return -1;
+    }
+
+    switch (setup->bRequest) {
+        case VENDOR_BULK_REQ_SET_MODE:
+            if (setup->wValue >= VENDOR_BULK_MODE_NUM) {
+                return -1;
+            }
+            g_vendor.mode = (vendor_bulk_mode_t)setup->wValue;
+            // 清空和计数归零都交给主循环 (缓冲区的消费者)
+            g_vendor.mode_changed = true;
+            g_vendor.rx_flush_req = true;
+            g_vendor.tx_flush_req = true;
+            *len = 0;
+            vendor_bulk_event(CDC_ACM_EVENT_STATE);
+            return 0;
+
+        case VENDOR_BULK_REQ_GET_STATS: {
+            uint32_t stats[3] = { g_vendor.rx_bytes, g_vendor.tx_bytes, g_vendor.lost_bytes };
+
+            memcpy(*data, stats, sizeof(stats)); // Cortex-M 为小端
+            *len = sizeof(stats);
+            return 0;
+        }
+
+        default:
+            return -1;
+    }
+}
+
+/* ========== 初始化 ========== */
+void vendor_bulk_add_interface(uint8_t busid)
+{
+    lf_spsc_ringbuffer_init(&g_vendor.rx_ringbuf, vendor_rx_pool, VENDOR_RX_RINGBUF_SIZE);
+    lf_spsc_ringbuffer_init(&g_vendor.tx_ringbuf, vendor_tx_pool, VENDOR_TX_RINGBUF_SIZE);
+
+    g_vendor.busid = busid;
+    g_vendor.configured = false;
+    g_vendor.rx_busy = false;
+    g_vendor.tx_busy = false;
+    g_vendor.mode = VENDOR_BULK_MODE_LOOP;
+
+    usbd_add_interface(busid, &vendor_intf);
+    usbd_add_endpoint(busid, &vendor_out_ep);
+    usbd_add_endpoint(busid, &vendor_in_ep);
+}
+
+/* ========== 收发API ========== */
+int vendor_bulk_write(const uint8_t *data, uint32_t len)
+{
+    if (!g_vendor.configured) {
+        return -1;
+    }
+
+    uint32_t written = lf_spsc_ringbuffer_write(&g_vendor.tx_ringbuf, data, len);
+    vendor_bulk_start_write();
+    return (int)written;
+}
+
+int vendor_bulk_read(uint8_t *buffer, uint32_t max_len)
+{
+    uint32_t read = lf_spsc_ringbuffer_read(vendor_bulk_rx_ring(), buffer, max_len);
+
+    if (read) {
+        vendor_bulk_start_read();
+    }
+    return (int)read;
+}
+
+uint32_t vendor_bulk_get_rx_available(void)
+{
+    return lf_spsc_ringbuffer_get_used(vendor_bulk_rx_ring());
+}
+
+uint32_t vendor_bulk_get_tx_free(void)
+{
+    return lf_spsc_ringbuffer_get_free(&g_vendor.tx_ringbuf);
+}
+
+bool vendor_bulk_is_configured(void)
+{
+    return g_vendor.configured;
+}
+
+/* ========== 零拷贝API ========== */
+void *vendor_bulk_rx_setup(uint32_t *size)
+{
+    return lf_spsc_ringbuffer_linear_read_setup(vendor_bulk_rx_ring(), size);
+}
+
+void vendor_bulk_rx_done(uint32_t size)
+{
+    lf_spsc_ringbuffer_linear_read_done(&g_vendor.rx_ringbuf, size);
+    vendor_bulk_start_read();
+}
+
+void *vendor_bulk_tx_setup(uint32_t *size)
+{
+    return lf_spsc_ringbuffer_linear_write_setup(&g_vendor.tx_ringbuf, size);
+}
+
+void vendor_bulk_tx_done(uint32_t size)
+{
+    lf_spsc_ringbuffer_linear_write_done(&g_vendor.tx_ringbuf, size);
+    vendor_bulk_start_write();
+}
+
+/* ========== 测试服务 ========== */
+void vendor_bulk_set_event_callback(vendor_bulk_event_cb_t cb)
+{
+    g_vendor.event_cb = cb;
+}
+
+vendor_bulk_mode_t vendor_bulk_get_mode(void)
+{
+    return g_vendor.mode;
+}
+
+static uint32_t vendor_bulk_source(void)
+{
+    uint32_t size;
+    uint8_t *ptr = vendor_bulk_tx_setup(&size);
+    uint8_t seq = g_vendor.tx_seq;
+
+    for (uint32_t i = 0; i < size; i++) {
+        ptr[i] = seq;
+        if (++seq == CDC_BENCH_PATTERN_MOD) {
+            seq = 0;
+        }
+    }
+    g_vendor.tx_seq = seq;
+    if (size) {
+        vendor_bulk_tx_done(size);
+        g_vendor.tx_bytes += size;
+    }
+    return size;
+}
+
+static uint32_t vendor_bulk_sink(void)
+{
+    uint32_t size;
+    uint8_t *ptr = vendor_bulk_rx_setup(&size);
+    uint8_t seq = g_vendor.rx_seq;
+
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t c = ptr[i];
+
+        if (c != seq && g_vendor.rx_synced) {
+            // 图案跳变：按差值计入丢失字节并重新同步 (同 cdc_bench.c)
+            g_vendor.lost_bytes += (c < CDC_BENCH_PATTERN_MOD) ?
+                                   (uint32_t)(c + CDC_BENCH_PATTERN_MOD - seq) % CDC_BENCH_PATTERN_MOD : 1U;
+        }
+        g_vendor.rx_synced = true;
+        seq = (c + 1U < CDC_BENCH_PATTERN_MOD) ? (uint8_t)(c + 1U) : 0;
+    }
+    g_vendor.rx_seq = seq;
+    if (size) {
+        vendor_bulk_rx_done(size);
+        g_vendor.rx_bytes += size;
+    }
+    return size;
+}
+
+/* 回显: 接收和发送是两个缓冲区，线性区域之间拷贝一次 */
+static uint32_t vendor_bulk_loop(void)
+{
+    uint32_t rx_size, tx_size;
+    uint8_t *rx = vendor_bulk_rx_setup(&rx_size);
+    uint8_t *tx = vendor_bulk_tx_setup(&tx_size);
+    uint32_t n = (rx_size < tx_size) ? rx_size : tx_size;
+
+    if (n) {
+        memcpy(tx, rx, n);
+        vendor_bulk_tx_done(n);
+        vendor_bulk_rx_done(n);
+        g_vendor.rx_bytes += n;
+        g_vendor.tx_bytes += n;
+    }
+    return n;
+}
+
+bool vendor_bulk_task(void)
+{
+    uint32_t moved;
+
+    if (!g_vendor.configured) {
+        return false;
+    }
+
+    if (g_vendor.mode_changed) {
+        g_vendor.mode_changed = false;
+        g_vendor.tx_seq = 0;
+        g_vendor.rx_seq = 0;
+        g_vendor.rx_synced = false;
+        g_vendor.rx_bytes = 0;
+        g_vendor.tx_bytes = 0;
+        g_vendor.lost_bytes = 0;
+    }
+
+    switch (g_vendor.mode) {
+        case VENDOR_BULK_MODE_SOURCE:
+            moved = vendor_bulk_source();
+            break;
+        case VENDOR_BULK_MODE_SINK:
+            moved = vendor_bulk_sink();
+            break;
+        default:
+            moved = vendor_bulk_loop();
+            break;
+    }
+
+    // 线性区域在缓冲区末尾被截断时，回绕后的部分下一轮立即处理
+    return moved > 0 && (g_vendor.mode == VENDOR_BULK_MODE_SOURCE ? vendor_bulk_get_tx_free() > 0
+                                                                   : vendor_bulk_get_rx_available() > 0);
+}
+
+#endif /* VENDOR_BULK_ENABLE */
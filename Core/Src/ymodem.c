@@ -0,0 +1,721 @@
+/*
+ * YMODEM File Transfer over USB CDC ACM
+ */
+
+#include "ymodem.h"
+#include "cdc_acm_ringbuffer.h"
+#include "stm32f4xx_hal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define YM_SOH          0x01
+#define YM_STX          0x02
+#define YM_EOT          0x04
+#define YM_ACK          0x06
+#define YM_NAK          0x15
+#define YM_CAN          0x18
+#define YM_CPMEOF       0x1A    // 最后一个块的填充字节
+
+#define YM_BLOCK_128    128
+#define YM_BLOCK_1K     1024
+#define YM_PKT_OVERHEAD 5       // 起始字节 + 块号 + 块号反码 + CRC16
+#define YM_CTL_MAX      8       // 等待写入发送缓冲区的控制字节上限
+
+typedef enum {
+    YM_RX_WAIT_HEADER = 0,      // 发送 'C'/'G'，等待块 0
+    YM_RX_WAIT_DATA,            // 接收数据块，直到 EOT
+    YM_RX_WAIT_END,             // EOT 已确认，等待空的块 0 结束批次
+    YM_TX_WAIT_START,           // 等待接收方的 'C'/'G'
+    YM_TX_WAIT_HEADER_ACK,
+    YM_TX_DATA,
+    YM_TX_WAIT_EOT_ACK,
+    YM_TX_WAIT_END,             // 等待接收方请求下一个文件
+    YM_TX_WAIT_FINAL_ACK,
+} ym_phase_t;
+
+typedef enum {
+    YM_PKT_NONE = 0,            // 数据不完整
+    YM_PKT_BLOCK,
+    YM_PKT_BAD,                 // 块号或 CRC 错误
+    YM_PKT_EOT,
+    YM_PKT_CAN,
+} ym_pkt_t;
+
+static struct {
+    ymodem_status_t status;
+    ym_phase_t phase;
+    uint8_t port;
+    uint8_t poll_char;          // 接收方的请求字符 'C' 或 'G'
+    uint8_t can_count;          // 连续收到的 CAN，两个即取消
+    uint32_t start_tick;
+    uint32_t last_tick;         // 上一次有进展的时间
+    uint32_t retry;             // 连续超时/错误次数
+    uint8_t ctl[YM_CTL_MAX];    // 发送缓冲区满时暂存的控制字节 (ACK/NAK/'C'/EOT)，按顺序补发
+    uint8_t ctl_len;
+
+    /* 接收 */
+    uint8_t *rx_buf;
+    uint32_t buf_size;
+    bool size_known;
+    bool eot_nak;               // 已对第一个 EOT 回复 NAK
+    uint8_t expected;           // 期望的块号
+    uint32_t pkt_len;           // 正在接收的包总长度，0 表示等待起始字节
+    uint32_t data_len;          // 最近一个完整包的数据长度
+
+    /* 发送: 块号 1..total_blocks，[base, next) 为已发送未确认的窗口 */
+    const uint8_t *tx_data;
+    uint32_t total_blocks;
+    uint32_t base;
+    uint32_t next;
+    bool hdr_acked;
+    bool tx_pending;            // 当前阶段的包 (块 0/EOT/结束块) 需要发送
+
+    /* 接收包缓冲，发送时用于拼接块 0 和不足一块的结尾 */
+    uint8_t pkt[YM_BLOCK_1K + YM_PKT_OVERHEAD];
+
+    ymodem_result_t res;
+} g_ym;
+
+/* ========== CRC-16/XMODEM (多项式 0x1021，初值 0) ========== */
+static uint16_t ym_crc16(const uint8_t *data, uint32_t len)
+{
+    static const uint16_t nibble_table[16] = {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+    };
+    uint16_t crc = 0;
+
+    while (len--) {
+        uint8_t b = *data++;
+        crc = (uint16_t)((crc << 4) ^ nibble_table[(crc >> 12) ^ (b >> 4)]);
+        crc = (uint16_t)((crc << 4) ^ nibble_table[(crc >> 12) ^ (b & 0x0F)]);
+    }
+    return crc;
+}
+
+/* ========== 公共辅助 ========== */
+static void ym_finish(ymodem_status_t status, const char *error)
+{
+    if (g_ym.status != YMODEM_RUNNING) {
+        return; // 保留第一个结束原因
+    }
+    g_ym.status = status;
+    g_ym.res.error = error;
+    g_ym.res.elapsed_ms = HAL_GetTick() - g_ym.start_tick;
+}
+
+static void ym_send_can(void)
+{
+    static const uint8_t can_seq[] = { YM_CAN, YM_CAN, YM_CAN, YM_CAN, YM_CAN };
+
+    cdc_acm_port_send_data(g_ym.port, can_seq, sizeof(can_seq));
+}
+
+static void ym_cancel(const char *error)
+{
+    ym_send_can();
+    ym_finish(YMODEM_FAILED, error);
+}
+
+/* 补发暂存的控制字节，整段写入，返回 false 表示仍有未发出的 */
+static bool ym_flush_ctl(void)
+{
+    if (g_ym.ctl_len == 0) {
+        return true;
+    }
+    if (cdc_acm_port_send_data(g_ym.port, g_ym.ctl, g_ym.ctl_len) <= 0) {
+        return false;
+    }
+    g_ym.ctl_len = 0;
+    return true;
+}
+
+/*
+ * 发送一个控制字节。发送缓冲区满 (主机不读) 时先暂存，下一次 ymodem_task() 重试，
+ * 不能丢: 少一个 ACK 或 'C' 对方就会一直等。暂存也放不下说明对方早已不读，放弃传输
+ */
+static void ym_put(uint8_t b)
+{
+    if (g_ym.ctl_len >= YM_CTL_MAX) {
+        ym_cancel("tx buffer full");
+        return;
+    }
+    g_ym.ctl[g_ym.ctl_len++] = b;
+    ym_flush_ctl();
+}
+
+static void ym_begin(uint8_t port, ym_phase_t phase)
+{
+    memset(&g_ym.res, 0, sizeof(g_ym.res));
+    g_ym.port = port;
+    g_ym.ctl_len = 0;
+    g_ym.phase = phase;
+    g_ym.can_count = 0;
+    g_ym.retry = 0;
+    g_ym.pkt_len = 0;
+    g_ym.start_tick = HAL_GetTick();
+    g_ym.last_tick = g_ym.start_tick;
+    g_ym.status = YMODEM_RUNNING;
+}
+
+/* ========== 接收 ========== */
+
+/* 从接收缓冲区解析一个包，包不完整时保留已读的起始字节，下次继续 */
+static ym_pkt_t ym_read_packet(void)
+{
+    uint8_t b;
+    uint16_t crc;
+    uint8_t *p = g_ym.pkt;
+
+    while (g_ym.pkt_len == 0) {
+        if (cdc_acm_port_read_data(g_ym.port, &b, 1) <= 0) {
+            return YM_PKT_NONE;
+        }
+        if (b == YM_CAN) {
+            if (++g_ym.can_count >= 2) {
+                return YM_PKT_CAN;
+            }
+            continue;
+        }
+        g_ym.can_count = 0;
+
+        if (b == YM_SOH) {
+            g_ym.pkt_len = YM_BLOCK_128 + YM_PKT_OVERHEAD;
+        } else if (b == YM_STX) {
+            g_ym.pkt_len = YM_BLOCK_1K + YM_PKT_OVERHEAD;
+        } else if (b == YM_EOT) {
+            return YM_PKT_EOT;
+        }
+        // 其他字节 (线路噪声、终端回显等) 丢弃
+        p[0] = b;
+    }
+
+    // 整包到齐后一次读出
+    if (cdc_acm_port_get_rx_available(g_ym.port) < g_ym.pkt_len - 1) {
+        return YM_PKT_NONE;
+    }
+    cdc_acm_port_read_data(g_ym.port, &p[1], g_ym.pkt_len - 1);
+    g_ym.data_len = g_ym.pkt_len - YM_PKT_OVERHEAD;
+    g_ym.pkt_len = 0;
+
+    if ((uint8_t)(p[1] ^ p[2]) != 0xFF) {
+        return YM_PKT_BAD;
+    }
+    crc = ym_crc16(&p[3], g_ym.data_len);
+    if (p[3 + g_ym.data_len] != (uint8_t)(crc >> 8) || p[4 + g_ym.data_len] != (uint8_t)crc) {
+        return YM_PKT_BAD;
+    }
+    return YM_PKT_BLOCK;
+}
+
+static void ym_rx_ack(void)
+{
+    // 流式传输不逐块确认
+    if (g_ym.poll_char == 'C') {
+        ym_put(YM_ACK);
+    }
+}
+
+/* 块 0: "文件名\0大小 [修改时间 ...]\0"，文件名为空表示批次结束 */
+static void ym_rx_header(void)
+{
+    char *name = (char *)&g_ym.pkt[3];
+    uint32_t name_len;
+
+    name[g_ym.data_len] = '\0'; // 覆盖已校验过的 CRC，保证字符串结束
+    name_len = (uint32_t)strlen(name);
+
+    if (name_len == 0) {
+        ym_rx_ack();
+        if (g_ym.phase == YM_RX_WAIT_END) {
+            ym_finish(YMODEM_DONE, NULL);
+        } else {
+            ym_finish(YMODEM_FAILED, "no file sent");
+        }
+        return;
+    }
+
+    if (g_ym.phase == YM_RX_WAIT_END) {
+        // 只保存第一个文件，取消批次中剩下的文件，第一个文件仍然有效
+        ym_send_can();
+        ym_finish(YMODEM_DONE, NULL);
+        return;
+    }
+
+    strncpy(g_ym.res.name, name, YMODEM_NAME_MAX - 1);
+    g_ym.res.name[YMODEM_NAME_MAX - 1] = '\0';
+    g_ym.res.size = (name_len + 1 < g_ym.data_len) ? (uint32_t)strtoul(&name[name_len + 1], NULL, 10) : 0;
+    g_ym.size_known = (g_ym.res.size != 0);
+
+    if (g_ym.res.size > g_ym.buf_size) {
+        ym_cancel("file too large");
+        return;
+    }
+
+    ym_rx_ack();
+    ym_put(g_ym.poll_char); // 请求数据块
+    g_ym.phase = YM_RX_WAIT_DATA;
+    g_ym.expected = 1;
+    g_ym.eot_nak = false;
+}
+
+static void ym_rx_block(void)
+{
+    uint8_t seq = g_ym.pkt[1];
+    uint32_t n = g_ym.data_len;
+
+    if (g_ym.phase != YM_RX_WAIT_DATA) {
+        if (seq == 0) {
+            ym_rx_header();
+        } else if (g_ym.poll_char == 'C') {
+            ym_put(YM_NAK);
+        }
+        return;
+    }
+
+    if (seq != g_ym.expected) {
+        if (seq == (uint8_t)(g_ym.expected - 1)) {
+            // 确认丢失导致的重发: 再确认一次 (块 0 重发时 expected 为 1)
+            ym_rx_ack();
+        } else if (g_ym.poll_char == 'C' && (uint8_t)(seq - g_ym.expected) <= YMODEM_TX_WINDOW) {
+            // 窗口发送方在 NAK 之前已发出的后续块，丢弃，等它回退重发
+        } else {
+            ym_cancel("block sequence error");
+        }
+        return;
+    }
+
+    if (g_ym.size_known && n > g_ym.res.size - g_ym.res.bytes) {
+        n = g_ym.res.size - g_ym.res.bytes; // 去掉最后一块的填充
+    }
+    if (g_ym.res.bytes + n > g_ym.buf_size) {
+        ym_cancel("file too large");
+        return;
+    }
+
+    memcpy(&g_ym.rx_buf[g_ym.res.bytes], &g_ym.pkt[3], n);
+    g_ym.res.bytes += n;
+    g_ym.res.blocks++;
+    g_ym.expected++;
+    ym_rx_ack();
+}
+
+static void ym_rx_eot(void)
+{
+    if (g_ym.phase != YM_RX_WAIT_DATA) {
+        ym_put(YM_ACK); // 发送方没收到对 EOT 的确认
+        return;
+    }
+
+    // 标准做法: 第一个 EOT 回 NAK，确认不是噪声
+    if (g_ym.poll_char == 'C' && !g_ym.eot_nak) {
+        g_ym.eot_nak = true;
+        ym_put(YM_NAK);
+        return;
+    }
+    ym_put(YM_ACK);
+
+    if (!g_ym.size_known) {
+        while (g_ym.res.bytes > 0 && g_ym.rx_buf[g_ym.res.bytes - 1] == YM_CPMEOF) {
+            g_ym.res.bytes--;
+        }
+        g_ym.res.size = g_ym.res.bytes;
+    }
+
+    g_ym.phase = YM_RX_WAIT_END;
+    ym_put(g_ym.poll_char);
+}
+
+static void ym_rx_timeout(void)
+{
+    if (g_ym.phase == YM_RX_WAIT_HEADER) {
+        if (HAL_GetTick() - g_ym.start_tick >= YMODEM_START_TIMEOUT_MS) {
+            ym_cancel("no sender");
+        } else {
+            ym_put(g_ym.poll_char);
+        }
+        return;
+    }
+
+    if (++g_ym.retry > YMODEM_MAX_RETRY) {
+        if (g_ym.phase == YM_RX_WAIT_END) {
+            ym_finish(YMODEM_DONE, NULL); // 文件已完整，对方没有结束批次
+        } else {
+            ym_cancel("timeout");
+        }
+        return;
+    }
+    g_ym.res.retries++;
+
+    if (g_ym.phase == YM_RX_WAIT_END || g_ym.expected == 1) {
+        ym_put(g_ym.poll_char);
+    } else if (g_ym.poll_char == 'C') {
+        // 丢弃残缺的包，请求重发
+        g_ym.pkt_len = 0;
+        cdc_acm_port_flush_rx(g_ym.port);
+        ym_put(YM_NAK);
+    }
+}
+
+static void ym_rx_task(void)
+{
+    ym_pkt_t pkt;
+
+    while (g_ym.status == YMODEM_RUNNING && (pkt = ym_read_packet()) != YM_PKT_NONE) {
+        g_ym.last_tick = HAL_GetTick();
+
+        switch (pkt) {
+            case YM_PKT_CAN:
+                ym_finish(YMODEM_FAILED, "cancelled by sender");
+                break;
+
+            case YM_PKT_BAD:
+                g_ym.res.retries++;
+                if (g_ym.poll_char == 'G') {
+                    ym_cancel("CRC error"); // 流式传输无法重发
+                } else if (++g_ym.retry > YMODEM_MAX_RETRY) {
+                    ym_cancel("too many errors");
+                } else {
+                    // 丢弃已到达的后续数据再请求重发，避免从块中间开始解析
+                    cdc_acm_port_flush_rx(g_ym.port);
+                    ym_put(YM_NAK);
+                }
+                break;
+
+            case YM_PKT_EOT:
+                g_ym.retry = 0;
+                ym_rx_eot();
+                break;
+
+            case YM_PKT_BLOCK:
+                g_ym.retry = 0;
+                ym_rx_block();
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (g_ym.status == YMODEM_RUNNING && HAL_GetTick() - g_ym.last_tick >= YMODEM_RETRY_MS) {
+        g_ym.last_tick = HAL_GetTick();
+        ym_rx_timeout();
+    }
+}
+
+/* ========== 发送 ========== */
+
+/* data 必须有 size 字节，头和 CRC 与数据分段写入发送缓冲区，整包要么全部写入要么不写 */
+static bool ym_send_packet(uint8_t seq, const uint8_t *data, uint32_t size)
+{
+    uint16_t crc = ym_crc16(data, size);
+    uint8_t hdr[3] = { (size == YM_BLOCK_1K) ? YM_STX : YM_SOH, seq, (uint8_t)~seq };
+    uint8_t tail[2] = { (uint8_t)(crc >> 8), (uint8_t)crc };
+    cdc_acm_iovec_t iov[3] = {
+        { hdr, sizeof(hdr) },
+        { data, size },
+        { tail, sizeof(tail) },
+    };
+
+    return cdc_acm_port_sendv(g_ym.port, iov, 3) > 0;
+}
+
+/* 块 0: 文件名和大小，name 为 NULL 时发送结束批次的空块 */
+static bool ym_send_header(const char *name)
+{
+    memset(g_ym.pkt, 0, YM_BLOCK_128);
+    if (name != NULL) {
+        int n = snprintf((char *)g_ym.pkt, YMODEM_NAME_MAX, "%s", name);
+        snprintf((char *)&g_ym.pkt[n + 1], YM_BLOCK_128 - (uint32_t)n - 1, "%lu", (unsigned long)g_ym.res.size);
+    }
+    return ym_send_packet(0, g_ym.pkt, YM_BLOCK_128);
+}
+
+static bool ym_send_data_block(uint32_t blk)
+{
+    uint32_t offset = (blk - 1) * YM_BLOCK_1K;
+    uint32_t n = g_ym.res.size - offset;
+    uint32_t size = (n > YM_BLOCK_128) ? YM_BLOCK_1K : YM_BLOCK_128;
+
+    // 整块直接从文件发送，只有最后不足一块时才拷贝并填充
+    if (n >= size) {
+        return ym_send_packet((uint8_t)blk, &g_ym.tx_data[offset], size);
+    }
+    memset(g_ym.pkt, YM_CPMEOF, size);
+    memcpy(g_ym.pkt, &g_ym.tx_data[offset], n);
+    return ym_send_packet((uint8_t)blk, g_ym.pkt, size);
+}
+
+static void ym_tx_enter_data(void)
+{
+    g_ym.phase = YM_TX_DATA;
+    g_ym.base = 1;
+    g_ym.next = 1;
+    g_ym.retry = 0;
+}
+
+static void ym_tx_input(uint8_t b)
+{
+    switch (g_ym.phase) {
+        case YM_TX_WAIT_START:
+            if (b == 'C' || b == 'G') {
+                g_ym.res.streaming = (b == 'G');
+                cdc_acm_port_flush_rx(g_ym.port); // 丢弃等待期间积压的重复请求
+                g_ym.phase = YM_TX_WAIT_HEADER_ACK;
+                g_ym.hdr_acked = false;
+                g_ym.tx_pending = true;
+            }
+            break;
+
+        case YM_TX_WAIT_HEADER_ACK:
+            if (b == YM_ACK) {
+                g_ym.hdr_acked = true;
+            } else if (b == YM_NAK) {
+                g_ym.res.retries++;
+                g_ym.tx_pending = true;
+            } else if ((b == 'C' && g_ym.hdr_acked) || (b == 'G' && g_ym.res.streaming)) {
+                ym_tx_enter_data();
+            }
+            break;
+
+        case YM_TX_DATA:
+            if (g_ym.res.streaming) {
+                break;
+            }
+            if (b == YM_ACK && g_ym.base < g_ym.next) {
+                g_ym.base++;
+                g_ym.retry = 0;
+                g_ym.last_tick = HAL_GetTick();
+            } else if (b == YM_NAK) {
+                g_ym.res.retries++;
+                g_ym.next = g_ym.base; // 回退到第一个未确认的块
+            }
+            break;
+
+        case YM_TX_WAIT_EOT_ACK:
+            if (b == YM_ACK) {
+                g_ym.phase = YM_TX_WAIT_END;
+                g_ym.retry = 0;
+            } else if (b == YM_NAK) {
+                g_ym.tx_pending = true;
+            }
+            break;
+
+        case YM_TX_WAIT_END:
+            if (b == 'C' || b == 'G') {
+                g_ym.phase = YM_TX_WAIT_FINAL_ACK;
+                g_ym.tx_pending = true;
+            }
+            break;
+
+        case YM_TX_WAIT_FINAL_ACK:
+            if (b == YM_ACK) {
+                ym_finish(YMODEM_DONE, NULL);
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void ym_tx_output(void)
+{
+    switch (g_ym.phase) {
+        case YM_TX_WAIT_HEADER_ACK:
+            if (g_ym.tx_pending && ym_send_header(g_ym.res.name)) {
+                g_ym.tx_pending = false;
+                g_ym.last_tick = HAL_GetTick();
+            }
+            break;
+
+        case YM_TX_DATA:
+            while (g_ym.next <= g_ym.total_blocks &&
+                   (g_ym.res.streaming || g_ym.next - g_ym.base < YMODEM_TX_WINDOW)) {
+                if (!ym_send_data_block(g_ym.next)) {
+                    break; // 发送缓冲区满
+                }
+                g_ym.next++;
+                if (g_ym.res.streaming) {
+                    g_ym.last_tick = HAL_GetTick();
+                }
+            }
+
+            // 流式传输发出即算完成，否则以确认为准
+            {
+                uint32_t done = g_ym.res.streaming ? g_ym.next - 1 : g_ym.base - 1;
+                g_ym.res.blocks = done;
+                g_ym.res.bytes = (done * YM_BLOCK_1K < g_ym.res.size) ? done * YM_BLOCK_1K : g_ym.res.size;
+                if (done == g_ym.total_blocks) {
+                    g_ym.phase = YM_TX_WAIT_EOT_ACK;
+                    g_ym.tx_pending = true;
+                    g_ym.retry = 0;
+                }
+            }
+            break;
+
+        case YM_TX_WAIT_EOT_ACK:
+            if (g_ym.tx_pending) {
+                ym_put(YM_EOT);
+                g_ym.tx_pending = false;
+                g_ym.last_tick = HAL_GetTick();
+            }
+            break;
+
+        case YM_TX_WAIT_FINAL_ACK:
+            if (g_ym.tx_pending && ym_send_header(NULL)) {
+                g_ym.tx_pending = false;
+                g_ym.last_tick = HAL_GetTick();
+                if (g_ym.res.streaming) {
+                    ym_finish(YMODEM_DONE, NULL);
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void ym_tx_timeout(void)
+{
+    if (g_ym.phase == YM_TX_WAIT_START) {
+        if (HAL_GetTick() - g_ym.start_tick >= YMODEM_START_TIMEOUT_MS) {
+            ym_cancel("no receiver");
+        }
+        return;
+    }
+
+    if (g_ym.phase == YM_TX_WAIT_FINAL_ACK && !g_ym.tx_pending) {
+        ym_finish(YMODEM_DONE, NULL); // 数据已全部确认，结束块的确认可以忽略
+        return;
+    }
+
+    if (++g_ym.retry > YMODEM_MAX_RETRY) {
+        ym_cancel("timeout");
+        return;
+    }
+    g_ym.res.retries++;
+
+    switch (g_ym.phase) {
+        case YM_TX_WAIT_HEADER_ACK:
+        case YM_TX_WAIT_EOT_ACK:
+            g_ym.tx_pending = true;
+            break;
+
+        case YM_TX_DATA:
+            if (!g_ym.res.streaming) {
+                g_ym.next = g_ym.base;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+static void ym_tx_task(void)
+{
+    uint8_t b;
+
+    while (g_ym.status == YMODEM_RUNNING && cdc_acm_port_read_data(g_ym.port, &b, 1) > 0) {
+        if (b == YM_CAN) {
+            if (++g_ym.can_count >= 2) {
+                ym_finish(YMODEM_FAILED, "cancelled by receiver");
+            }
+            continue;
+        }
+        g_ym.can_count = 0;
+        ym_tx_input(b);
+    }
+
+    // 控制字节 (EOT) 没发出去之前不能发后面的包
+    if (g_ym.status != YMODEM_RUNNING || !ym_flush_ctl()) {
+        return;
+    }
+    ym_tx_output();
+
+    if (g_ym.status == YMODEM_RUNNING) {
+        uint32_t timeout = (g_ym.phase == YM_TX_WAIT_START) ? YMODEM_RETRY_MS : YMODEM_ACK_TIMEOUT_MS;
+        if (HAL_GetTick() - g_ym.last_tick >= timeout) {
+            g_ym.last_tick = HAL_GetTick();
+            ym_tx_timeout();
+        }
+    }
+}
+
+/* ========== 公共API ========== */
+int ymodem_receive_start(uint8_t port, uint8_t *buf, uint32_t buf_size, bool streaming)
+{
+    if (g_ym.status != YMODEM_IDLE) {
+        return -1;
+    }
+
+    ym_begin(port, YM_RX_WAIT_HEADER);
+    g_ym.rx_buf = buf;
+    g_ym.buf_size = buf_size;
+    g_ym.poll_char = streaming ? 'G' : 'C';
+    g_ym.res.streaming = streaming;
+
+    ym_put(g_ym.poll_char);
+    return 0;
+}
+
+int ymodem_send_start(uint8_t port, const char *name, const void *data, uint32_t len)
+{
+    if (g_ym.status != YMODEM_IDLE) {
+        return -1;
+    }
+
+    ym_begin(port, YM_TX_WAIT_START);
+    g_ym.res.sending = true;
+    strncpy(g_ym.res.name, name, YMODEM_NAME_MAX - 1);
+    g_ym.res.name[YMODEM_NAME_MAX - 1] = '\0';
+    g_ym.res.size = len;
+    g_ym.tx_data = data;
+    g_ym.total_blocks = (len + YM_BLOCK_1K - 1) / YM_BLOCK_1K;
+    g_ym.tx_pending = false;
+    return 0;
+}
+
+ymodem_status_t ymodem_task(void)
+{
+    ymodem_status_t status = g_ym.status;
+
+    if (status == YMODEM_RUNNING) {
+        ym_flush_ctl();
+        if (g_ym.res.sending) {
+            ym_tx_task();
+        } else {
+            ym_rx_task();
+        }
+        status = g_ym.status;
+    }
+
+    // 结束状态只报告一次
+    if (status == YMODEM_DONE || status == YMODEM_FAILED) {
+        g_ym.status = YMODEM_IDLE;
+    }
+    return status;
+}
+
+void ymodem_abort(void)
+{
+    if (g_ym.status == YMODEM_RUNNING) {
+        ym_cancel("aborted");
+    }
+}
+
+bool ymodem_is_active(void)
+{
+    return g_ym.status != YMODEM_IDLE;
+}
+
+void ymodem_get_result(ymodem_result_t *result)
+{
+    *result = g_ym.res;
+    if (g_ym.status == YMODEM_RUNNING) {
+        result->elapsed_ms = HAL_GetTick() - g_ym.start_tick;
+    }
+}
@@ -1,7 +1,16 @@
 #include "gt9147_logic.h"
 #include "touch_hal_port.h"
+#include "touch_bus.h"
 #include <string.h>
 
+// 一帧: 状态寄存器 (0x814E)、保留字节、5 个点各 8 字节，一次事务读完
+#define GT_FRAME_LEN    (GT_TP1_REG - GT_GSTID_REG + 8 * GT_MAX_POINTS)
+
+// 异步读取的阶段
+#define GT_XFER_IDLE    0
+#define GT_XFER_READ    1   // 读取状态和坐标
+#define GT_XFER_CLEAR   2   // 清除状态寄存器
+
 // ============================================================================
 // 静态变量
 // ============================================================================
@@ -16,6 +25,25 @@ static uint16_t s_last_valid_y = 0;
 // CPU 占用率优化计数器
 static uint8_t s_scan_counter = 0;
 
+// INT 中断: 中断里只记录时间并通知，读取在主循环中进行
+static volatile uint8_t s_irq_pending = 0;
+static volatile uint32_t s_irq_tick = 0;
+static volatile uint32_t s_irq_cyc = 0;
+static void (*s_irq_notify)(void) = 0;
+
+// 触摸事件队列 (单生产者单消费者，下标自由增长)
+static GT_TouchEvent_t s_events[GT_EVENT_QUEUE_LEN];
+static volatile uint32_t s_ev_head = 0;
+static volatile uint32_t s_ev_tail = 0;
+
+static GT_TouchStats_t s_stats;
+
+// 异步读取: 读到的原始帧和写入的事件槽，完成回调 (中断上下文) 负责解析和入队
+static volatile uint8_t s_xfer = GT_XFER_IDLE;
+static uint32_t s_xfer_tick;
+static uint32_t s_xfer_head;
+static uint8_t s_frame[GT_FRAME_LEN];
+
 // ============================================================================
 // 常量定义
 // ============================================================================
@@ -156,6 +184,11 @@ uint8_t GT9147_Init(uint16_t width, uint16_t height, uint8_t orientation)
 	#endif
 	
 	TOUCH_HW_Delay_ms(100);
+
+	#ifdef GT9147_NEED_INT_OUTPUT_CONFIG
+	// 地址选定后释放 INT，之后由芯片驱动 (触摸数据就绪时输出脉冲)
+	TOUCH_HW_Set_INT_Mode_Input();
+	#endif
 	
 	// 读取产品ID
 	GT9147_RD_Reg(GT_PID_REG, temp, 4);
@@ -182,45 +215,36 @@ uint8_t GT9147_Init(uint16_t width, uint16_t height, uint8_t orientation)
 	return 1;
 }
 
-uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points)
+// ============================================================================
+// 读取一帧
+// ============================================================================
+
+/**
+ * @brief 解析一帧原始数据 (从 GT_GSTID_REG 开始)
+ * @param count 输出: 有效触摸点数 (0 = 抬起帧)
+ * @return 0: 芯片还没有新数据 (Buffer Status 为 0), 1: 新的一帧
+ */
+static uint8_t GT9147_Parse_Frame(const uint8_t* frame, GT_TouchPoint_t* points, uint8_t max_points, uint8_t* count)
 {
-    uint8_t buf[4];
     uint8_t i = 0;
-    uint8_t point_status = 0;
+    uint8_t point_status = frame[0];
     uint8_t point_count = 0;
-    uint8_t clear_status = 0;
     uint8_t valid_point_count = 0;
-    
-    // 1. 参数校验
-    if(points == NULL || max_points == 0) {
-        return 0;
-    }
-    
-    // 2. 读取状态寄存器
-	GT9147_RD_Reg(GT_GSTID_REG, &point_status, 1);
-    
-    // 3. 检查 Buffer Status (bit 7)
-    //    如果 Buffer 未准备好 (bit 7 == 0)，则没有新事件。
-    //    我们必须返回 0，这将被应用层状态机正确处理为 IDLE 或 HOLDING（无状态变化）。
+
+    *count = 0;
+
+    // 检查 Buffer Status (bit 7)
+    // 如果 Buffer 未准备好 (bit 7 == 0)，则没有新事件。
 	if ((point_status & 0x80) == 0)
 	{
 		return 0; // 没有新数据
 	}
-    
-    // --- Buffer 准备好了 (bit 7 is 1) ---
 
-    // 4. 获取触摸点数量 (bits 3-0)
+    // 获取触摸点数量 (bits 3-0)
     point_count = point_status & 0x0F;
-    
-    // 5. [关键修复]
-    //    无论有多少个点（>0 或 ==0），我们都必须清除状态寄存器。
-    //    这告诉芯片我们已经处理了这一帧，并准备好接收下一帧。
-    GT9147_WR_Reg(GT_GSTID_REG, &clear_status, 1);
-
-    // 6. 检查触摸点
     if (point_count == 0 || point_count > GT_MAX_POINTS)
     {
-        return 0; // 没有有效点（可能是“抬起”事件，返回 0）
+        return 1; // 没有有效点（“抬起”帧）
     }
 
     // 限制最大点数
@@ -228,17 +252,16 @@ uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points)
         point_count = max_points;
     }
 
-    // 7. 循环读取坐标
 	for(i = 0; i < point_count; i++)
 	{
-		GT9147_RD_Reg(GT9147_TPX_TBL[i], buf, 4);
+		const uint8_t* buf = &frame[GT9147_TPX_TBL[i] - GT_GSTID_REG];
 		
 		uint16_t raw_x = ((uint16_t)buf[1] << 8) + buf[0];
 		uint16_t raw_y = ((uint16_t)buf[3] << 8) + buf[2];
 		
 		uint16_t temp_x, temp_y;
 		
-        // 8. 坐标转换
+        // 坐标转换
 		if(s_lcd_orientation == 1) // 横屏
 		{
 			temp_y = raw_x;
@@ -250,7 +273,7 @@ uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points)
 			temp_y = raw_y;
 		}
 		
-        // 9. 坐标校验（过滤掉屏幕外的非法点）
+        // 坐标校验（过滤掉屏幕外的非法点）
 		if(temp_x < s_lcd_width && temp_y < s_lcd_height)
 		{
 			points[valid_point_count].x = temp_x;
@@ -260,5 +283,196 @@ uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points)
 		}
 	}
     
-	return valid_point_count;
-}
\ No newline at end of file
+    *count = valid_point_count;
+	return 1;
+}
+
+/**
+ * @brief 同步读取一帧 (状态和坐标一次事务)，有新数据时清除状态寄存器
+ * @return 0: 没有新数据或读取失败, 1: 读到新的一帧
+ */
+static uint8_t GT9147_Read_Frame(GT_TouchPoint_t* points, uint8_t max_points, uint8_t* count)
+{
+    uint8_t frame[GT_FRAME_LEN];
+    uint8_t clear_status = 0;
+
+    *count = 0;
+    s_stats.reads++;
+
+    if (TOUCH_BUS_Read(GT_CMD_WR, GT_GSTID_REG, frame, sizeof(frame))) {
+        return 0;
+    }
+    if (!GT9147_Parse_Frame(frame, points, max_points, count)) {
+        return 0;
+    }
+
+    // 无论有多少个点都要清除状态寄存器，芯片才会准备下一帧
+    TOUCH_BUS_Write(GT_CMD_WR, GT_GSTID_REG, &clear_status, 1);
+    return 1;
+}
+
+uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points)
+{
+    uint8_t count;
+
+    // 1. 参数校验
+    if(points == NULL || max_points == 0) {
+        return 0;
+    }
+
+    // 没有新数据和抬起帧都返回 0，由应用层状态机处理
+    GT9147_Read_Frame(points, max_points, &count);
+    return count;
+}
+
+// ============================================================================
+// 中断模式和事件队列
+// ============================================================================
+
+/* INT 下降沿中断 (中断上下文) */
+static void GT9147_INT_Handler(void)
+{
+    s_stats.irqs++;
+
+    // 记录第一次未处理的 INT 时间，延迟按最早的算
+    if (!s_irq_pending)
+    {
+        s_irq_tick = TOUCH_HW_Get_Tick();
+        s_irq_cyc = TOUCH_HW_Get_Cycles();
+        s_irq_pending = 1;
+    }
+
+    if (s_irq_notify) {
+        s_irq_notify();
+    }
+}
+
+void GT9147_IRQ_Enable(void (*notify)(void))
+{
+    s_irq_notify = notify;
+    s_irq_pending = 0;
+    TOUCH_HW_INT_IRQ_Init(GT9147_INT_Handler);
+}
+
+/* 读取失败: 恢复未处理的 INT，下一次调度时重读 (不通知，免得总线故障时反复唤醒) */
+static void GT9147_Retry(const GT_TouchEvent_t* ev)
+{
+    if (!s_irq_pending)
+    {
+        s_irq_tick = ev->tick;
+        s_irq_cyc = ev->cyc;
+        s_irq_pending = 1;
+    }
+}
+
+/* 清除状态寄存器完成 (中断上下文): 读取期间又来了 INT 就再唤醒一次 */
+static void GT9147_Clear_Done(uint8_t err)
+{
+    (void)err; // 清除失败时芯片会再报告同一帧，状态机能容忍
+    s_xfer = GT_XFER_IDLE;
+    if (s_irq_pending && s_irq_notify) {
+        s_irq_notify();
+    }
+}
+
+/* 帧读取完成 (中断上下文): 解析、入队、通知，然后异步清除状态寄存器 */
+static void GT9147_Read_Done(uint8_t err)
+{
+    static const uint8_t clear_status = 0;
+    GT_TouchEvent_t* ev = &s_events[s_xfer_head & (GT_EVENT_QUEUE_LEN - 1)];
+
+    if (err)
+    {
+        GT9147_Retry(ev);
+        s_xfer = GT_XFER_IDLE;
+        return;
+    }
+    if (!GT9147_Parse_Frame(s_frame, ev->points, GT_MAX_POINTS, &ev->count))
+    {
+        s_xfer = GT_XFER_IDLE;
+        return;
+    }
+
+    s_stats.frames++;
+    __atomic_store_n(&s_ev_head, s_xfer_head + 1, __ATOMIC_RELEASE);
+
+    // 软件后端同步完成，回调在 Write_Start 返回前就把状态改回空闲
+    s_xfer = GT_XFER_CLEAR;
+    if (TOUCH_BUS_Write_Start(GT_CMD_WR, GT_GSTID_REG, &clear_status, 1, GT9147_Clear_Done)) {
+        s_xfer = GT_XFER_IDLE;
+    }
+
+    if (s_irq_notify) {
+        s_irq_notify();
+    }
+}
+
+uint8_t GT9147_Service(uint8_t force)
+{
+    GT_TouchEvent_t* ev;
+    uint32_t head = s_ev_head;
+
+    if (s_xfer != GT_XFER_IDLE)
+    {
+        // 完成回调迟迟不来 (总线挂死): 中止事务，回调以失败结束
+        if (TOUCH_HW_Get_Tick() - s_xfer_tick > TOUCH_BUS_TIMEOUT_MS) {
+            TOUCH_BUS_Abort();
+        }
+        return 0;
+    }
+
+    // 空闲时不访问 I2C
+    if (!s_irq_pending && !force) {
+        return 0;
+    }
+
+    if (head - __atomic_load_n(&s_ev_tail, __ATOMIC_ACQUIRE) >= GT_EVENT_QUEUE_LEN)
+    {
+        s_stats.overflows++; // 队列满，留到消费者取走之后再读
+        return 0;
+    }
+
+    ev = &s_events[head & (GT_EVENT_QUEUE_LEN - 1)];
+    if (s_irq_pending)
+    {
+        // 读取期间再来的 INT 会重新置位，下一次再读一帧
+        ev->tick = s_irq_tick;
+        ev->cyc = s_irq_cyc;
+        s_irq_pending = 0;
+    }
+    else
+    {
+        ev->tick = TOUCH_HW_Get_Tick();
+        ev->cyc = TOUCH_HW_Get_Cycles();
+    }
+
+    s_stats.reads++;
+    s_xfer_head = head;
+    s_xfer_tick = TOUCH_HW_Get_Tick();
+    s_xfer = GT_XFER_READ;
+    if (TOUCH_BUS_Read_Start(GT_CMD_WR, GT_GSTID_REG, s_frame, GT_FRAME_LEN, GT9147_Read_Done))
+    {
+        s_xfer = GT_XFER_IDLE;
+        GT9147_Retry(ev);
+        return 0;
+    }
+    return 1;
+}
+
+uint8_t GT9147_Get_Event(GT_TouchEvent_t* ev)
+{
+    uint32_t tail = s_ev_tail;
+
+    if (tail == __atomic_load_n(&s_ev_head, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+
+    *ev = s_events[tail & (GT_EVENT_QUEUE_LEN - 1)];
+    __atomic_store_n(&s_ev_tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+void GT9147_Get_Stats(GT_TouchStats_t* stats)
+{
+    *stats = s_stats;
+}
@@ -26,6 +26,8 @@
 
 #define GT9147_NEED_INT_OUTPUT_CONFIG
 
+#define GT_EVENT_QUEUE_LEN  8       // 触摸事件队列长度 (2的幂)
+
 /*
 ================================================================================
   公开数据结构
@@ -42,6 +44,28 @@ typedef struct
 	uint16_t y;         // 转换后的 Y 坐标
 } GT_TouchPoint_t;
 
+/**
+ * @brief 触摸事件 (芯片报告的一帧)
+ */
+typedef struct
+{
+	uint32_t tick;      // INT 到来的时刻 (ms)，主动读取时为读取时刻
+	uint32_t cyc;       // 同一时刻的 CPU 周期计数，用于计算处理延迟
+	uint8_t  count;     // 触摸点数，0 = 手指已全部抬起
+	GT_TouchPoint_t points[GT_MAX_POINTS];
+} GT_TouchEvent_t;
+
+/**
+ * @brief 触摸统计
+ */
+typedef struct
+{
+	uint32_t irqs;      // INT 中断次数
+	uint32_t reads;     // I2C 读取帧的次数 (含没有新数据的)
+	uint32_t frames;    // 读到的新帧 (进入事件队列)
+	uint32_t overflows; // 队列满推迟读取的次数
+} GT_TouchStats_t;
+
 
 /*
 ================================================================================
@@ -66,4 +90,33 @@ uint8_t GT9147_Init(uint16_t width, uint16_t height, uint8_t orientation);
  */
 uint8_t GT9147_Scan(GT_TouchPoint_t* points, uint8_t max_points);
 
+/**
+ * @brief 切换到中断模式: INT (下降沿) 到来时才读取
+ * @param notify 中断中调用的通知函数 (用于唤醒主循环)，可为 NULL
+ * @note  在 GT9147_Init 成功之后调用。芯片配置 0x804D 的低 2 位决定 INT 触发方式，
+ *        本驱动的配置表为下降沿 (01)
+ */
+void GT9147_IRQ_Enable(void (*notify)(void));
+
+/**
+ * @brief 主循环调用: 有未处理的 INT (或 force 为 1) 时启动读取一帧
+ * @param force 1 = 没有 INT 也读取 (轮询模式，或怀疑漏掉了 INT)
+ * @return 1: 已启动读取, 0: 没有启动 (空闲、队列满或上一次读取未完成)
+ * @note  没有 INT 且 force 为 0 时不访问 I2C。读取是异步事务 (TOUCH_BUS_Read_Start)，
+ *        新帧在完成回调中入队并调用 GT9147_IRQ_Enable 注册的通知函数；
+ *        软件 I2C 后端同步完成，返回时事件已经入队
+ */
+uint8_t GT9147_Service(uint8_t force);
+
+/**
+ * @brief 从事件队列取出最早的事件
+ * @return 1: 取到, 0: 队列空
+ */
+uint8_t GT9147_Get_Event(GT_TouchEvent_t* ev);
+
+/**
+ * @brief 获取触摸统计
+ */
+void GT9147_Get_Stats(GT_TouchStats_t* stats);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,82 @@
+#ifndef __TOUCH_BUS_H
+#define __TOUCH_BUS_H
+
+#include <stdint.h>
+
+/*
+================================================================================
+  触摸屏 I2C 总线抽象
+
+  按"事务"访问 16 位寄存器地址的 I2C 设备 (GT9147)，有两个后端:
+  - TOUCH_BUS_SOFT : 软件模拟 I2C (PB0/PF11)，事务同步完成，回调在返回前调用
+  - TOUCH_BUS_I2C  : 硬件 I2C1 + DMA (touch_i2c_dma.c)，启动后立即返回，
+                     完成回调在中断中调用，传输期间 CPU 不参与
+
+  gt9147_logic.c 的扫描 (GT9147_Service) 用异步事务读取一帧；初始化和配置写入
+  仍使用 touch_hal_port.h 中的字节级接口 (Start/Send_Byte/...)，硬件后端把这些
+  调用收集成阻塞事务再执行
+
+  板上触摸屏接在 PB0/PF11，这两个引脚没有 I2C 复用功能。使用硬件后端需要把
+  SCL/SDA 改接到 I2C1 (默认 PB8/PB9，见 touch_i2c_dma.c)，并外接上拉电阻
+================================================================================
+*/
+
+#define TOUCH_BUS_SOFT      0
+#define TOUCH_BUS_I2C       1
+
+#ifndef TOUCH_BUS_BACKEND
+#define TOUCH_BUS_BACKEND   TOUCH_BUS_SOFT
+#endif
+
+/* 一次写入最多的数据字节 (GT9147 配置表 184 字节 + 校验) */
+#define TOUCH_BUS_MAX_WRITE     188
+
+/* 阻塞接口等待一次事务的最长时间 */
+#define TOUCH_BUS_TIMEOUT_MS    10
+
+/**
+ * @brief 事务完成回调
+ * @param err 0: 成功, 1: 失败 (无应答/总线错误/超时)
+ */
+typedef void (*TOUCH_BUS_Done_t)(uint8_t err);
+
+/**
+ * @brief 初始化总线 (引脚、外设、DMA、中断)
+ */
+void TOUCH_BUS_Init(void);
+
+/**
+ * @brief 启动一次寄存器读取: START, addr+W, reg, RESTART, addr+R, len 字节, STOP
+ * @param addr 8 位写地址 (如 GT_CMD_WR)
+ * @param done 完成回调，可为 NULL
+ * @return 0: 已启动, 1: 总线忙或参数无效
+ * @note  buf 在完成之前必须保持有效
+ */
+uint8_t TOUCH_BUS_Read_Start(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done);
+
+/**
+ * @brief 启动一次寄存器写入: START, addr+W, reg, len 字节, STOP
+ * @return 0: 已启动, 1: 总线忙或参数无效
+ * @note  数据在启动时已拷贝，调用返回后 buf 即可复用
+ */
+uint8_t TOUCH_BUS_Write_Start(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done);
+
+/**
+ * @brief 是否有事务正在进行
+ */
+uint8_t TOUCH_BUS_Is_Busy(void);
+
+/**
+ * @brief 中止正在进行的事务并复位总线，完成回调以失败 (err = 1) 调用
+ * @note  异步调用方用它处理超时 (TOUCH_BUS_TIMEOUT_MS 内没有完成)
+ */
+void TOUCH_BUS_Abort(void);
+
+/**
+ * @brief 阻塞读取/写入: 启动事务并等待完成 (硬件后端等待期间执行 WFI)
+ * @return 0: 成功, 1: 失败
+ */
+uint8_t TOUCH_BUS_Read(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len);
+uint8_t TOUCH_BUS_Write(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len);
+
+#endif
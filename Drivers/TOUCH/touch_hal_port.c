@@ -1,5 +1,6 @@
 
 #include "touch_hal_port.h"
+#include "touch_bus.h"
 #include "main.h" // 包含 STM32 HAL 库
 
 /*
@@ -18,6 +19,10 @@
 #define CT_RST_PIN      GPIO_PIN_13
 #define CT_INT_PORT     GPIOB
 #define CT_INT_PIN      GPIO_PIN_1
+#define CT_INT_IRQn     EXTI1_IRQn
+#define CT_INT_IRQ_PRIO 5           // 低于 USB (0) 和串口 (1)
+
+static TOUCH_HW_INT_Callback_t s_int_cb = 0;
 
 /*
 ================================================================================
@@ -70,12 +75,55 @@ void TOUCH_HW_Set_INT_Mode_Output(void)
     HAL_GPIO_Init(CT_INT_PORT, &GPIO_Initure);
 }
 
+void TOUCH_HW_Set_INT_Mode_Input(void)
+{
+    GPIO_InitTypeDef GPIO_Initure;
+    
+    GPIO_Initure.Pin = CT_INT_PIN;
+    GPIO_Initure.Mode = GPIO_MODE_INPUT;
+    GPIO_Initure.Pull = GPIO_NOPULL;
+    GPIO_Initure.Speed = GPIO_SPEED_HIGH;
+    HAL_GPIO_Init(CT_INT_PORT, &GPIO_Initure);
+}
+
+void TOUCH_HW_INT_IRQ_Init(TOUCH_HW_INT_Callback_t cb)
+{
+    GPIO_InitTypeDef GPIO_Initure;
+
+    s_int_cb = cb;
+
+    GPIO_Initure.Pin = CT_INT_PIN;
+    GPIO_Initure.Mode = GPIO_MODE_IT_FALLING;
+    GPIO_Initure.Pull = GPIO_NOPULL;
+    GPIO_Initure.Speed = GPIO_SPEED_HIGH;
+    HAL_GPIO_Init(CT_INT_PORT, &GPIO_Initure);
+
+    __HAL_GPIO_EXTI_CLEAR_IT(CT_INT_PIN);
+    HAL_NVIC_SetPriority(CT_INT_IRQn, CT_INT_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(CT_INT_IRQn);
+}
+
+/* PB1 -> EXTI1 */
+void EXTI1_IRQHandler(void)
+{
+    if (__HAL_GPIO_EXTI_GET_IT(CT_INT_PIN) != 0)
+    {
+        __HAL_GPIO_EXTI_CLEAR_IT(CT_INT_PIN);
+        if (s_int_cb) {
+            s_int_cb();
+        }
+    }
+}
+
 /*
 ================================================================================
   2. 软件 I2C (基于 ctiic.c)
+     硬件 I2C + DMA 后端 (TOUCH_BUS_I2C) 的同名接口在 touch_i2c_dma.c
 ================================================================================
 */
 
+#if TOUCH_BUS_BACKEND == TOUCH_BUS_SOFT
+
 // SDA 设为输出模式
 static void SDA_Out(void)
 {
@@ -232,6 +280,92 @@ uint8_t TOUCH_HW_IIC_Read_Byte(unsigned char ack)
     return receive;
 }
 
+/* ========== 总线事务 (同步完成) ========== */
+
+// 发送 START、写地址和 16 位寄存器地址，无应答时已发出 STOP
+static uint8_t IIC_Send_Header(uint8_t addr, uint16_t reg)
+{
+    TOUCH_HW_IIC_Start();
+    TOUCH_HW_IIC_Send_Byte(addr);
+    if (TOUCH_HW_IIC_Wait_Ack()) return 1;
+    TOUCH_HW_IIC_Send_Byte(reg >> 8);
+    if (TOUCH_HW_IIC_Wait_Ack()) return 1;
+    TOUCH_HW_IIC_Send_Byte(reg & 0xFF);
+    return TOUCH_HW_IIC_Wait_Ack();
+}
+
+void TOUCH_BUS_Init(void)
+{
+    TOUCH_HW_IIC_Init();
+}
+
+uint8_t TOUCH_BUS_Read(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len)
+{
+    uint16_t i;
+
+    if (IIC_Send_Header(addr, reg)) return 1;
+
+    TOUCH_HW_IIC_Start();
+    TOUCH_HW_IIC_Send_Byte(addr | 1);
+    if (TOUCH_HW_IIC_Wait_Ack()) return 1;
+
+    for (i = 0; i < len; i++)
+    {
+        buf[i] = TOUCH_HW_IIC_Read_Byte(i != len - 1);
+    }
+    TOUCH_HW_IIC_Stop();
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Write(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len)
+{
+    uint16_t i;
+
+    if (IIC_Send_Header(addr, reg)) return 1;
+
+    for (i = 0; i < len; i++)
+    {
+        TOUCH_HW_IIC_Send_Byte(buf[i]);
+        if (TOUCH_HW_IIC_Wait_Ack()) return 1;
+    }
+    TOUCH_HW_IIC_Stop();
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Read_Start(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done)
+{
+    uint8_t err;
+
+    if (buf == 0 || len == 0) return 1;
+
+    err = TOUCH_BUS_Read(addr, reg, buf, len);
+    if (done) done(err);
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Write_Start(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done)
+{
+    uint8_t err;
+
+    if ((buf == 0 && len) || len > TOUCH_BUS_MAX_WRITE) return 1;
+
+    err = TOUCH_BUS_Write(addr, reg, buf, len);
+    if (done) done(err);
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Is_Busy(void)
+{
+    return 0;
+}
+
+void TOUCH_BUS_Abort(void)
+{
+    // 事务同步完成，不会有进行中的事务
+}
+
+#endif /* TOUCH_BUS_BACKEND == TOUCH_BUS_SOFT */
+
 /*
 ================================================================================
   3. 延时
@@ -243,6 +377,16 @@ void TOUCH_HW_Delay_ms(uint32_t ms)
     HAL_Delay(ms);
 }
 
+uint32_t TOUCH_HW_Get_Tick(void)
+{
+    return HAL_GetTick();
+}
+
+uint32_t TOUCH_HW_Get_Cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
 /**
  * @brief 硬件：微秒延时 (需要校准)
  */
@@ -37,6 +37,19 @@ uint8_t TOUCH_HW_Read_INT(void);
 
 void TOUCH_HW_Set_INT_Mode_Output(void);
 
+/**
+ * @brief INT 引脚恢复为输入 (初始化选定地址之后由芯片驱动)
+ */
+void TOUCH_HW_Set_INT_Mode_Input(void);
+
+typedef void (*TOUCH_HW_INT_Callback_t)(void);
+
+/**
+ * @brief 把 INT 引脚配置为下降沿外部中断
+ * @param cb 中断回调 (中断上下文)
+ */
+void TOUCH_HW_INT_IRQ_Init(TOUCH_HW_INT_Callback_t cb);
+
 
 
 /*
@@ -106,5 +119,15 @@ void TOUCH_HW_Delay_ms(uint32_t ms);
  */
 void TOUCH_HW_Delay_us(uint32_t us);
 
+/**
+ * @brief 毫秒计数 (事件时间戳)
+ */
+uint32_t TOUCH_HW_Get_Tick(void);
+
+/**
+ * @brief CPU 周期计数 (计算延迟，回绕按无符号减法处理)
+ */
+uint32_t TOUCH_HW_Get_Cycles(void);
+
 
 #endif
\ No newline at end of file
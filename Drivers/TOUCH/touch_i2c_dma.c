@@ -0,0 +1,509 @@
+#include "touch_bus.h"
+#include "touch_hal_port.h"
+#include "main.h" // 包含 STM32 HAL 库
+#include <string.h>
+#if TOUCH_BUS_BACKEND == TOUCH_BUS_I2C
+
+/*
+================================================================================
+  硬件 I2C + DMA 后端
+
+  I2C1 (SCL PB8, SDA PB9)，400kHz。寄存器地址和写入数据由 DMA 发送，读取的数据
+  由 DMA 接收 (只读 1 个字节时用 RXNE 中断)，START/地址/RESTART/STOP 在事件中断中
+  推进。一次事务 CPU 只处理 4~5 个中断，其余时间不参与
+
+  工程中没有 HAL I2C 驱动，I2C 外设直接操作寄存器，DMA 使用 HAL_DMA
+================================================================================
+*/
+
+// 引脚和外设
+#define TB_I2C              I2C1
+#define TB_GPIO_PORT        GPIOB
+#define TB_SCL_PIN          GPIO_PIN_8
+#define TB_SDA_PIN          GPIO_PIN_9
+#define TB_GPIO_AF          GPIO_AF4_I2C1
+#define TB_EV_IRQn          I2C1_EV_IRQn
+#define TB_ER_IRQn          I2C1_ER_IRQn
+#define TB_RX_DMA_STREAM    DMA1_Stream0
+#define TB_RX_DMA_IRQn      DMA1_Stream0_IRQn
+#define TB_TX_DMA_STREAM    DMA1_Stream6
+#define TB_TX_DMA_IRQn      DMA1_Stream6_IRQn
+#define TB_DMA_CHANNEL      DMA_CHANNEL_1
+#define TB_IRQ_PRIO         5           // 与触摸 INT 相同，彼此不抢占
+#define TB_SPEED_HZ         400000
+
+// 适配字节级接口时，读取一次预读的字节数 (GT9147 的坐标和 ID 都是 4 字节)
+#define TB_READ_AHEAD       4
+
+typedef enum {
+    TB_IDLE = 0,
+    TB_START,       // 等待 SB，发送写地址
+    TB_ADDR,        // 等待 ADDR，启动 DMA 发送寄存器地址 (和数据)
+    TB_TX,          // DMA 发送中，完成后等待 BTF
+    TB_RSTART,      // 等待 SB，发送读地址
+    TB_RADDR,       // 等待 ADDR，启动接收
+    TB_RX           // 接收中
+} TB_State_t;
+
+static struct {
+    volatile uint8_t busy;
+    volatile uint8_t err;
+    volatile TB_State_t state;
+    uint8_t addr;
+    uint8_t read;               // 1: 发完寄存器地址后重新开始读取
+    uint8_t* rx_buf;
+    uint16_t rx_len;
+    uint16_t tx_len;
+    TOUCH_BUS_Done_t done;
+    uint8_t tx_buf[2 + TOUCH_BUS_MAX_WRITE];
+} s_tb;
+
+static DMA_HandleTypeDef s_dma_rx;
+static DMA_HandleTypeDef s_dma_tx;
+
+/*
+================================================================================
+  外设配置和事务结束
+================================================================================
+*/
+
+static void TB_I2C_Config(void)
+{
+    uint32_t pclk = HAL_RCC_GetPCLK1Freq();
+    uint32_t mhz = pclk / 1000000U;
+
+    // 软件复位可以解除异常结束后残留的 BUSY 状态
+    TB_I2C->CR1 = I2C_CR1_SWRST;
+    TB_I2C->CR1 = 0;
+
+    TB_I2C->CR2 = mhz | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+    TB_I2C->CCR = I2C_CCR_FS | (pclk / (TB_SPEED_HZ * 3U)); // 快速模式, Tlow:Thigh = 2:1
+    TB_I2C->TRISE = mhz * 300U / 1000U + 1U;                // 快速模式最长上升时间 300ns
+    TB_I2C->CR1 = I2C_CR1_PE;
+}
+
+static void TB_Finish(uint8_t err)
+{
+    TOUCH_BUS_Done_t done = s_tb.done;
+
+    s_tb.state = TB_IDLE;
+    s_tb.err = err;
+    s_tb.busy = 0;
+    if (done) {
+        done(err);
+    }
+}
+
+static void TB_Abort(void)
+{
+    if (HAL_DMA_GetState(&s_dma_rx) == HAL_DMA_STATE_BUSY) {
+        HAL_DMA_Abort(&s_dma_rx);
+    }
+    if (HAL_DMA_GetState(&s_dma_tx) == HAL_DMA_STATE_BUSY) {
+        HAL_DMA_Abort(&s_dma_tx);
+    }
+    TB_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST | I2C_CR2_ITBUFEN);
+    TB_I2C->CR1 |= I2C_CR1_STOP;
+    TB_Finish(1);
+}
+
+static uint8_t TB_Start(void)
+{
+    uint32_t i;
+
+    // 上一次的 STOP 还没发完时不能设置 START
+    for (i = 0; (TB_I2C->CR1 & I2C_CR1_STOP) && i < 10000U; i++);
+
+    if (TB_I2C->SR2 & I2C_SR2_BUSY) {
+        TB_I2C_Config();
+        if (TB_I2C->SR2 & I2C_SR2_BUSY) {
+            return 1; // 从机一直拉低 SDA
+        }
+    }
+
+    s_tb.err = 0;
+    s_tb.state = TB_START;
+    TB_I2C->CR1 |= I2C_CR1_ACK | I2C_CR1_START;
+    return 0;
+}
+
+/*
+================================================================================
+  中断
+================================================================================
+*/
+
+static void TB_DMA_Tx_Cplt(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    // 最后一个字节已写入 DR，关闭 DMA 请求，等 BTF 再发 RESTART/STOP
+    TB_I2C->CR2 &= ~I2C_CR2_DMAEN;
+}
+
+static void TB_DMA_Rx_Cplt(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    // LAST 已让最后一个字节回 NACK
+    TB_I2C->CR2 &= ~(I2C_CR2_DMAEN | I2C_CR2_LAST);
+    TB_I2C->CR1 |= I2C_CR1_STOP;
+    TB_Finish(0);
+}
+
+static void TB_DMA_Error(DMA_HandleTypeDef* hdma)
+{
+    (void)hdma;
+    TB_Abort();
+}
+
+void I2C1_EV_IRQHandler(void)
+{
+    uint32_t sr1 = TB_I2C->SR1;
+
+    switch (s_tb.state)
+    {
+        case TB_START:
+            if (sr1 & I2C_SR1_SB) {
+                TB_I2C->DR = s_tb.addr;
+                s_tb.state = TB_ADDR;
+            }
+            break;
+
+        case TB_ADDR:
+            if (sr1 & I2C_SR1_ADDR) {
+                s_tb.state = TB_TX;
+                TB_I2C->CR2 |= I2C_CR2_DMAEN;
+                HAL_DMA_Start_IT(&s_dma_tx, (uint32_t)s_tb.tx_buf, (uint32_t)&TB_I2C->DR, s_tb.tx_len);
+                (void)TB_I2C->SR2; // 读 SR1 后读 SR2 清除 ADDR
+            }
+            break;
+
+        case TB_TX:
+            // DMA 还在发送时 BTF 只是短暂置位，等 DMA 写入下一个字节
+            if ((sr1 & I2C_SR1_BTF) && __HAL_DMA_GET_COUNTER(&s_dma_tx) == 0) {
+                TB_I2C->CR2 &= ~I2C_CR2_DMAEN;
+                if (s_tb.read) {
+                    s_tb.state = TB_RSTART;
+                    TB_I2C->CR1 |= I2C_CR1_START;
+                } else {
+                    TB_I2C->CR1 |= I2C_CR1_STOP;
+                    TB_Finish(0);
+                }
+            }
+            break;
+
+        case TB_RSTART:
+            if (sr1 & I2C_SR1_SB) {
+                TB_I2C->DR = s_tb.addr | 1;
+                s_tb.state = TB_RADDR;
+            }
+            break;
+
+        case TB_RADDR:
+            if (sr1 & I2C_SR1_ADDR) {
+                s_tb.state = TB_RX;
+                if (s_tb.rx_len == 1) {
+                    // 只读 1 个字节: 清除 ADDR 之前关闭应答，清除之后立即 STOP，用 RXNE 取数据
+                    TB_I2C->CR1 &= ~I2C_CR1_ACK;
+                    (void)TB_I2C->SR2;
+                    TB_I2C->CR1 |= I2C_CR1_STOP;
+                    TB_I2C->CR2 |= I2C_CR2_ITBUFEN;
+                } else {
+                    // DMA 接收，LAST 使最后一个字节自动回 NACK
+                    TB_I2C->CR2 |= I2C_CR2_DMAEN | I2C_CR2_LAST;
+                    HAL_DMA_Start_IT(&s_dma_rx, (uint32_t)&TB_I2C->DR, (uint32_t)s_tb.rx_buf, s_tb.rx_len);
+                    (void)TB_I2C->SR2;
+                }
+            }
+            break;
+
+        case TB_RX:
+            if ((sr1 & I2C_SR1_RXNE) && s_tb.rx_len == 1) {
+                s_tb.rx_buf[0] = (uint8_t)TB_I2C->DR;
+                TB_I2C->CR2 &= ~I2C_CR2_ITBUFEN;
+                TB_Finish(0);
+            }
+            break;
+
+        default:
+            // 没有事务时不应有事件，复位外设免得反复进中断
+            if (sr1 & (I2C_SR1_SB | I2C_SR1_ADDR | I2C_SR1_BTF)) {
+                TB_I2C_Config();
+            }
+            break;
+    }
+}
+
+void I2C1_ER_IRQHandler(void)
+{
+    // 无应答 (AF)、总线错误、仲裁丢失、溢出、超时
+    TB_I2C->SR1 &= ~(I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR | I2C_SR1_TIMEOUT);
+    if (s_tb.busy) {
+        TB_Abort();
+    }
+}
+
+void DMA1_Stream0_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&s_dma_rx);
+}
+
+void DMA1_Stream6_IRQHandler(void)
+{
+    HAL_DMA_IRQHandler(&s_dma_tx);
+}
+
+/*
+================================================================================
+  总线事务接口 (touch_bus.h)
+================================================================================
+*/
+
+static void TB_DMA_Init(DMA_HandleTypeDef* hdma, DMA_Stream_TypeDef* stream, uint32_t dir)
+{
+    hdma->Instance = stream;
+    hdma->Init.Channel = TB_DMA_CHANNEL;
+    hdma->Init.Direction = dir;
+    hdma->Init.PeriphInc = DMA_PINC_DISABLE;
+    hdma->Init.MemInc = DMA_MINC_ENABLE;
+    hdma->Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    hdma->Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+    hdma->Init.Mode = DMA_NORMAL;
+    hdma->Init.Priority = DMA_PRIORITY_LOW;
+    hdma->Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+    HAL_DMA_Init(hdma);
+    hdma->XferErrorCallback = TB_DMA_Error;
+}
+
+void TOUCH_BUS_Init(void)
+{
+    GPIO_InitTypeDef GPIO_Initure;
+
+    __HAL_RCC_GPIOB_CLK_ENABLE();
+    __HAL_RCC_I2C1_CLK_ENABLE();
+    __HAL_RCC_DMA1_CLK_ENABLE();
+
+    // SCL/SDA: 复用开漏 (板上没有上拉时需要外接)
+    GPIO_Initure.Pin = TB_SCL_PIN | TB_SDA_PIN;
+    GPIO_Initure.Mode = GPIO_MODE_AF_OD;
+    GPIO_Initure.Pull = GPIO_PULLUP;
+    GPIO_Initure.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+    GPIO_Initure.Alternate = TB_GPIO_AF;
+    HAL_GPIO_Init(TB_GPIO_PORT, &GPIO_Initure);
+
+    TB_DMA_Init(&s_dma_rx, TB_RX_DMA_STREAM, DMA_PERIPH_TO_MEMORY);
+    s_dma_rx.XferCpltCallback = TB_DMA_Rx_Cplt;
+    TB_DMA_Init(&s_dma_tx, TB_TX_DMA_STREAM, DMA_MEMORY_TO_PERIPH);
+    s_dma_tx.XferCpltCallback = TB_DMA_Tx_Cplt;
+
+    s_tb.busy = 0;
+    s_tb.state = TB_IDLE;
+    TB_I2C_Config();
+
+    HAL_NVIC_SetPriority(TB_EV_IRQn, TB_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TB_EV_IRQn);
+    HAL_NVIC_SetPriority(TB_ER_IRQn, TB_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TB_ER_IRQn);
+    HAL_NVIC_SetPriority(TB_RX_DMA_IRQn, TB_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TB_RX_DMA_IRQn);
+    HAL_NVIC_SetPriority(TB_TX_DMA_IRQn, TB_IRQ_PRIO, 0);
+    HAL_NVIC_EnableIRQ(TB_TX_DMA_IRQn);
+}
+
+uint8_t TOUCH_BUS_Read_Start(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done)
+{
+    if (buf == 0 || len == 0 || s_tb.busy) return 1;
+
+    s_tb.busy = 1;
+    s_tb.addr = addr;
+    s_tb.read = 1;
+    s_tb.rx_buf = buf;
+    s_tb.rx_len = len;
+    s_tb.tx_buf[0] = reg >> 8;
+    s_tb.tx_buf[1] = reg & 0xFF;
+    s_tb.tx_len = 2;
+    s_tb.done = done;
+
+    if (TB_Start()) {
+        s_tb.busy = 0;
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Write_Start(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len, TOUCH_BUS_Done_t done)
+{
+    uint16_t i;
+
+    if ((buf == 0 && len) || len > TOUCH_BUS_MAX_WRITE || s_tb.busy) return 1;
+
+    s_tb.busy = 1;
+    s_tb.addr = addr;
+    s_tb.read = 0;
+    s_tb.tx_buf[0] = reg >> 8;
+    s_tb.tx_buf[1] = reg & 0xFF;
+    for (i = 0; i < len; i++) {
+        s_tb.tx_buf[2 + i] = buf[i];
+    }
+    s_tb.tx_len = 2 + len;
+    s_tb.done = done;
+
+    if (TB_Start()) {
+        s_tb.busy = 0;
+        return 1;
+    }
+    return 0;
+}
+
+uint8_t TOUCH_BUS_Is_Busy(void)
+{
+    return s_tb.busy;
+}
+
+void TOUCH_BUS_Abort(void)
+{
+    __disable_irq();
+    if (s_tb.busy) {
+        TB_Abort();
+        TB_I2C_Config();
+    }
+    __enable_irq();
+}
+
+// 等待事务完成，期间睡眠 (DMA/I2C 中断唤醒)，超时则中止并复位外设
+static uint8_t TB_Wait(void)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (s_tb.busy)
+    {
+        __disable_irq();
+        if (s_tb.busy) {
+            __WFI();
+        }
+        __enable_irq();
+
+        if (HAL_GetTick() - start > TOUCH_BUS_TIMEOUT_MS)
+        {
+            TOUCH_BUS_Abort();
+            return 1;
+        }
+    }
+    return s_tb.err;
+}
+
+uint8_t TOUCH_BUS_Read(uint8_t addr, uint16_t reg, uint8_t* buf, uint16_t len)
+{
+    if (TOUCH_BUS_Read_Start(addr, reg, buf, len, 0)) return 1;
+    return TB_Wait();
+}
+
+uint8_t TOUCH_BUS_Write(uint8_t addr, uint16_t reg, const uint8_t* buf, uint16_t len)
+{
+    if (TOUCH_BUS_Write_Start(addr, reg, buf, len, 0)) return 1;
+    return TB_Wait();
+}
+
+/*
+================================================================================
+  字节级接口适配 (touch_hal_port.h 第 2 节)
+
+  只用于初始化和配置写入，扫描走上面的异步事务。gt9147_logic.c 按 START / 地址 / 寄存器 / [RESTART / 读地址 / 读 N 字节] / STOP
+  逐字节调用。这里把写入收集起来在 STOP 时作为一次事务发出；读取在第一次
+  Read_Byte 时发起，ack=0 (最后一个字节) 时只读 1 个字节，否则按 TB_READ_AHEAD
+  预读 (GT9147 的寄存器可以随意多读)
+
+  应答在事务执行时才知道: Wait_Ack 返回本次访问中已发生的错误，写入的错误只能
+  在 STOP 之后体现 (驱动逻辑本来也不检查写入结果)
+================================================================================
+*/
+
+enum { IIC_IDLE = 0, IIC_WRITE, IIC_RESTART, IIC_READ };
+
+static struct {
+    uint8_t state;
+    uint8_t err;
+    uint16_t len;               // 已收集的字节 (写地址、寄存器高/低字节、数据)
+    uint8_t buf[3 + TOUCH_BUS_MAX_WRITE];
+    uint16_t rd_reg;            // 下一次预读的寄存器地址
+    uint8_t rd_buf[TB_READ_AHEAD];
+    uint8_t rd_pos;
+    uint8_t rd_len;
+} s_iic;
+
+void TOUCH_HW_IIC_Init(void)
+{
+    s_iic.state = IIC_IDLE;
+    TOUCH_BUS_Init();
+}
+
+void TOUCH_HW_IIC_Start(void)
+{
+    if (s_iic.state == IIC_WRITE && s_iic.len >= 3) {
+        s_iic.state = IIC_RESTART; // 寄存器地址已写入，接下来是读取
+        return;
+    }
+    s_iic.state = IIC_WRITE;
+    s_iic.len = 0;
+    s_iic.err = 0;
+}
+
+void TOUCH_HW_IIC_Stop(void)
+{
+    uint16_t reg = ((uint16_t)s_iic.buf[1] << 8) | s_iic.buf[2];
+
+    if (s_iic.state == IIC_WRITE && s_iic.len >= 3 && !s_iic.err) {
+        s_iic.err = TOUCH_BUS_Write(s_iic.buf[0], reg, &s_iic.buf[3], s_iic.len - 3);
+    }
+    s_iic.state = IIC_IDLE;
+}
+
+void TOUCH_HW_IIC_Send_Byte(uint8_t txd)
+{
+    if (s_iic.state == IIC_RESTART) {
+        // 读地址: 读取从 Read_Byte 开始
+        s_iic.state = IIC_READ;
+        s_iic.rd_reg = ((uint16_t)s_iic.buf[1] << 8) | s_iic.buf[2];
+        s_iic.rd_pos = 0;
+        s_iic.rd_len = 0;
+        return;
+    }
+    if (s_iic.len < sizeof(s_iic.buf)) {
+        s_iic.buf[s_iic.len++] = txd;
+    } else {
+        s_iic.err = 1;
+    }
+}
+
+uint8_t TOUCH_HW_IIC_Read_Byte(unsigned char ack)
+{
+    if (s_iic.state != IIC_READ) {
+        return 0xFF;
+    }
+    if (s_iic.rd_pos >= s_iic.rd_len) {
+        uint8_t n = ack ? TB_READ_AHEAD : 1;
+
+        if (TOUCH_BUS_Read(s_iic.buf[0], s_iic.rd_reg, s_iic.rd_buf, n)) {
+            s_iic.err = 1;
+            memset(s_iic.rd_buf, 0, n);
+        }
+        s_iic.rd_reg += n;
+        s_iic.rd_pos = 0;
+        s_iic.rd_len = n;
+    }
+    return s_iic.rd_buf[s_iic.rd_pos++];
+}
+
+uint8_t TOUCH_HW_IIC_Wait_Ack(void)
+{
+    return s_iic.err;
+}
+
+void TOUCH_HW_IIC_Ack(void)
+{
+}
+
+void TOUCH_HW_IIC_NAck(void)
+{
+}
+
+#endif /* TOUCH_BUS_BACKEND == TOUCH_BUS_I2C */
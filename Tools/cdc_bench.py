@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+"""
+Host side of the firmware CDC benchmark (Core/Src/cdc_bench.c) on Linux.
+
+Sends "BENCH <MODE>" to the default CDC port, runs for a while and closes the
+port, which ends the benchmark on the device (DTR off).
+
+  source  the device streams the n % 251 pattern; it is read and checked
+  sink    the pattern is written at full rate; the device counts lost bytes
+  loop    the device echoes; data is written in timestamped chunks and the
+          round-trip time of each chunk is measured
+
+The device's own report (terminal title line) shows the gap between two
+transfers, not a round trip; loop mode here is where latency comes from.
+
+  cdc_bench.py /dev/ttyACM0 source
+  cdc_bench.py /dev/ttyACM0 loop -t 5                 # RTT under load (8 KB in flight)
+  cdc_bench.py /dev/ttyACM0 loop --chunk 63 --window 63   # RTT of one packet, idle bus
+  cdc_bench.py /tmp/sim0 sink                         # Tools/host usb_sim -l /tmp/sim
+
+Linux cdc-acm sends no ZLP, so when only one chunk is in flight it must not be a
+multiple of 64 bytes, or it waits in the device until the next one arrives.
+"""
+
+import argparse
+import collections
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+PATTERN_MOD = 251   # CDC_BENCH_PATTERN_MOD
+READ_MAX = 65536
+# pattern bytes from any phase: PATTERN[phase:phase + n]
+PATTERN = bytes(i % PATTERN_MOD for i in range(PATTERN_MOD + READ_MAX))
+MODES = ("source", "sink", "loop")
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    tty.setraw(fd)
+    return fd
+
+
+def drain(fd, quiet=0.2, rounds=10):
+    """Discard what an earlier session left in the tty and the device"""
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    # a short packet ends an OUT transfer the last session left half full,
+    # so its bytes are not glued to the command. The "\r" can itself fill
+    # that transfer and wait in the device, so repeat until only "\r"s (echo)
+    # or nothing come back.
+    for _ in range(rounds):
+        os.write(fd, b"\r")
+        got = b""
+        while select.select([fd], [], [], quiet)[0]:
+            try:
+                data = os.read(fd, READ_MAX)
+            except BlockingIOError:
+                break
+            if not data:
+                break
+            got += data
+        if not got.strip(b"\r"):
+            return
+
+
+def percentiles(samples):
+    """p50, p99 and max of a list of seconds, in microseconds"""
+    if not samples:
+        return 0, 0, 0
+    s = sorted(samples)
+    pick = lambda q: s[min(len(s) - 1, int(len(s) * q))] * 1e6
+    return pick(0.50), pick(0.99), s[-1] * 1e6
+
+
+class Bench:
+    def __init__(self, fd, mode, chunk, window):
+        self.fd = fd
+        self.mode = mode
+        self.chunk = chunk
+        self.window = window
+        self.tx = 0
+        self.rx = 0
+        self.breaks = 0          # source: places where the pattern jumps
+        self.expect = None       # source: next pattern byte, None until synced
+        self.times = []          # source: gaps between reads; loop: round trips
+        self.last_read = None
+        self.inflight = collections.deque()  # loop: (end offset, send time)
+
+    def want_write(self):
+        if self.mode == "sink":
+            return True
+        return self.mode == "loop" and self.tx - self.rx < self.window
+
+    def write(self):
+        n = self.chunk if self.mode == "loop" else 4096
+        start = self.tx % PATTERN_MOD
+        try:
+            n = os.write(self.fd, PATTERN[start:start + n])
+        except BlockingIOError:
+            return
+        self.tx += n
+        if self.mode == "loop":
+            self.inflight.append((self.tx, time.monotonic()))
+
+    def read(self):
+        try:
+            data = os.read(self.fd, READ_MAX)
+        except BlockingIOError:
+            return
+        if not data:
+            return
+        now = time.monotonic()
+        if self.mode == "loop":
+            ref = PATTERN[self.rx % PATTERN_MOD:self.rx % PATTERN_MOD + len(data)]
+            if data != ref:
+                i = next(i for i in range(len(data)) if data[i] != ref[i])
+                raise ValueError("echo error at byte %d: got %d, expected %d"
+                                 % (self.rx + i, data[i], ref[i]))
+            self.rx += len(data)
+            while self.inflight and self.inflight[0][0] <= self.rx:
+                self.times.append(now - self.inflight.popleft()[1])
+            return
+        if self.last_read is not None:
+            self.times.append(now - self.last_read)
+        self.last_read = now
+        expect = data[0] if self.expect is None else self.expect
+        ref = PATTERN[expect:expect + len(data)]
+        if data != ref:
+            # count the jump and resync on what the device actually sent
+            self.breaks += sum(1 for i in range(1, len(data))
+                               if data[i] != (data[i - 1] + 1) % PATTERN_MOD)
+            self.breaks += data[0] != expect
+        self.expect = (data[-1] + 1) % PATTERN_MOD
+        self.rx += len(data)
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Host side of the firmware CDC benchmark")
+    ap.add_argument("port", help="tty of the default CDC port, e.g. /dev/ttyACM0")
+    ap.add_argument("mode", choices=MODES)
+    ap.add_argument("-t", "--time", type=float, default=10.0, help="seconds to run")
+    ap.add_argument("--chunk", type=int, default=512, help="loop: bytes per timestamped write")
+    ap.add_argument("--window", type=int, default=8192, help="loop: max unechoed bytes")
+    args = ap.parse_args()
+
+    try:
+        fd = open_port(args.port)
+    except OSError as e:
+        sys.exit(str(e))
+
+    bench = Bench(fd, args.mode, args.chunk, args.window)
+    try:
+        drain(fd)
+        os.write(fd, b"BENCH " + args.mode.upper().encode())
+        time.sleep(0.05)   # the device takes the command as one chunk
+        t0 = time.monotonic()
+        while time.monotonic() - t0 < args.time:
+            wr = [fd] if bench.want_write() else []
+            r, w, _ = select.select([fd], wr, [], 0.1)
+            if w:
+                bench.write()
+            if r:
+                bench.read()
+        elapsed = time.monotonic() - t0
+    except ValueError as e:
+        sys.exit("%s: %s" % (args.port, e))
+    finally:
+        os.close(fd)
+
+    moved = bench.rx if args.mode != "sink" else bench.tx
+    print("%s %.1fs: %.3f MB/s (out %d B, in %d B)"
+          % (args.mode, elapsed, moved / elapsed / 1e6, bench.tx, bench.rx))
+    p50, p99, pmax = percentiles(bench.times)
+    if args.mode == "source":
+        print("pattern breaks %d, read gap p50 %.0fus p99 %.0fus max %.0fus"
+              % (bench.breaks, p50, p99, pmax))
+    elif args.mode == "loop":
+        print("round trip (%d B chunks, %d samples) p50 %.0fus p99 %.0fus max %.0fus"
+              % (args.chunk, len(bench.times), p50, p99, pmax))
+    else:
+        print("lost bytes are counted on the device (terminal title line)")
+    if moved == 0:
+        sys.exit("no data")
+
+
+if __name__ == "__main__":
+    main()
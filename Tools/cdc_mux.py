@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+"""
+Host side of the CDC virtual channel mux (Core/Inc/cdc_mux.h).
+
+Sends "MUX ON" on the default CDC port, then speaks the framed protocol:
+channel 0 carries the terminal's text commands, channel 1 is looped back
+by the device.
+
+  cdc_mux.py /dev/ttyACM0 --cmd STATS        # send a command on channel 0
+  cdc_mux.py COM5 --bench 10                 # loopback throughput on channel 1
+  cdc_mux.py COM5 --bench 10 --size 512      # write size per channel write
+"""
+
+import argparse
+import os
+import sys
+import time
+
+HDR_LEN = 3
+TYPE_DATA, TYPE_CREDIT, TYPE_CLOSE = 0, 1, 2
+MAX_CHUNK = 512          # same as CDC_MUX_MAX_CHUNK
+HOST_WINDOW = 0xFFFF     # credit granted per channel, host buffers are unbounded
+
+
+class MuxError(Exception):
+    pass
+
+
+def header(ftype, ch, length):
+    return bytes(((ftype << 4) | ch, length & 0xFF, length >> 8))
+
+
+class Mux:
+    def __init__(self, ser, channels=16):
+        self.ser = ser
+        self.credit = [0] * channels       # bytes the device still accepts
+        self.rx = [bytearray() for _ in range(channels)]
+        self.granted = [False] * channels
+        self.buf = bytearray()
+        self.hdr_bytes = [0, 0]            # [rx, tx]
+        self.data_bytes = [0, 0]
+
+    def open(self, timeout=2.0):
+        """Switch the device into mux mode and wait for its initial credits."""
+        self.ser.reset_input_buffer()
+        self.ser.write(b"MUX ON")
+        deadline = time.monotonic() + timeout
+        while not any(self.credit):
+            if time.monotonic() > deadline:
+                raise MuxError("no credit from device (is the port in text mode?)")
+            self.poll()
+        for ch in range(len(self.credit)):
+            if self.credit[ch]:
+                self._send(header(TYPE_CREDIT, ch, HOST_WINDOW))
+
+    def close(self):
+        self._send(header(TYPE_CLOSE, 0, 0))
+
+    def _send(self, frame):
+        self.hdr_bytes[1] += HDR_LEN
+        self.ser.write(frame)
+
+    def write(self, ch, data):
+        """Queue as much of data as the device's credit allows, return bytes sent."""
+        out = bytearray()
+        sent = 0
+        while sent < len(data) and self.credit[ch]:
+            n = min(len(data) - sent, self.credit[ch], MAX_CHUNK)
+            out += header(TYPE_DATA, ch, n) + data[sent:sent + n]
+            self.credit[ch] -= n
+            self.hdr_bytes[1] += HDR_LEN
+            sent += n
+        if out:
+            self.ser.write(out)
+        self.data_bytes[1] += sent
+        return sent
+
+    def read(self, ch):
+        data = bytes(self.rx[ch])
+        self.rx[ch].clear()
+        return data
+
+    def poll(self):
+        chunk = self.ser.read(self.ser.in_waiting or 1)
+        self.buf += chunk
+        i = 0
+        returned = {}
+        while len(self.buf) - i >= HDR_LEN:
+            ftype, ch = self.buf[i] >> 4, self.buf[i] & 0x0F
+            length = self.buf[i + 1] | (self.buf[i + 2] << 8)
+            if ftype == TYPE_CREDIT:
+                self.credit[ch] += length
+            elif ftype == TYPE_DATA:
+                if len(self.buf) - i < HDR_LEN + length:
+                    break
+                self.rx[ch] += self.buf[i + HDR_LEN:i + HDR_LEN + length]
+                self.data_bytes[0] += length
+                returned[ch] = returned.get(ch, 0) + length
+            else:
+                raise MuxError("bad frame type %d" % ftype)
+            self.hdr_bytes[0] += HDR_LEN
+            i += HDR_LEN + (length if ftype == TYPE_DATA else 0)
+        del self.buf[:i]
+        # data is moved out of the window at once, give the credit straight back
+        for ch, n in returned.items():
+            self._send(header(TYPE_CREDIT, ch, n))
+        return len(chunk)
+
+
+def bench(mux, seconds, size):
+    pattern = os.urandom(size)
+    expect = bytearray()
+    got = 0
+    start = time.monotonic()
+    while time.monotonic() - start < seconds:
+        if mux.credit[1] >= size:
+            mux.write(1, pattern)
+            expect += pattern
+        mux.poll()
+        data = mux.read(1)
+        if data:
+            if expect[:len(data)] != data:
+                raise MuxError("loopback mismatch at byte %d" % got)
+            del expect[:len(data)]
+            got += len(data)
+    elapsed = time.monotonic() - start
+    hdr = sum(mux.hdr_bytes)
+    total = hdr + sum(mux.data_bytes)
+    print("loopback %d bytes in %.1fs: %.1f KB/s each way, header overhead %.2f%%"
+          % (got, elapsed, got / elapsed / 1024, 100.0 * hdr / total if total else 0))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    ap.add_argument("port", help="serial port, e.g. /dev/ttyACM0 or COM5")
+    ap.add_argument("--cmd", help="send a text command on channel 0 and print the reply")
+    ap.add_argument("--bench", type=float, metavar="SECONDS", help="loopback test on channel 1")
+    ap.add_argument("--size", type=int, default=512, help="bytes per write in --bench")
+    args = ap.parse_args()
+
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is required: pip install pyserial")
+
+    with serial.Serial(args.port, timeout=0.05) as ser:
+        mux = Mux(ser)
+        mux.open()
+        try:
+            if args.cmd:
+                mux.write(0, args.cmd.encode())
+                deadline = time.monotonic() + 1.0
+                while time.monotonic() < deadline:
+                    mux.poll()
+                sys.stdout.write(mux.read(0).decode(errors="replace"))
+            if args.bench:
+                bench(mux, args.bench, args.size)
+        finally:
+            mux.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,181 @@
+#!/usr/bin/env python3
+"""
+Per-port and aggregate throughput of a multi-port CDC ACM device (Linux).
+
+All ports run at the same time, so the numbers show how the ports share the
+bus (CDC_ACM_PORT_NUM / CDC_ACM_BUS_NUM in Core/Inc/cdc_acm_ringbuffer.h).
+Each port is PATH[:MODE]:
+
+  loop          the device echoes everything; data is sent and checked back
+  bench-loop    send "BENCH LOOP" first (firmware default port), then as loop
+  bench-source  send "BENCH SOURCE" first, then read and check the pattern
+
+Closing the port ends a BENCH mode on the device (DTR off).
+
+  cdc_port_bench.py /dev/ttyACM0:bench-loop                # board, port 0
+  cdc_port_bench.py /tmp/sim0 /tmp/sim1 -t 5               # Tools/host usb_sim_2port
+  cdc_port_bench.py /tmp/sim0:bench-source /tmp/sim1       # flood one port, echo the other
+
+Only ports that move data can be measured: on the board port 1 is the text
+control channel, so multi-port numbers come from the simulator builds
+(Tools/host, make usb_sim_2port / usb_sim_2bus) or firmware that echoes.
+"""
+
+import argparse
+import os
+import select
+import sys
+import termios
+import time
+import tty
+
+PATTERN_MOD = 251   # CDC_BENCH_PATTERN_MOD
+READ_MAX = 65536
+# pattern bytes from any phase: PATTERN[phase:phase + n]
+PATTERN = bytes(i % PATTERN_MOD for i in range(PATTERN_MOD + READ_MAX))
+MODES = ("loop", "bench-loop", "bench-source")
+
+
+class Port:
+    def __init__(self, spec, window):
+        path, _, mode = spec.partition(":")
+        self.path = path
+        self.mode = mode or "loop"
+        if self.mode not in MODES:
+            raise ValueError("%s: unknown mode %r" % (spec, self.mode))
+        self.window = window
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self.fd)
+        self.tx = 0            # bytes written (loop modes)
+        self.rx = 0            # bytes read and checked
+        self.expect = None     # next pattern byte (source mode), None until synced
+        self.last = (0, 0)     # (tx, rx) at the previous report
+
+    def drain(self, quiet=0.2, rounds=10):
+        """Discard what an earlier session left in the tty and the device"""
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        # a short packet ends an OUT transfer the last session left half full,
+        # so its bytes are not glued to the next command; the "\r" can itself
+        # complete a full transfer that then waits, so repeat until it is quiet
+        for _ in range(rounds):
+            os.write(self.fd, b"\r")
+            got = b""
+            while select.select([self.fd], [], [], quiet)[0]:
+                try:
+                    data = os.read(self.fd, READ_MAX)
+                except BlockingIOError:
+                    break
+                if not data:
+                    break
+                got += data
+            if not got.strip(b"\r"):
+                return
+
+    def start(self):
+        self.drain()
+        if self.mode == "bench-loop":
+            os.write(self.fd, b"BENCH LOOP")
+        elif self.mode == "bench-source":
+            os.write(self.fd, b"BENCH SOURCE")
+        if self.mode != "loop":
+            time.sleep(0.05)   # the device takes the command as one chunk
+
+    @property
+    def sends(self):
+        return self.mode != "bench-source"
+
+    def want_write(self):
+        return self.sends and self.tx - self.rx < self.window
+
+    def write(self):
+        n = min(self.window - (self.tx - self.rx), 4096)
+        start = self.tx % PATTERN_MOD
+        try:
+            self.tx += os.write(self.fd, PATTERN[start:start + n])
+        except BlockingIOError:
+            pass
+
+    def read(self):
+        try:
+            data = os.read(self.fd, READ_MAX)
+        except BlockingIOError:
+            return
+        if not data:
+            return
+        if self.sends:
+            expect = self.rx % PATTERN_MOD
+        else:
+            expect = data[0] % PATTERN_MOD if self.expect is None else self.expect
+        ref = PATTERN[expect:expect + len(data)]
+        if data != ref:
+            i = next(i for i in range(len(data)) if data[i] != ref[i])
+            raise ValueError("%s: data error at byte %d: got %d, expected %d"
+                             % (self.path, self.rx + i, data[i], ref[i]))
+        self.expect = (expect + len(data)) % PATTERN_MOD
+        self.rx += len(data)
+
+    def close(self):
+        os.close(self.fd)
+
+
+def rate(n, seconds):
+    return "%9.1f KB/s" % (n / seconds / 1024) if seconds > 0 else "-"
+
+
+def report(ports, seconds, totals=False):
+    agg_tx = agg_rx = 0
+    for i, p in enumerate(ports):
+        tx, rx = (p.tx, p.rx) if totals else (p.tx - p.last[0], p.rx - p.last[1])
+        p.last = (p.tx, p.rx)
+        agg_tx += tx
+        agg_rx += rx
+        print("  port %d %-13s out %s  in %s" % (i, p.mode, rate(tx, seconds), rate(rx, seconds)))
+    print("  aggregate          out %s  in %s  bus %s"
+          % (rate(agg_tx, seconds), rate(agg_rx, seconds), rate(agg_tx + agg_rx, seconds)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Per-port and aggregate CDC ACM throughput")
+    ap.add_argument("ports", nargs="+", metavar="PATH[:MODE]", help="modes: " + ", ".join(MODES))
+    ap.add_argument("-t", "--time", type=float, default=10.0, help="seconds to run")
+    ap.add_argument("--window", type=int, default=8192, help="max unechoed bytes per loop port")
+    ap.add_argument("--interval", type=float, default=1.0, help="seconds between reports")
+    args = ap.parse_args()
+
+    try:
+        ports = [Port(spec, args.window) for spec in args.ports]
+    except (OSError, ValueError) as e:
+        sys.exit(str(e))
+
+    try:
+        for p in ports:
+            p.start()
+        t0 = tick = time.monotonic()
+        while time.monotonic() - t0 < args.time:
+            rd = [p.fd for p in ports]
+            wr = [p.fd for p in ports if p.want_write()]
+            r, w, _ = select.select(rd, wr, [], 0.1)
+            for p in ports:
+                if p.fd in w:
+                    p.write()
+                if p.fd in r:
+                    p.read()
+            now = time.monotonic()
+            if now - tick >= args.interval:
+                print("%.0fs" % (now - t0))
+                report(ports, now - tick)
+                tick = now
+        print("total %.1fs" % (time.monotonic() - t0))
+        report(ports, time.monotonic() - t0, totals=True)
+    except ValueError as e:
+        sys.exit(str(e))
+    finally:
+        for p in ports:
+            p.close()
+
+    if any(p.rx == 0 for p in ports):
+        sys.exit("no data on: " + ", ".join(p.path for p in ports if p.rx == 0))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,148 @@
+/*
+ * Host microbenchmark for the dwc2 FIFO copy routines (usb_dwc2_fifo.h).
+ *
+ * Compares, per packet:
+ *   old     - the one-word-per-iteration loop dwc2_ep_write/read used before
+ *   burst   - dwc2_fifo_write/dwc2_fifo_read (the C fallback of the burst
+ *             paths; the LDM/STM asm is only built for ARMv7-M)
+ *   memcpy  - usb_memcpy into a plain buffer, as a lower bound
+ *
+ * The FIFO window is a 4KB volatile array, so the numbers show loop and
+ * alignment overhead, not bus timing. On target, measure with DWT->CYCCNT
+ * around USBD_IRQHandler.
+ *
+ *   fifo_bench            # model check, then timings
+ *   fifo_bench --check    # model check only (used by "make check")
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "host_cmsis.h"
+#include "usb_dwc2_fifo.h"
+
+#define CONFIG_USB_MEMCPY_DISABLE
+#include "usb_memcpy.h"
+
+int fifo_model_check(int verbose);
+
+static volatile uint32_t s_window[1024];
+static uint8_t s_src[4096 + 16] __attribute__((aligned(16)));
+static uint8_t s_dst[4096 + 16] __attribute__((aligned(16)));
+static volatile uint32_t s_sink;
+
+static void old_write(__IO uint32_t *fifo, uint8_t *src, uint16_t len)
+{
+    uint32_t count32b = ((uint32_t)len + 3U) / 4U;
+
+    for (uint32_t i = 0U; i < count32b; i++) {
+        *fifo = __UNALIGNED_UINT32_READ(src);
+        src += 4;
+    }
+}
+
+static void old_read(__IO uint32_t *fifo, uint8_t *dest, uint16_t len)
+{
+    uint32_t count32b = ((uint32_t)len + 3U) / 4U;
+
+    for (uint32_t i = 0U; i < count32b; i++) {
+        __UNALIGNED_UINT32_WRITE(dest, *fifo);
+        dest += 4;
+    }
+}
+
+static void burst_write(__IO uint32_t *fifo, uint8_t *src, uint16_t len)
+{
+    dwc2_fifo_write(fifo, src, len);
+}
+
+static void burst_read(__IO uint32_t *fifo, uint8_t *dest, uint16_t len)
+{
+    dwc2_fifo_read(fifo, dest, len);
+}
+
+static void memcpy_write(__IO uint32_t *fifo, uint8_t *src, uint16_t len)
+{
+    (void)fifo;
+    usb_memcpy(s_dst, src, len);
+}
+
+static void memcpy_read(__IO uint32_t *fifo, uint8_t *dest, uint16_t len)
+{
+    (void)fifo;
+    usb_memcpy(dest, s_src, len);
+}
+
+typedef void (*copy_fn_t)(__IO uint32_t *fifo, uint8_t *buf, uint16_t len);
+
+static double now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* Best of several runs, ns per packet */
+static double time_copy(copy_fn_t fn, uint8_t *buf, uint16_t len)
+{
+    const uint32_t iters = 200000U;
+    double best = 1e30;
+
+    for (int run = 0; run < 5; run++) {
+        double t0 = now_ns();
+        for (uint32_t i = 0; i < iters; i++) {
+            fn(s_window, buf, len);
+            __asm volatile("" ::: "memory");
+        }
+        double ns = (now_ns() - t0) / iters;
+        if (ns < best) {
+            best = ns;
+        }
+    }
+    s_sink += s_dst[0];
+    return best;
+}
+
+static void bench_row(const char *dir, copy_fn_t f_old, copy_fn_t f_new, copy_fn_t f_mem,
+                      uint8_t *base, uint16_t len, uint32_t align)
+{
+    double t_old = time_copy(f_old, base + align, len);
+    double t_new = time_copy(f_new, base + align, len);
+    double t_mem = time_copy(f_mem, base + align, len);
+
+    printf("%-5s %4u  %u   %8.1f %8.1f %8.1f   %5.2fx\n",
+           dir, len, align, t_old, t_new, t_mem, t_new > 0 ? t_old / t_new : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint16_t lens[] = { 8, 61, 62, 63, 64, 509, 510, 511, 512 };
+    int check_only = argc > 1 && strcmp(argv[1], "--check") == 0;
+
+    if (fifo_model_check(!check_only)) {
+        return 1;
+    }
+    if (check_only) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < sizeof(s_src); i++) {
+        s_src[i] = (uint8_t)i;
+    }
+
+    printf("\nns per packet (lower is better), speedup = old / burst\n");
+    printf("dir    len  al       old    burst   memcpy   speedup\n");
+    for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        for (uint32_t align = 0; align < 4U; align += 1U) {
+            bench_row("write", old_write, burst_write, memcpy_write,
+                      s_src, lens[i], align);
+        }
+    }
+    for (uint32_t i = 0; i < sizeof(lens) / sizeof(lens[0]); i++) {
+        for (uint32_t align = 0; align < 4U; align += 1U) {
+            bench_row("read", old_read, burst_read, memcpy_read, s_dst, lens[i], align);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Correctness model for the dwc2 FIFO copy routines (usb_dwc2_fifo.h).
+ *
+ * The 4KB FIFO window is replaced by a software fifo: every access to word i
+ * of the window pushes/pops the same queue, as on the core. Checks every
+ * length up to two max-size HS packets, every source/destination alignment,
+ * and that nothing is written outside [dest, dest + len).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_cmsis.h"
+
+#define FIFO_WINDOW_WORDS 1024U /* USB_OTG_FIFO_SIZE / 4 */
+#define FIFO_DEPTH        512U
+
+static uint32_t s_fifo[FIFO_DEPTH];
+static uint32_t s_head, s_tail;
+static uint32_t s_bad_index;
+
+static void model_push(uint32_t i, uint32_t v)
+{
+    if (i >= FIFO_WINDOW_WORDS) {
+        s_bad_index++;
+    }
+    s_fifo[s_head++ % FIFO_DEPTH] = v;
+}
+
+static uint32_t model_pop(uint32_t i)
+{
+    if (i >= FIFO_WINDOW_WORDS) {
+        s_bad_index++;
+    }
+    return s_fifo[s_tail++ % FIFO_DEPTH];
+}
+
+#define DWC2_FIFO_WR(fifo, i, v) ((void)(fifo), model_push((i), (v)))
+#define DWC2_FIFO_RD(fifo, i)    ((void)(fifo), model_pop(i))
+#include "usb_dwc2_fifo.h"
+
+/* The loop dwc2_ep_read used before the burst paths */
+static void old_fifo_read(uint8_t *dest, uint16_t len)
+{
+    uint32_t count32b = ((uint32_t)len + 3U) / 4U;
+
+    for (uint32_t i = 0U; i < count32b; i++) {
+        __UNALIGNED_UINT32_WRITE(dest, model_pop(0));
+        dest += 4;
+    }
+}
+
+#define MAX_LEN 1024U
+#define GUARD   8U
+#define FILL    0xA5U
+
+static volatile uint32_t s_window[FIFO_WINDOW_WORDS];
+
+static void fill_pattern(uint8_t *p, uint32_t len, uint32_t seed)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        p[i] = (uint8_t)(seed * 131U + i * 7U + (i >> 8));
+    }
+}
+
+static int check_write(uint16_t len, uint32_t align)
+{
+    static uint8_t src[MAX_LEN + 16];
+    uint8_t *p = src + align;
+    uint32_t words = ((uint32_t)len + 3U) / 4U;
+
+    fill_pattern(p, len, len ^ align);
+    s_head = s_tail = 0;
+    dwc2_fifo_write(s_window, p, len);
+
+    if (s_head != words) {
+        printf("write len %u align %u: pushed %u words, want %u\n", len, align, s_head, words);
+        return 1;
+    }
+    for (uint32_t i = 0; i < len; i++) {
+        uint8_t b = (uint8_t)(s_fifo[i / 4] >> ((i & 3U) * 8U));
+        if (b != p[i]) {
+            printf("write len %u align %u: byte %u is %02x, want %02x\n", len, align, i, b, p[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void load_fifo(uint16_t len, uint32_t seed, uint8_t *expect)
+{
+    uint32_t words = ((uint32_t)len + 3U) / 4U;
+
+    fill_pattern(expect, words * 4U, seed);
+    s_head = s_tail = 0;
+    for (uint32_t i = 0; i < words; i++) {
+        model_push(0, host_unaligned_rd32(expect + i * 4U));
+    }
+}
+
+static int check_read(uint16_t len, uint32_t align)
+{
+    static uint8_t buf[GUARD + MAX_LEN + 16 + GUARD];
+    static uint8_t expect[MAX_LEN + 4];
+    uint8_t *p = buf + GUARD + align;
+    uint32_t words = ((uint32_t)len + 3U) / 4U;
+
+    load_fifo(len, len ^ align, expect);
+    memset(buf, FILL, sizeof(buf));
+    dwc2_fifo_read(s_window, p, len);
+
+    if (s_tail != words) {
+        printf("read len %u align %u: popped %u words, want %u\n", len, align, s_tail, words);
+        return 1;
+    }
+    if (memcmp(p, expect, len) != 0) {
+        printf("read len %u align %u: data mismatch\n", len, align);
+        return 1;
+    }
+    for (uint8_t *g = buf; g < p; g++) {
+        if (*g != FILL) {
+            printf("read len %u align %u: wrote before dest\n", len, align);
+            return 1;
+        }
+    }
+    for (uint8_t *g = p + len; g < buf + sizeof(buf); g++) {
+        if (*g != FILL) {
+            printf("read len %u align %u: wrote %u bytes past dest + len\n",
+                   len, align, (unsigned)(g - (p + len)) + 1U);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Bytes the old loop wrote past dest + len for tail lengths 1..3 */
+static void report_old_overrun(void)
+{
+    static uint8_t buf[64 + GUARD];
+    static uint8_t expect[64 + 4];
+
+    for (uint16_t len = 61; len <= 63; len++) {
+        uint32_t over = 0;
+
+        load_fifo(len, len, expect);
+        memset(buf, FILL, sizeof(buf));
+        old_fifo_read(buf, len);
+        for (uint32_t i = len; i < sizeof(buf); i++) {
+            if (buf[i] != FILL) {
+                over = i - len + 1U;
+            }
+        }
+        printf("  old read loop, len %u: %u byte(s) written past dest + len\n", len, over);
+    }
+}
+
+int fifo_model_check(int verbose)
+{
+    int fail = 0;
+
+    s_bad_index = 0;
+    for (uint32_t len = 0; len <= MAX_LEN; len++) {
+        for (uint32_t align = 0; align < 4U; align++) {
+            fail |= check_write((uint16_t)len, align);
+            fail |= check_read((uint16_t)len, align);
+        }
+    }
+    if (s_bad_index) {
+        printf("%u accesses outside the FIFO window\n", s_bad_index);
+        fail = 1;
+    }
+
+    printf("fifo model: lengths 0..%u, alignments 0..3: %s\n", MAX_LEN, fail ? "FAIL" : "ok");
+    if (verbose) {
+        report_old_overrun();
+    }
+    return fail;
+}
@@ -0,0 +1,29 @@
+/*
+ * Minimal CMSIS definitions for building firmware modules on the host.
+ */
+#ifndef HOST_CMSIS_H
+#define HOST_CMSIS_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef __IO
+#define __IO volatile
+#endif
+
+static inline uint32_t host_unaligned_rd32(const void *addr)
+{
+    uint32_t v;
+    memcpy(&v, addr, sizeof(v));
+    return v;
+}
+
+static inline void host_unaligned_wr32(void *addr, uint32_t v)
+{
+    memcpy(addr, &v, sizeof(v));
+}
+
+#define __UNALIGNED_UINT32_READ(addr)       host_unaligned_rd32(addr)
+#define __UNALIGNED_UINT32_WRITE(addr, val) host_unaligned_wr32((addr), (val))
+
+#endif /* HOST_CMSIS_H */
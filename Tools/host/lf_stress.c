@@ -0,0 +1,454 @@
+/*
+ * Multi-threaded stress test for Core/Src/lf_ringbuffer.c.
+ *
+ * MPSC: several producer threads write numbered messages
+ *   [id][len][seq:4][payload:len]
+ * through lf_mpsc_ringbuffer_write, reserve/fill/commit (header and payload
+ * filled separately) and linear_write_setup/done. One consumer drains the
+ * ring with read, peek + drop and linear_read_setup/done in random chunk
+ * sizes and reassembles the byte stream. Every message must arrive whole,
+ * in per-producer seq order, with the right payload, exactly once.
+ *
+ * The runs cross the index wrap of the state word many times, and the
+ * linear writer checks that no reservation succeeds while it holds the
+ * LINEAR bit.
+ *
+ * SPSC: one producer (write / linear write) and one consumer (read / peek +
+ * drop / linear read) move a counting byte stream.
+ *
+ *   lf_stress                 # default run
+ *   lf_stress -n 200000       # messages per producer
+ *   lf_stress -p 6            # producer threads
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lf_ringbuffer.h"
+
+#define MAX_PRODUCERS 16
+#define MSG_HDR       6
+#define MSG_MAX_DATA  57
+#define MSG_MAX       (MSG_HDR + MSG_MAX_DATA)
+
+enum {
+    MODE_WRITE,    /* lf_mpsc_ringbuffer_write */
+    MODE_RESERVE,  /* reserve, two fills, commit */
+    MODE_LINEAR,   /* linear_write_setup/done, alternating with reserve */
+};
+
+static lf_mpsc_ringbuffer_t g_mpsc;
+static uint32_t g_msgs;
+static uint32_t g_producers;
+static volatile int g_done_producers;
+static volatile int g_fail;
+
+static struct {
+    uint32_t sent;
+    uint32_t full;            /* attempts that found the ring full */
+    uint32_t linear_msgs;
+    uint32_t lockout_checks;
+} g_prod[MAX_PRODUCERS];
+
+static void fail(const char *msg, uint32_t a, uint32_t b)
+{
+    if (!__atomic_exchange_n(&g_fail, 1, __ATOMIC_SEQ_CST)) {
+        printf("FAIL: %s (%u, %u)\n", msg, a, b);
+    }
+}
+
+/* xorshift, one state per thread */
+static uint32_t rnd(uint32_t *s)
+{
+    *s ^= *s << 13;
+    *s ^= *s >> 17;
+    *s ^= *s << 5;
+    return *s;
+}
+
+static uint8_t payload_byte(uint32_t id, uint32_t seq, uint32_t k)
+{
+    return (uint8_t)(seq * 31U + k * 7U + id * 101U);
+}
+
+static uint32_t make_msg(uint8_t *m, uint32_t id, uint32_t seq, uint32_t *rs)
+{
+    uint32_t len = rnd(rs) % (MSG_MAX_DATA + 1);
+
+    m[0] = (uint8_t)id;
+    m[1] = (uint8_t)len;
+    memcpy(&m[2], &seq, 4);
+    for (uint32_t k = 0; k < len; k++) {
+        m[MSG_HDR + k] = payload_byte(id, seq, k);
+    }
+    return MSG_HDR + len;
+}
+
+static int put_reserve(const uint8_t *m, uint32_t n)
+{
+    int32_t pos = lf_mpsc_ringbuffer_reserve(&g_mpsc, n);
+
+    if (pos < 0) {
+        return 0;
+    }
+    /* payload first, then header: the consumer must not see either early */
+    lf_mpsc_ringbuffer_fill(&g_mpsc, (uint32_t)pos + MSG_HDR, m + MSG_HDR, n - MSG_HDR);
+    if ((n & 7) == 0) {
+        sched_yield();
+    }
+    lf_mpsc_ringbuffer_fill(&g_mpsc, (uint32_t)pos, m, MSG_HDR);
+    lf_mpsc_ringbuffer_commit(&g_mpsc);
+    return 1;
+}
+
+/* Fill the linear region with whole messages, give back the rest */
+static uint32_t put_linear(uint32_t id, uint32_t *seq, uint32_t *rs, uint8_t *pending, uint32_t *pending_len)
+{
+    uint32_t size, used = 0, count = 0;
+    uint8_t *p = lf_mpsc_ringbuffer_linear_write_setup(&g_mpsc, &size);
+
+    if (size == 0) {
+        return 0;
+    }
+
+    /* the LINEAR bit must lock out every other reservation, ours included */
+    uint32_t dummy;
+    if (lf_mpsc_ringbuffer_reserve(&g_mpsc, 1) >= 0) {
+        fail("reserve succeeded during linear write", id, size);
+    }
+    if (lf_mpsc_ringbuffer_write(&g_mpsc, pending, 1) != 0) {
+        fail("write succeeded during linear write", id, size);
+    }
+    lf_mpsc_ringbuffer_linear_write_setup(&g_mpsc, &dummy);
+    if (dummy != 0) {
+        fail("second linear setup succeeded", id, dummy);
+    }
+    g_prod[id].lockout_checks++;
+
+    while (*seq < g_msgs && used + *pending_len <= size) {
+        memcpy(p + used, pending, *pending_len);
+        used += *pending_len;
+        (*seq)++;
+        count++;
+        *pending_len = make_msg(pending, id, *seq, rs);
+    }
+    if ((rnd(rs) & 3) == 0) {
+        sched_yield(); /* hold the region while the others spin */
+    }
+
+    if (lf_mpsc_ringbuffer_linear_write_done(&g_mpsc, used) != used) {
+        fail("linear_write_done size", used, size);
+    }
+    return count;
+}
+
+static void *mpsc_producer(void *arg)
+{
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    uint32_t mode = (id == 0) ? MODE_LINEAR : (id & 1) ? MODE_WRITE : MODE_RESERVE;
+    uint32_t rs = 0x9E3779B9U ^ (id * 0x85EBCA6BU);
+    uint32_t seq = 0, n;
+    uint8_t m[MSG_MAX];
+
+    n = make_msg(m, id, seq, &rs);
+    while (seq < g_msgs && !g_fail) {
+        int ok;
+
+        if (mode == MODE_LINEAR && (rnd(&rs) & 1)) {
+            uint32_t c = put_linear(id, &seq, &rs, m, &n);
+            g_prod[id].linear_msgs += c;
+            ok = c > 0;
+        } else if (mode != MODE_WRITE) {
+            ok = put_reserve(m, n);
+            if (ok) {
+                n = make_msg(m, id, ++seq, &rs);
+            }
+        } else {
+            ok = lf_mpsc_ringbuffer_write(&g_mpsc, m, n) == n;
+            if (ok) {
+                n = make_msg(m, id, ++seq, &rs);
+            }
+        }
+
+        if (!ok) {
+            g_prod[id].full++;
+            sched_yield();
+        }
+    }
+
+    g_prod[id].sent = seq;
+    __atomic_add_fetch(&g_done_producers, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Consumer: pull bytes in random-sized chunks, parse the stream */
+static uint8_t s_stream[4 * MSG_MAX + 4096];
+static uint32_t s_stream_len;
+static uint32_t s_next_seq[MAX_PRODUCERS];
+static uint64_t s_msgs_rx;
+
+static void parse_stream(void)
+{
+    uint32_t off = 0;
+
+    while (s_stream_len - off >= MSG_HDR) {
+        const uint8_t *m = &s_stream[off];
+        uint32_t id = m[0], len = m[1], seq;
+
+        if (id >= g_producers || len > MSG_MAX_DATA) {
+            fail("bad header at stream offset", off, id);
+            return;
+        }
+        if (s_stream_len - off < MSG_HDR + len) {
+            break;
+        }
+        memcpy(&seq, &m[2], 4);
+        if (seq != s_next_seq[id]) {
+            fail(seq < s_next_seq[id] ? "duplicate or reordered message" : "lost message",
+                 id, seq);
+            return;
+        }
+        for (uint32_t k = 0; k < len; k++) {
+            if (m[MSG_HDR + k] != payload_byte(id, seq, k)) {
+                fail("payload corrupted", id, seq);
+                return;
+            }
+        }
+        s_next_seq[id]++;
+        s_msgs_rx++;
+        off += MSG_HDR + len;
+    }
+
+    memmove(s_stream, &s_stream[off], s_stream_len - off);
+    s_stream_len -= off;
+}
+
+static uint32_t mpsc_consume_once(uint32_t *rs)
+{
+    uint32_t room = sizeof(s_stream) - s_stream_len;
+    uint32_t want = 1 + rnd(rs) % 300;
+    uint32_t got = 0, size;
+    uint8_t *p;
+
+    if (want > room) {
+        want = room;
+    }
+
+    switch (rnd(rs) % 3) {
+        case 0:
+            got = lf_mpsc_ringbuffer_read(&g_mpsc, &s_stream[s_stream_len], want);
+            break;
+        case 1:
+            got = lf_mpsc_ringbuffer_peek(&g_mpsc, &s_stream[s_stream_len], want);
+            if (lf_mpsc_ringbuffer_drop(&g_mpsc, got) != got) {
+                fail("drop after peek", got, 0);
+            }
+            break;
+        default:
+            p = lf_mpsc_ringbuffer_linear_read_setup(&g_mpsc, &size);
+            got = size < want ? size : want;
+            memcpy(&s_stream[s_stream_len], p, got);
+            lf_mpsc_ringbuffer_linear_read_done(&g_mpsc, got);
+            break;
+    }
+
+    s_stream_len += got;
+    parse_stream();
+    return got;
+}
+
+static int run_mpsc(uint32_t ring_size, uint32_t producers, uint32_t msgs)
+{
+    static uint8_t pool[LF_MPSC_MAX_SIZE];
+    pthread_t th[MAX_PRODUCERS];
+    uint32_t rs = 12345U + ring_size;
+    uint64_t bytes_total = 0;
+
+    memset(g_prod, 0, sizeof(g_prod));
+    memset(s_next_seq, 0, sizeof(s_next_seq));
+    s_stream_len = 0;
+    s_msgs_rx = 0;
+    g_msgs = msgs;
+    g_producers = producers;
+    g_done_producers = 0;
+
+    if (lf_mpsc_ringbuffer_init(&g_mpsc, pool, ring_size) != 0) {
+        printf("FAIL: init %u\n", ring_size);
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < producers; i++) {
+        pthread_create(&th[i], NULL, mpsc_producer, (void *)(uintptr_t)i);
+    }
+
+    for (;;) {
+        int done = __atomic_load_n(&g_done_producers, __ATOMIC_ACQUIRE) == (int)producers;
+        uint32_t got = mpsc_consume_once(&rs);
+
+        bytes_total += got;
+        if (g_fail || (done && got == 0 && lf_mpsc_ringbuffer_check_empty(&g_mpsc))) {
+            break;
+        }
+        if (got == 0) {
+            sched_yield();
+        }
+    }
+
+    for (uint32_t i = 0; i < producers; i++) {
+        pthread_join(th[i], NULL);
+    }
+
+    for (uint32_t i = 0; i < producers && !g_fail; i++) {
+        if (s_next_seq[i] != g_prod[i].sent) {
+            fail("producer message count", s_next_seq[i], g_prod[i].sent);
+        }
+    }
+    if (!g_fail && s_stream_len != 0) {
+        fail("trailing bytes", s_stream_len, 0);
+    }
+    if (!g_fail && lf_mpsc_ringbuffer_get_free(&g_mpsc) != ring_size) {
+        fail("free space after drain", lf_mpsc_ringbuffer_get_free(&g_mpsc), ring_size);
+    }
+
+    printf("mpsc ring %5u, %u producers: %llu msgs, %llu bytes (%.1f index wraps), "
+           "linear %u msgs / %u lockout checks, full %u: %s\n",
+           ring_size, producers, (unsigned long long)s_msgs_rx, (unsigned long long)bytes_total,
+           bytes_total / 131072.0, g_prod[0].linear_msgs, g_prod[0].lockout_checks,
+           g_prod[1].full, g_fail ? "FAIL" : "ok");
+    return g_fail;
+}
+
+/* ========== SPSC ========== */
+static lf_spsc_ringbuffer_t g_spsc;
+static uint64_t g_spsc_total;
+
+static uint8_t stream_byte(uint64_t n)
+{
+    return (uint8_t)(n * 7U + (n >> 8) + (n >> 16));
+}
+
+static void *spsc_producer(void *arg)
+{
+    uint32_t rs = 0xC0FFEEU;
+    uint64_t n = 0;
+    uint8_t buf[512];
+    (void)arg;
+
+    while (n < g_spsc_total && !g_fail) {
+        uint32_t want = 1 + rnd(&rs) % sizeof(buf), size, got;
+        uint8_t *p;
+
+        if (want > g_spsc_total - n) {
+            want = (uint32_t)(g_spsc_total - n);
+        }
+        if (rnd(&rs) & 1) {
+            for (uint32_t k = 0; k < want; k++) {
+                buf[k] = stream_byte(n + k);
+            }
+            got = lf_spsc_ringbuffer_write(&g_spsc, buf, want);
+        } else {
+            p = lf_spsc_ringbuffer_linear_write_setup(&g_spsc, &size);
+            got = size < want ? size : want;
+            for (uint32_t k = 0; k < got; k++) {
+                p[k] = stream_byte(n + k);
+            }
+            lf_spsc_ringbuffer_linear_write_done(&g_spsc, got);
+        }
+        n += got;
+        if (got == 0) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static int run_spsc(uint32_t ring_size, uint64_t total)
+{
+    static uint8_t pool[65536];
+    pthread_t th;
+    uint32_t rs = 0xBEEFU;
+    uint64_t n = 0;
+    uint8_t buf[512];
+
+    g_spsc_total = total;
+    lf_spsc_ringbuffer_init(&g_spsc, pool, ring_size);
+    pthread_create(&th, NULL, spsc_producer, NULL);
+
+    while (n < total && !g_fail) {
+        uint32_t want = 1 + rnd(&rs) % sizeof(buf), got, size;
+        const uint8_t *p = buf;
+
+        switch (rnd(&rs) % 3) {
+            case 0:
+                got = lf_spsc_ringbuffer_read(&g_spsc, buf, want);
+                break;
+            case 1:
+                got = lf_spsc_ringbuffer_peek(&g_spsc, buf, want);
+                if (lf_spsc_ringbuffer_drop(&g_spsc, got) != got) {
+                    fail("spsc drop after peek", got, 0);
+                }
+                break;
+            default:
+                p = lf_spsc_ringbuffer_linear_read_setup(&g_spsc, &size);
+                got = size < want ? size : want;
+                break;
+        }
+        for (uint32_t k = 0; k < got; k++) {
+            if (p[k] != stream_byte(n + k)) {
+                fail("spsc byte mismatch", (uint32_t)(n + k), p[k]);
+                break;
+            }
+        }
+        if (p != buf) {
+            lf_spsc_ringbuffer_linear_read_done(&g_spsc, got);
+        }
+        n += got;
+        if (got == 0) {
+            sched_yield();
+        }
+    }
+    pthread_join(th, NULL);
+
+    if (!g_fail && !lf_spsc_ringbuffer_check_empty(&g_spsc)) {
+        fail("spsc not empty after the stream", lf_spsc_ringbuffer_get_used(&g_spsc), 0);
+    }
+    printf("spsc ring %5u: %llu bytes: %s\n", ring_size, (unsigned long long)n,
+           g_fail ? "FAIL" : "ok");
+    return g_fail;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t sizes[] = { 64, 256, 4096, LF_MPSC_MAX_SIZE };
+    uint32_t msgs = 50000, producers = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
+        switch (opt) {
+            case 'n':
+                msgs = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                producers = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n msgs_per_producer] [-p producers]\n", argv[0]);
+                return 2;
+        }
+    }
+    if (producers < 2 || producers > MAX_PRODUCERS) {
+        fprintf(stderr, "producers must be 2..%d\n", MAX_PRODUCERS);
+        return 2;
+    }
+
+    for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]) && !g_fail; i++) {
+        run_mpsc(sizes[i], producers, msgs);
+    }
+    for (uint32_t i = 0; i < 3 && !g_fail; i++) {
+        run_spsc(sizes[i], (uint64_t)msgs * 64U);
+    }
+    return g_fail;
+}
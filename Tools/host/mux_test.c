@@ -0,0 +1,445 @@
+/*
+ * Host test for the CDC channel multiplexer (Core/Src/cdc_mux.c).
+ *
+ * cdc_mux.c and lf_ringbuffer.c run against a fake default port: the host
+ * side writes frames into its receive buffer, handed to the mux in linear
+ * read chunks of a chosen size, and parses the frames the mux sends.
+ *
+ * Covered:
+ *   initial credits, frame headers and data split across reads,
+ *   zero-credit stall and resume, round-robin interleaving of two channels,
+ *   credit return (batch and drained channel), port tx buffer full,
+ *   credit overrun, CLOSE and an invalid frame leaving the rest unread.
+ *
+ *   mux_test        # all cases, prints one line each
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cdc_mux.h"
+
+#define MT_RX_SIZE  8192
+#define MT_TX_SIZE  8192
+#define MT_FRAMES   64
+
+static uint8_t s_rx[MT_RX_SIZE];            /* host -> device */
+static uint32_t s_rx_head, s_rx_tail;
+static uint32_t s_rx_chunk;                 /* linear read size limit, 0 = all */
+static uint8_t s_tx[MT_TX_SIZE];            /* device -> host */
+static uint32_t s_tx_len;
+static uint32_t s_tx_cap;                   /* port tx buffer room */
+
+typedef struct {
+    uint8_t type;
+    uint8_t ch;
+    uint16_t len;
+    const uint8_t *data;
+} frame_t;
+
+static frame_t s_frames[MT_FRAMES];
+static uint32_t s_frame_num;
+
+static void fail(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fprintf(stderr, "mux_test: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(1);
+}
+
+/* ========== stand-ins for the default CDC port ========== */
+void *cdc_acm_linear_read_setup(uint32_t *size)
+{
+    uint32_t n = s_rx_head - s_rx_tail;
+
+    if (s_rx_chunk && n > s_rx_chunk) {
+        n = s_rx_chunk;
+    }
+    *size = n;
+    return &s_rx[s_rx_tail];
+}
+
+void cdc_acm_linear_read_done(uint32_t size)
+{
+    s_rx_tail += size;
+}
+
+static int tx_put(const cdc_acm_iovec_t *iov, uint32_t iovcnt)
+{
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        total += iov[i].len;
+    }
+    if (total > s_tx_cap - s_tx_len) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        memcpy(&s_tx[s_tx_len], iov[i].base, iov[i].len);
+        s_tx_len += iov[i].len;
+    }
+    return (int)total;
+}
+
+int cdc_acm_port_send_data(uint8_t port, const uint8_t *data, uint32_t len)
+{
+    cdc_acm_iovec_t iov = { data, len };
+
+    return (port == CDC_ACM_PORT_DEFAULT) ? tx_put(&iov, 1) : -1;
+}
+
+int cdc_acm_port_sendv(uint8_t port, const cdc_acm_iovec_t *iov, uint32_t iovcnt)
+{
+    return (port == CDC_ACM_PORT_DEFAULT) ? tx_put(iov, iovcnt) : -1;
+}
+
+bool cdc_acm_port_is_open(uint8_t port)
+{
+    return port == CDC_ACM_PORT_DEFAULT;
+}
+
+/* ========== host side ========== */
+static void host_write(const void *data, uint32_t len)
+{
+    if (s_rx_tail == s_rx_head) {
+        s_rx_head = s_rx_tail = 0;
+    }
+    if (len > MT_RX_SIZE - s_rx_head) {
+        fail("host -> device buffer overflow");
+    }
+    memcpy(&s_rx[s_rx_head], data, len);
+    s_rx_head += len;
+}
+
+static void host_frame(uint8_t type, uint8_t ch, const void *data, uint16_t len)
+{
+    uint8_t hdr[CDC_MUX_HDR_LEN] = { (uint8_t)((type << 4) | ch), (uint8_t)len, (uint8_t)(len >> 8) };
+
+    host_write(hdr, sizeof(hdr));
+    if (type == CDC_MUX_TYPE_DATA) {
+        host_write(data, len);
+    }
+}
+
+static void host_credit(uint8_t ch, uint16_t n)
+{
+    host_frame(CDC_MUX_TYPE_CREDIT, ch, NULL, n);
+}
+
+/* parse everything the device sent since the last call */
+static void poll_frames(void)
+{
+    uint32_t i = 0;
+
+    s_tx_len = 0;
+    cdc_mux_poll();
+
+    s_frame_num = 0;
+    while (i < s_tx_len) {
+        frame_t *f = &s_frames[s_frame_num];
+
+        if (s_frame_num == MT_FRAMES || s_tx_len - i < CDC_MUX_HDR_LEN) {
+            fail("frame stream: too many frames or a cut header");
+        }
+        f->type = s_tx[i] >> 4;
+        f->ch = s_tx[i] & 0x0F;
+        f->len = (uint16_t)(s_tx[i + 1] | (s_tx[i + 2] << 8));
+        f->data = &s_tx[i + CDC_MUX_HDR_LEN];
+        i += CDC_MUX_HDR_LEN;
+        if (f->type == CDC_MUX_TYPE_DATA) {
+            if (f->len == 0 || f->len > CDC_MUX_MAX_CHUNK || s_tx_len - i < f->len) {
+                fail("bad DATA frame length %u", f->len);
+            }
+            i += f->len;
+        } else if (f->type != CDC_MUX_TYPE_CREDIT) {
+            fail("device sent frame type %u", f->type);
+        }
+        s_frame_num++;
+    }
+}
+
+static void expect_frame(uint32_t idx, uint8_t type, uint8_t ch, uint16_t len)
+{
+    if (idx >= s_frame_num) {
+        fail("frame %u missing (got %u)", idx, s_frame_num);
+    }
+    if (s_frames[idx].type != type || s_frames[idx].ch != ch || s_frames[idx].len != len) {
+        fail("frame %u: type %u ch %u len %u, expected type %u ch %u len %u", idx,
+             s_frames[idx].type, s_frames[idx].ch, s_frames[idx].len, type, ch, len);
+    }
+}
+
+static void expect_frames(uint32_t n)
+{
+    if (s_frame_num != n) {
+        fail("%u frames, expected %u", s_frame_num, n);
+    }
+}
+
+static void pattern(uint8_t *buf, uint32_t len, uint8_t seed)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)(seed + i * 7);
+    }
+}
+
+static void read_all(uint8_t ch, const uint8_t *want, uint32_t len)
+{
+    uint8_t got[CDC_MUX_RING_SIZE];
+    int n = cdc_mux_read(ch, got, sizeof(got));
+
+    if ((uint32_t)n != len || memcmp(got, want, len) != 0) {
+        fail("channel %u: read %d bytes, expected %u", ch, n, len);
+    }
+}
+
+/* fresh mux; checks the initial CREDIT frame of every channel */
+static void start(void)
+{
+    s_rx_head = s_rx_tail = 0;
+    s_rx_chunk = 0;
+    s_tx_cap = MT_TX_SIZE;
+
+    s_tx_len = 0;
+    cdc_mux_start();
+    s_frame_num = 0;
+    for (uint32_t i = 0; i < s_tx_len; i += CDC_MUX_HDR_LEN) {
+        s_frames[s_frame_num].type = s_tx[i] >> 4;
+        s_frames[s_frame_num].ch = s_tx[i] & 0x0F;
+        s_frames[s_frame_num].len = (uint16_t)(s_tx[i + 1] | (s_tx[i + 2] << 8));
+        s_frame_num++;
+    }
+    expect_frames(CDC_MUX_CH_NUM);
+    for (uint8_t c = 0; c < CDC_MUX_CH_NUM; c++) {
+        expect_frame(c, CDC_MUX_TYPE_CREDIT, c, CDC_MUX_RING_SIZE);
+    }
+}
+
+/* frame headers and data arrive in reads of 1, 2, 5 ... bytes */
+static void test_split_reads(void)
+{
+    static const uint32_t chunks[] = { 1, 2, 4, 5, 7, 0 };
+    uint8_t a[300], b[200];
+
+    for (uint32_t k = 0; k < sizeof(chunks) / sizeof(chunks[0]); k++) {
+        start();
+        s_rx_chunk = chunks[k];
+        pattern(a, sizeof(a), 1);
+        pattern(b, sizeof(b), 99);
+
+        host_frame(CDC_MUX_TYPE_DATA, 1, a, 100);
+        host_frame(CDC_MUX_TYPE_DATA, 2, b, sizeof(b));
+        host_frame(CDC_MUX_TYPE_DATA, 1, a + 100, 200);
+        host_credit(3, 10);
+        poll_frames();
+
+        read_all(1, a, sizeof(a));
+        read_all(2, b, sizeof(b));
+        if (!cdc_mux_is_active() || s_rx_tail != s_rx_head) {
+            fail("split reads (chunk %u): mux stopped or input left over", chunks[k]);
+        }
+    }
+    printf("headers split across reads: ok\n");
+}
+
+/* no credit, no DATA; each CREDIT frame lets exactly that much out */
+static void test_credit_stall(void)
+{
+    uint8_t msg[40];
+
+    start();
+    pattern(msg, sizeof(msg), 5);
+    if (cdc_mux_write(0, msg, sizeof(msg)) != (int)sizeof(msg)) {
+        fail("write");
+    }
+    poll_frames();
+    expect_frames(0);
+
+    host_credit(0, 15);
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_DATA, 0, 15);
+    if (memcmp(s_frames[0].data, msg, 15) != 0) {
+        fail("stall: first 15 bytes");
+    }
+    poll_frames();
+    expect_frames(0);
+
+    host_credit(0, 1000);
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_DATA, 0, 25);
+    if (memcmp(s_frames[0].data, msg + 15, 25) != 0) {
+        fail("stall: last 25 bytes");
+    }
+    printf("zero-credit stall and resume: ok\n");
+}
+
+/* two busy channels take turns, CDC_MUX_MAX_CHUNK per frame */
+static void test_interleave(void)
+{
+    uint8_t a[1000], b[600];
+
+    start();
+    pattern(a, sizeof(a), 11);
+    pattern(b, sizeof(b), 77);
+    host_credit(0, 0xFFFF);
+    host_credit(1, 0xFFFF);
+    cdc_mux_write(0, a, sizeof(a));
+    cdc_mux_write(1, b, sizeof(b));
+    poll_frames();
+
+    expect_frames(4);
+    expect_frame(0, CDC_MUX_TYPE_DATA, 0, CDC_MUX_MAX_CHUNK);
+    expect_frame(1, CDC_MUX_TYPE_DATA, 1, CDC_MUX_MAX_CHUNK);
+    expect_frame(2, CDC_MUX_TYPE_DATA, 0, sizeof(a) - CDC_MUX_MAX_CHUNK);
+    expect_frame(3, CDC_MUX_TYPE_DATA, 1, sizeof(b) - CDC_MUX_MAX_CHUNK);
+    if (memcmp(s_frames[0].data, a, CDC_MUX_MAX_CHUNK) != 0 ||
+        memcmp(s_frames[2].data, a + CDC_MUX_MAX_CHUNK, sizeof(a) - CDC_MUX_MAX_CHUNK) != 0 ||
+        memcmp(s_frames[1].data, b, CDC_MUX_MAX_CHUNK) != 0 ||
+        memcmp(s_frames[3].data, b + CDC_MUX_MAX_CHUNK, sizeof(b) - CDC_MUX_MAX_CHUNK) != 0) {
+        fail("interleave: data");
+    }
+    printf("two channels interleave: ok\n");
+}
+
+/* port tx buffer full: the blocked channel goes first next time */
+static void test_port_full(void)
+{
+    uint8_t a[100], b[100];
+
+    start();
+    pattern(a, sizeof(a), 3);
+    pattern(b, sizeof(b), 4);
+    host_credit(0, 1000);
+    host_credit(1, 1000);
+    cdc_mux_write(0, a, sizeof(a));
+    cdc_mux_write(1, b, sizeof(b));
+
+    s_tx_cap = CDC_MUX_HDR_LEN + sizeof(a); // room for channel 0 only
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_DATA, 0, sizeof(a));
+
+    s_tx_cap = MT_TX_SIZE;
+    cdc_mux_write(0, a, 50);
+    poll_frames();
+    expect_frames(2);
+    expect_frame(0, CDC_MUX_TYPE_DATA, 1, sizeof(b));
+    expect_frame(1, CDC_MUX_TYPE_DATA, 0, 50);
+    printf("port tx buffer full: ok\n");
+}
+
+/* credit comes back once a batch is read or the channel is drained */
+static void test_credit_return(void)
+{
+    uint8_t d[700], got[700];
+    uint32_t n;
+
+    start();
+    pattern(d, sizeof(d), 9);
+    host_frame(CDC_MUX_TYPE_DATA, 3, d, 300);
+    poll_frames();
+    expect_frames(0);
+
+    cdc_mux_read(3, got, 100);
+    poll_frames();
+    expect_frames(0); // below the batch, channel not empty
+
+    cdc_mux_read(3, got, sizeof(got));
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_CREDIT, 3, 300); // drained
+
+    host_frame(CDC_MUX_TYPE_DATA, 3, d, sizeof(d));
+    poll_frames();
+    uint8_t *p = cdc_mux_linear_read_setup(3, &n);
+    if (n < CDC_MUX_CREDIT_BATCH || memcmp(p, d, CDC_MUX_CREDIT_BATCH) != 0) {
+        fail("credit: linear read");
+    }
+    cdc_mux_linear_read_done(3, CDC_MUX_CREDIT_BATCH);
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_CREDIT, 3, CDC_MUX_CREDIT_BATCH); // a full batch
+
+    s_tx_cap = 0; // no room: the credit waits
+    cdc_mux_read(3, got, sizeof(got));
+    poll_frames();
+    expect_frames(0);
+    s_tx_cap = MT_TX_SIZE;
+    poll_frames();
+    expect_frames(1);
+    expect_frame(0, CDC_MUX_TYPE_CREDIT, 3, sizeof(d) - CDC_MUX_CREDIT_BATCH);
+    printf("credit return: ok\n");
+}
+
+/* data beyond the credit is dropped and counted, the stream stays in sync */
+static void test_overrun(void)
+{
+    static uint8_t d[CDC_MUX_RING_SIZE + 100];
+    cdc_mux_stats_t st;
+
+    start();
+    pattern(d, sizeof(d), 21);
+    host_frame(CDC_MUX_TYPE_DATA, 0, d, sizeof(d));
+    host_frame(CDC_MUX_TYPE_DATA, 1, d, 10);
+    poll_frames();
+
+    cdc_mux_get_stats(&st);
+    if (st.credit_overruns != 100 || cdc_mux_get_rx_available(0) != CDC_MUX_RING_SIZE ||
+        cdc_mux_get_rx_available(1) != 10) {
+        fail("overrun: %u dropped, ch0 %u ch1 %u", st.credit_overruns,
+             cdc_mux_get_rx_available(0), cdc_mux_get_rx_available(1));
+    }
+    printf("credit overrun: ok\n");
+}
+
+/* CLOSE and an invalid frame end mux mode; what follows is left for text mode */
+static void test_exit(void)
+{
+    static const char tail[] = "HELP\r";
+    cdc_mux_stats_t st;
+
+    start();
+    host_frame(CDC_MUX_TYPE_CLOSE, 0, NULL, 0);
+    host_write(tail, sizeof(tail) - 1);
+    poll_frames();
+    if (cdc_mux_is_active() || s_rx_head - s_rx_tail != sizeof(tail) - 1) {
+        fail("CLOSE");
+    }
+
+    start();
+    s_rx_chunk = 2;
+    host_frame(0x7, 0, NULL, 0); // type 7 does not exist
+    host_write(tail, sizeof(tail) - 1);
+    poll_frames();
+    cdc_mux_get_stats(&st);
+    if (cdc_mux_is_active() || st.format_errors != 1 || s_rx_head - s_rx_tail != sizeof(tail) - 1 ||
+        memcmp(&s_rx[s_rx_tail], tail, sizeof(tail) - 1) != 0) {
+        fail("invalid frame");
+    }
+    if (cdc_mux_write(0, tail, 1) != -1) {
+        fail("write after stop");
+    }
+    printf("CLOSE and invalid frame: ok\n");
+}
+
+int main(void)
+{
+    test_split_reads();
+    test_credit_stall();
+    test_interleave();
+    test_port_full();
+    test_credit_return();
+    test_overrun();
+    test_exit();
+
+    printf("mux_test: ok\n");
+    return 0;
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""Smoke test for a usb_sim build.
+
+Starts the simulator, then through each pty:
+  - echoes a pattern larger than the device buffers on every port at once;
+    with --buses 2 the aggregate must exceed one full-speed bus
+  - on port 0, runs BENCH SOURCE and checks the test pattern
+  - closes port 0 and checks the bench stopped (plain echo again)
+  - runs BENCH LOOP on port 0, then checks it stops the same way
+
+Echo sizes are not multiples of 64: like Linux cdc-acm, the simulated host
+sends no ZLP, so a write ending on a packet boundary stays in the device's
+OUT transfer until more data arrives.
+
+Usage:
+  sim_check.py ./usb_sim
+  sim_check.py --buses 2 ./usb_sim_2bus
+"""
+import argparse
+import os
+import select
+import subprocess
+import sys
+import time
+import tty
+
+PATTERN_MOD = 251  # CDC_BENCH_PATTERN_MOD
+FS_BUS_RATE = 19 * 64 * 1000  # USB_SIM_FS_FRAME_BYTES per 1 ms frame
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    tty.setraw(fd)
+    return fd
+
+
+def drain(fd, quiet=0.2):
+    while select.select([fd], [], [], quiet)[0]:
+        try:
+            if not os.read(fd, 65536):
+                return
+        except BlockingIOError:
+            return
+
+
+def echo_all(paths, size, command=None):
+    fds = [open_port(p) for p in paths]
+    for fd in fds:
+        drain(fd)
+    if command:
+        os.write(fds[0], command)
+        time.sleep(0.05)  # the device takes the command as one chunk
+    msgs = [bytes((i * 7 + n) & 0xFF for i in range(size)) for n in range(len(fds))]
+    sent = [0] * len(fds)
+    got = [bytearray() for _ in fds]
+    deadline = time.time() + 10
+    while time.time() < deadline and any(len(g) < size for g in got):
+        wr = [fd for i, fd in enumerate(fds) if sent[i] < size]
+        r, w, _ = select.select(fds, wr, [], 0.2)
+        for i, fd in enumerate(fds):
+            if fd in w:
+                try:
+                    sent[i] += os.write(fd, msgs[i][sent[i]:sent[i] + 4096])
+                except BlockingIOError:
+                    pass
+            if fd in r:
+                got[i] += os.read(fd, 65536)
+    elapsed = time.time() - (deadline - 10)
+    for fd in fds:
+        os.close(fd)
+    for i, path in enumerate(paths):
+        if bytes(got[i]) != msgs[i]:
+            sys.exit("echo mismatch on %s: %d/%d bytes" % (path, len(got[i]), size))
+    return 2 * size * len(fds) / elapsed
+
+
+def bench_source(path, seconds=1.0):
+    fd = open_port(path)
+    drain(fd)
+    os.write(fd, b"BENCH SOURCE")
+    data = bytearray()
+    deadline = time.time() + seconds
+    while time.time() < deadline:
+        if select.select([fd], [], [], 0.2)[0]:
+            data += os.read(fd, 65536)
+    os.close(fd)
+    if len(data) < 1000:
+        sys.exit("BENCH SOURCE: only %d bytes" % len(data))
+    expect = data[0]
+    for i, b in enumerate(data):
+        if b != expect:
+            sys.exit("BENCH SOURCE: pattern break at byte %d" % i)
+        expect = (expect + 1) % PATTERN_MOD
+    return len(data) / seconds
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("sim", help="usb_sim binary")
+    ap.add_argument("--size", type=int, default=100000, help="echo bytes per port")
+    ap.add_argument("--buses", type=int, default=1,
+                    help="buses the ports are spread over; echo must beat what one bus fewer can carry")
+    args = ap.parse_args()
+
+    proc = subprocess.Popen([args.sim], stdout=subprocess.PIPE, text=True)
+    try:
+        header = proc.stdout.readline().split()
+        if len(header) != 2 or header[0] != "ports":
+            sys.exit("simulator did not start")
+        paths = [proc.stdout.readline().split(": ", 1)[1].strip() for _ in range(int(header[1]))]
+
+        echo_rate = echo_all(paths, args.size)
+        if echo_rate < FS_BUS_RATE * (args.buses - 1) * 1.1:
+            sys.exit("echo %.0f B/s: ports do not run on %d independent buses" % (echo_rate, args.buses))
+        rate = bench_source(paths[0])
+        time.sleep(0.1)  # DTR drop reaches the device
+        echo_all(paths[:1], 1000)
+        # forwarded RX ring regions start at any byte offset
+        echo_all(paths[:1], 10001, b"BENCH LOOP")
+        time.sleep(0.1)
+        echo_all(paths[:1], 1000)
+        print("sim_check: %d port(s) echo ok, %.0f B/s on the bus(es), BENCH SOURCE %.0f B/s"
+              % (len(paths), echo_rate, rate))
+    finally:
+        proc.terminate()
+        try:
+            proc.wait(timeout=2)
+        except subprocess.TimeoutExpired:
+            proc.kill()  # e.g. spinning in a USB_ASSERT inside the frame interrupt
+            proc.wait()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+/*
+ * Host stand-in for the STM32 HAL/CMSIS header, for firmware modules built
+ * into the USB device simulator (usb_sim). Provides only what those modules
+ * use: the DWT cycle counter, HAL_GetTick, SystemCoreClock and the PRIMASK
+ * intrinsics.
+ *
+ * The USB "interrupt" is SIGALRM (see usb_dc_sim.c), so PRIMASK maps to
+ * blocking that signal.
+ */
+#ifndef SIM_STM32F4XX_HAL_H
+#define SIM_STM32F4XX_HAL_H
+
+#include <stdint.h>
+
+#ifndef __IO
+#define __IO volatile
+#endif
+
+typedef struct {
+    __IO uint32_t CTRL;
+    __IO uint32_t CYCCNT;
+} sim_dwt_t;
+
+typedef struct {
+    __IO uint32_t DEMCR;
+} sim_core_debug_t;
+
+/* CYCCNT runs at SystemCoreClock from the host monotonic clock */
+sim_dwt_t *sim_dwt(void);
+extern sim_core_debug_t sim_core_debug;
+
+#define DWT       (sim_dwt())
+#define CoreDebug (&sim_core_debug)
+
+#define DWT_CTRL_CYCCNTENA_Msk     (1UL << 0)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+
+/* PRIMASK = SIGALRM blocked */
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+void __disable_irq(void);
+void __enable_irq(void);
+
+/* Sleep until the next "interrupt"; with PRIMASK set it stays pending */
+void __WFI(void);
+
+#define __DSB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DMB() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+static inline uint8_t __CLZ(uint32_t value)
+{
+    return value ? (uint8_t)__builtin_clz(value) : 32U;
+}
+
+#endif /* SIM_STM32F4XX_HAL_H */
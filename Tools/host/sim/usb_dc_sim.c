@@ -0,0 +1,759 @@
+/*
+ * Host-simulated USB device controller (usb_dc.h backend) for Linux.
+ *
+ * Interrupt model: a 1 ms SIGALRM timer is the USB interrupt. Each tick is
+ * one frame: the handler resets and enumerates newly attached buses, delivers
+ * SOF, then plays the host side of every CDC ACM function. PRIMASK is the
+ * SIGALRM mask (sim/stm32f4xx_hal.h), so __disable_irq() sections in the
+ * firmware keep the "interrupt" out exactly as on the target.
+ *
+ * Host side of a CDC ACM function = one pty master:
+ *   - slave opened / closed      -> SET_LINE_CODING + SET_CONTROL_LINE_STATE
+ *                                   with DTR set / cleared (POLLHUP on master)
+ *   - termios speed/format change -> SET_LINE_CODING
+ *   - bulk IN  -> written to the master while the slave is open; a full pty
+ *                 NAKs the endpoint
+ *   - bulk OUT -> read from the master in max-packet units; a packet shorter
+ *                 than wMaxPacketSize ends the transfer, like on the bus
+ *   - interrupt IN (serial state) is accepted and dropped
+ *
+ * Transfers follow the dwc2 port in slave (non-DMA) mode: EP0 moves one packet
+ * per start_write/read, other endpoints the whole length, any alignment. Bulk
+ * traffic of all functions on a bus shares a per-frame byte budget
+ * (USB_SIM_FS_FRAME_BYTES for a full-speed bus).
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "usbd_core.h"
+#include "usb_cdc.h"
+#include "usb_dc_sim.h"
+#include "stm32f4xx_hal.h"
+
+#define SIM_MAX_EPS 8
+#define SIM_ACM_NONE 0xFF
+
+struct sim_ep {
+    uint16_t mps;
+    uint8_t type;
+    bool open;
+    bool stalled;
+    uint8_t *buf;
+    uint32_t len;
+    uint32_t actual;
+    volatile sig_atomic_t armed;
+};
+
+struct sim_port {
+    int master;
+    char path[64];
+    char link[128];
+    uint8_t busid;
+    uint8_t intf;
+    uint8_t in_ep;
+    uint8_t out_ep;
+    uint8_t int_ep;
+    bool bound;         /* found in a configuration descriptor */
+    bool open;          /* slave side open = DTR */
+    uint8_t coding[7];  /* last line coding sent */
+    usb_sim_port_stats_t stats;
+};
+
+struct sim_bus {
+    volatile sig_atomic_t attached;
+    bool configured;
+    uint8_t address;
+    uint8_t port_first;
+    uint8_t port_num;
+    bool ep0_stall;
+    bool sof_enable;
+    struct sim_ep in[SIM_MAX_EPS];
+    struct sim_ep out[SIM_MAX_EPS];
+};
+
+static struct sim_bus g_bus[USB_SIM_MAX_BUS];
+static struct sim_port g_port[USB_SIM_MAX_PORTS];
+static usb_sim_config_t g_cfg;
+static uint8_t g_port_bound;
+static struct timespec g_t0;
+
+/* ========== CMSIS/HAL stand-ins (sim/stm32f4xx_hal.h) ========== */
+uint32_t SystemCoreClock = 168000000U;
+sim_core_debug_t sim_core_debug;
+static sim_dwt_t g_dwt;
+
+static uint64_t sim_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - g_t0.tv_sec) * 1000000000ULL + (uint64_t)ts.tv_nsec - (uint64_t)g_t0.tv_nsec;
+}
+
+sim_dwt_t *sim_dwt(void)
+{
+    g_dwt.CYCCNT = (uint32_t)(sim_now_ns() * (SystemCoreClock / 1000000U) / 1000U);
+    return &g_dwt;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (uint32_t)(sim_now_ns() / 1000000U);
+}
+
+static sigset_t sim_irq_set(void)
+{
+    sigset_t s;
+
+    sigemptyset(&s);
+    sigaddset(&s, SIGALRM);
+    return s;
+}
+
+uint32_t __get_PRIMASK(void)
+{
+    sigset_t cur;
+
+    sigprocmask(SIG_BLOCK, NULL, &cur);
+    return sigismember(&cur, SIGALRM) ? 1U : 0U;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+    sigset_t s = sim_irq_set();
+
+    sigprocmask(primask ? SIG_BLOCK : SIG_UNBLOCK, &s, NULL);
+}
+
+void __disable_irq(void)
+{
+    __set_PRIMASK(1);
+}
+
+void __enable_irq(void)
+{
+    __set_PRIMASK(0);
+}
+
+void __WFI(void)
+{
+    sigset_t cur;
+
+    sigprocmask(SIG_BLOCK, NULL, &cur);
+    if (sigismember(&cur, SIGALRM)) {
+        // masked: wake on the pending interrupt but leave it pending, as WFI does
+        sigset_t s = sim_irq_set();
+        if (sigwaitinfo(&s, NULL) == SIGALRM) {
+            raise(SIGALRM);
+        }
+    } else {
+        sigsuspend(&cur);
+    }
+}
+
+/* ========== usb_dc.h ========== */
+int usb_dc_init(uint8_t busid)
+{
+    if (busid >= USB_SIM_MAX_BUS) {
+        return -1;
+    }
+    memset(g_bus[busid].in, 0, sizeof(g_bus[busid].in));
+    memset(g_bus[busid].out, 0, sizeof(g_bus[busid].out));
+    g_bus[busid].configured = false;
+#ifdef CONFIG_USBDEV_SOF_ENABLE
+    g_bus[busid].sof_enable = true;
+#endif
+    g_bus[busid].attached = 1; // the next frame resets and enumerates
+    return 0;
+}
+
+int usb_dc_deinit(uint8_t busid)
+{
+    g_bus[busid].attached = 0;
+    g_bus[busid].configured = false;
+    return 0;
+}
+
+int usbd_set_address(uint8_t busid, const uint8_t addr)
+{
+    g_bus[busid].address = addr;
+    return 0;
+}
+
+int usbd_set_remote_wakeup(uint8_t busid)
+{
+    return -1;
+}
+
+uint8_t usbd_get_port_speed(uint8_t busid)
+{
+    return USB_SPEED_FULL;
+}
+
+void usbd_set_sof_enable(uint8_t busid, bool enable)
+{
+    g_bus[busid].sof_enable = enable;
+}
+
+static struct sim_ep *sim_ep(uint8_t busid, uint8_t ep)
+{
+    uint8_t idx = USB_EP_GET_IDX(ep);
+
+    if (idx >= SIM_MAX_EPS) {
+        return NULL;
+    }
+    return USB_EP_DIR_IS_IN(ep) ? &g_bus[busid].in[idx] : &g_bus[busid].out[idx];
+}
+
+int usbd_ep_open(uint8_t busid, const struct usb_endpoint_descriptor *ep)
+{
+    struct sim_ep *e = sim_ep(busid, ep->bEndpointAddress);
+
+    if (e == NULL) {
+        return -1;
+    }
+    e->armed = 0;
+    e->mps = USB_GET_MAXPACKETSIZE(ep->wMaxPacketSize);
+    e->type = USB_GET_ENDPOINT_TYPE(ep->bmAttributes);
+    e->stalled = false;
+    e->open = true;
+    return 0;
+}
+
+int usbd_ep_close(uint8_t busid, const uint8_t ep)
+{
+    struct sim_ep *e = sim_ep(busid, ep);
+
+    if (e == NULL) {
+        return -1;
+    }
+    e->armed = 0;
+    e->open = false;
+    return 0;
+}
+
+int usbd_ep_set_stall(uint8_t busid, const uint8_t ep)
+{
+    struct sim_ep *e = sim_ep(busid, ep);
+
+    if (e == NULL) {
+        return -1;
+    }
+    if (USB_EP_GET_IDX(ep) == 0) {
+        g_bus[busid].ep0_stall = true;
+    } else {
+        e->stalled = true;
+    }
+    return 0;
+}
+
+int usbd_ep_clear_stall(uint8_t busid, const uint8_t ep)
+{
+    struct sim_ep *e = sim_ep(busid, ep);
+
+    if (e == NULL) {
+        return -1;
+    }
+    e->stalled = false;
+    return 0;
+}
+
+int usbd_ep_is_stalled(uint8_t busid, const uint8_t ep, uint8_t *stalled)
+{
+    struct sim_ep *e = sim_ep(busid, ep);
+
+    if (e == NULL) {
+        return -1;
+    }
+    *stalled = e->stalled;
+    return 0;
+}
+
+static int sim_ep_start(uint8_t busid, uint8_t ep, uint8_t *data, uint32_t data_len)
+{
+    struct sim_ep *e = sim_ep(busid, ep);
+
+    if (e == NULL || (!data && data_len)) {
+        return -1;
+    }
+    if (USB_EP_GET_IDX(ep) && !e->open) {
+        return -2;
+    }
+    // EP0 moves one packet per call, the core continues the transfer
+    if (USB_EP_GET_IDX(ep) == 0 && data_len > e->mps) {
+        data_len = e->mps;
+    }
+
+    e->buf = data;
+    e->len = data_len;
+    e->actual = 0;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+    e->armed = 1;
+    return 0;
+}
+
+int usbd_ep_start_write(uint8_t busid, const uint8_t ep, const uint8_t *data, uint32_t data_len)
+{
+    return sim_ep_start(busid, ep, (uint8_t *)data, data_len);
+}
+
+int usbd_ep_start_read(uint8_t busid, const uint8_t ep, uint8_t *data, uint32_t data_len)
+{
+    return sim_ep_start(busid, ep, data, data_len);
+}
+
+/* ========== host side: control transfers ========== */
+/* Run one control transfer to completion. Returns bytes moved in the data
+ * stage, -1 on stall.
+ */
+static int sim_control(uint8_t busid, uint8_t type, uint8_t req, uint16_t value, uint16_t index,
+                       uint8_t *data, uint16_t length)
+{
+    struct sim_bus *bus = &g_bus[busid];
+    struct sim_ep *in0 = &bus->in[0];
+    struct sim_ep *out0 = &bus->out[0];
+    struct usb_setup_packet setup = {
+        .bmRequestType = type, .bRequest = req, .wValue = value, .wIndex = index, .wLength = length
+    };
+    bool dir_in = (type & USB_REQUEST_DIR_MASK) == USB_REQUEST_DIR_IN;
+    uint32_t done = 0;
+
+    bus->ep0_stall = false;
+    in0->armed = 0;
+    out0->armed = 0;
+    usbd_event_ep0_setup_complete_handler(busid, (uint8_t *)&setup);
+
+    for (int guard = 0; guard < 256 && !bus->ep0_stall; guard++) {
+        if (in0->armed) {
+            uint32_t n = in0->len;
+
+            if (dir_in && n) {
+                uint32_t copy = (done + n > length) ? length - done : n;
+                memcpy(data + done, in0->buf, copy);
+                done += copy;
+            }
+            in0->armed = 0;
+            usbd_event_ep_in_complete_handler(busid, USB_CONTROL_IN_EP0, n);
+        } else if (out0->armed) {
+            uint32_t n = 0;
+
+            if (!dir_in && out0->len) {
+                n = (out0->len < length - done) ? out0->len : length - done;
+                memcpy(out0->buf, data + done, n);
+                done += n;
+            }
+            out0->armed = 0;
+            usbd_event_ep_out_complete_handler(busid, USB_CONTROL_OUT_EP0, n);
+        } else {
+            break;
+        }
+    }
+
+    return bus->ep0_stall ? -1 : (int)done;
+}
+
+/* ========== host side: enumeration ========== */
+static void sim_bind_functions(uint8_t busid, const uint8_t *desc, uint32_t len)
+{
+    struct sim_bus *bus = &g_bus[busid];
+    struct sim_port *cur = NULL;
+    bool in_data = false;
+
+    if (bus->port_num == 0) {
+        bus->port_first = g_port_bound;
+    }
+    uint8_t next = bus->port_first;
+
+    for (uint32_t off = 0; off + 2 <= len && desc[off] >= 2; off += desc[off]) {
+        const uint8_t *d = &desc[off];
+
+        if (d[1] == USB_DESCRIPTOR_TYPE_INTERFACE && d[3] == 0) {
+            in_data = false;
+            if (d[5] == USB_DEVICE_CLASS_CDC && d[6] == CDC_ABSTRACT_CONTROL_MODEL) {
+                if (next >= g_cfg.ports) {
+                    cur = NULL;
+                    continue;
+                }
+                cur = &g_port[next++];
+                cur->busid = busid;
+                cur->intf = d[2];
+                cur->bound = true;
+            } else if (d[5] == CDC_DATA_INTERFACE_CLASS && cur != NULL) {
+                in_data = true;
+            } else {
+                cur = NULL;
+            }
+        } else if (d[1] == USB_DESCRIPTOR_TYPE_ENDPOINT && cur != NULL) {
+            uint8_t addr = d[2];
+            uint8_t type = d[3] & USB_ENDPOINT_TYPE_MASK;
+
+            if (type == USB_ENDPOINT_TYPE_INTERRUPT && !in_data) {
+                cur->int_ep = addr;
+            } else if (type == USB_ENDPOINT_TYPE_BULK && in_data) {
+                if (USB_EP_DIR_IS_IN(addr)) {
+                    cur->in_ep = addr;
+                } else {
+                    cur->out_ep = addr;
+                }
+            }
+        }
+    }
+
+    bus->port_num = next - bus->port_first;
+    if (next > g_port_bound) {
+        g_port_bound = next;
+    }
+}
+
+static void sim_enumerate(uint8_t busid)
+{
+    static uint8_t buf[CONFIG_USBDEV_REQUEST_BUFFER_LEN];
+    struct sim_bus *bus = &g_bus[busid];
+    uint16_t total;
+
+    usbd_event_reset_handler(busid);
+
+    if (sim_control(busid, 0x80, USB_REQUEST_GET_DESCRIPTOR, USB_DESCRIPTOR_TYPE_DEVICE << 8, 0, buf, 18) != 18) {
+        return;
+    }
+    if (sim_control(busid, 0x00, USB_REQUEST_SET_ADDRESS, busid + 1, 0, NULL, 0) < 0) {
+        return;
+    }
+    if (sim_control(busid, 0x80, USB_REQUEST_GET_DESCRIPTOR, USB_DESCRIPTOR_TYPE_CONFIGURATION << 8, 0, buf, 9) != 9) {
+        return;
+    }
+    total = (uint16_t)(buf[2] | (buf[3] << 8));
+    if (total > sizeof(buf) ||
+        sim_control(busid, 0x80, USB_REQUEST_GET_DESCRIPTOR, USB_DESCRIPTOR_TYPE_CONFIGURATION << 8, 0, buf, total) != total) {
+        return;
+    }
+    sim_bind_functions(busid, buf, total);
+
+    if (sim_control(busid, 0x00, USB_REQUEST_SET_CONFIGURATION, buf[5], 0, NULL, 0) < 0) {
+        return;
+    }
+    bus->configured = true;
+
+    for (uint8_t i = bus->port_first; i < bus->port_first + bus->port_num; i++) {
+        g_port[i].open = false;
+        memset(g_port[i].coding, 0, sizeof(g_port[i].coding));
+    }
+}
+
+/* ========== host side: CDC ACM functions ========== */
+static uint32_t sim_baud(speed_t s)
+{
+    static const struct {
+        speed_t s;
+        uint32_t baud;
+    } map[] = {
+        { B1200, 1200 }, { B2400, 2400 }, { B4800, 4800 }, { B9600, 9600 }, { B19200, 19200 },
+        { B38400, 38400 }, { B57600, 57600 }, { B115200, 115200 }, { B230400, 230400 },
+        { B460800, 460800 }, { B921600, 921600 }, { B1000000, 1000000 }, { B1500000, 1500000 },
+        { B2000000, 2000000 }, { B3000000, 3000000 }, { B4000000, 4000000 },
+    };
+
+    for (uint32_t i = 0; i < sizeof(map) / sizeof(map[0]); i++) {
+        if (map[i].s == s) {
+            return map[i].baud;
+        }
+    }
+    return 115200;
+}
+
+/* Line coding as the host cdc-acm driver derives it from termios */
+static void sim_line_coding(struct sim_port *p, uint8_t coding[7])
+{
+    struct termios tio;
+    uint32_t baud = 115200;
+    uint8_t bits = 8;
+
+    memset(&tio, 0, sizeof(tio));
+    if (tcgetattr(p->master, &tio) == 0) {
+        baud = sim_baud(cfgetospeed(&tio));
+        switch (tio.c_cflag & CSIZE) {
+            case CS5: bits = 5; break;
+            case CS6: bits = 6; break;
+            case CS7: bits = 7; break;
+            default: bits = 8; break;
+        }
+    }
+
+    coding[0] = (uint8_t)baud;
+    coding[1] = (uint8_t)(baud >> 8);
+    coding[2] = (uint8_t)(baud >> 16);
+    coding[3] = (uint8_t)(baud >> 24);
+    coding[4] = (tio.c_cflag & CSTOPB) ? 2 : 0;
+    coding[5] = (tio.c_cflag & PARENB) ? ((tio.c_cflag & PARODD) ? 1 : 2) : 0;
+    coding[6] = bits;
+}
+
+static void sim_port_state(struct sim_port *p)
+{
+    struct pollfd pfd = { .fd = p->master, .events = POLLIN };
+    uint8_t coding[7];
+    bool open;
+
+    poll(&pfd, 1, 0);
+    open = !(pfd.revents & POLLHUP);
+
+    if (open) {
+        sim_line_coding(p, coding);
+        if (!p->open || memcmp(coding, p->coding, sizeof(coding)) != 0) {
+            memcpy(p->coding, coding, sizeof(coding));
+            sim_control(p->busid, 0x21, CDC_REQUEST_SET_LINE_CODING, 0, p->intf, coding, sizeof(coding));
+        }
+    }
+    if (open != p->open) {
+        p->open = open;
+        if (open) {
+            p->stats.opens++;
+        }
+        sim_control(p->busid, 0x21, CDC_REQUEST_SET_CONTROL_LINE_STATE, open ? 0x0003 : 0x0000, p->intf, NULL, 0);
+    }
+}
+
+/* One IN packet to the pty. Returns bytes moved, -1 if nothing to do */
+static int sim_in_packet(struct sim_port *p, uint32_t budget, bool *nak)
+{
+    struct sim_ep *e = sim_ep(p->busid, p->in_ep);
+    uint32_t n;
+    ssize_t w;
+
+    if (!p->open || !e->armed || e->stalled) {
+        return -1;
+    }
+
+    n = e->len - e->actual;
+    if (n > e->mps) {
+        n = e->mps;
+    }
+    if (n > budget) {
+        return -1;
+    }
+    if (n > 0) {
+        w = write(p->master, e->buf + e->actual, n);
+        if (w <= 0) {
+            *nak = true;
+            return -1;
+        }
+        e->actual += (uint32_t)w;
+        p->stats.in_bytes += (uint64_t)w;
+    } else {
+        w = 0; // zero-length packet
+    }
+
+    if (e->actual == e->len) {
+        e->armed = 0;
+        usbd_event_ep_in_complete_handler(p->busid, p->in_ep, e->len);
+    }
+    return (int)w;
+}
+
+/* One OUT packet from the pty. Returns bytes moved, -1 if nothing to do */
+static int sim_out_packet(struct sim_port *p, uint32_t budget)
+{
+    struct sim_ep *e = sim_ep(p->busid, p->out_ep);
+    uint32_t want;
+    ssize_t r;
+
+    if (!p->open || !e->armed || e->stalled) {
+        return -1;
+    }
+
+    want = e->len - e->actual;
+    if (want > e->mps) {
+        want = e->mps;
+    }
+    if (want > budget || want == 0) {
+        return -1;
+    }
+
+    r = read(p->master, e->buf + e->actual, want);
+    if (r <= 0) {
+        return -1;
+    }
+    e->actual += (uint32_t)r;
+    p->stats.out_bytes += (uint64_t)r;
+
+    // a short packet or the full length ends the transfer
+    if ((uint32_t)r < e->mps || e->actual == e->len) {
+        e->armed = 0;
+        usbd_event_ep_out_complete_handler(p->busid, p->out_ep, e->actual);
+    }
+    return (int)r;
+}
+
+static void sim_bus_frame(uint8_t busid)
+{
+    struct sim_bus *bus = &g_bus[busid];
+    uint32_t budget = g_cfg.frame_bytes ? g_cfg.frame_bytes : UINT32_MAX;
+    bool nak[USB_SIM_MAX_PORTS] = { false };
+    bool progress;
+
+    if (!bus->configured) {
+        sim_enumerate(busid);
+        if (!bus->configured) {
+            return;
+        }
+    }
+
+    if (bus->sof_enable) {
+        usbd_event_sof_handler(busid);
+    }
+
+    for (uint8_t i = bus->port_first; i < bus->port_first + bus->port_num; i++) {
+        sim_port_state(&g_port[i]);
+        g_port[i].stats.frames++;
+
+        // serial state notifications: accepted and dropped
+        struct sim_ep *e = sim_ep(busid, g_port[i].int_ep);
+        if (g_port[i].int_ep && e->armed) {
+            e->armed = 0;
+            usbd_event_ep_in_complete_handler(busid, g_port[i].int_ep, e->len);
+        }
+    }
+
+    // bulk packets round-robin over the functions until the frame is full
+    do {
+        progress = false;
+        for (uint8_t i = bus->port_first; i < bus->port_first + bus->port_num && budget; i++) {
+            int n = sim_in_packet(&g_port[i], budget, &nak[i]);
+            if (n >= 0) {
+                budget -= (uint32_t)n;
+                progress = true;
+            }
+            n = sim_out_packet(&g_port[i], budget);
+            if (n >= 0) {
+                budget -= (uint32_t)n;
+                progress = true;
+            }
+        }
+    } while (progress && budget);
+
+    for (uint8_t i = bus->port_first; i < bus->port_first + bus->port_num; i++) {
+        if (nak[i]) {
+            g_port[i].stats.in_nak_frames++;
+        }
+    }
+}
+
+/* The "USB interrupt": one frame on every attached bus */
+static void sim_frame_irq(int sig)
+{
+    int saved_errno = errno;
+
+    (void)sig;
+    for (uint8_t busid = 0; busid < USB_SIM_MAX_BUS; busid++) {
+        if (g_bus[busid].attached) {
+            sim_bus_frame(busid);
+        }
+    }
+    errno = saved_errno;
+}
+
+/* ========== API ========== */
+static int sim_open_pty(struct sim_port *p, uint8_t index)
+{
+    struct termios tio;
+    int slave;
+
+    p->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (p->master < 0 || grantpt(p->master) != 0 || unlockpt(p->master) != 0 ||
+        ptsname_r(p->master, p->path, sizeof(p->path)) != 0) {
+        perror("pty");
+        return -1;
+    }
+
+    // raw 115200 8N1 like a fresh ttyACM; opening and closing the slave once
+    // also makes the master report POLLHUP until a host program opens it
+    slave = open(p->path, O_RDWR | O_NOCTTY);
+    if (slave < 0) {
+        perror(p->path);
+        return -1;
+    }
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    cfsetspeed(&tio, B115200);
+    tcsetattr(slave, TCSANOW, &tio);
+    close(slave);
+
+    if (g_cfg.link_prefix) {
+        snprintf(p->link, sizeof(p->link), "%s%u", g_cfg.link_prefix, index);
+        unlink(p->link);
+        if (symlink(p->path, p->link) != 0) {
+            perror(p->link);
+            p->link[0] = '\0';
+        }
+    }
+    return 0;
+}
+
+int usb_sim_start(const usb_sim_config_t *cfg)
+{
+    struct sigaction sa;
+    struct itimerval it = { .it_interval = { 0, 1000 }, .it_value = { 0, 1000 } };
+
+    g_cfg = *cfg;
+    if (g_cfg.ports == 0 || g_cfg.ports > USB_SIM_MAX_PORTS) {
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &g_t0);
+
+    for (uint8_t i = 0; i < g_cfg.ports; i++) {
+        if (sim_open_pty(&g_port[i], i) != 0) {
+            return -1;
+        }
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = sim_frame_irq;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, NULL);
+    return setitimer(ITIMER_REAL, &it, NULL);
+}
+
+void usb_sim_stop(void)
+{
+    struct itimerval it = { 0 };
+
+    setitimer(ITIMER_REAL, &it, NULL);
+    for (uint8_t i = 0; i < g_cfg.ports; i++) {
+        if (g_port[i].link[0]) {
+            unlink(g_port[i].link);
+        }
+    }
+}
+
+const char *usb_sim_port_path(uint8_t port)
+{
+    if (port >= g_cfg.ports) {
+        return NULL;
+    }
+    return g_port[port].link[0] ? g_port[port].link : g_port[port].path;
+}
+
+bool usb_sim_bus_configured(uint8_t busid)
+{
+    return busid < USB_SIM_MAX_BUS && g_bus[busid].configured;
+}
+
+void usb_sim_get_port_stats(uint8_t port, usb_sim_port_stats_t *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    *stats = g_port[port].stats;
+    __set_PRIMASK(primask);
+}
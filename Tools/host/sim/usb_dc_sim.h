@@ -0,0 +1,53 @@
+/*
+ * Host-simulated USB device controller (usb_dc.h backend) - Header File
+ *
+ * Replaces the dwc2 port so CherryUSB, the CDC ACM service and the benchmark
+ * run unmodified on Linux. Every CDC ACM function the device enumerates is
+ * bridged to a pseudo-terminal; host programs open its slave side like
+ * /dev/ttyACM*.
+ */
+#ifndef USB_DC_SIM_H
+#define USB_DC_SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define USB_SIM_MAX_BUS   2
+#define USB_SIM_MAX_PORTS 4
+
+typedef struct {
+    uint32_t ports;          /* ptys to create, one per CDC ACM function */
+    uint32_t frame_bytes;    /* bulk bytes per bus per 1 ms frame, 0 = unlimited */
+    const char *link_prefix; /* if set, symlink <prefix>0, <prefix>1, ... to the ptys */
+} usb_sim_config_t;
+
+typedef struct {
+    uint32_t frames;         /* SOFs delivered */
+    uint64_t in_bytes;       /* device -> host */
+    uint64_t out_bytes;      /* host -> device */
+    uint32_t in_nak_frames;  /* frames the host could not take IN data (pty full) */
+    uint32_t opens;          /* SET_CONTROL_LINE_STATE with DTR set */
+} usb_sim_port_stats_t;
+
+/* FS bulk: at most 19 64-byte packets per frame */
+#define USB_SIM_FS_FRAME_BYTES (19 * 64)
+
+/**
+ * @brief Create the ptys and start the 1 ms frame timer
+ *
+ * @note Call before cdc_acm_init(); usb_dc_init() only marks the bus attached,
+ *       the next frame resets and enumerates it.
+ */
+int usb_sim_start(const usb_sim_config_t *cfg);
+
+void usb_sim_stop(void);
+
+/** Slave path of port's pty (ports are numbered in enumeration order: bus 0 first) */
+const char *usb_sim_port_path(uint8_t port);
+
+/** Whether the bus finished SET_CONFIGURATION */
+bool usb_sim_bus_configured(uint8_t busid);
+
+void usb_sim_get_port_stats(uint8_t port, usb_sim_port_stats_t *stats);
+
+#endif /* USB_DC_SIM_H */
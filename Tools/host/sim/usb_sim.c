@@ -0,0 +1,210 @@
+/*
+ * CDC ACM device on the host-simulated controller.
+ *
+ * Runs the firmware's USB stack (CherryUSB core + usbd_cdc_acm), the CDC
+ * ring-buffer service and the throughput benchmark against usb_dc_sim.c.
+ * Every CDC ACM port shows up as a pty:
+ *
+ *   port 0       "BENCH SOURCE|SINK|LOOP|OFF" (one write, no newline) switches
+ *                the benchmark as on the terminal; closing the port (DTR off)
+ *                stops it. Anything else is echoed back.
+ *   other ports  echo
+ *
+ *   usb_sim [-l prefix] [-f frame_bytes] [-t seconds]
+ *     -l  symlink the ptys to <prefix>0, <prefix>1, ...
+ *     -f  bulk bytes per bus per 1 ms frame (default 1216 = FS, 0 = unlimited)
+ *     -t  exit after this many seconds (default: run until SIGINT/SIGTERM)
+ *
+ * Build variants (Makefile): usb_sim (1 port), usb_sim_2port (two ports on the
+ * OTG_HS core, sharing one bus), usb_sim_2bus (one port on each of two buses,
+ * OTG_FS + OTG_HS; each bus has its own frame budget).
+ */
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cdc_acm_ringbuffer.h"
+#include "cdc_bench.h"
+#include "stm32f4xx_hal.h"
+#include "usb_dc_sim.h"
+
+#ifndef USB_SIM_BUS1_BASE
+#define USB_SIM_BUS1_BASE 0x40040000UL // USB_OTG_HS_PERIPH_BASE
+#endif
+
+#if (CDC_ACM_BUS_NUM == 1) && (CDC_ACM_BUS_PORTS > 1)
+#define USB_SIM_BUS0_BASE USB_SIM_BUS1_BASE // several ports need the HS core
+#else
+#define USB_SIM_BUS0_BASE 0x50000000UL // USB_OTG_FS_PERIPH_BASE
+#endif
+
+#define SIM_RX_SIZE 8192
+#define SIM_TX_SIZE 8192
+
+static uint8_t s_rx_pool[CDC_ACM_PORT_NUM][SIM_RX_SIZE] __attribute__((aligned(4)));
+static uint8_t s_tx_pool[CDC_ACM_PORT_NUM][SIM_TX_SIZE] __attribute__((aligned(4)));
+
+static volatile sig_atomic_t s_quit;
+static volatile uint8_t s_events;
+
+static void on_quit(int sig)
+{
+    s_quit = 1;
+}
+
+static void on_cdc_event(uint8_t port, uint8_t events)
+{
+    s_events |= events;
+}
+
+/* Port 0 commands, matched against the whole chunk like the terminal does */
+static bool handle_command(const uint8_t *data, int len)
+{
+    char cmd[16];
+
+    if (len < 6 || len >= (int)sizeof(cmd) || memcmp(data, "BENCH ", 6) != 0) {
+        return false;
+    }
+    memcpy(cmd, data, (size_t)len);
+    cmd[len] = '\0';
+    for (int m = CDC_BENCH_OFF; m < CDC_BENCH_MODE_NUM; m++) {
+        if (strcmp(cmd + 6, cdc_bench_mode_name((cdc_bench_mode_t)m)) == 0) {
+            cdc_bench_start(0, (cdc_bench_mode_t)m);
+            fprintf(stderr, "bench %s\n", cdc_bench_mode_name((cdc_bench_mode_t)m));
+            return true;
+        }
+    }
+    return false;
+}
+
+static void echo_port(uint8_t port)
+{
+    uint8_t buf[512];
+    uint32_t n = cdc_acm_port_get_rx_available(port);
+    uint32_t room = cdc_acm_port_get_tx_free(port);
+
+    if (n > room) {
+        n = room;
+    }
+    if (n > sizeof(buf)) {
+        n = sizeof(buf);
+    }
+    if (n == 0) {
+        return;
+    }
+    int got = cdc_acm_port_read_data(port, buf, n);
+    if (got <= 0) {
+        return;
+    }
+    if (port == CDC_ACM_PORT_DEFAULT && handle_command(buf, got)) {
+        return;
+    }
+    cdc_acm_port_send_data(port, buf, (uint32_t)got);
+}
+
+static void bench_poll(void)
+{
+    cdc_bench_report_t rpt;
+
+    if (cdc_bench_get_mode() == CDC_BENCH_OFF) {
+        return;
+    }
+    if (!cdc_acm_port_is_open(CDC_ACM_PORT_DEFAULT)) {
+        cdc_bench_stop();
+        fprintf(stderr, "bench OFF (port closed)\n");
+        return;
+    }
+    if (cdc_bench_task(&rpt)) {
+        fprintf(stderr, "bench %s: tx %lu B/s rx %lu B/s lost %lu interval p50/p99/max %lu/%lu/%lu us\n",
+                cdc_bench_mode_name(rpt.mode),
+                (unsigned long)((uint64_t)rpt.tx_bytes * 1000U / (rpt.period_ms ? rpt.period_ms : 1)),
+                (unsigned long)((uint64_t)rpt.rx_bytes * 1000U / (rpt.period_ms ? rpt.period_ms : 1)),
+                (unsigned long)rpt.lost_bytes, (unsigned long)rpt.interval_p50_us,
+                (unsigned long)rpt.interval_p99_us, (unsigned long)rpt.interval_max_us);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    usb_sim_config_t cfg = { .ports = CDC_ACM_PORT_NUM, .frame_bytes = USB_SIM_FS_FRAME_BYTES };
+    unsigned seconds = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:f:t:")) != -1) {
+        switch (opt) {
+            case 'l': cfg.link_prefix = optarg; break;
+            case 'f': cfg.frame_bytes = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': seconds = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                fprintf(stderr, "usage: %s [-l prefix] [-f frame_bytes] [-t seconds]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    signal(SIGINT, on_quit);
+    signal(SIGTERM, on_quit);
+
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        cdc_acm_port_set_buffers(port, s_rx_pool[port], SIM_RX_SIZE, s_tx_pool[port], SIM_TX_SIZE);
+    }
+    cdc_acm_set_event_callback(on_cdc_event);
+
+    if (usb_sim_start(&cfg) != 0) {
+        return 1;
+    }
+    cdc_acm_init(0, USB_SIM_BUS0_BASE);
+#if CDC_ACM_BUS_NUM > 1
+    cdc_acm_init(1, USB_SIM_BUS1_BASE);
+#endif
+
+    // every bus must enumerate before the ports are announced
+    uint32_t start = HAL_GetTick();
+    for (uint8_t busid = 0; busid < CDC_ACM_BUS_NUM; busid++) {
+        while (!usb_sim_bus_configured(busid)) {
+            if (HAL_GetTick() - start > 1000U) {
+                fprintf(stderr, "bus %u did not enumerate\n", busid);
+                usb_sim_stop();
+                return 1;
+            }
+            __WFI();
+        }
+    }
+
+    printf("ports %u\n", CDC_ACM_PORT_NUM);
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        printf("port %u: %s\n", port, usb_sim_port_path(port));
+    }
+    fflush(stdout);
+
+    start = HAL_GetTick();
+    while (!s_quit && (seconds == 0 || HAL_GetTick() - start < seconds * 1000U)) {
+        bench_poll();
+
+        for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+            if (port != CDC_ACM_PORT_DEFAULT || cdc_bench_get_mode() == CDC_BENCH_OFF) {
+                echo_port(port);
+            }
+        }
+
+        // sleep until a USB event or the next frame, as the firmware scheduler does
+        __disable_irq();
+        if (s_events == 0) {
+            __WFI();
+        }
+        s_events = 0;
+        __enable_irq();
+    }
+
+    usb_sim_stop();
+    for (uint8_t port = 0; port < CDC_ACM_PORT_NUM; port++) {
+        usb_sim_port_stats_t st;
+
+        usb_sim_get_port_stats(port, &st);
+        fprintf(stderr, "port %u: frames %u in %llu B out %llu B in-NAK frames %u opens %u\n", port,
+                st.frames, (unsigned long long)st.in_bytes, (unsigned long long)st.out_bytes,
+                st.in_nak_frames, st.opens);
+    }
+    return 0;
+}
@@ -0,0 +1,504 @@
+/*
+ * Host test for the YMODEM engine (Core/Src/ymodem.c).
+ *
+ * ymodem.c runs against a fake CDC port (the cdc_acm_port_* calls it uses)
+ * and a simulated millisecond tick. The test plays the host side: lrzsz-like
+ * sender and receiver written as straight-line code that pumps ymodem_task()
+ * while it waits for device output.
+ *
+ * Covered:
+ *   receive 1K (CRC block, lost ACK resend, EOT NAK/ACK), receive 1K-G,
+ *   send 1K with the window and a NAK go-back, send 1K-G,
+ *   control bytes held back while the tx buffer is full and sent afterwards,
+ *   a session that gives up when the tx buffer never drains.
+ *
+ *   ym_test         # all cases, prints one line each
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cdc_acm_ringbuffer.h"
+#include "stm32f4xx_hal.h"
+#include "ymodem.h"
+
+#define YT_PORT     1           /* not the default port: the session must use its own */
+#define YT_TX_SIZE  4096        /* CDC_TX_RINGBUF_SIZE */
+#define YT_RX_SIZE  8192
+#define YT_WAIT_MS  20000       /* longest a host step waits for the device */
+
+#define SOH 0x01
+#define STX 0x02
+#define EOT 0x04
+#define ACK 0x06
+#define NAK 0x15
+#define CAN 0x18
+
+static uint32_t s_tick;
+
+static uint8_t s_rx[YT_RX_SIZE];            /* host -> device */
+static uint32_t s_rx_head, s_rx_tail;
+static uint8_t s_tx[YT_TX_SIZE];            /* device -> host */
+static uint32_t s_tx_len;
+static uint32_t s_tx_fail;                  /* fail this many device writes */
+static int s_tx_stuck;                      /* every device write fails */
+
+static ymodem_status_t s_end;               /* DONE/FAILED once reported */
+
+static void fail(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    fprintf(stderr, "ym_test: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(1);
+}
+
+/* ========== stand-ins for the firmware ========== */
+uint32_t HAL_GetTick(void)
+{
+    return s_tick;
+}
+
+static void check_port(uint8_t port)
+{
+    if (port != YT_PORT) {
+        fail("I/O on port %u, session is on port %u", port, YT_PORT);
+    }
+}
+
+static int tx_put(const void *data, uint32_t len)
+{
+    if (s_tx_stuck || s_tx_fail || len > YT_TX_SIZE - s_tx_len) {
+        if (s_tx_fail) {
+            s_tx_fail--;
+        }
+        return 0;
+    }
+    memcpy(&s_tx[s_tx_len], data, len);
+    s_tx_len += len;
+    return (int)len;
+}
+
+int cdc_acm_port_send_data(uint8_t port, const uint8_t *data, uint32_t len)
+{
+    check_port(port);
+    return tx_put(data, len);
+}
+
+int cdc_acm_port_sendv(uint8_t port, const cdc_acm_iovec_t *iov, uint32_t iovcnt)
+{
+    uint8_t buf[YT_TX_SIZE];
+    uint32_t total = 0;
+
+    check_port(port);
+    for (uint32_t i = 0; i < iovcnt; i++) {
+        if (iov[i].len > sizeof(buf) - total) {
+            return 0;
+        }
+        memcpy(&buf[total], iov[i].base, iov[i].len);
+        total += iov[i].len;
+    }
+    return tx_put(buf, total);
+}
+
+int cdc_acm_port_read_data(uint8_t port, uint8_t *buffer, uint32_t max_len)
+{
+    uint32_t n = s_rx_head - s_rx_tail;
+
+    check_port(port);
+    if (n > max_len) {
+        n = max_len;
+    }
+    memcpy(buffer, &s_rx[s_rx_tail], n);
+    s_rx_tail += n;
+    return (int)n;
+}
+
+uint32_t cdc_acm_port_get_rx_available(uint8_t port)
+{
+    check_port(port);
+    return s_rx_head - s_rx_tail;
+}
+
+void cdc_acm_port_flush_rx(uint8_t port)
+{
+    check_port(port);
+    s_rx_head = s_rx_tail = 0;
+}
+
+/* ========== host side ========== */
+static void reset(void)
+{
+    s_tick = 1000;
+    s_rx_head = s_rx_tail = 0;
+    s_tx_len = 0;
+    s_tx_fail = 0;
+    s_tx_stuck = 0;
+    s_end = YMODEM_IDLE;
+}
+
+/* one main loop pass of the device, 1 ms apart */
+static void pump(void)
+{
+    ymodem_status_t st = ymodem_task();
+
+    if (st == YMODEM_DONE || st == YMODEM_FAILED) {
+        s_end = st;
+    }
+    s_tick++;
+}
+
+static void host_write(const void *data, uint32_t len)
+{
+    if (s_rx_tail == s_rx_head) {
+        s_rx_head = s_rx_tail = 0;
+    }
+    if (len > YT_RX_SIZE - s_rx_head) {
+        fail("host -> device buffer overflow");
+    }
+    memcpy(&s_rx[s_rx_head], data, len);
+    s_rx_head += len;
+}
+
+/* let the device take what was written, as the OUT endpoint NAKs when its buffer is full */
+static void host_flush(void)
+{
+    for (uint32_t t = 0; s_rx_tail != s_rx_head && t < YT_WAIT_MS; t++) {
+        pump();
+    }
+}
+
+static void host_putc(uint8_t b)
+{
+    host_write(&b, 1);
+}
+
+/* next byte from the device, pumping it until one arrives */
+static int host_getc(void)
+{
+    uint8_t b;
+
+    for (uint32_t t = 0; s_tx_len == 0; t++) {
+        if (t >= YT_WAIT_MS || s_end != YMODEM_IDLE) {
+            return -1;
+        }
+        pump();
+    }
+    b = s_tx[0];
+    memmove(s_tx, s_tx + 1, --s_tx_len);
+    return b;
+}
+
+static void expect(uint8_t want, const char *what)
+{
+    int b = host_getc();
+
+    if (b != want) {
+        fail("%s: expected 0x%02x, got %d", what, want, b);
+    }
+}
+
+static void wait_end(ymodem_status_t want)
+{
+    for (uint32_t t = 0; s_end == YMODEM_IDLE && t < YT_WAIT_MS; t++) {
+        pump();
+    }
+    if (s_end != want) {
+        ymodem_result_t res;
+
+        ymodem_get_result(&res);
+        fail("session ended with %d (%s), expected %d", s_end, res.error ? res.error : "-", want);
+    }
+}
+
+static uint16_t crc16(const uint8_t *data, uint32_t len)
+{
+    uint16_t crc = 0;
+
+    while (len--) {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void host_block(uint8_t seq, const uint8_t *data, uint32_t size, int corrupt)
+{
+    uint8_t pkt[3 + 1024 + 2];
+    uint16_t crc = crc16(data, size);
+
+    pkt[0] = (size == 1024) ? STX : SOH;
+    pkt[1] = seq;
+    pkt[2] = (uint8_t)~seq;
+    memcpy(&pkt[3], data, size);
+    pkt[3 + size] = (uint8_t)(crc >> 8);
+    pkt[4 + size] = (uint8_t)crc;
+    if (corrupt) {
+        pkt[3 + size / 2] ^= 0x40;
+    }
+    host_write(pkt, size + 5);
+}
+
+static void host_header(const char *name, uint32_t size)
+{
+    uint8_t blk[128] = { 0 };
+
+    if (name != NULL) {
+        int n = snprintf((char *)blk, 64, "%s", name);
+        snprintf((char *)&blk[n + 1], sizeof(blk) - (uint32_t)n - 1, "%lu 0", (unsigned long)size);
+    }
+    host_block(0, blk, sizeof(blk), 0);
+}
+
+/* data block blk (1..) of file, padded with 0x1A, 1K unless 128 bytes hold the rest */
+static uint32_t file_block(const uint8_t *file, uint32_t len, uint32_t blk, uint8_t *out)
+{
+    uint32_t off = (blk - 1) * 1024;
+    uint32_t n = len - off;
+    uint32_t size = (n > 128) ? 1024 : 128;
+
+    memset(out, 0x1A, size);
+    memcpy(out, &file[off], (n < size) ? n : size);
+    return size;
+}
+
+/* read one packet from the device; returns its data length, 0 for EOT */
+static uint32_t host_read_packet(uint8_t *seq, uint8_t *data)
+{
+    int b = host_getc();
+    uint32_t size;
+    uint8_t hdr[2], crc[2];
+
+    if (b == EOT) {
+        return 0;
+    }
+    if (b != SOH && b != STX) {
+        fail("expected a packet, got %d", b);
+    }
+    size = (b == STX) ? 1024 : 128;
+    for (int i = 0; i < 2; i++) {
+        hdr[i] = (uint8_t)host_getc();
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        data[i] = (uint8_t)host_getc();
+    }
+    for (int i = 0; i < 2; i++) {
+        crc[i] = (uint8_t)host_getc();
+    }
+    if ((uint8_t)(hdr[0] ^ hdr[1]) != 0xFF || ((crc[0] << 8) | crc[1]) != crc16(data, size)) {
+        fail("bad packet from the device (seq %u)", hdr[0]);
+    }
+    *seq = hdr[0];
+    return size;
+}
+
+static void make_file(uint8_t *file, uint32_t len, uint32_t seed)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        seed = seed * 1103515245u + 12345u;
+        file[i] = (uint8_t)(seed >> 16);
+    }
+}
+
+static void check_result(const char *name, uint32_t len, uint32_t min_retries)
+{
+    ymodem_result_t res;
+
+    ymodem_get_result(&res);
+    if (strcmp(res.name, name) != 0 || res.size != len || res.bytes != len || res.error != NULL) {
+        fail("result: name '%s' size %lu bytes %lu error %s", res.name, (unsigned long)res.size,
+             (unsigned long)res.bytes, res.error ? res.error : "-");
+    }
+    if (res.retries < min_retries) {
+        fail("result: %lu retries, expected at least %lu", (unsigned long)res.retries, (unsigned long)min_retries);
+    }
+}
+
+/* device receives; host sends like sb: 'C' with per-block ACK, or 'G' streaming */
+static void test_receive(int streaming, uint32_t len, uint32_t stall_at)
+{
+    static uint8_t file[20000], buf[20000], blk[1024];
+    uint8_t poll = streaming ? 'G' : 'C';
+    uint32_t blocks = (len + 1023) / 1024;
+
+    reset();
+    make_file(file, len, len);
+    memset(buf, 0, sizeof(buf));
+    if (ymodem_receive_start(YT_PORT, buf, sizeof(buf), streaming) != 0) {
+        fail("receive_start");
+    }
+
+    expect(poll, "start");
+    host_header("recv.bin", len);
+    if (!streaming) {
+        expect(ACK, "header ACK");
+    }
+    expect(poll, "data request");
+
+    for (uint32_t i = 1; i <= blocks; i++) {
+        uint32_t size = file_block(file, len, i, blk);
+
+        if (streaming) {
+            host_block((uint8_t)i, blk, size, 0);
+            host_flush();
+            continue;
+        }
+        if (i == 2) {
+            // corrupted once: NAK, then the good copy
+            host_block((uint8_t)i, blk, size, 1);
+            expect(NAK, "NAK for a bad CRC");
+        }
+        if (i == stall_at) {
+            s_tx_fail = 3; // the ACK has to wait for room in the tx buffer
+        }
+        host_block((uint8_t)i, blk, size, 0);
+        expect(ACK, "block ACK");
+        if (i == 3) {
+            // as if the ACK was lost: the same block again is ACKed and dropped
+            host_block((uint8_t)i, blk, size, 0);
+            expect(ACK, "duplicate block ACK");
+        }
+    }
+
+    host_putc(EOT);
+    if (!streaming) {
+        expect(NAK, "first EOT");
+        host_putc(EOT);
+    }
+    expect(ACK, "EOT ACK");
+    expect(poll, "next file request");
+    host_header(NULL, 0);
+    if (!streaming) {
+        expect(ACK, "end of batch ACK");
+    }
+    wait_end(YMODEM_DONE);
+
+    check_result("recv.bin", len, (!streaming && blocks >= 2) ? 1 : 0);
+    if (memcmp(buf, file, len) != 0) {
+        fail("received file differs");
+    }
+    printf("receive %-3s %5lu B: ok\n", streaming ? "1KG" : "1K", (unsigned long)len);
+}
+
+/* device sends; host receives like rb: window acked per block (one NAK), or 'G' */
+static void test_send(int streaming, uint32_t len)
+{
+    static uint8_t file[20000], got[20000 + 1024], data[1024];
+    uint8_t poll = streaming ? 'G' : 'C';
+    uint32_t blocks = (len + 1023) / 1024;
+    uint32_t expected = 1, bytes = 0;
+    int nak_sent = 0, eot_naked = 0;
+    uint8_t seq;
+    uint32_t size;
+
+    reset();
+    make_file(file, len, len + 7);
+    if (ymodem_send_start(YT_PORT, "send.bin", file, len) != 0) {
+        fail("send_start");
+    }
+
+    host_putc(poll);
+    size = host_read_packet(&seq, data);
+    if (size != 128 || seq != 0 || strcmp((char *)data, "send.bin") != 0 ||
+        strtoul((char *)data + strlen((char *)data) + 1, NULL, 10) != len) {
+        fail("header block");
+    }
+    if (!streaming) {
+        host_putc(ACK);
+    }
+    host_putc(poll);
+
+    for (;;) {
+        size = host_read_packet(&seq, data);
+        if (size == 0) {
+            if (expected != blocks + 1) {
+                fail("EOT after %lu of %lu blocks", (unsigned long)(expected - 1), (unsigned long)blocks);
+            }
+            if (!streaming && !eot_naked) {
+                eot_naked = 1;
+                host_putc(NAK);
+                continue;
+            }
+            host_putc(ACK);
+            break;
+        }
+        if (seq != (uint8_t)expected) {
+            if (streaming) {
+                fail("stream block %u, expected %lu", seq, (unsigned long)expected);
+            }
+            continue; // sent ahead of the NAK, the sender goes back
+        }
+        if (!streaming && expected == 2 && !nak_sent) {
+            nak_sent = 1;
+            host_putc(NAK);
+            continue;
+        }
+        memcpy(&got[bytes], data, size);
+        bytes += size;
+        expected++;
+        if (!streaming) {
+            host_putc(ACK);
+        }
+    }
+
+    host_putc(poll);
+    size = host_read_packet(&seq, data);
+    if (size != 128 || seq != 0 || data[0] != 0) {
+        fail("end of batch block");
+    }
+    if (!streaming) {
+        host_putc(ACK);
+    }
+    wait_end(YMODEM_DONE);
+
+    check_result("send.bin", len, (!streaming && blocks >= 2) ? 1 : 0);
+    if (memcmp(got, file, len) != 0) {
+        fail("sent file differs");
+    }
+    for (uint32_t i = len; i < bytes; i++) {
+        if (got[i] != 0x1A) {
+            fail("padding byte %lu is 0x%02x", (unsigned long)i, got[i]);
+        }
+    }
+    printf("send    %-3s %5lu B: ok\n", streaming ? "1KG" : "1K", (unsigned long)len);
+}
+
+/* the host never reads: queued control bytes overflow and the session gives up */
+static void test_tx_stuck(void)
+{
+    static uint8_t buf[1024];
+    ymodem_result_t res;
+
+    reset();
+    s_tx_stuck = 1;
+    ymodem_receive_start(YT_PORT, buf, sizeof(buf), false);
+    wait_end(YMODEM_FAILED);
+
+    ymodem_get_result(&res);
+    if (res.error == NULL || strcmp(res.error, "tx buffer full") != 0) {
+        fail("stuck tx ended with '%s'", res.error ? res.error : "-");
+    }
+    printf("receive, tx never drains: failed as expected (%s)\n", res.error);
+}
+
+int main(void)
+{
+    test_receive(0, 5000, 0);
+    test_receive(0, 5000, 4);       // an ACK waits for tx room
+    test_receive(1, 10000, 0);
+    test_receive(0, 100, 0);
+    test_send(0, 9000);
+    test_send(0, 1024);
+    test_send(1, 12345);
+    test_tx_stuck();
+
+    printf("ym_test: ok\n");
+    return 0;
+}
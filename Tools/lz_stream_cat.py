@@ -0,0 +1,192 @@
+#!/usr/bin/env python3
+"""
+Decode the compressed CDC log stream (Core/Inc/lz_stream.h) and print plain text.
+
+Bytes outside a compressed stream pass through unchanged, so the tool can stay
+attached while the device switches compression on ("LZ ON") and off ("LZ OFF").
+
+  lz_stream_cat.py /dev/ttyACM0          # read the CDC port (needs pyserial)
+  lz_stream_cat.py capture.bin -o log.txt
+  lz_stream_cat.py COM5 --stats          # print the ratio to stderr on exit
+"""
+
+import argparse
+import os
+import sys
+
+MAGIC = b"\xffLZ1"
+HDR_LEN = 5
+TYPE_LZ, TYPE_STORED, TYPE_END = 0, 1, 2
+HISTORY = 65536  # > LZ_STREAM_WINDOW, offsets are 16-bit
+
+
+class DecodeError(Exception):
+    pass
+
+
+def decode_block(data, hist):
+    """Decode one type 0 block, appending to hist (bytearray)."""
+    i, n = 0, len(data)
+    start = len(hist)
+    while i < n:
+        token = data[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                if i >= n:
+                    raise DecodeError("truncated literal length")
+                b = data[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        if i + lit > n:
+            raise DecodeError("literals past end of block")
+        hist += data[i:i + lit]
+        i += lit
+        if i == n:
+            break  # last sequence has literals only
+        if i + 2 > n:
+            raise DecodeError("truncated offset")
+        off = data[i] | (data[i + 1] << 8)
+        i += 2
+        mlen = token & 15
+        if mlen == 15:
+            while True:
+                if i >= n:
+                    raise DecodeError("truncated match length")
+                b = data[i]
+                i += 1
+                mlen += b
+                if b != 255:
+                    break
+        mlen += 4
+        if off == 0 or off > len(hist):
+            raise DecodeError("offset %d outside history" % off)
+        pos = len(hist) - off
+        if off >= mlen:
+            hist += hist[pos:pos + mlen]
+        else:
+            for k in range(mlen):  # overlapping copy
+                hist.append(hist[pos + k])
+    return len(hist) - start
+
+
+class StreamDecoder:
+    def __init__(self):
+        self.buf = bytearray()
+        self.hist = bytearray()
+        self.in_stream = False
+        self.raw = 0      # decoded bytes from compressed blocks
+        self.wire = 0     # stream bytes (magic + headers + payload)
+        self.errors = 0
+
+    def feed(self, chunk):
+        """Return the plain bytes that became available."""
+        self.buf += chunk
+        out = bytearray()
+        while True:
+            if not self.in_stream:
+                k = self.buf.find(MAGIC)
+                if k < 0:
+                    # keep a possible partial magic at the end
+                    keep = 0
+                    for m in range(len(MAGIC) - 1, 0, -1):
+                        if self.buf.endswith(MAGIC[:m]):
+                            keep = m
+                            break
+                    out += self.buf[:len(self.buf) - keep]
+                    del self.buf[:len(self.buf) - keep]
+                    return bytes(out)
+                out += self.buf[:k]
+                del self.buf[:k + len(MAGIC)]
+                self.in_stream = True
+                self.hist = bytearray()
+                self.wire += len(MAGIC)
+                continue
+
+            if len(self.buf) < HDR_LEN:
+                return bytes(out)
+            btype = self.buf[0]
+            clen = self.buf[1] | (self.buf[2] << 8)
+            rlen = self.buf[3] | (self.buf[4] << 8)
+            if btype > TYPE_END or (btype == TYPE_STORED and clen != rlen):
+                self._lost("bad block header")
+                continue
+            if len(self.buf) < HDR_LEN + clen:
+                return bytes(out)
+            payload = bytes(self.buf[HDR_LEN:HDR_LEN + clen])
+            del self.buf[:HDR_LEN + clen]
+            self.wire += HDR_LEN + clen
+
+            if btype == TYPE_END:
+                self.in_stream = False
+                continue
+
+            start = len(self.hist)
+            try:
+                if btype == TYPE_STORED:
+                    self.hist += payload
+                elif decode_block(payload, self.hist) != rlen:
+                    raise DecodeError("length mismatch")
+            except DecodeError as e:
+                self._lost(str(e))
+                continue
+            out += self.hist[start:]
+            self.raw += rlen
+            if len(self.hist) > 2 * HISTORY:
+                del self.hist[:len(self.hist) - HISTORY]
+
+    def _lost(self, why):
+        # wait for the next stream start (device re-sends it after DTR toggles)
+        self.errors += 1
+        self.in_stream = False
+        sys.stderr.write("[lz_stream_cat] %s, resyncing\n" % why)
+
+
+def open_source(name, baud):
+    if os.path.isfile(name) or name == "-":
+        f = sys.stdin.buffer if name == "-" else open(name, "rb")
+        return lambda: f.read(4096)
+    try:
+        import serial
+    except ImportError:
+        sys.exit("pyserial is required to read a serial port: pip install pyserial")
+    port = serial.Serial(name, baud, timeout=0.1)
+    port.dtr = True  # the device only sends while DTR is set
+    return lambda: port.read(4096) or b""
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("source", help="serial port or capture file ('-' for stdin)")
+    ap.add_argument("-o", "--output", help="write decoded text here instead of stdout")
+    ap.add_argument("-b", "--baud", type=int, default=115200, help="ignored by USB CDC, kept for drivers")
+    ap.add_argument("--stats", action="store_true", help="print compression ratio to stderr on exit")
+    args = ap.parse_args()
+
+    read = open_source(args.source, args.baud)
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    dec = StreamDecoder()
+    is_file = os.path.isfile(args.source) or args.source == "-"
+
+    try:
+        while True:
+            chunk = read()
+            if not chunk and is_file:
+                break
+            text = dec.feed(chunk)
+            if text:
+                out.write(text)
+                out.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if args.stats and dec.raw:
+            sys.stderr.write("[lz_stream_cat] %d B decoded from %d B (%.1f%%), %d errors\n"
+                             % (dec.raw, dec.wire, 100.0 * dec.wire / dec.raw, dec.errors))
+
+
+if __name__ == "__main__":
+    main()
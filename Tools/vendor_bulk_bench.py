@@ -0,0 +1,237 @@
+#!/usr/bin/env python3
+"""
+Throughput of the vendor bulk (WinUSB) interface through libusb.
+
+Talks to the test service in Core/Src/usb_vendor_bulk.c (vendor_bulk_task):
+a SET_MODE vendor request picks the mode, GET_STATS reads the device counters.
+
+  source  the device streams the n % 251 pattern; it is read and checked
+  sink    the pattern is written at full rate; the device checks it and
+          reports received / lost bytes
+  loop    the device echoes; data is written in timestamped chunks and the
+          round-trip time of each chunk is measured
+
+Needs pyusb and libusb-1.0. The interface has no kernel driver on Linux, so
+only access rights are needed (udev rule or root); on Windows WinUSB binds
+without a driver install.
+
+  vendor_bulk_bench.py source -t 5
+  vendor_bulk_bench.py loop --chunk 1000 --window 16000
+  vendor_bulk_bench.py sink --vid 0xffff --pid 0xffff
+
+The firmware sends a ZLP after a transfer that ends on a packet boundary, but
+libusb does not: loop chunks must not be a multiple of the packet size, and
+sink ends with a short write so the last OUT transfer completes.
+"""
+
+import argparse
+import collections
+import struct
+import sys
+import threading
+import time
+
+try:
+    import usb.core
+    import usb.util
+except ImportError:
+    sys.exit("needs pyusb: pip install pyusb (and libusb-1.0)")
+
+PATTERN_MOD = 251           # CDC_BENCH_PATTERN_MOD
+XFER_MAX = 65536
+# pattern bytes from any phase: PATTERN[phase:phase + n]
+PATTERN = bytes(i % PATTERN_MOD for i in range(PATTERN_MOD + XFER_MAX))
+
+REQ_SET_MODE = 0x01         # VENDOR_BULK_REQ_SET_MODE
+REQ_GET_STATS = 0x02        # VENDOR_BULK_REQ_GET_STATS
+MODES = {"loop": 0, "source": 1, "sink": 2}   # vendor_bulk_mode_t
+TIMEOUT_MS = 1000
+
+
+class VendorBulk:
+    def __init__(self, vid, pid):
+        self.dev = usb.core.find(idVendor=vid, idProduct=pid)
+        if self.dev is None:
+            raise ValueError("no device %04x:%04x" % (vid, pid))
+        cfg = self.dev.get_active_configuration()
+        intf = usb.util.find_descriptor(cfg, bInterfaceClass=0xFF)
+        if intf is None:
+            raise ValueError("device has no vendor interface (VENDOR_BULK_ENABLE=0?)")
+        self.intf = intf.bInterfaceNumber
+        usb.util.claim_interface(self.dev, self.intf)
+        direction = lambda e: usb.util.endpoint_direction(e.bEndpointAddress)
+        self.ep_out = usb.util.find_descriptor(intf, custom_match=lambda e: direction(e) == usb.util.ENDPOINT_OUT)
+        self.ep_in = usb.util.find_descriptor(intf, custom_match=lambda e: direction(e) == usb.util.ENDPOINT_IN)
+        self.mps = self.ep_in.wMaxPacketSize
+
+    def set_mode(self, mode):
+        self.dev.ctrl_transfer(0x41, REQ_SET_MODE, MODES[mode], self.intf)
+
+    def stats(self):
+        """(rx bytes, tx bytes, lost bytes) counted by the device"""
+        return struct.unpack("<3I", bytes(self.dev.ctrl_transfer(0xC1, REQ_GET_STATS, 0, self.intf, 12)))
+
+    def write(self, data):
+        return self.ep_out.write(data, TIMEOUT_MS)
+
+    def read(self, timeout=TIMEOUT_MS):
+        try:
+            return bytes(self.ep_in.read(XFER_MAX, timeout))
+        except usb.core.USBTimeoutError:
+            return b""
+
+    def drain(self, quiet_ms=100):
+        """Discard what the previous session left in the device (loop mode)"""
+        while self.read(quiet_ms):
+            pass
+
+    def close(self):
+        self.set_mode("loop")
+        usb.util.release_interface(self.dev, self.intf)
+        usb.util.dispose_resources(self.dev)
+
+
+def percentiles(samples):
+    """p50, p99 and max of a list of seconds, in microseconds"""
+    if not samples:
+        return 0, 0, 0
+    s = sorted(samples)
+    pick = lambda q: s[min(len(s) - 1, int(len(s) * q))] * 1e6
+    return pick(0.50), pick(0.99), s[-1] * 1e6
+
+
+def run_source(vb, seconds):
+    rx = breaks = 0
+    expect = None
+    t0 = time.monotonic()
+    while time.monotonic() - t0 < seconds:
+        data = vb.read()
+        if not data:
+            continue
+        if expect is None:
+            expect = data[0]
+        if data != PATTERN[expect:expect + len(data)]:
+            breaks += (data[0] != expect) + sum(1 for i in range(1, len(data))
+                                                if data[i] != (data[i - 1] + 1) % PATTERN_MOD)
+        expect = (data[-1] + 1) % PATTERN_MOD
+        rx += len(data)
+    elapsed = time.monotonic() - t0
+    print("source %.1fs: %.3f MB/s (%d B), pattern breaks %d" % (elapsed, rx / elapsed / 1e6, rx, breaks))
+    return rx
+
+
+def run_sink(vb, seconds):
+    tx = 0
+    t0 = time.monotonic()
+    while time.monotonic() - t0 < seconds:
+        start = tx % PATTERN_MOD
+        tx += vb.write(PATTERN[start:start + XFER_MAX])
+    # a short packet completes the OUT transfer the last write left open
+    tx += vb.write(PATTERN[tx % PATTERN_MOD:tx % PATTERN_MOD + 1])
+    elapsed = time.monotonic() - t0
+    time.sleep(0.1)
+    rx, _, lost = vb.stats()
+    print("sink %.1fs: %.3f MB/s (sent %d B, device got %d B, lost %d B)"
+          % (elapsed, tx / elapsed / 1e6, tx, rx, lost))
+    if rx != tx & 0xFFFFFFFF or lost:   # device counters are uint32
+        raise ValueError("device did not receive the pattern intact")
+    return tx
+
+
+def run_loop(vb, seconds, chunk, window):
+    if chunk % vb.mps == 0:
+        raise ValueError("--chunk must not be a multiple of %d (no ZLP from libusb)" % vb.mps)
+    inflight = collections.deque()   # (end offset, send time)
+    cond = threading.Condition()
+    state = {"tx": 0, "rx": 0, "stop": False, "error": None}
+
+    def writer():
+        try:
+            while True:
+                with cond:
+                    while not state["stop"] and state["tx"] - state["rx"] + chunk > window:
+                        cond.wait(0.1)
+                    if state["stop"]:
+                        return
+                    start = state["tx"] % PATTERN_MOD
+                now = time.monotonic()
+                n = vb.write(PATTERN[start:start + chunk])
+                with cond:
+                    state["tx"] += n
+                    inflight.append((state["tx"], now))
+        except usb.core.USBError as e:
+            state["error"] = e
+
+    times = []
+    thread = threading.Thread(target=writer, daemon=True)
+    t0 = time.monotonic()
+    thread.start()
+    try:
+        while time.monotonic() - t0 < seconds and state["error"] is None:
+            data = vb.read(100)
+            if not data:
+                continue
+            now = time.monotonic()
+            with cond:
+                rx = state["rx"]
+                ref = PATTERN[rx % PATTERN_MOD:rx % PATTERN_MOD + len(data)]
+                if data != ref:
+                    i = next(i for i in range(len(data)) if data[i] != ref[i])
+                    raise ValueError("echo error at byte %d: got %d, expected %d" % (rx + i, data[i], ref[i]))
+                state["rx"] = rx + len(data)
+                while inflight and inflight[0][0] <= state["rx"]:
+                    times.append(now - inflight.popleft()[1])
+                cond.notify()
+    finally:
+        with cond:
+            state["stop"] = True
+            cond.notify()
+        thread.join()
+    if state["error"] is not None:
+        raise state["error"]
+    elapsed = time.monotonic() - t0
+    p50, p99, pmax = percentiles(times)
+    print("loop %.1fs: %.3f MB/s each way (out %d B, in %d B)"
+          % (elapsed, state["rx"] / elapsed / 1e6, state["tx"], state["rx"]))
+    print("round trip (%d B chunks, %d samples) p50 %.0fus p99 %.0fus max %.0fus"
+          % (chunk, len(times), p50, p99, pmax))
+    return state["rx"]
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Vendor bulk (WinUSB/libusb) throughput")
+    ap.add_argument("mode", choices=sorted(MODES))
+    ap.add_argument("-t", "--time", type=float, default=10.0, help="seconds to run")
+    ap.add_argument("--vid", type=lambda s: int(s, 0), default=0xFFFF, help="USBD_VID")
+    ap.add_argument("--pid", type=lambda s: int(s, 0), default=0xFFFF, help="USBD_PID")
+    ap.add_argument("--chunk", type=int, default=1000, help="loop: bytes per timestamped write")
+    ap.add_argument("--window", type=int, default=16000, help="loop: max unechoed bytes")
+    args = ap.parse_args()
+
+    try:
+        vb = VendorBulk(args.vid, args.pid)
+    except (ValueError, usb.core.USBError) as e:
+        sys.exit(str(e))
+
+    try:
+        # echo mode goes quiet once the host stops writing, source would not
+        vb.set_mode("loop")
+        vb.drain()
+        vb.set_mode(args.mode)
+        if args.mode == "source":
+            moved = run_source(vb, args.time)
+        elif args.mode == "sink":
+            moved = run_sink(vb, args.time)
+        else:
+            moved = run_loop(vb, args.time, args.chunk, args.window)
+    except (ValueError, usb.core.USBError) as e:
+        sys.exit(str(e))
+    finally:
+        vb.close()
+
+    if moved == 0:
+        sys.exit("no data")
+
+
+if __name__ == "__main__":
+    main()